@@ -0,0 +1,119 @@
+/* Copyright (c) 2023 Sam Blenny
+ * SPDX-License-Identifier: CC-BY-NC-SA-4.0
+ *
+ * Keyframe animation for sprites: clips packed into one frame table, and
+ * playback state for many sprites at once with structure-of-arrays layout.
+ *
+ * Each frame, one pass over all the slots advances their play time and
+ * looks up their frames. The pass has no per-sprite logic beyond wrapping
+ * at the end of a clip, so thousands of sprites cost about as much as a
+ * memory copy.
+ */
+#ifndef MKB_ANIM_C
+#define MKB_ANIM_C
+
+#include "mkb_engine.h"
+#include "anim.h"
+
+
+/**************************/
+/* Non-exported Functions */
+/**************************/
+
+/* Forget all clips */
+static void animClipsClear(anim_clips_t * clips) {
+    u32 i;
+    clips->used = 0;
+    for(i = 0; i < ANIM_CLIPS_MAX; i++) {
+        clips->start[i] = 0;
+        clips->last[i] = 0;
+        clips->wrap[i] = ANIM_NO_WRAP;
+    }
+}
+
+/* Define clip id from n keyframes: frame[i] shows for ticks[i] ticks. Flags
+ * can include ANIM_LOOP. Defining an id again uses new room in the table,
+ * so clear the clips to start over.
+ * Returns: 1 = Success, 0 = bad id, zero length, or not enough room
+ */
+static u32 animClip(anim_clips_t * clips, u32 id, const u16 * frame,
+    const u16 * ticks, u32 n, u32 flags) {
+    u32 len = 0;
+    u32 i;
+    u32 t;
+    for(i = 0; i < n; i++) {
+        len += ticks[i];
+    }
+    if(id >= ANIM_CLIPS_MAX || len == 0
+        || len > ANIM_TABLE_MAX - clips->used) {
+        return 0;
+    }
+    u16 * dst = &clips->table[clips->used];
+    for(i = 0; i < n; i++) {
+        for(t = 0; t < ticks[i]; t++) {
+            *dst++ = frame[i];
+        }
+    }
+    clips->start[id] = clips->used;
+    clips->last[id] = (len << ANIM_TIME_SHIFT) - 1;
+    clips->wrap[id] = (flags & ANIM_LOOP) ? len << ANIM_TIME_SHIFT
+        : ANIM_NO_WRAP;
+    clips->used += len;
+    return 1;
+}
+
+/* Set the number of slots in use. New slots play clip 0 from the start at */
+/* normal speed, with a base of 0.                                         */
+static void animResize(anim_set_t * set, u32 count) {
+    u32 i;
+    count = count < ANIM_MAX ? count : ANIM_MAX;
+    for(i = set->count; i < count; i++) {
+        set->clip[i] = 0;
+        set->base[i] = 0;
+        set->time[i] = 0;
+        set->speed[i] = ANIM_SPEED_UNITY;
+    }
+    set->count = count;
+}
+
+/* Play clip in a slot at a speed. If the slot is already playing that clip, */
+/* it keeps its place, so calling this every frame doesn't restart it.      */
+static void animPlay(anim_set_t * set, u32 slot, u32 clip, u32 speed) {
+    if(slot >= set->count || clip >= ANIM_CLIPS_MAX) {
+        return;
+    }
+    if(set->clip[slot] != clip) {
+        set->clip[slot] = clip;
+        set->time[slot] = 0;
+    }
+    set->speed[slot] = speed;
+}
+
+/* Advance slots begin to end - 1 by ticks, then write each one's current
+ * frame to out. Looping clips wrap around, and others hold their last frame.
+ * Slots are independent, so separate ranges can run on different threads.
+ */
+static void animEval(anim_set_t * set, const anim_clips_t * clips, u32 ticks,
+    u16 * out, u32 begin, u32 end) {
+    const u32 n = end < set->count ? end : set->count;
+    u32 i;
+    for(i = begin; i < n; i++) {
+        const u32 c = set->clip[i];
+        const u32 last = clips->last[c];
+        const u32 wrap = clips->wrap[c];
+        u32 t = set->time[i] + set->speed[i] * ticks;
+        if(t >= wrap) {
+            /* Only once per loop, since clips that don't loop never wrap */
+            t %= wrap;
+        }
+        /* Clips that don't loop hold their last frame. This compiles to */
+        /* a conditional move, which matters since a mix of clips would  */
+        /* mispredict a branch here about half the time.                 */
+        t = t < last ? t : last;
+        set->time[i] = t;
+        out[i] = set->base[i] + clips->table[clips->start[c]
+            + (t >> ANIM_TIME_SHIFT)];
+    }
+}
+
+#endif /* MKB_ANIM_C */
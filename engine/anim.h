@@ -0,0 +1,83 @@
+/* Copyright (c) 2023 Sam Blenny
+ * SPDX-License-Identifier: CC-BY-NC-SA-4.0
+ *
+ * Keyframe animation for sprites: clips packed into one frame table, and
+ * playback state for many sprites at once with structure-of-arrays layout.
+ */
+#ifndef MKB_ANIM_H
+#define MKB_ANIM_H
+
+/* Number of sprites that can play animations */
+#ifndef ANIM_MAX
+#define ANIM_MAX (8192)
+#endif
+
+/* Number of clips, and room for their frames (one entry per tick) */
+#define ANIM_CLIPS_MAX (64)
+#ifndef ANIM_TABLE_MAX
+#define ANIM_TABLE_MAX (4096)
+#endif
+
+/* Play time is fixed point ticks with this many fraction bits, and speed */
+/* is fixed point ticks per tick: ANIM_SPEED_UNITY plays at normal speed  */
+#define ANIM_TIME_SHIFT  (8)
+#define ANIM_SPEED_UNITY (1 << ANIM_TIME_SHIFT)
+
+/* Clip flags */
+#define ANIM_LOOP (1  /* Start over at the end, rather than holding */)
+
+/* Wrap point of clips that don't loop, which play time never reaches */
+#define ANIM_NO_WRAP (0xffffffff)
+
+/* Clips. Each clip's keyframes get expanded into one frame per tick of
+ * table, so finding a sprite's current frame is a lookup rather than a
+ * search through keyframes.
+ */
+typedef struct anim_clips {
+    u32 used;                      /* Entries of table used so far         */
+    u32 start[ANIM_CLIPS_MAX];     /* First table entry of each clip       */
+    u32 last[ANIM_CLIPS_MAX];      /* Last fixed point time in the clip    */
+    u32 wrap[ANIM_CLIPS_MAX];      /* Length in fixed point ticks if the   */
+                                   /* clip loops, otherwise ANIM_NO_WRAP   */
+    u16 table[ANIM_TABLE_MAX];     /* Frame number for each tick           */
+} anim_clips_t;
+
+/* Playback state as parallel arrays, one slot per sprite. A sprite's frame
+ * is its base plus the clip's frame number, so sprites with different
+ * sprite sheets can share clips.
+ */
+typedef struct anim_set {
+    u32 count;
+    u16 clip[ANIM_MAX];
+    u16 base[ANIM_MAX];      /* Added to the clip's frame numbers      */
+    u32 time[ANIM_MAX];      /* Fixed point ticks since the clip began */
+    u32 speed[ANIM_MAX];     /* Fixed point ticks per tick             */
+} anim_set_t;
+
+/* Forget all clips */
+static void animClipsClear(anim_clips_t * clips);
+
+/* Define clip id from n keyframes: frame[i] shows for ticks[i] ticks. Flags
+ * can include ANIM_LOOP. Defining an id again uses new room in the table,
+ * so clear the clips to start over.
+ * Returns: 1 = Success, 0 = bad id, zero length, or not enough room
+ */
+static u32 animClip(anim_clips_t * clips, u32 id, const u16 * frame,
+    const u16 * ticks, u32 n, u32 flags);
+
+/* Set the number of slots in use. New slots play clip 0 from the start at */
+/* normal speed, with a base of 0.                                         */
+static void animResize(anim_set_t * set, u32 count);
+
+/* Play clip in a slot at a speed. If the slot is already playing that clip, */
+/* it keeps its place, so calling this every frame doesn't restart it.      */
+static void animPlay(anim_set_t * set, u32 slot, u32 clip, u32 speed);
+
+/* Advance slots begin to end - 1 by ticks, then write each one's current
+ * frame to out. Looping clips wrap around, and others hold their last frame.
+ * Slots are independent, so separate ranges can run on different threads.
+ */
+static void animEval(anim_set_t * set, const anim_clips_t * clips, u32 ticks,
+    u16 * out, u32 begin, u32 end);
+
+#endif /* MKB_ANIM_H */
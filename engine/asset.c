@@ -0,0 +1,316 @@
+/* Copyright (c) 2023 Sam Blenny
+ * SPDX-License-Identifier: CC-BY-NC-SA-4.0
+ *
+ * Asset containers: tiles, maps, fonts, and audio packed into one blob with
+ * an index table, with LZ compressed assets that get decoded a chunk at a
+ * time into a pool of buffers.
+ *
+ * The compression is a byte oriented LZ77, like LZ4, which decodes with
+ * nothing but copies and a few bounds checks. That gives up some ratio
+ * compared to entropy coding, but decoding a chunk costs about as much as
+ * copying it a few times, so assets can stay compressed in memory and get
+ * decoded when they're needed, rather than all at load time.
+ */
+#ifndef MKB_ASSET_C
+#define MKB_ASSET_C
+
+#include "mkb_engine.h"
+#include "asset.h"
+
+
+/**************************/
+/* Non-exported Functions */
+/**************************/
+
+/* Read little-endian u16 from buffer BUF at index I */
+#define _asset_u16(BUF, I) ((u32)(BUF)[(I)] | ((u32)(BUF)[(I) + 1] << 8))
+
+/* Read little-endian u32 from buffer BUF at index I */
+#define _asset_u32(BUF, I) (_asset_u16(BUF, I) | \
+                            (_asset_u16(BUF, (I) + 2) << 16))
+
+/* Returns: offset of asset id's index table entry in the blob */
+static u32 assetEntry(u32 id) {
+    return ASSET_HEADER_LEN + id * ASSET_ENTRY_LEN;
+}
+
+/* Returns: number of chunks in an asset of length bytes */
+static u32 assetChunks(u32 length) {
+    return length / ASSET_CHUNK + (length % ASSET_CHUNK != 0);
+}
+
+/* Add the length bytes that follow a 4 bit length of 15 to n, advancing */
+/* *ip past them. Lengths over max are malformed, so this stops early.  */
+/* Returns: the length, or more than max if it's malformed               */
+static u32 lzLength(const u8 * src, u32 src_len, u32 * ip, u32 n, u32 max) {
+    u32 i = *ip;
+    u32 b = 255;
+    while(b == 255 && n <= max) {
+        if(i >= src_len) {
+            return max + 1;
+        }
+        b = src[i++];
+        n += b;
+    }
+    *ip = i;
+    return n;
+}
+
+/* Smallest multiple of each match distance under 8 that's at least 8 */
+static const u8 LZ_STEP[8] = {0, 8, 8, 9, 8, 10, 12, 14};
+
+/* Copy 8 bytes, which compilers can turn into one load and store */
+static void lzCopy8(u8 * dst, const u8 * src) {
+    u32 i;
+    for(i = 0; i < 8; i++) {
+        dst[i] = src[i];
+    }
+}
+
+/* Decode one LZ compressed chunk of src_len bytes into dst, which has room */
+/* for dst_len bytes                                                       */
+/* Returns: bytes written, or 0 if src is malformed or doesn't fit         */
+static u32 lzDecode(const u8 * src, u32 src_len, u8 * dst, u32 dst_len) {
+    u32 ip = 0;
+    u32 op = 0;
+    u32 i;
+    while(ip < src_len) {
+        const u32 token = src[ip++];
+        u32 n = token >> 4;
+        if(n == 15) {
+            n = lzLength(src, src_len, &ip, n, dst_len);
+        }
+        if(n > src_len - ip || n > dst_len - op) {
+            return 0;
+        }
+        /* Literals, 8 bytes at a time while there's room to overshoot */
+        const u8 * lit = &src[ip];
+        u8 * out = &dst[op];
+        i = 0;
+        if(src_len - ip >= n + 8 && dst_len - op >= n + 8) {
+            for(; i < n; i += 8) {
+                lzCopy8(&out[i], &lit[i]);
+            }
+        }
+        for(; i < n; i++) {
+            out[i] = lit[i];
+        }
+        ip += n;
+        op += n;
+        if(ip == src_len) {
+            break;  /* The last sequence has no match */
+        }
+        /* Match */
+        if(src_len - ip < 2) {
+            return 0;
+        }
+        const u32 dist = _asset_u16(src, ip);
+        ip += 2;
+        n = token & 15;
+        if(n == 15) {
+            n = lzLength(src, src_len, &ip, n, dst_len);
+        }
+        n += ASSET_MIN_MATCH;
+        if(dist == 0 || dist > op || n > dst_len - op) {
+            return 0;
+        }
+        /* When the match overlaps its output, copying in order repeats */
+        /* the last dist bytes. Past the first pattern, copying from any */
+        /* whole number of patterns back gives the same bytes, so short  */
+        /* distances can still copy 8 at a time from 8 or more back.     */
+        out = &dst[op];
+        const u8 * from = out - dist;
+        i = 0;
+        if(dst_len - op >= n + 8) {
+            u32 step = dist;
+            if(dist < 8) {
+                step = LZ_STEP[dist];
+                for(; i < step && i < n; i++) {
+                    out[i] = from[i];
+                }
+            }
+            const u8 * back = out - step;
+            for(; i < n; i += 8) {
+                lzCopy8(&out[i], &back[i]);
+            }
+        }
+        for(; i < n; i++) {
+            out[i] = from[i];
+        }
+        op += n;
+    }
+    return op;
+}
+
+/* Check the chunk table of compressed asset data at offset, size bytes */
+/* long, for an asset of length bytes.                                 */
+/* Returns: 1 = Success, 0 = table is malformed                        */
+static u32 assetCheckChunks(const u8 * blob, u32 offset, u32 size,
+    u32 length) {
+    const u32 chunks = assetChunks(length);
+    u32 i;
+    if(chunks == 0 || chunks >= size / 4) {
+        return 0;
+    }
+    u32 prev = _asset_u32(blob, offset);
+    if(prev != (chunks + 1) * 4) {
+        return 0;
+    }
+    for(i = 1; i <= chunks; i++) {
+        const u32 next = _asset_u32(blob, offset + i * 4);
+        if(next <= prev || next > size) {
+            return 0;
+        }
+        prev = next;
+    }
+    return 1;
+}
+
+/* Load a container. The blob must stay valid while the container is in */
+/* use. This checks the whole index and every chunk table, so later     */
+/* reads only need to check the chunk data itself.                      */
+/* Returns: 1 = Success, 0 = blob is malformed                          */
+static u32 assetOpen(asset_pack_t * pack, const u8 * blob, u32 blob_len) {
+    if(blob_len < ASSET_HEADER_LEN || blob[0] != 'M' || blob[1] != 'K'
+        || blob[2] != 'A' || blob[3] != 'C') {
+        return 0;
+    }
+    const u32 count = _asset_u32(blob, 4);
+    if(count > (blob_len - ASSET_HEADER_LEN) / ASSET_ENTRY_LEN) {
+        return 0;
+    }
+    const u32 data = assetEntry(count);
+    u32 id;
+    for(id = 0; id < count; id++) {
+        const u32 e = assetEntry(id);
+        const u32 flags = _asset_u16(blob, e + ASSET_FLAGS);
+        const u32 offset = _asset_u32(blob, e + ASSET_OFFSET);
+        const u32 size = _asset_u32(blob, e + ASSET_SIZE);
+        const u32 length = _asset_u32(blob, e + ASSET_LENGTH);
+        if(offset % ASSET_ALIGN != 0 || offset < data || offset > blob_len
+            || size > blob_len - offset) {
+            return 0;
+        }
+        if(flags & ASSET_LZ) {
+            if(!assetCheckChunks(blob, offset, size, length)) {
+                return 0;
+            }
+        } else if(size != length) {
+            return 0;
+        }
+    }
+    pack->blob = blob;
+    pack->blobLen = blob_len;
+    pack->count = count;
+    return 1;
+}
+
+/* Returns: type of asset id, or 0 if there's no such asset */
+static u32 assetType(const asset_pack_t * pack, u32 id) {
+    if(id >= pack->count) {
+        return 0;
+    }
+    return _asset_u16(pack->blob, assetEntry(id) + ASSET_TYPE);
+}
+
+/* Returns: decompressed length of asset id, or 0 if there's no such asset */
+static u32 assetLength(const asset_pack_t * pack, u32 id) {
+    if(id >= pack->count) {
+        return 0;
+    }
+    return _asset_u32(pack->blob, assetEntry(id) + ASSET_LENGTH);
+}
+
+/* Empty the pool */
+static void assetPoolClear(asset_pool_t * pool) {
+    u32 i;
+    pool->clock = 0;
+    pool->decodes = 0;
+    for(i = 0; i < ASSET_POOL_SLOTS; i++) {
+        pool->slotAsset[i] = -1;
+        pool->slotChunk[i] = 0;
+        pool->slotUsed[i] = 0;
+        pool->slotLen[i] = 0;
+    }
+}
+
+/* Get chunk n of asset id, decoding it into the pool if it isn't there   */
+/* already. Assets that aren't compressed come straight from the blob.   */
+/* Returns: the chunk's data, with its length in len, or 0 if there's no  */
+/* such chunk or it's malformed                                           */
+static const u8 * assetChunk(const asset_pack_t * pack, asset_pool_t * pool,
+    u32 id, u32 n, u32 * len) {
+    if(id >= pack->count) {
+        return 0;
+    }
+    const u8 * blob = pack->blob;
+    const u32 e = assetEntry(id);
+    const u32 offset = _asset_u32(blob, e + ASSET_OFFSET);
+    const u32 length = _asset_u32(blob, e + ASSET_LENGTH);
+    if(n >= assetChunks(length)) {
+        return 0;
+    }
+    const u32 want = length - n * ASSET_CHUNK < ASSET_CHUNK
+        ? length - n * ASSET_CHUNK : ASSET_CHUNK;
+    if(!(_asset_u16(blob, e + ASSET_FLAGS) & ASSET_LZ)) {
+        *len = want;
+        return &blob[offset + n * ASSET_CHUNK];
+    }
+    u32 lru = 0;
+    u32 i;
+    pool->clock += 1;
+    for(i = 0; i < ASSET_POOL_SLOTS; i++) {
+        if(pool->slotAsset[i] == (i32)id && pool->slotChunk[i] == n) {
+            pool->slotUsed[i] = pool->clock;
+            *len = pool->slotLen[i];
+            return pool->slotData[i];
+        }
+        if(pool->slotUsed[i] < pool->slotUsed[lru]) {
+            lru = i;
+        }
+    }
+    /* assetOpen() checked the chunk table, so these offsets are in bounds */
+    const u32 start = _asset_u32(blob, offset + n * 4);
+    const u32 end = _asset_u32(blob, offset + n * 4 + 4);
+    const u32 got = lzDecode(&blob[offset + start], end - start,
+        pool->slotData[lru], want);
+    pool->decodes += 1;
+    if(got != want) {
+        pool->slotAsset[lru] = -1;
+        pool->slotUsed[lru] = 0;
+        return 0;
+    }
+    pool->slotAsset[lru] = id;
+    pool->slotChunk[lru] = n;
+    pool->slotUsed[lru] = pool->clock;
+    pool->slotLen[lru] = got;
+    *len = got;
+    return pool->slotData[lru];
+}
+
+/* Copy up to n bytes of asset id starting at offset into dst, decoding   */
+/* chunks as needed                                                        */
+/* Returns: bytes copied, which is short at the end of the asset or at a  */
+/* malformed chunk                                                         */
+static u32 assetRead(const asset_pack_t * pack, asset_pool_t * pool, u32 id,
+    u32 offset, u8 * dst, u32 n) {
+    u32 copied = 0;
+    while(copied < n) {
+        const u32 pos = offset + copied;
+        const u32 within = pos % ASSET_CHUNK;
+        u32 len = 0;
+        const u8 * src = assetChunk(pack, pool, id, pos / ASSET_CHUNK, &len);
+        if(src == 0 || within >= len) {
+            break;
+        }
+        const u32 take = len - within < n - copied ? len - within : n - copied;
+        u32 i;
+        for(i = 0; i < take; i++) {
+            dst[copied + i] = src[within + i];
+        }
+        copied += take;
+    }
+    return copied;
+}
+
+#endif /* MKB_ASSET_C */
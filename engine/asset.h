@@ -0,0 +1,122 @@
+/* Copyright (c) 2023 Sam Blenny
+ * SPDX-License-Identifier: CC-BY-NC-SA-4.0
+ *
+ * Asset containers: tiles, maps, fonts, and audio packed into one blob with
+ * an index table, with LZ compressed assets that get decoded a chunk at a
+ * time into a pool of buffers.
+ */
+#ifndef MKB_ASSET_H
+#define MKB_ASSET_H
+
+/*
+ * Container layout (all integers are little-endian):
+ *   offset 0: 'M' 'K' 'A' 'C'    magic number
+ *   offset 4: u32                number of assets
+ *   offset 8: entry[count]       index table, ASSET_ENTRY_LEN bytes each:
+ *               u16 type         ASSET_TILES, ASSET_MAP, ...
+ *               u16 flags        ASSET_LZ if the asset is compressed
+ *               u32 offset       where the asset's data starts, from the
+ *                                start of the container (a multiple of
+ *                                ASSET_ALIGN)
+ *               u32 size         bytes of data in the container
+ *               u32 length       bytes of data once decompressed
+ *   then:     each asset's data, padded to ASSET_ALIGN
+ *
+ * Containers should be loaded at an address that's a multiple of
+ * ASSET_ALIGN, so assets that aren't compressed can be used in place.
+ *
+ * Compressed assets get split into chunks of ASSET_CHUNK bytes (the last
+ * may be short) that get compressed separately, so any chunk can be decoded
+ * without the ones before it. The data starts with a u32 offset for each
+ * chunk, plus one for the end of the last chunk, from the start of the
+ * asset's data. Each chunk is a series of sequences:
+ *   u8 token       literal count in the high 4 bits, and match length
+ *                  minus ASSET_MIN_MATCH in the low 4 bits. A value of 15
+ *                  continues with bytes that get added to it, up to and
+ *                  including the first byte that isn't 255.
+ *   literals       bytes to copy to the output
+ *   u16 distance   how far back in the output the match starts (1 or
+ *                  more). Matches can overlap their own output, so a
+ *                  distance of 1 repeats the last byte.
+ * The last sequence has no match. It ends at the end of the chunk.
+ */
+#define ASSET_HEADER_LEN (8)
+#define ASSET_ENTRY_LEN  (16)
+#define ASSET_ALIGN      (16)
+#define ASSET_CHUNK      (1 << 15)
+#define ASSET_MIN_MATCH  (4)
+
+/* Offsets of the fields of an index table entry */
+#define ASSET_TYPE   (0)
+#define ASSET_FLAGS  (2)
+#define ASSET_OFFSET (4)
+#define ASSET_SIZE   (8)
+#define ASSET_LENGTH (12)
+
+/* Asset types */
+#define ASSET_TILES (1)
+#define ASSET_MAP   (2)
+#define ASSET_FONT  (3)
+#define ASSET_AUDIO (4)
+
+/* Asset flags */
+#define ASSET_LZ (1  /* Data is LZ compressed chunks */)
+
+/* Number of decoded chunks to keep in the pool */
+#ifndef ASSET_POOL_SLOTS
+#define ASSET_POOL_SLOTS (8)
+#endif
+
+/* Loaded container */
+typedef struct asset_pack {
+    const u8 * blob;
+    u32 blobLen;
+    u32 count;
+} asset_pack_t;
+
+/* Pool of buffers for decoded chunks, reused least recently used first */
+typedef struct asset_pool {
+    u32 clock;                       /* Use counter for LRU eviction    */
+    u32 decodes;                     /* Chunks decoded so far           */
+    i32 slotAsset[ASSET_POOL_SLOTS]; /* Asset id per slot, or -1        */
+    u32 slotChunk[ASSET_POOL_SLOTS]; /* Chunk number per slot           */
+    u32 slotUsed[ASSET_POOL_SLOTS];  /* Clock value at last use         */
+    u32 slotLen[ASSET_POOL_SLOTS];   /* Bytes of data in the slot       */
+    u8 slotData[ASSET_POOL_SLOTS][ASSET_CHUNK];
+} asset_pool_t;
+
+/* Decode one LZ compressed chunk of src_len bytes into dst, which has room */
+/* for dst_len bytes                                                       */
+/* Returns: bytes written, or 0 if src is malformed or doesn't fit         */
+static u32 lzDecode(const u8 * src, u32 src_len, u8 * dst, u32 dst_len);
+
+/* Load a container. The blob must stay valid while the container is in */
+/* use. This checks the whole index and every chunk table, so later     */
+/* reads only need to check the chunk data itself.                      */
+/* Returns: 1 = Success, 0 = blob is malformed                          */
+static u32 assetOpen(asset_pack_t * pack, const u8 * blob, u32 blob_len);
+
+/* Returns: type of asset id, or 0 if there's no such asset */
+static u32 assetType(const asset_pack_t * pack, u32 id);
+
+/* Returns: decompressed length of asset id, or 0 if there's no such asset */
+static u32 assetLength(const asset_pack_t * pack, u32 id);
+
+/* Empty the pool */
+static void assetPoolClear(asset_pool_t * pool);
+
+/* Get chunk n of asset id, decoding it into the pool if it isn't there   */
+/* already. Assets that aren't compressed come straight from the blob.   */
+/* Returns: the chunk's data, with its length in len, or 0 if there's no  */
+/* such chunk or it's malformed                                           */
+static const u8 * assetChunk(const asset_pack_t * pack, asset_pool_t * pool,
+    u32 id, u32 n, u32 * len);
+
+/* Copy up to n bytes of asset id starting at offset into dst, decoding   */
+/* chunks as needed                                                        */
+/* Returns: bytes copied, which is short at the end of the asset or at a  */
+/* malformed chunk                                                         */
+static u32 assetRead(const asset_pack_t * pack, asset_pool_t * pool, u32 id,
+    u32 offset, u8 * dst, u32 n);
+
+#endif /* MKB_ASSET_H */
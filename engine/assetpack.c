@@ -0,0 +1,242 @@
+/* Copyright (c) 2023 Sam Blenny
+ * SPDX-License-Identifier: CC-BY-NC-SA-4.0
+ *
+ * Asset container packing for native tools (see asset.h for the format).
+ * This isn't part of the wasm module, since only the packer, tests, and
+ * benchmark need to compress anything.
+ *
+ * The compressor is greedy: at each byte, it looks up the last place the
+ * next 4 bytes appeared in a hash table, and takes the match if there is
+ * one. That's fast and simple, and decoding speed doesn't depend on how
+ * hard the compressor worked.
+ */
+#ifndef MKB_ASSETPACK_C
+#define MKB_ASSETPACK_C
+
+#include "mkb_engine.h"
+#include "asset.h"
+#include "assetpack.h"
+
+
+/**************************/
+/* Non-exported Functions */
+/**************************/
+
+/* Write little-endian u16 to buffer BUF at index I */
+#define _pack_u16(BUF, I, V) do { \
+    (BUF)[(I)] = (u8)(V); \
+    (BUF)[(I) + 1] = (u8)((V) >> 8); \
+} while(0)
+
+/* Write little-endian u32 to buffer BUF at index I */
+#define _pack_u32(BUF, I, V) do { \
+    _pack_u16(BUF, I, (V)); \
+    _pack_u16(BUF, (I) + 2, (V) >> 16); \
+} while(0)
+
+/* Returns: hash table slot for the 4 bytes at p */
+static u32 lzHash(const u8 * p) {
+    const u32 v = (u32)p[0] | ((u32)p[1] << 8) | ((u32)p[2] << 16)
+        | ((u32)p[3] << 24);
+    return (v * 2654435761u) >> (32 - LZ_HASH_BITS);
+}
+
+/* Write the length bytes that follow a 4 bit length of 15, for a length */
+/* of n (15 or more)                                                     */
+/* Returns: 1 = Success, 0 = dst is full                                 */
+static u32 lzPutLength(u8 * dst, u32 * op, u32 cap, u32 n) {
+    u32 o = *op;
+    for(n -= 15; ; n -= 255) {
+        if(o >= cap) {
+            return 0;
+        }
+        dst[o++] = n < 255 ? n : 255;
+        if(n < 255) {
+            break;
+        }
+    }
+    *op = o;
+    return 1;
+}
+
+/* Write a sequence: lit_n literals from lit, then a match of match_n bytes */
+/* at dist (or no match, if match_n is 0)                                  */
+/* Returns: 1 = Success, 0 = dst is full                                   */
+static u32 lzPutSequence(u8 * dst, u32 * op, u32 cap, const u8 * lit,
+    u32 lit_n, u32 dist, u32 match_n) {
+    const u32 m = match_n ? match_n - ASSET_MIN_MATCH : 0;
+    u32 o = *op;
+    u32 i;
+    if(o >= cap) {
+        return 0;
+    }
+    dst[o++] = ((lit_n < 15 ? lit_n : 15) << 4) | (m < 15 ? m : 15);
+    if(lit_n >= 15 && !lzPutLength(dst, &o, cap, lit_n)) {
+        return 0;
+    }
+    if(lit_n > cap - o) {
+        return 0;
+    }
+    for(i = 0; i < lit_n; i++) {
+        dst[o++] = lit[i];
+    }
+    if(match_n) {
+        if(cap - o < 2) {
+            return 0;
+        }
+        _pack_u16(dst, o, dist);
+        o += 2;
+        if(m >= 15 && !lzPutLength(dst, &o, cap, m)) {
+            return 0;
+        }
+    }
+    *op = o;
+    return 1;
+}
+
+/* Compress n bytes of src (up to ASSET_CHUNK) into dst, which has room */
+/* for cap bytes                                                        */
+/* Returns: compressed size, or 0 if it doesn't fit                     */
+static u32 lzEncode(const u8 * src, u32 n, u8 * dst, u32 cap) {
+    /* Position + 1 of the last time each hash came up, or 0 for never */
+    u32 head[1 << LZ_HASH_BITS];
+    u32 ip = 0;
+    u32 anchor = 0;
+    u32 op = 0;
+    u32 i;
+    if(n > ASSET_CHUNK) {
+        return 0;
+    }
+    for(i = 0; i < (1 << LZ_HASH_BITS); i++) {
+        head[i] = 0;
+    }
+    while(ip + ASSET_MIN_MATCH <= n) {
+        const u32 h = lzHash(&src[ip]);
+        const u32 cand = head[h];
+        head[h] = ip + 1;
+        if(cand == 0 || src[cand - 1] != src[ip]
+            || src[cand] != src[ip + 1] || src[cand + 1] != src[ip + 2]
+            || src[cand + 2] != src[ip + 3]) {
+            ip += 1;
+            continue;
+        }
+        /* Chunks are smaller than the largest distance, so any match */
+        /* in the table is in range                                    */
+        const u32 from = cand - 1;
+        u32 len = ASSET_MIN_MATCH;
+        while(ip + len < n && src[from + len] == src[ip + len]) {
+            len += 1;
+        }
+        if(!lzPutSequence(dst, &op, cap, &src[anchor], ip - anchor,
+            ip - from, len)) {
+            return 0;
+        }
+        /* Hash the positions inside the match too, so later matches can */
+        /* start there                                                   */
+        for(i = ip + 1; i < ip + len && i + ASSET_MIN_MATCH <= n; i++) {
+            head[lzHash(&src[i])] = i + 1;
+        }
+        ip += len;
+        anchor = ip;
+    }
+    if(!lzPutSequence(dst, &op, cap, &src[anchor], n - anchor, 0, 0)) {
+        return 0;
+    }
+    return op;
+}
+
+/* Start a container in out, with room in the index for max assets */
+/* Returns: 1 = Success, 0 = out is too small                      */
+static u32 assetBuildBegin(asset_builder_t * b, u8 * out, u32 cap, u32 max) {
+    const u32 len = ASSET_HEADER_LEN + max * ASSET_ENTRY_LEN;
+    u32 i;
+    if(len > cap) {
+        return 0;
+    }
+    for(i = 0; i < len; i++) {
+        out[i] = 0;
+    }
+    out[0] = 'M';
+    out[1] = 'K';
+    out[2] = 'A';
+    out[3] = 'C';
+    b->out = out;
+    b->cap = cap;
+    b->len = len;
+    b->count = 0;
+    b->max = max;
+    return 1;
+}
+
+/* Compress n bytes of data into the container at offset, as a chunk    */
+/* table and chunks.                                                     */
+/* Returns: bytes written, or 0 if that's no smaller than n or won't fit */
+static u32 assetBuildChunks(asset_builder_t * b, u32 offset, const u8 * data,
+    u32 n) {
+    const u32 chunks = n / ASSET_CHUNK + (n % ASSET_CHUNK != 0);
+    const u32 limit = b->cap - offset < n ? b->cap - offset : n;
+    u32 size = (chunks + 1) * 4;
+    u32 i;
+    if(chunks == 0 || size >= limit) {
+        return 0;
+    }
+    u8 * out = &b->out[offset];
+    for(i = 0; i < chunks; i++) {
+        const u32 start = i * ASSET_CHUNK;
+        const u32 len = n - start < ASSET_CHUNK ? n - start : ASSET_CHUNK;
+        const u32 packed = lzEncode(&data[start], len, &out[size],
+            limit - size);
+        if(packed == 0) {
+            return 0;
+        }
+        _pack_u32(out, i * 4, size);
+        size += packed;
+    }
+    _pack_u32(out, chunks * 4, size);
+    return size < n ? size : 0;
+}
+
+/* Add n bytes of data as an asset of a type. If compress is set, the     */
+/* asset gets compressed, unless that wouldn't make it any smaller.       */
+/* Returns: the asset's id, or -1 if the index or the buffer is full      */
+static i32 assetBuildAdd(asset_builder_t * b, u32 type, const u8 * data,
+    u32 n, u32 compress) {
+    const u32 offset = (b->len + ASSET_ALIGN - 1) & ~(ASSET_ALIGN - 1);
+    u32 i;
+    if(b->count >= b->max || offset > b->cap) {
+        return -1;
+    }
+    for(i = b->len; i < offset; i++) {
+        b->out[i] = 0;
+    }
+    u32 flags = ASSET_LZ;
+    u32 size = compress ? assetBuildChunks(b, offset, data, n) : 0;
+    if(size == 0) {
+        if(n > b->cap - offset) {
+            return -1;
+        }
+        for(i = 0; i < n; i++) {
+            b->out[offset + i] = data[i];
+        }
+        flags = 0;
+        size = n;
+    }
+    const u32 e = ASSET_HEADER_LEN + b->count * ASSET_ENTRY_LEN;
+    _pack_u16(b->out, e + ASSET_TYPE, type);
+    _pack_u16(b->out, e + ASSET_FLAGS, flags);
+    _pack_u32(b->out, e + ASSET_OFFSET, offset);
+    _pack_u32(b->out, e + ASSET_SIZE, size);
+    _pack_u32(b->out, e + ASSET_LENGTH, n);
+    b->len = offset + size;
+    b->count += 1;
+    return b->count - 1;
+}
+
+/* Finish the container.              */
+/* Returns: its length in bytes       */
+static u32 assetBuildEnd(asset_builder_t * b) {
+    _pack_u32(b->out, 4, b->count);
+    return b->len;
+}
+
+#endif /* MKB_ASSETPACK_C */
@@ -0,0 +1,45 @@
+/* Copyright (c) 2023 Sam Blenny
+ * SPDX-License-Identifier: CC-BY-NC-SA-4.0
+ *
+ * Asset container packing for native tools (see asset.h for the format).
+ * This isn't part of the wasm module, since only the packer, tests, and
+ * benchmark need to compress anything.
+ */
+#ifndef MKB_ASSETPACK_H
+#define MKB_ASSETPACK_H
+
+/* Hash table size for finding matches, as a power of 2 */
+#define LZ_HASH_BITS (14)
+
+/* Most bytes that lzEncode() can need for n bytes of input */
+#define LZ_BOUND(N) ((N) + (N) / 255 + 16)
+
+/* Container being built in a caller's buffer */
+typedef struct asset_builder {
+    u8 * out;
+    u32 cap;       /* Size of out                           */
+    u32 len;       /* Bytes of out used so far              */
+    u32 count;     /* Assets added so far                   */
+    u32 max;       /* Room in the index table               */
+} asset_builder_t;
+
+/* Compress n bytes of src (up to ASSET_CHUNK) into dst, which has room */
+/* for cap bytes                                                        */
+/* Returns: compressed size, or 0 if it doesn't fit                     */
+static u32 lzEncode(const u8 * src, u32 n, u8 * dst, u32 cap);
+
+/* Start a container in out, with room in the index for max assets */
+/* Returns: 1 = Success, 0 = out is too small                      */
+static u32 assetBuildBegin(asset_builder_t * b, u8 * out, u32 cap, u32 max);
+
+/* Add n bytes of data as an asset of a type. If compress is set, the     */
+/* asset gets compressed, unless that wouldn't make it any smaller.       */
+/* Returns: the asset's id, or -1 if the index or the buffer is full      */
+static i32 assetBuildAdd(asset_builder_t * b, u32 type, const u8 * data,
+    u32 n, u32 compress);
+
+/* Finish the container.              */
+/* Returns: its length in bytes       */
+static u32 assetBuildEnd(asset_builder_t * b);
+
+#endif /* MKB_ASSETPACK_H */
@@ -0,0 +1,262 @@
+/* Copyright (c) 2023 Sam Blenny
+ * SPDX-License-Identifier: CC-BY-NC-SA-4.0
+ *
+ * Software audio mixer that renders blocks of stereo samples into a ring for
+ * the front end to play.
+ *
+ * Mixing happens a block at a time into a buffer of i32 sums, one voice
+ * after another, then the sums get clamped to the i16 range and scaled to
+ * f32 samples. Blocks are planar, like AudioWorklet outputs. Voices that play at
+ * their sound's own rate take a fast path that adds samples straight across,
+ * which vectorizes. Other voices resample with linear interpolation. Each
+ * voice's block gets split at the end of its sound or loop, so the inner
+ * loops don't need to check for either.
+ *
+ * Doing this in wasm means the front end only has to copy finished blocks,
+ * with no per-sample work, so audio doesn't depend on javascript garbage
+ * collection pauses.
+ */
+#ifndef MKB_AUDIO_C
+#define MKB_AUDIO_C
+
+#include "mkb_engine.h"
+#include "audio.h"
+
+
+/**************************************/
+/* Exported Symbols: Global Variables */
+/**************************************/
+
+/* Ring of rendered blocks, and its indexes (see audio.h for protocol) */
+__attribute__((visibility("default")))
+f32 AUDIO_RING[AUDIO_RING_BLOCKS * AUDIO_BLOCK * 2];
+__attribute__((visibility("default")))
+u32 AUDIO_HEAD;
+__attribute__((visibility("default")))
+u32 AUDIO_TAIL;
+
+/* Pool of mono i16 samples for sounds. js copies PCM data in here, then */
+/* defines sounds as ranges of it.                                       */
+__attribute__((visibility("default")))
+i16 SOUND_PCM[SOUND_PCM_MAX];
+
+
+/*********************************/
+/* Non-exported Global Variables */
+/*********************************/
+
+/* Output sample rate in Hz, or 0 when audio is off */
+static u32 AUDIO_RATE = 0;
+
+static sound_t SOUNDS[SOUND_MAX];
+static voice_t VOICES[VOICE_MAX];
+
+/* Mix buffer of AUDIO_BLOCK left sums then AUDIO_BLOCK right sums, in */
+/* units of AUDIO_UNITY per sample                                    */
+static i32 AUDIO_MIX[AUDIO_BLOCK * 2];
+
+
+/**************************/
+/* Non-exported Functions */
+/**************************/
+
+/* Set the output sample rate, and stop all voices and forget all sounds.  */
+/* Rate 0 turns audio off. Returns: 1 = Success, 0 = rate is out of range. */
+static u32 audioInit(u32 rate) {
+    u32 i;
+    if(rate != 0 && (rate < AUDIO_RATE_MIN || rate > AUDIO_RATE_MAX)) {
+        return 0;
+    }
+    AUDIO_RATE = rate;
+    AUDIO_HEAD = 0;
+    AUDIO_TAIL = 0;
+    for(i = 0; i < VOICE_MAX; i++) {
+        VOICES[i].active = 0;
+    }
+    /* Sound ratios depend on the output rate, so sounds need defining again */
+    for(i = 0; i < SOUND_MAX; i++) {
+        SOUNDS[i].frames = 0;
+    }
+    return 1;
+}
+
+/* Define sound id as frames samples of SOUND_PCM from start, recorded at  */
+/* rate. Loop points are frame indexes into the sound (0, 0 = no loop).    */
+/* Returns: 1 = Success, 0 = bad id, range, loop points, or rate          */
+static u32 audioSound(u32 id, u32 start, u32 frames, u32 loop_start,
+    u32 loop_end, u32 rate) {
+    if(id >= SOUND_MAX || AUDIO_RATE == 0 || frames == 0
+        || start > SOUND_PCM_MAX || frames > SOUND_PCM_MAX - start
+        || loop_end > frames || loop_start > loop_end
+        || rate < AUDIO_RATE_MIN || rate > AUDIO_RATE_MAX) {
+        return 0;
+    }
+    u32 i;
+    for(i = 0; i < VOICE_MAX; i++) {
+        if(VOICES[i].sound == id) {
+            VOICES[i].active = 0;
+        }
+    }
+    sound_t * s = &SOUNDS[id];
+    s->start = start;
+    s->frames = frames;
+    s->loopStart = loop_start;
+    s->loopEnd = loop_end;
+    s->ratio = (rate << 16) / AUDIO_RATE;
+    return 1;
+}
+
+/* Set the gains and step of voice v */
+static void audioTune(voice_t * v, u32 volume, i32 pan, u32 pitch) {
+    const u32 ratio = SOUNDS[v->sound].ratio;
+    const i32 vol = volume < AUDIO_UNITY ? volume : AUDIO_UNITY;
+    pan = pan < -AUDIO_UNITY ? -AUDIO_UNITY : pan;
+    pan = pan > AUDIO_UNITY ? AUDIO_UNITY : pan;
+    v->gainL = (vol * (AUDIO_UNITY - (pan > 0 ? pan : 0))) / AUDIO_UNITY;
+    v->gainR = (vol * (AUDIO_UNITY + (pan < 0 ? pan : 0))) / AUDIO_UNITY;
+    /* Scale down before multiplying so it fits in 32 bits. AUDIO_RATE_MIN */
+    /* keeps the ratio under 2^20.                                         */
+    pitch = pitch < PITCH_MAX ? pitch : PITCH_MAX;
+    const u32 step = ((pitch >> 8) * ratio) >> 8;
+    v->step = step < 1 ? 1 : (step < PITCH_MAX ? step : PITCH_MAX);
+}
+
+/* Start playing sound id. Volume goes from 0 to AUDIO_UNITY, pan from    */
+/* -AUDIO_UNITY to AUDIO_UNITY, and pitch is 16.16 fixed point.           */
+/* Returns: voice id, or -1 if audio is off or all voices are busy        */
+static i32 audioPlay(u32 id, u32 volume, i32 pan, u32 pitch) {
+    u32 i;
+    if(id >= SOUND_MAX || SOUNDS[id].frames == 0) {
+        return -1;
+    }
+    for(i = 0; i < VOICE_MAX; i++) {
+        voice_t * v = &VOICES[i];
+        if(!v->active) {
+            v->active = 1;
+            v->sound = id;
+            v->pos = 0;
+            v->frac = 0;
+            audioTune(v, volume, pan, pitch);
+            return i;
+        }
+    }
+    return -1;
+}
+
+/* Change the volume, pan, and pitch of a voice that's playing */
+static void audioVoice(u32 v, u32 volume, i32 pan, u32 pitch) {
+    if(v < VOICE_MAX && VOICES[v].active) {
+        audioTune(&VOICES[v], volume, pan, pitch);
+    }
+}
+
+/* Stop a voice */
+static void audioStop(u32 v) {
+    if(v < VOICE_MAX) {
+        VOICES[v].active = 0;
+    }
+}
+
+/* Add one block of voice v to mix, stopping the voice if its sound ends */
+static void audioMixVoice(voice_t * v, i32 * mix) {
+    const sound_t * s = &SOUNDS[v->sound];
+    const i16 * pcm = &SOUND_PCM[s->start];
+    const u32 loops = s->loopEnd > s->loopStart;
+    const u32 end = loops ? s->loopEnd : s->frames;
+    /* Sample that comes after the last one, for interpolating */
+    const i32 after = loops ? pcm[s->loopStart] : 0;
+    const i32 gl = v->gainL;
+    const i32 gr = v->gainR;
+    const u32 step = v->step;
+    u32 done = 0;
+    while(done < AUDIO_BLOCK) {
+        if(v->pos >= end) {
+            if(!loops) {
+                v->active = 0;
+                return;
+            }
+            v->pos = s->loopStart + (v->pos - end) % (end - s->loopStart);
+        }
+        /* Mix up to where the position reaches the end. Only work that out */
+        /* when the end is close, so the shift can't overflow.              */
+        u32 span = AUDIO_BLOCK - done;
+        const u32 left = end - v->pos;
+        if(left <= AUDIO_BLOCK * (PITCH_MAX >> 16)) {
+            const u32 reach = ((left << 16) - v->frac + step - 1) / step;
+            span = reach < span ? reach : span;
+        }
+        i32 * ml = &mix[done];
+        i32 * mr = &mix[AUDIO_BLOCK + done];
+        u32 pos = v->pos;
+        u32 i;
+        if(step == PITCH_UNITY && v->frac == 0) {
+            /* Fast path: one sample per frame */
+            const i16 * src = &pcm[pos];
+            for(i = 0; i < span; i++) {
+                ml[i] += src[i] * gl;
+                mr[i] += src[i] * gr;
+            }
+            v->pos = pos + span;
+        } else {
+            /* Linear interpolation, with 15 bits of the fraction so the */
+            /* product fits in 32 bits                                   */
+            u32 frac = v->frac;
+            for(i = 0; i < span; i++) {
+                const i32 s0 = pcm[pos];
+                const i32 s1 = pos + 1 < end ? pcm[pos + 1] : after;
+                const i32 smp = s0 + (((s1 - s0) * (i32)(frac >> 1)) >> 15);
+                ml[i] += smp * gl;
+                mr[i] += smp * gr;
+                frac += step;
+                pos += frac >> 16;
+                frac &= 0xffff;
+            }
+            v->pos = pos;
+            v->frac = frac;
+        }
+        done += span;
+    }
+}
+
+/* Mix one block of all active voices into out, as AUDIO_BLOCK left */
+/* samples then AUDIO_BLOCK right samples                           */
+static void audioMixBlock(f32 * out) {
+    i32 * mix = AUDIO_MIX;
+    u32 i;
+    for(i = 0; i < AUDIO_BLOCK * 2; i++) {
+        mix[i] = 0;
+    }
+    for(i = 0; i < VOICE_MAX; i++) {
+        if(VOICES[i].active) {
+            audioMixVoice(&VOICES[i], mix);
+        }
+    }
+    /* Scale, clamp, and convert (vectorizable) */
+    for(i = 0; i < AUDIO_BLOCK * 2; i++) {
+        i32 smp = mix[i] / AUDIO_UNITY;
+        smp = smp < -32768 ? -32768 : (smp > 32767 ? 32767 : smp);
+        out[i] = (f32)smp * AUDIO_SCALE;
+    }
+}
+
+/* Render blocks into the ring until it's AUDIO_LEAD_BLOCKS ahead of the */
+/* front end. Returns: number of blocks rendered.                        */
+static u32 audioRender(void) {
+    u32 n = 0;
+    if(AUDIO_RATE == 0) {
+        return 0;
+    }
+    /* If the front end got ahead somehow, start over from its position */
+    if((i32)(AUDIO_HEAD - AUDIO_TAIL) < 0) {
+        AUDIO_HEAD = AUDIO_TAIL;
+    }
+    while(AUDIO_HEAD - AUDIO_TAIL < AUDIO_LEAD_BLOCKS) {
+        const u32 b = AUDIO_HEAD & AUDIO_RING_MASK;
+        audioMixBlock(&AUDIO_RING[b * AUDIO_BLOCK * 2]);
+        AUDIO_HEAD += 1;
+        n += 1;
+    }
+    return n;
+}
+
+#endif /* MKB_AUDIO_C */
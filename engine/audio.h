@@ -0,0 +1,114 @@
+/* Copyright (c) 2023 Sam Blenny
+ * SPDX-License-Identifier: CC-BY-NC-SA-4.0
+ *
+ * Software audio mixer that renders blocks of stereo samples into a ring for
+ * the front end to play.
+ */
+#ifndef MKB_AUDIO_H
+#define MKB_AUDIO_H
+
+/* Frames per block. This matches the AudioWorklet render quantum. */
+#define AUDIO_BLOCK (128)
+
+/* Blocks in the ring. Must be a power of 2. */
+#define AUDIO_RING_BLOCKS (32)
+#define AUDIO_RING_MASK   (AUDIO_RING_BLOCKS - 1)
+
+/* How many blocks to keep rendered ahead of the front end. At 48 kHz, 12  */
+/* blocks is 32 ms, which covers a dropped frame at 60 fps.                */
+#ifndef AUDIO_LEAD_BLOCKS
+#define AUDIO_LEAD_BLOCKS (12)
+#endif
+
+/* Number of sounds, and room for their samples in the PCM pool */
+#define SOUND_MAX     (32)
+#ifndef SOUND_PCM_MAX
+#define SOUND_PCM_MAX (1 << 18)
+#endif
+
+/* Number of voices that can play at once */
+#define VOICE_MAX (32)
+
+/* Full volume, and the pan range (-AUDIO_UNITY = left, 0 = center, */
+/* AUDIO_UNITY = right)                                             */
+#define AUDIO_UNITY (256)
+
+/* Pitch is 16.16 fixed point: PITCH_UNITY plays a sound at its own rate */
+#define PITCH_UNITY (1 << 16)
+#define PITCH_MAX   (16 << 16)
+
+/* Range of sample rates for sounds and for the mixer output */
+#define AUDIO_RATE_MIN (8000)
+#define AUDIO_RATE_MAX (65535)
+
+/* Scale from i16 samples to the -1.0 to 1.0 range of output samples. It's */
+/* a power of 2, so output samples are exact.                              */
+#define AUDIO_SCALE (1.0f / 32768)
+
+/*
+ * Ring protocol:
+ * - AUDIO_RING holds AUDIO_RING_BLOCKS blocks of f32 samples, each block
+ *   AUDIO_BLOCK left samples then AUDIO_BLOCK right samples. That's the
+ *   layout AudioWorklet outputs use, so the front end can copy whole blocks
+ *   without touching each sample.
+ * - AUDIO_HEAD counts blocks rendered, and AUDIO_TAIL counts blocks the
+ *   front end has taken. Block n is at AUDIO_RING[(n & AUDIO_RING_MASK) *
+ *   AUDIO_BLOCK * 2].
+ * - The engine renders until AUDIO_HEAD is AUDIO_LEAD_BLOCKS ahead of
+ *   AUDIO_TAIL. The front end copies blocks from AUDIO_TAIL up to AUDIO_HEAD,
+ *   then sets AUDIO_TAIL to say it's done with them.
+ */
+
+/* A sound: mono i16 samples in SOUND_PCM. If loopEnd > loopStart, the     */
+/* sound repeats frames loopStart up to loopEnd until its voice gets        */
+/* stopped. Otherwise it plays once.                                        */
+typedef struct sound {
+    u32 start;              /* Offset of the first sample in SOUND_PCM */
+    u32 frames;
+    u32 loopStart;
+    u32 loopEnd;
+    u32 ratio;              /* Sound rate / output rate, 16.16         */
+} sound_t;
+
+/* A voice playing a sound. The play position is a frame index plus a */
+/* 16 bit fraction, which advances by step each output frame.         */
+typedef struct voice {
+    u32 active;
+    u32 sound;
+    u32 pos;
+    u32 frac;
+    u32 step;               /* Pitch times sound's ratio, 16.16   */
+    i32 gainL;              /* Channel gains, 0 to AUDIO_UNITY    */
+    i32 gainR;
+} voice_t;
+
+/* Set the output sample rate, and stop all voices and forget all sounds.  */
+/* Rate 0 turns audio off. Returns: 1 = Success, 0 = rate is out of range. */
+static u32 audioInit(u32 rate);
+
+/* Define sound id as frames samples of SOUND_PCM from start, recorded at  */
+/* rate. Loop points are frame indexes into the sound (0, 0 = no loop).    */
+/* Returns: 1 = Success, 0 = bad id, range, loop points, or rate          */
+static u32 audioSound(u32 id, u32 start, u32 frames, u32 loop_start,
+    u32 loop_end, u32 rate);
+
+/* Start playing sound id. Volume goes from 0 to AUDIO_UNITY, pan from    */
+/* -AUDIO_UNITY to AUDIO_UNITY, and pitch is 16.16 fixed point.           */
+/* Returns: voice id, or -1 if audio is off or all voices are busy        */
+static i32 audioPlay(u32 id, u32 volume, i32 pan, u32 pitch);
+
+/* Change the volume, pan, and pitch of a voice that's playing */
+static void audioVoice(u32 v, u32 volume, i32 pan, u32 pitch);
+
+/* Stop a voice */
+static void audioStop(u32 v);
+
+/* Mix one block of all active voices into out, as AUDIO_BLOCK left */
+/* samples then AUDIO_BLOCK right samples                           */
+static void audioMixBlock(f32 * out);
+
+/* Render blocks into the ring until it's AUDIO_LEAD_BLOCKS ahead of the */
+/* front end. Returns: number of blocks rendered.                        */
+static u32 audioRender(void);
+
+#endif /* MKB_AUDIO_H */
@@ -0,0 +1,49 @@
+/* Copyright (c) 2023 Sam Blenny */
+/* SPDX-License-Identifier: CC-BY-NC-SA-4.0 */
+/*
+ * Check that main.js supplies every function a wasm module imports.
+ *
+ * The wasm build links with --allow-undefined, so a call to a function that
+ * nothing defines (like a memset() that clang made out of a loop) turns into
+ * an import instead of a link error. The page would then fail to load with a
+ * LinkError. This lists the module's imports and the keys of the env object
+ * in main.js's importObject, and fails if any import is missing.
+ *
+ * Usage: node check_imports.js www/main.js www/markab-engine.wasm ...
+ */
+"use strict";
+
+const fs = require("fs");
+
+if(process.argv.length < 4) {
+    console.error("Usage: node check_imports.js main.js module.wasm ...");
+    process.exit(2);
+}
+
+/* Pull the names out of main.js's `env: { ... },` block */
+const mainJs = fs.readFileSync(process.argv[2], "utf8");
+const envBlock = mainJs.match(/\benv:\s*\{([\s\S]*?)\n\s*\},/);
+if(envBlock === null) {
+    console.error(process.argv[2] + ": can't find the importObject env block");
+    process.exit(1);
+}
+const supplied = new Set();
+for(const m of envBlock[1].matchAll(/^\s*([A-Za-z_$][\w$]*)\s*:/gm)) {
+    supplied.add(m[1]);
+}
+
+let ok = true;
+for(const file of process.argv.slice(3)) {
+    const mod = new WebAssembly.Module(fs.readFileSync(file));
+    const missing = [];
+    for(const imp of WebAssembly.Module.imports(mod)) {
+        if(imp.module !== "env" || !supplied.has(imp.name)) {
+            missing.push(imp.module + "." + imp.name);
+        }
+    }
+    if(missing.length > 0) {
+        console.error(file + ": main.js doesn't supply " + missing.join(", "));
+        ok = false;
+    }
+}
+process.exit(ok ? 0 : 1);
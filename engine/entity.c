@@ -0,0 +1,166 @@
+/* Copyright (c) 2023 Sam Blenny
+ * SPDX-License-Identifier: CC-BY-NC-SA-4.0
+ *
+ * Entity store with structure-of-arrays layout, plus a uniform grid spatial
+ * hash for finding entities near a point or inside a rectangle.
+ *
+ * The spatial hash gets rebuilt from scratch each frame with a counting sort,
+ * which costs O(entities + buckets) and needs no per-entity allocation.
+ * Cells hash into a fixed number of buckets, so the world can be any size.
+ */
+#ifndef MKB_ENTITY_C
+#define MKB_ENTITY_C
+
+#include "mkb_engine.h"
+#include "entity.h"
+
+
+/**************************/
+/* Non-exported Functions */
+/**************************/
+
+/* Hash spatial cell coordinates to a bucket number using bucket mask M */
+#define _spatial_hash(CX, CY, M) \
+    ((((u32)(CX) * 73856093u) ^ ((u32)(CY) * 19349663u)) & (M))
+
+/* Remove all entities and set the spatial hash bucket count, which must be */
+/* a power of 2 (it gets clamped to the range 1..SPATIAL_BUCKETS_MAX)       */
+static void entityClear(entity_store_t * es, u32 buckets) {
+    buckets = buckets < 1 ? 1 : buckets;
+    buckets = buckets > SPATIAL_BUCKETS_MAX ? SPATIAL_BUCKETS_MAX : buckets;
+    es->count = 0;
+    es->buckets = buckets;
+    u32 i;
+    for(i = 0; i <= buckets; i++) {
+        es->start[i] = 0;
+    }
+}
+
+/* Add an entity. Returns: entity id, or -1 if the store is full */
+static i32 entitySpawn(entity_store_t * es, i32 x, i32 y, i32 vx, i32 vy,
+    u16 tile, u8 flags) {
+    if(es->count >= ENTITY_MAX) {
+        return -1;
+    }
+    const u32 id = es->count;
+    es->x[id] = x;
+    es->y[id] = y;
+    es->vx[id] = vx;
+    es->vy[id] = vy;
+    es->tile[id] = tile;
+    es->flags[id] = flags;
+    es->count += 1;
+    return id;
+}
+
+/* Same as entityIntegrate(), for entities begin to end - 1 only, so      */
+/* separate ranges can run on different threads                          */
+static void entityIntegrateRange(entity_store_t * es, u32 begin, u32 end,
+    i32 w, i32 h) {
+    const u32 n = end < es->count ? end : es->count;
+    const i32 max_x = w - 1;
+    const i32 max_y = h - 1;
+    i32 * x = es->x;
+    i32 * y = es->y;
+    i32 * vx = es->vx;
+    i32 * vy = es->vy;
+    u32 i;
+    /* Keep the loop bodies branch-free so they vectorize */
+    for(i = begin; i < n; i++) {
+        const i32 nx = x[i] + vx[i];
+        const i32 out = (nx < 0) | (nx > max_x);
+        vx[i] = out ? -vx[i] : vx[i];
+        x[i] = nx < 0 ? 0 : (nx > max_x ? max_x : nx);
+    }
+    for(i = begin; i < n; i++) {
+        const i32 ny = y[i] + vy[i];
+        const i32 out = (ny < 0) | (ny > max_y);
+        vy[i] = out ? -vy[i] : vy[i];
+        y[i] = ny < 0 ? 0 : (ny > max_y ? max_y : ny);
+    }
+}
+
+/* Move all entities by their velocity, bouncing off the edges of a world */
+/* that is w by h in fixed point units                                    */
+static void entityIntegrate(entity_store_t * es, i32 w, i32 h) {
+    entityIntegrateRange(es, 0, es->count, w, h);
+}
+
+/* Rebuild the spatial hash from current entity positions */
+static void spatialBuild(entity_store_t * es) {
+    const u32 n = es->count;
+    const u32 buckets = es->buckets;
+    const u32 mask = buckets - 1;
+    u32 * start = es->start;
+    u32 i;
+    /* Pass 1: Hash each entity's cell (vectorizable) */
+    for(i = 0; i < n; i++) {
+        const i32 cx = es->x[i] >> SPATIAL_CELL_SHIFT;
+        const i32 cy = es->y[i] >> SPATIAL_CELL_SHIFT;
+        es->bucket[i] = _spatial_hash(cx, cy, mask);
+    }
+    /* Pass 2: Count entities per bucket, then prefix sum so that start[b] */
+    /* is the end of bucket b's range in sorted                           */
+    for(i = 0; i <= buckets; i++) {
+        start[i] = 0;
+    }
+    for(i = 0; i < n; i++) {
+        start[es->bucket[i]] += 1;
+    }
+    u32 sum = 0;
+    for(i = 0; i < buckets; i++) {
+        sum += start[i];
+        start[i] = sum;
+    }
+    start[buckets] = n;
+    /* Pass 3: Scatter ids into place, counting each bucket's end back down */
+    /* to its start. Going in reverse keeps ids in each bucket in order.    */
+    for(i = n; i > 0; i--) {
+        const u32 b = es->bucket[i - 1];
+        start[b] -= 1;
+        es->sorted[start[b]] = i - 1;
+    }
+}
+
+/* Find active entities with positions inside the rectangle from (x0, y0) to
+ * (x1, y1), inclusive, in fixed point units. Uses the spatial hash as of the
+ * last spatialBuild(). Ids get written to out, up to out_max of them.
+ * Returns: number of entities found (may be more than out_max)
+ */
+static u32 spatialQuery(entity_store_t * es, i32 x0, i32 y0, i32 x1, i32 y1,
+    u32 * out, u32 out_max) {
+    const i32 cx0 = x0 >> SPATIAL_CELL_SHIFT;
+    const i32 cy0 = y0 >> SPATIAL_CELL_SHIFT;
+    const i32 cx1 = x1 >> SPATIAL_CELL_SHIFT;
+    const i32 cy1 = y1 >> SPATIAL_CELL_SHIFT;
+    const u32 mask = es->buckets - 1;
+    u32 found = 0;
+    i32 cx;
+    i32 cy;
+    for(cy = cy0; cy <= cy1; cy++) {
+        for(cx = cx0; cx <= cx1; cx++) {
+            const u32 b = _spatial_hash(cx, cy, mask);
+            u32 k;
+            for(k = es->start[b]; k < es->start[b + 1]; k++) {
+                const u32 id = es->sorted[k];
+                const i32 x = es->x[id];
+                const i32 y = es->y[id];
+                /* Skip entities from other cells that share this bucket, */
+                /* so an entity can't be found twice                      */
+                if((x >> SPATIAL_CELL_SHIFT) != cx
+                    || (y >> SPATIAL_CELL_SHIFT) != cy
+                    || !(es->flags[id] & ENTITY_ACTIVE)
+                    || x < x0 || x > x1 || y < y0 || y > y1) {
+                    continue;
+                }
+                if(found < out_max) {
+                    out[found] = id;
+                }
+                found += 1;
+            }
+        }
+    }
+    return found;
+}
+
+#endif /* MKB_ENTITY_C */
@@ -0,0 +1,80 @@
+/* Copyright (c) 2023 Sam Blenny
+ * SPDX-License-Identifier: CC-BY-NC-SA-4.0
+ *
+ * Entity store with structure-of-arrays layout, plus a uniform grid spatial
+ * hash for finding entities near a point or inside a rectangle.
+ */
+#ifndef MKB_ENTITY_H
+#define MKB_ENTITY_H
+
+/* Capacity of an entity store */
+#ifndef ENTITY_MAX
+#define ENTITY_MAX (4096)
+#endif
+
+/* Entity positions are fixed point with this many bits of sub-tile precision */
+#define ENTITY_SUB_SHIFT (8)
+#define ENTITY_SUB       (1 << ENTITY_SUB_SHIFT)
+
+/* Spatial hash cells are 8 tiles square (in fixed point units) */
+#define SPATIAL_CELL_SHIFT (ENTITY_SUB_SHIFT + 3)
+
+/* Most spatial hash buckets an entity store can use. Must be a power of 2. */
+/* Rebuilding the hash costs time in proportion to the bucket count, so     */
+/* each store picks its own count to suit how many entities it holds.      */
+#ifndef SPATIAL_BUCKETS_MAX
+#define SPATIAL_BUCKETS_MAX (4096)
+#endif
+
+/* Entity flags */
+#define ENTITY_ACTIVE (1  /* Entity can be found by spatial queries */)
+
+/* Entities stored as parallel arrays. Each update pass streams through only
+ * the arrays it needs, which keeps loops simple enough for the compiler to
+ * vectorize. Entity ids are array indexes. To take an entity out of play,
+ * clear its ENTITY_ACTIVE flag so queries skip it.
+ */
+typedef struct entity_store {
+    u32 count;
+    u32 buckets;             /* Spatial hash bucket count (power of 2)   */
+    i32 x[ENTITY_MAX];       /* Position (fixed point world coordinates) */
+    i32 y[ENTITY_MAX];
+    i32 vx[ENTITY_MAX];      /* Velocity (fixed point units per frame)   */
+    i32 vy[ENTITY_MAX];
+    u16 tile[ENTITY_MAX];    /* Sprite tile id                           */
+    u8  flags[ENTITY_MAX];
+    /* Spatial hash, rebuilt by spatialBuild() */
+    u32 bucket[ENTITY_MAX];            /* Bucket of each entity           */
+    u32 start[SPATIAL_BUCKETS_MAX + 1];  /* First index in sorted per bucket */
+    u32 sorted[ENTITY_MAX];            /* Entity ids sorted by bucket      */
+} entity_store_t;
+
+/* Remove all entities and set the spatial hash bucket count, which must be */
+/* a power of 2 (it gets clamped to the range 1..SPATIAL_BUCKETS_MAX)       */
+static void entityClear(entity_store_t * es, u32 buckets);
+
+/* Add an entity. Returns: entity id, or -1 if the store is full */
+static i32 entitySpawn(entity_store_t * es, i32 x, i32 y, i32 vx, i32 vy,
+    u16 tile, u8 flags);
+
+/* Move all entities by their velocity, bouncing off the edges of a world */
+/* that is w by h in fixed point units                                    */
+static void entityIntegrate(entity_store_t * es, i32 w, i32 h);
+
+/* Same as entityIntegrate(), for entities begin to end - 1 only, so      */
+/* separate ranges can run on different threads                          */
+static void entityIntegrateRange(entity_store_t * es, u32 begin, u32 end,
+    i32 w, i32 h);
+
+/* Rebuild the spatial hash from current entity positions */
+static void spatialBuild(entity_store_t * es);
+
+/* Find active entities with positions inside the rectangle from (x0, y0) to
+ * (x1, y1), inclusive, in fixed point units. Uses the spatial hash as of the
+ * last spatialBuild(). Ids get written to out, up to out_max of them.
+ * Returns: number of entities found (may be more than out_max)
+ */
+static u32 spatialQuery(entity_store_t * es, i32 x0, i32 y0, i32 x1, i32 y1,
+    u32 * out, u32 out_max);
+
+#endif /* MKB_ENTITY_H */
@@ -0,0 +1,306 @@
+/* Copyright (c) 2023 Sam Blenny
+ * SPDX-License-Identifier: CC-BY-NC-SA-4.0
+ *
+ * Field of view and lighting with recursive shadowcasting.
+ *
+ * Shadowcasting scans each of the 8 octants around the origin row by row,
+ * moving out from the origin, and tracks the range of slopes that are still
+ * lit. When it finds an opaque tile, it recurses to scan the rest of the
+ * octant with the part of the range before the tile, then carries on with
+ * the part after it. Slopes are kept as fractions of small integers, so the
+ * results are exact and don't depend on floating point.
+ *
+ * Before casting, the opaque bits near the origin get copied into a window
+ * of FOV_SIZE rows of one u32 each. An octant with no opaque bits in range
+ * can't have any shadows, so its visible tiles are just a precomputed mask,
+ * and the cost of a step through open space is a few dozen word operations.
+ * Only octants with walls in them get cast.
+ */
+#ifndef MKB_FOV_C
+#define MKB_FOV_C
+
+#include "mkb_engine.h"
+#include "fov.h"
+
+
+/**************************/
+/* Non-exported Functions */
+/**************************/
+
+/* Octant transforms from (dx, dy), with dy < 0 and -dy <= dx <= 0, to */
+/* window offsets                                                      */
+static const i32 FOV_XX[8] = {1,  0,  0, -1, -1,  0,  0,  1};
+static const i32 FOV_XY[8] = {0,  1, -1,  0,  0, -1,  1,  0};
+static const i32 FOV_YX[8] = {0,  1,  1,  0,  0, -1, -1,  0};
+static const i32 FOV_YY[8] = {1,  0,  0,  1, -1,  0,  0, -1};
+
+/* Test if window offset (dx, dy) is within range of radius. Adding the */
+/* radius to its square gives rounder looking circles.                  */
+static u32 fovInRange(i32 dx, i32 dy, u32 radius) {
+    return (u32)(dx * dx + dy * dy) <= radius * (radius + 1);
+}
+
+/* Scan octant oct from row j outward, setting bits in rows for the tiles
+ * it can see past the opaque tiles in the window. The lit slopes run from
+ * s = sn/sd down to e = en/ed, where the slope of a tile is how far it is
+ * from the octant's axis over how far it is from the origin.
+ */
+static void fovCast(const fov_t * f, u32 * rows, u32 oct, u32 radius,
+    i32 j, i32 sn, i32 sd, i32 en, i32 ed) {
+    const i32 xx = FOV_XX[oct];
+    const i32 xy = FOV_XY[oct];
+    const i32 yx = FOV_YX[oct];
+    const i32 yy = FOV_YY[oct];
+    i32 nn = 0;  /* New start slope after a run of opaque tiles */
+    i32 nd = 1;
+    if(sn * ed < en * sd) {
+        return;
+    }
+    for(; j <= (i32)radius; j++) {
+        u32 blocked = 0;
+        i32 u;
+        for(u = j; u >= 0; u--) {
+            /* Slopes of the tile's left and right edges */
+            const i32 ln = 2 * u + 1;
+            const i32 ld = 2 * j - 1;
+            const i32 rn = 2 * u - 1;
+            const i32 rd = 2 * j + 1;
+            if(sn * rd < rn * sd) {
+                continue;  /* Tile is before the lit range */
+            }
+            if(en * ld > ln * ed) {
+                break;     /* Tile is past the lit range */
+            }
+            const i32 wx = FOV_RADIUS - u * xx - j * xy;
+            const i32 wy = FOV_RADIUS - u * yx - j * yy;
+            if(fovInRange(u, j, radius)) {
+                rows[wy] |= 1u << wx;
+            }
+            const u32 opaque = (f->window[wy] >> wx) & 1;
+            if(blocked) {
+                if(opaque) {
+                    nn = rn;
+                    nd = rd;
+                    continue;
+                }
+                blocked = 0;
+                sn = nn;
+                sd = nd;
+            } else if(opaque && j < (i32)radius) {
+                blocked = 1;
+                fovCast(f, rows, oct, radius, j + 1, sn, sd, ln, ld);
+                nn = rn;
+                nd = rd;
+            }
+        }
+        if(blocked) {
+            break;
+        }
+    }
+}
+
+/* Copy the opaque bits around (x, y) into the window, keeping only the */
+/* ones in range of radius. Tiles outside the grid count as opaque.     */
+static void fovWindow(fov_t * f, i32 x, i32 y, u32 radius) {
+    const i32 left = x - FOV_RADIUS;
+    const u32 inside = left >= 0 && x + FOV_RADIUS < (i32)f->tilesWide;
+    const u32 shift = left & 31;
+    u32 j;
+    for(j = 0; j < FOV_SIZE; j++) {
+        const i32 wy = y - FOV_RADIUS + (i32)j;
+        u32 bits = 0;
+        if(inside && (u32)wy < f->tilesHigh) {
+            /* Fast path: the row is up to 2 words of the bitset */
+            const u32 * row = &f->opaque[wy * f->rowWords + (left >> 5)];
+            bits = row[0] >> shift;
+            if(shift > 1) {
+                bits |= row[1] << (32 - shift);
+            }
+        } else {
+            u32 i;
+            for(i = 0; i < FOV_SIZE; i++) {
+                bits |= fovOpaque(f, left + (i32)i, wy) << i;
+            }
+        }
+        f->window[j] = bits & f->disk[radius][j];
+    }
+}
+
+/* Compute view v from (x, y), casting only the octants with opaque tiles */
+static void fovCompute(fov_t * f, fov_view_t * v, i32 x, i32 y, u32 radius) {
+    u32 oct;
+    u32 j;
+    radius = radius < FOV_RADIUS ? radius : FOV_RADIUS;
+    fovWindow(f, x, y, radius);
+    v->x = x;
+    v->y = y;
+    v->radius = radius;
+    v->valid = 1;
+    for(j = 0; j < FOV_SIZE; j++) {
+        v->rows[j] = 0;
+    }
+    for(oct = 0; oct < 8; oct++) {
+        u32 walls = 0;
+        for(j = 0; j < FOV_SIZE; j++) {
+            walls |= f->window[j] & f->octant[oct][j];
+        }
+        if(walls) {
+            f->casts += 1;
+            fovCast(f, v->rows, oct, radius, 1, 1, 1, 0, 1);
+        } else {
+            for(j = 0; j < FOV_SIZE; j++) {
+                v->rows[j] |= f->octant[oct][j] & f->disk[radius][j];
+            }
+        }
+    }
+    v->rows[FOV_RADIUS] |= 1u << FOV_RADIUS;  /* Origin */
+    f->looks += 1;
+}
+
+/* Set the grid size, with all tiles clear, an empty view, and no lights. */
+/* Returns: 1 = Success, 0 = grid is too big                              */
+static u32 fovInit(fov_t * f, u32 tiles_wide, u32 tiles_high) {
+    const u32 row_words = (tiles_wide + 31) >> 5;
+    if(tiles_wide == 0 || tiles_high == 0
+        || tiles_high > FOV_TILES_MAX / (row_words * 32)) {
+        return 0;
+    }
+    f->tilesWide = tiles_wide;
+    f->tilesHigh = tiles_high;
+    f->rowWords = row_words;
+    u32 i;
+    for(i = 0; i < row_words * tiles_high; i++) {
+        f->opaque[i] = 0;
+    }
+    /* Disks for each radius */
+    u32 r;
+    u32 j;
+    for(r = 0; r <= FOV_RADIUS; r++) {
+        for(j = 0; j < FOV_SIZE; j++) {
+            const i32 dy = (i32)j - FOV_RADIUS;
+            u32 bits = 0;
+            for(i = 0; i < FOV_SIZE; i++) {
+                bits |= fovInRange((i32)i - FOV_RADIUS, dy, r) << i;
+            }
+            f->disk[r][j] = bits;
+        }
+    }
+    /* Octant masks are what each octant can see with no opaque tiles */
+    for(j = 0; j < FOV_SIZE; j++) {
+        f->window[j] = 0;
+    }
+    for(i = 0; i < 8; i++) {
+        for(j = 0; j < FOV_SIZE; j++) {
+            f->octant[i][j] = 0;
+        }
+        fovCast(f, f->octant[i], i, FOV_RADIUS, 1, 1, 1, 0, 1);
+    }
+    f->casts = 0;
+    f->looks = 0;
+    f->view.valid = 0;
+    for(i = 0; i < LIGHT_MAX; i++) {
+        f->light[i].view.valid = 0;
+        f->light[i].intensity = 0;
+    }
+    return 1;
+}
+
+/* Returns: 1 if tile (x, y) is opaque or outside the grid, otherwise 0 */
+static u32 fovOpaque(const fov_t * f, i32 x, i32 y) {
+    if((u32)x >= f->tilesWide || (u32)y >= f->tilesHigh) {
+        return 1;
+    }
+    return (f->opaque[y * f->rowWords + (x >> 5)] >> (x & 31)) & 1;
+}
+
+/* Invalidate view v if tile (x, y) is within its radius */
+static void fovTouch(fov_view_t * v, i32 x, i32 y) {
+    const i32 dx = x - v->x;
+    const i32 dy = y - v->y;
+    const i32 r = v->radius;
+    if(dx >= -r && dx <= r && dy >= -r && dy <= r) {
+        v->valid = 0;
+    }
+}
+
+/* Make tile (x, y) opaque or clear. If that changes it, this invalidates */
+/* the player's view and any lights that might see the tile.              */
+static void fovSetOpaque(fov_t * f, i32 x, i32 y, u32 opaque) {
+    if((u32)x >= f->tilesWide || (u32)y >= f->tilesHigh
+        || fovOpaque(f, x, y) == (opaque != 0)) {
+        return;
+    }
+    f->opaque[y * f->rowWords + (x >> 5)] ^= 1u << (x & 31);
+    fovTouch(&f->view, x, y);
+    u32 i;
+    for(i = 0; i < LIGHT_MAX; i++) {
+        fovTouch(&f->light[i].view, x, y);
+    }
+}
+
+/* Update the player's view from (x, y), unless it's still valid for that */
+/* origin. Returns: 1 if the view was recomputed, 0 if it was cached.     */
+static u32 fovLook(fov_t * f, i32 x, i32 y, u32 radius) {
+    fov_view_t * v = &f->view;
+    radius = radius < FOV_RADIUS ? radius : FOV_RADIUS;
+    if(v->valid && v->x == x && v->y == y && v->radius == radius) {
+        return 0;
+    }
+    fovCompute(f, v, x, y, radius);
+    return 1;
+}
+
+/* Returns: 1 if tile (x, y) is inside the grid and visible in view v */
+static u32 fovVisible(const fov_t * f, const fov_view_t * v, i32 x, i32 y) {
+    const i32 wx = x - v->x + FOV_RADIUS;
+    const i32 wy = y - v->y + FOV_RADIUS;
+    if(!v->valid || (u32)x >= f->tilesWide || (u32)y >= f->tilesHigh
+        || (u32)wx >= FOV_SIZE || (u32)wy >= FOV_SIZE) {
+        return 0;
+    }
+    return (v->rows[wy] >> wx) & 1;
+}
+
+/* Move light id to (x, y) with a radius (clamped to FOV_RADIUS) and an */
+/* intensity (clamped to LIGHT_FULL), or turn it off with intensity 0   */
+static void lightSet(fov_t * f, u32 id, i32 x, i32 y, u32 radius,
+    u32 intensity) {
+    if(id >= LIGHT_MAX) {
+        return;
+    }
+    light_t * l = &f->light[id];
+    l->view.x = x;
+    l->view.y = y;
+    l->view.radius = radius < FOV_RADIUS ? radius : FOV_RADIUS;
+    l->view.valid = 0;
+    l->intensity = intensity < LIGHT_FULL ? intensity : LIGHT_FULL;
+}
+
+/* Add up the light reaching tile (x, y), fading with distance from each */
+/* source. Lights that aren't cached get their views computed first.    */
+/* Returns: light level, from 0 (dark) to LIGHT_FULL                    */
+static u32 lightLevel(fov_t * f, i32 x, i32 y) {
+    u32 level = 0;
+    u32 i;
+    for(i = 0; i < LIGHT_MAX && level < LIGHT_FULL; i++) {
+        light_t * l = &f->light[i];
+        fov_view_t * v = &l->view;
+        const i32 dx = x - v->x;
+        const i32 dy = y - v->y;
+        const i32 r = v->radius;
+        if(l->intensity == 0 || dx < -r || dx > r || dy < -r || dy > r
+            || !fovInRange(dx, dy, r)) {
+            continue;
+        }
+        if(!v->valid) {
+            fovCompute(f, v, v->x, v->y, r);
+        }
+        if(fovVisible(f, v, x, y)) {
+            const u32 range = r * (r + 1) + 1;
+            level += l->intensity * (range - (dx * dx + dy * dy)) / range;
+        }
+    }
+    return level < LIGHT_FULL ? level : LIGHT_FULL;
+}
+
+#endif /* MKB_FOV_C */
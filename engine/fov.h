@@ -0,0 +1,93 @@
+/* Copyright (c) 2023 Sam Blenny
+ * SPDX-License-Identifier: CC-BY-NC-SA-4.0
+ *
+ * Field of view and lighting over a tile grid, using recursive shadowcasting
+ * on bitsets of opaque tiles.
+ */
+#ifndef MKB_FOV_H
+#define MKB_FOV_H
+
+/* Longest view or light radius in tiles. A view covers a window of tiles */
+/* FOV_SIZE square around its origin, so each row fits in one u32 word.   */
+#define FOV_RADIUS (15)
+#define FOV_SIZE   (FOV_RADIUS * 2 + 1)
+
+/* Most tiles an FOV grid can have */
+#ifndef FOV_TILES_MAX
+#define FOV_TILES_MAX (1 << 20)
+#endif
+
+/* Number of light sources */
+#ifndef LIGHT_MAX
+#define LIGHT_MAX (16)
+#endif
+
+/* Brightest light level */
+#define LIGHT_FULL (255)
+
+/* Tiles visible from an origin, as a window of bits. Bit i of rows[j] is */
+/* for tile (x - FOV_RADIUS + i, y - FOV_RADIUS + j).                     */
+typedef struct fov_view {
+    i32 x;                      /* Origin in tile coordinates  */
+    i32 y;
+    u32 radius;
+    u32 valid;
+    u32 rows[FOV_SIZE];
+} fov_view_t;
+
+/* A light source, with its view cached until it moves or a tile changes */
+/* near it                                                               */
+typedef struct light {
+    fov_view_t view;
+    u32 intensity;              /* Level at the light's own tile, 0 = off */
+} light_t;
+
+/* FOV state for one tile grid. Opaque tiles are stored as a bitset with one
+ * bit per tile, so each row is a run of u32 words. Shadowcasting works on a
+ * copy of the opaque bits in the window around a view's origin, and the
+ * masks let it skip octants that have no opaque tiles, which is most of them
+ * in open areas.
+ */
+typedef struct fov {
+    u32 tilesWide;                          /* Grid size in tiles          */
+    u32 tilesHigh;
+    u32 rowWords;                           /* u32 words per row of bits   */
+    u32 casts;                              /* Octants shadowcast so far   */
+    u32 looks;                              /* Views computed so far       */
+    u32 opaque[FOV_TILES_MAX / 32];         /* 1 bit per tile, 1 = opaque  */
+    u32 window[FOV_SIZE];                   /* Opaque bits near the origin */
+    u32 disk[FOV_RADIUS + 1][FOV_SIZE];     /* Tiles in range, per radius  */
+    u32 octant[8][FOV_SIZE];                /* Tiles in each octant        */
+    fov_view_t view;                        /* The player's view           */
+    light_t light[LIGHT_MAX];
+} fov_t;
+
+/* Set the grid size, with all tiles clear, an empty view, and no lights. */
+/* Returns: 1 = Success, 0 = grid is too big                              */
+static u32 fovInit(fov_t * f, u32 tiles_wide, u32 tiles_high);
+
+/* Returns: 1 if tile (x, y) is opaque or outside the grid, otherwise 0 */
+static u32 fovOpaque(const fov_t * f, i32 x, i32 y);
+
+/* Make tile (x, y) opaque or clear. If that changes it, this invalidates */
+/* the player's view and any lights that might see the tile.              */
+static void fovSetOpaque(fov_t * f, i32 x, i32 y, u32 opaque);
+
+/* Update the player's view from (x, y), unless it's still valid for that */
+/* origin. Returns: 1 if the view was recomputed, 0 if it was cached.     */
+static u32 fovLook(fov_t * f, i32 x, i32 y, u32 radius);
+
+/* Returns: 1 if tile (x, y) is inside the grid and visible in view v */
+static u32 fovVisible(const fov_t * f, const fov_view_t * v, i32 x, i32 y);
+
+/* Move light id to (x, y) with a radius (clamped to FOV_RADIUS) and an */
+/* intensity (clamped to LIGHT_FULL), or turn it off with intensity 0   */
+static void lightSet(fov_t * f, u32 id, i32 x, i32 y, u32 radius,
+    u32 intensity);
+
+/* Add up the light reaching tile (x, y), fading with distance from each */
+/* source. Lights that aren't cached get their views computed first.    */
+/* Returns: light level, from 0 (dark) to LIGHT_FULL                    */
+static u32 lightLevel(fov_t * f, i32 x, i32 y);
+
+#endif /* MKB_FOV_H */
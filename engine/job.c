@@ -0,0 +1,346 @@
+/* Copyright (c) 2023 Sam Blenny
+ * SPDX-License-Identifier: CC-BY-NC-SA-4.0
+ *
+ * Job system: graphs of jobs with dependencies, where each job can be a
+ * parallel-for over a range of items, run by a pool of worker threads that
+ * steal work from each other.
+ *
+ * Each job counts the jobs it waits for, and goes in a queue when that gets
+ * to 0. A thread running a piece of a job's range splits off the back half
+ * into its own queue until the piece is down to the job's grain size, so
+ * idle threads have big pieces to steal and busy ones work through nearby
+ * items. A job is done when its last piece is, which releases the jobs
+ * waiting for it. The queues use a lock each, since pieces are big enough
+ * that a lock costs little next to the work in them.
+ */
+#ifndef MKB_JOB_C
+#define MKB_JOB_C
+
+#include "mkb_engine.h"
+#include "job.h"
+
+
+/**************************/
+/* Non-exported Functions */
+/**************************/
+
+/* Locks and atomic counters, which are plain operations without threads */
+#ifdef MKB_THREADS
+#define _job_lock(M)     pthread_mutex_lock(M)
+#define _job_unlock(M)   pthread_mutex_unlock(M)
+#define _job_add(P, V)   __atomic_add_fetch((P), (V), __ATOMIC_ACQ_REL)
+#define _job_load(P)     __atomic_load_n((P), __ATOMIC_ACQUIRE)
+#define _job_store(P, V) __atomic_store_n((P), (V), __ATOMIC_RELEASE)
+#else
+#define _job_lock(M)
+#define _job_unlock(M)
+#define _job_add(P, V)   (*(P) += (V))
+#define _job_load(P)     (*(P))
+#define _job_store(P, V) (*(P) = (V))
+#endif
+
+/* Push a piece onto the newest end of a queue */
+/* Returns: 1 = Success, 0 = queue is full     */
+static u32 jobPush(job_queue_t * q, const job_piece_t * p) {
+    _job_lock(&q->lock);
+    const u32 ok = q->bottom - q->top < JOB_QUEUE;
+    if(ok) {
+        q->piece[q->bottom & JOB_QUEUE_MASK] = *p;
+        q->bottom += 1;
+    }
+    _job_unlock(&q->lock);
+    return ok;
+}
+
+/* Pop the newest piece from a queue into p */
+/* Returns: 1 = Success, 0 = queue is empty */
+static u32 jobPop(job_queue_t * q, job_piece_t * p) {
+    _job_lock(&q->lock);
+    const u32 ok = q->bottom != q->top;
+    if(ok) {
+        q->bottom -= 1;
+        *p = q->piece[q->bottom & JOB_QUEUE_MASK];
+    }
+    _job_unlock(&q->lock);
+    return ok;
+}
+
+/* Take the oldest piece from another thread's queue into p, trying the */
+/* threads after self in turn                                           */
+/* Returns: 1 = Success, 0 = every other queue is empty                 */
+static u32 jobSteal(job_system_t * js, u32 self, job_piece_t * p) {
+    u32 i;
+    for(i = 1; i < js->threads; i++) {
+        const u32 victim = (self + i) % js->threads;
+        job_queue_t * q = &js->queue[victim];
+        _job_lock(&q->lock);
+        const u32 ok = q->bottom != q->top;
+        if(ok) {
+            *p = q->piece[q->top & JOB_QUEUE_MASK];
+            q->top += 1;
+        }
+        _job_unlock(&q->lock);
+        if(ok) {
+            _job_add(&js->steals, 1);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static void jobExecute(job_system_t * js, u32 self, job_piece_t p);
+
+/* Queue job id of graph g on thread self, now that it's ready to run */
+static void jobReady(job_system_t * js, u32 self, job_graph_t * g, u32 id) {
+    job_piece_t p;
+    p.graph = g;
+    p.job = id;
+    p.begin = 0;
+    p.end = g->job[id].count;
+    if(!jobPush(&js->queue[self], &p)) {
+        jobExecute(js, self, p);
+    }
+}
+
+/* Release the jobs waiting for job id of graph g, which just finished */
+static void jobFinish(job_system_t * js, u32 self, job_graph_t * g, u32 id) {
+    const job_t * j = &g->job[id];
+    u32 i;
+    for(i = 0; i < j->dependents; i++) {
+        const u32 d = j->dependent[i];
+        if(_job_add(&g->job[d].waiting, -1) == 0) {
+            jobReady(js, self, g, d);
+        }
+    }
+    _job_add(&g->remaining, -1);
+}
+
+/* Run piece p on thread self, first splitting off pieces for other */
+/* threads to steal while it's bigger than the job's grain          */
+static void jobExecute(job_system_t * js, u32 self, job_piece_t p) {
+    job_graph_t * g = p.graph;
+    job_t * j = &g->job[p.job];
+    const u32 grain = j->grain;
+    /* With one thread, splitting would only add overhead */
+    while(js->threads > 1 && p.end - p.begin > grain) {
+        const u32 pieces = (p.end - p.begin) / grain;
+        const u32 mid = p.begin + (pieces + 1) / 2 * grain;
+        job_piece_t back = p;
+        back.begin = mid;
+        _job_add(&j->unfinished, 1);
+        if(!jobPush(&js->queue[self], &back)) {
+            _job_add(&j->unfinished, -1);
+            break;
+        }
+        p.end = mid;
+    }
+    if(p.begin < p.end) {
+        j->fn(j->arg, p.begin, p.end);
+    }
+    if(_job_add(&j->unfinished, -1) == 0) {
+        jobFinish(js, self, g, p.job);
+    }
+}
+
+/* Run pieces of graph g on thread self until every job in it is done */
+static void jobWork(job_system_t * js, u32 self, job_graph_t * g) {
+    job_piece_t p;
+    while(_job_load(&g->remaining) > 0) {
+        if(jobPop(&js->queue[self], &p) || jobSteal(js, self, &p)) {
+            jobExecute(js, self, p);
+            continue;
+        }
+#ifdef MKB_THREADS
+        /* Other threads are running the last pieces */
+        sched_yield();
+#else
+        /* Nothing to run but jobs left over means there was a cycle */
+        break;
+#endif
+    }
+}
+
+#ifdef MKB_THREADS
+/* Worker thread: help with each run until the job system shuts down */
+static void * jobThread(void * arg) {
+    const job_worker_t * w = (const job_worker_t *)arg;
+    job_system_t * js = w->js;
+    u32 seen = 0;
+    for(;;) {
+        pthread_mutex_lock(&js->lock);
+        while(js->run == seen && !js->quit) {
+            pthread_cond_wait(&js->wake, &js->lock);
+        }
+        const u32 quit = js->quit;
+        job_graph_t * g = js->graph;
+        seen = js->run;
+        pthread_mutex_unlock(&js->lock);
+        if(quit) {
+            return 0;
+        }
+        jobWork(js, w->id, g);
+    }
+}
+
+/* Stop a job system's threads, so it can be started again */
+static void jobShutdown(job_system_t * js) {
+    u32 i;
+    if(js->threads == 0) {
+        return;
+    }
+    pthread_mutex_lock(&js->lock);
+    js->quit = 1;
+    pthread_cond_broadcast(&js->wake);
+    pthread_mutex_unlock(&js->lock);
+    for(i = 1; i < js->threads; i++) {
+        pthread_join(js->thread[i], 0);
+    }
+    for(i = 0; i < js->threads; i++) {
+        pthread_mutex_destroy(&js->queue[i].lock);
+    }
+    pthread_cond_destroy(&js->wake);
+    pthread_mutex_destroy(&js->lock);
+    js->threads = 0;
+}
+#endif
+
+/* Start a job system with up to threads threads, counting the caller. */
+/* Without MKB_THREADS, that's always 1. Does nothing if it's running. */
+/* Returns: number of threads                                          */
+static u32 jobInit(job_system_t * js, u32 threads) {
+    u32 i;
+    if(js->threads) {
+        return js->threads;
+    }
+    threads = threads < 1 ? 1 : threads;
+    threads = threads > JOB_THREADS_MAX ? JOB_THREADS_MAX : threads;
+    js->steals = 0;
+    for(i = 0; i < threads; i++) {
+        js->queue[i].top = 0;
+        js->queue[i].bottom = 0;
+    }
+#ifdef MKB_THREADS
+    for(i = 0; i < threads; i++) {
+        pthread_mutex_init(&js->queue[i].lock, 0);
+    }
+    pthread_mutex_init(&js->lock, 0);
+    pthread_cond_init(&js->wake, 0);
+    js->graph = 0;
+    js->run = 0;
+    js->quit = 0;
+    /* If a thread won't start, make do with the ones that did */
+    js->threads = 1;
+    for(i = 1; i < threads; i++) {
+        js->worker[i].js = js;
+        js->worker[i].id = i;
+        if(pthread_create(&js->thread[i], 0, jobThread, &js->worker[i])) {
+            break;
+        }
+        js->threads = i + 1;
+    }
+    for(i = js->threads; i < threads; i++) {
+        pthread_mutex_destroy(&js->queue[i].lock);
+    }
+#else
+    js->threads = threads;
+#endif
+    return js->threads;
+}
+
+/* Remove all jobs from a graph */
+static void jobGraphClear(job_graph_t * g) {
+    g->count = 0;
+    g->remaining = 0;
+}
+
+/* Add a job that calls fn(arg, begin, end) for pieces of the range 0 to  */
+/* count - 1, each with at least grain items (except maybe the last).     */
+/* Returns: job id, or -1 if the graph is full                            */
+static i32 jobFor(job_graph_t * g, job_fn_t fn, void * arg, u32 count,
+    u32 grain) {
+    if(g->count >= JOB_MAX) {
+        return -1;
+    }
+    job_t * j = &g->job[g->count];
+    j->fn = fn;
+    j->arg = arg;
+    j->count = count;
+    j->grain = grain ? grain : 1;
+    j->deps = 0;
+    j->dependents = 0;
+    j->waiting = 0;
+    j->unfinished = 0;
+    g->count += 1;
+    return g->count - 1;
+}
+
+/* Add a job that calls fn(arg, 0, 1) once     */
+/* Returns: job id, or -1 if the graph is full */
+static i32 jobAdd(job_graph_t * g, job_fn_t fn, void * arg) {
+    return jobFor(g, fn, arg, 1, 1);
+}
+
+/* Make job id wait until job before is done. Dependencies must not form */
+/* a cycle.                                                               */
+/* Returns: 1 = Success, 0 = bad id or too many dependents                */
+static u32 jobAfter(job_graph_t * g, u32 id, u32 before) {
+    if(id >= g->count || before >= g->count || id == before
+        || g->job[before].dependents >= JOB_DEPENDENTS_MAX) {
+        return 0;
+    }
+    job_t * b = &g->job[before];
+    b->dependent[b->dependents] = id;
+    b->dependents += 1;
+    g->job[id].deps += 1;
+    return 1;
+}
+
+/* Change the number of items in job id's range, for the next run */
+static void jobRange(job_graph_t * g, u32 id, u32 count) {
+    if(id < g->count) {
+        g->job[id].count = count;
+    }
+}
+
+/* Run every job in a graph, with the caller helping, and return when */
+/* they're all done. Jobs must not call jobRun() themselves.           */
+static void jobRun(job_system_t * js, job_graph_t * g) {
+    u32 i;
+    if(js->threads == 0) {
+        jobInit(js, 1);
+    }
+    if(g->count == 0) {
+        return;
+    }
+    for(i = 0; i < g->count; i++) {
+        g->job[i].waiting = g->job[i].deps;
+        g->job[i].unfinished = 1;
+    }
+    _job_store(&g->remaining, g->count);
+    /* Deal the jobs that don't wait for anything out to the threads. */
+    /* JOB_MAX fits in a queue, so pushes can't fail.                 */
+    u32 t = 0;
+    for(i = 0; i < g->count; i++) {
+        if(g->job[i].deps == 0) {
+            job_piece_t p;
+            p.graph = g;
+            p.job = i;
+            p.begin = 0;
+            p.end = g->job[i].count;
+            jobPush(&js->queue[t], &p);
+            t = t + 1 < js->threads ? t + 1 : 0;
+        }
+    }
+#ifdef MKB_THREADS
+    if(js->threads > 1) {
+        pthread_mutex_lock(&js->lock);
+        js->graph = g;
+        js->run += 1;
+        pthread_cond_broadcast(&js->wake);
+        pthread_mutex_unlock(&js->lock);
+    }
+#endif
+    jobWork(js, 0, g);
+}
+
+#endif /* MKB_JOB_C */
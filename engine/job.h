@@ -0,0 +1,150 @@
+/* Copyright (c) 2023 Sam Blenny
+ * SPDX-License-Identifier: CC-BY-NC-SA-4.0
+ *
+ * Job system: graphs of jobs with dependencies, where each job can be a
+ * parallel-for over a range of items, run by a pool of worker threads that
+ * steal work from each other.
+ *
+ * Threads are only used when MKB_THREADS is defined (native builds, linked
+ * with -lpthread). Otherwise, the wasm module has no threads, so jobRun()
+ * runs every job on the calling thread, in an order that respects the
+ * dependencies. The API is the same either way.
+ */
+#ifndef MKB_JOB_H
+#define MKB_JOB_H
+
+#ifdef MKB_THREADS
+#include <pthread.h>        /* pthread_create(), pthread_mutex_lock(), ... */
+#include <sched.h>          /* sched_yield() */
+#endif
+
+/* Most jobs in a graph */
+#ifndef JOB_MAX
+#define JOB_MAX (32)
+#endif
+
+/* Most jobs that can wait for one job */
+#define JOB_DEPENDENTS_MAX (8)
+
+/* Most threads in a job system, counting the one that calls jobRun() */
+#ifndef JOB_THREADS_MAX
+#ifdef MKB_THREADS
+#define JOB_THREADS_MAX (16)
+#else
+#define JOB_THREADS_MAX (1)
+#endif
+#endif
+
+/* Room for pieces of jobs in each thread's queue. Must be a power of 2, */
+/* with room for every job in a graph.                                   */
+#define JOB_QUEUE      (256)
+#define JOB_QUEUE_MASK (JOB_QUEUE - 1)
+#if JOB_MAX > JOB_QUEUE
+#error "JOB_MAX must be no more than JOB_QUEUE"
+#endif
+
+/* Job function: process items begin to end - 1 of the job's range */
+typedef void (*job_fn_t)(void * arg, u32 begin, u32 end);
+
+/* Job in a graph. A job with a range of n items runs as pieces of at */
+/* least grain items, which can run on different threads at once.    */
+typedef struct job {
+    job_fn_t fn;
+    void * arg;
+    u32 count;                          /* Items in the range            */
+    u32 grain;                          /* Fewest items per piece        */
+    u32 deps;                           /* Jobs this one waits for       */
+    u32 dependents;                     /* Jobs waiting for this one     */
+    u32 dependent[JOB_DEPENDENTS_MAX];
+    i32 waiting;                        /* Deps not done in this run     */
+    i32 unfinished;                     /* Pieces not done in this run   */
+} job_t;
+
+/* Graph of jobs. Graphs get built once and can run any number of times. */
+/* Jobs get ids in the order they're added, starting from 0.             */
+typedef struct job_graph {
+    u32 count;
+    i32 remaining;                      /* Jobs not done in this run     */
+    job_t job[JOB_MAX];
+} job_graph_t;
+
+/* Piece of a job's range, waiting in a queue */
+typedef struct job_piece {
+    job_graph_t * graph;
+    u32 job;
+    u32 begin;
+    u32 end;
+} job_piece_t;
+
+/* Double ended queue of pieces. The thread that owns it pushes and pops  */
+/* the newest pieces, which are the smallest and most likely to be in its */
+/* cache, while other threads steal the oldest, which are the biggest.   */
+typedef struct job_queue {
+#ifdef MKB_THREADS
+    pthread_mutex_t lock;
+#endif
+    u32 top;                            /* Oldest piece, for stealing    */
+    u32 bottom;                         /* One past the newest piece     */
+    job_piece_t piece[JOB_QUEUE];
+} job_queue_t;
+
+#ifdef MKB_THREADS
+/* What each worker thread gets passed when it starts */
+typedef struct job_worker {
+    struct job_system * js;
+    u32 id;                             /* Index of the thread's queue   */
+} job_worker_t;
+#endif
+
+/* Pool of worker threads with a queue for each */
+typedef struct job_system {
+    u32 threads;                        /* 0 until jobInit()             */
+    u32 steals;                         /* Pieces stolen so far          */
+    job_queue_t queue[JOB_THREADS_MAX];
+#ifdef MKB_THREADS
+    pthread_t thread[JOB_THREADS_MAX];
+    job_worker_t worker[JOB_THREADS_MAX];
+    pthread_mutex_t lock;               /* Guards graph, run, and quit   */
+    pthread_cond_t wake;                /* Signaled when a run starts    */
+    job_graph_t * graph;                /* Graph of the current run      */
+    u32 run;                            /* Counts calls to jobRun()      */
+    u32 quit;
+#endif
+} job_system_t;
+
+/* Start a job system with up to threads threads, counting the caller. */
+/* Without MKB_THREADS, that's always 1. Does nothing if it's running. */
+/* Returns: number of threads                                          */
+static u32 jobInit(job_system_t * js, u32 threads);
+
+#ifdef MKB_THREADS
+/* Stop a job system's threads, so it can be started again */
+static void jobShutdown(job_system_t * js);
+#endif
+
+/* Remove all jobs from a graph */
+static void jobGraphClear(job_graph_t * g);
+
+/* Add a job that calls fn(arg, begin, end) for pieces of the range 0 to  */
+/* count - 1, each with at least grain items (except maybe the last).     */
+/* Returns: job id, or -1 if the graph is full                            */
+static i32 jobFor(job_graph_t * g, job_fn_t fn, void * arg, u32 count,
+    u32 grain);
+
+/* Add a job that calls fn(arg, 0, 1) once */
+/* Returns: job id, or -1 if the graph is full */
+static i32 jobAdd(job_graph_t * g, job_fn_t fn, void * arg);
+
+/* Make job id wait until job before is done. Dependencies must not form */
+/* a cycle.                                                               */
+/* Returns: 1 = Success, 0 = bad id or too many dependents                */
+static u32 jobAfter(job_graph_t * g, u32 id, u32 before);
+
+/* Change the number of items in job id's range, for the next run */
+static void jobRange(job_graph_t * g, u32 id, u32 count);
+
+/* Run every job in a graph, with the caller helping, and return when */
+/* they're all done. Jobs must not call jobRun() themselves.           */
+static void jobRun(job_system_t * js, job_graph_t * g);
+
+#endif /* MKB_JOB_H */
@@ -0,0 +1,504 @@
+/* Copyright (c) 2023 Sam Blenny
+ * SPDX-License-Identifier: CC-BY-NC-SA-4.0
+ *
+ * 3D math for WebGL: matrices, quaternions, batch transforms, frustum
+ * culling, and matrix palettes, with SIMD versions of the batch passes.
+ *
+ * The batch passes work on 4 items at a time using wasm simd128 for wasm
+ * builds with -msimd128, or SSE for native builds. Without either, they fall
+ * back to plain loops. Unlike the rest of the engine, this uses floats, since
+ * the results go straight to WebGL. Square roots come from SIMD instructions
+ * (or the wasm f32.sqrt instruction) rather than libm.
+ *
+ * Culling tests each sphere or box against each frustum plane, so it can
+ * keep some objects near the frustum's corners that are actually outside.
+ * It never drops an object that's inside.
+ */
+#ifndef MKB_MATH3D_C
+#define MKB_MATH3D_C
+
+#include "mkb_engine.h"
+#include "math3d.h"
+
+/* Vector macros for the batch passes: f4_t holds 4 f32 lanes. Comparisons
+ * give lanes of all 1 bits for true, and f4Mask() packs the top bit of each
+ * lane into the low 4 bits of an int. f4Transpose() turns 4 rows into 4
+ * columns, in place. Loads and stores don't need to be aligned.
+ */
+#if defined(__wasm_simd128__)
+#include <wasm_simd128.h>
+typedef v128_t f4_t;
+#define MATH3D_SIMD
+#define f4Load(P)     wasm_v128_load(P)
+#define f4Store(P, V) wasm_v128_store((P), (V))
+#define f4Splat(N)    wasm_f32x4_splat(N)
+#define f4Add(A, B)   wasm_f32x4_add((A), (B))
+#define f4Sub(A, B)   wasm_f32x4_sub((A), (B))
+#define f4Mul(A, B)   wasm_f32x4_mul((A), (B))
+#define f4Div(A, B)   wasm_f32x4_div((A), (B))
+#define f4Max(A, B)   wasm_f32x4_max((A), (B))
+#define f4Sqrt(V)     wasm_f32x4_sqrt(V)
+#define f4Ge(A, B)    wasm_f32x4_ge((A), (B))
+#define f4Mask(V)     wasm_i32x4_bitmask(V)
+#define f4Transpose(A, B, C, D) do { \
+    const v128_t t0_ = wasm_i32x4_shuffle((A), (B), 0, 4, 1, 5); \
+    const v128_t t1_ = wasm_i32x4_shuffle((A), (B), 2, 6, 3, 7); \
+    const v128_t t2_ = wasm_i32x4_shuffle((C), (D), 0, 4, 1, 5); \
+    const v128_t t3_ = wasm_i32x4_shuffle((C), (D), 2, 6, 3, 7); \
+    (A) = wasm_i32x4_shuffle(t0_, t2_, 0, 1, 4, 5); \
+    (B) = wasm_i32x4_shuffle(t0_, t2_, 2, 3, 6, 7); \
+    (C) = wasm_i32x4_shuffle(t1_, t3_, 0, 1, 4, 5); \
+    (D) = wasm_i32x4_shuffle(t1_, t3_, 2, 3, 6, 7); \
+} while(0)
+#elif defined(__SSE__)
+#include <xmmintrin.h>
+typedef __m128 f4_t;
+#define MATH3D_SIMD
+#define f4Load(P)     _mm_loadu_ps(P)
+#define f4Store(P, V) _mm_storeu_ps((P), (V))
+#define f4Splat(N)    _mm_set1_ps(N)
+#define f4Add(A, B)   _mm_add_ps((A), (B))
+#define f4Sub(A, B)   _mm_sub_ps((A), (B))
+#define f4Mul(A, B)   _mm_mul_ps((A), (B))
+#define f4Div(A, B)   _mm_div_ps((A), (B))
+#define f4Max(A, B)   _mm_max_ps((A), (B))
+#define f4Sqrt(V)     _mm_sqrt_ps(V)
+#define f4Ge(A, B)    _mm_cmpge_ps((A), (B))
+#define f4Mask(V)     _mm_movemask_ps(V)
+#define f4Transpose(A, B, C, D) _MM_TRANSPOSE4_PS(A, B, C, D)
+#endif
+
+/* Smallest squared length that normalizing scales up. Anything shorter */
+/* (like a zero quaternion) ends up close to zero rather than NaN.     */
+#define MATH3D_TINY (1e-30f)
+
+
+/**************************/
+/* Non-exported Functions */
+/**************************/
+
+/* Returns: square root of x (0 for x <= 0) */
+static f32 m3Sqrt(f32 x) {
+    if(x <= 0.0f) {
+        return 0.0f;
+    }
+#if defined(__wasm__)
+    return __builtin_sqrtf(x);
+#elif defined(MATH3D_SIMD)
+    return _mm_cvtss_f32(_mm_sqrt_ss(_mm_set_ss(x)));
+#else
+    /* Halve the exponent for a first guess, then refine it */
+    union {
+        f32 f;
+        u32 u;
+    } v;
+    u32 i;
+    v.f = x;
+    v.u = (v.u >> 1) + 0x1fc00000;
+    for(i = 0; i < 3; i++) {
+        v.f = 0.5f * (v.f + x / v.f);
+    }
+    return v.f;
+#endif
+}
+
+/* Set m to the identity matrix */
+static void mat4Identity(mat4_t * m) {
+    u32 i;
+    for(i = 0; i < 16; i++) {
+        m->m[i] = (i % 5 == 0) ? 1.0f : 0.0f;
+    }
+}
+
+/* Set out = a * b. Out may be the same matrix as a or b. */
+static void mat4Mul(mat4_t * out, const mat4_t * a, const mat4_t * b) {
+    u32 c;
+#ifdef MATH3D_SIMD
+    /* Each column of out is a sum of a's columns, weighted by the same   */
+    /* column of b. Loading all of a first, and each column of b before   */
+    /* storing that column, makes it safe for out to be a or b.          */
+    const f4_t a0 = f4Load(&a->m[0]);
+    const f4_t a1 = f4Load(&a->m[4]);
+    const f4_t a2 = f4Load(&a->m[8]);
+    const f4_t a3 = f4Load(&a->m[12]);
+    for(c = 0; c < 4; c++) {
+        const f32 * bc = &b->m[c * 4];
+        f4_t r = f4Mul(a0, f4Splat(bc[0]));
+        r = f4Add(r, f4Mul(a1, f4Splat(bc[1])));
+        r = f4Add(r, f4Mul(a2, f4Splat(bc[2])));
+        r = f4Add(r, f4Mul(a3, f4Splat(bc[3])));
+        f4Store(&out->m[c * 4], r);
+    }
+#else
+    mat4_t t;
+    u32 r;
+    for(c = 0; c < 4; c++) {
+        const f32 * bc = &b->m[c * 4];
+        for(r = 0; r < 4; r++) {
+            t.m[c * 4 + r] = a->m[r] * bc[0] + a->m[4 + r] * bc[1]
+                + a->m[8 + r] * bc[2] + a->m[12 + r] * bc[3];
+        }
+    }
+    *out = t;
+#endif
+}
+
+/* Set out[i] = a[i] * b[i] for n matrices. Out may be the same as a or b. */
+static void mat4MulBatch(mat4_t * out, const mat4_t * a, const mat4_t * b,
+    u32 n) {
+    u32 i;
+    for(i = 0; i < n; i++) {
+        mat4Mul(&out[i], &a[i], &b[i]);
+    }
+}
+
+/* Transform a batch of n points {x, y, z, w} (stride apart) by m, writing */
+/* to out, which may be the same as in                                    */
+static void mat4TransformBatch(const mat4_t * m, const f32 * in, f32 * out,
+    u32 stride, u32 n) {
+    const f32 * e = m->m;
+    u32 i = 0;
+#ifdef MATH3D_SIMD
+    f4_t s[16];
+    u32 k;
+    for(k = 0; k < 16; k++) {
+        s[k] = f4Splat(e[k]);
+    }
+    for(; i + 4 <= n; i += 4) {
+        const f4_t x = f4Load(&in[i]);
+        const f4_t y = f4Load(&in[stride + i]);
+        const f4_t z = f4Load(&in[stride * 2 + i]);
+        const f4_t w = f4Load(&in[stride * 3 + i]);
+        for(k = 0; k < 4; k++) {
+            f4_t r = f4Mul(s[k], x);
+            r = f4Add(r, f4Mul(s[4 + k], y));
+            r = f4Add(r, f4Mul(s[8 + k], z));
+            r = f4Add(r, f4Mul(s[12 + k], w));
+            f4Store(&out[stride * k + i], r);
+        }
+    }
+#endif
+    for(; i < n; i++) {
+        const f32 x = in[i];
+        const f32 y = in[stride + i];
+        const f32 z = in[stride * 2 + i];
+        const f32 w = in[stride * 3 + i];
+        out[i] = e[0] * x + e[4] * y + e[8] * z + e[12] * w;
+        out[stride + i] = e[1] * x + e[5] * y + e[9] * z + e[13] * w;
+        out[stride * 2 + i] = e[2] * x + e[6] * y + e[10] * z + e[14] * w;
+        out[stride * 3 + i] = e[3] * x + e[7] * y + e[11] * z + e[15] * w;
+    }
+}
+
+/* Build a matrix for each of n poses (POSE_FIELDS arrays, stride apart)  */
+/* that scales, then rotates, then translates. Rotations should be unit   */
+/* quaternions.                                                            */
+static void mat4ComposeBatch(const f32 * pose, u32 stride, mat4_t * out,
+    u32 n) {
+    const f32 * tx = &pose[POSE_TX * stride];
+    const f32 * ty = &pose[POSE_TY * stride];
+    const f32 * tz = &pose[POSE_TZ * stride];
+    const f32 * qx = &pose[POSE_QX * stride];
+    const f32 * qy = &pose[POSE_QY * stride];
+    const f32 * qz = &pose[POSE_QZ * stride];
+    const f32 * qw = &pose[POSE_QW * stride];
+    const f32 * sx = &pose[POSE_SX * stride];
+    const f32 * sy = &pose[POSE_SY * stride];
+    const f32 * sz = &pose[POSE_SZ * stride];
+    u32 i = 0;
+#ifdef MATH3D_SIMD
+    /* Work out each matrix element for 4 poses at once, then transpose */
+    /* them into columns of the 4 matrices                              */
+    const f4_t one = f4Splat(1.0f);
+    const f4_t zero = f4Splat(0.0f);
+    for(; i + 4 <= n; i += 4) {
+        const f4_t x = f4Load(&qx[i]);
+        const f4_t y = f4Load(&qy[i]);
+        const f4_t z = f4Load(&qz[i]);
+        const f4_t w = f4Load(&qw[i]);
+        const f4_t x2 = f4Add(x, x);
+        const f4_t y2 = f4Add(y, y);
+        const f4_t z2 = f4Add(z, z);
+        const f4_t xx = f4Mul(x, x2);
+        const f4_t yy = f4Mul(y, y2);
+        const f4_t zz = f4Mul(z, z2);
+        const f4_t xy = f4Mul(x, y2);
+        const f4_t xz = f4Mul(x, z2);
+        const f4_t yz = f4Mul(y, z2);
+        const f4_t wx = f4Mul(w, x2);
+        const f4_t wy = f4Mul(w, y2);
+        const f4_t wz = f4Mul(w, z2);
+        const f4_t vx = f4Load(&sx[i]);
+        const f4_t vy = f4Load(&sy[i]);
+        const f4_t vz = f4Load(&sz[i]);
+        f4_t c[16];
+        c[0] = f4Mul(f4Sub(one, f4Add(yy, zz)), vx);
+        c[1] = f4Mul(f4Add(xy, wz), vx);
+        c[2] = f4Mul(f4Sub(xz, wy), vx);
+        c[3] = zero;
+        c[4] = f4Mul(f4Sub(xy, wz), vy);
+        c[5] = f4Mul(f4Sub(one, f4Add(xx, zz)), vy);
+        c[6] = f4Mul(f4Add(yz, wx), vy);
+        c[7] = zero;
+        c[8] = f4Mul(f4Add(xz, wy), vz);
+        c[9] = f4Mul(f4Sub(yz, wx), vz);
+        c[10] = f4Mul(f4Sub(one, f4Add(xx, yy)), vz);
+        c[11] = zero;
+        c[12] = f4Load(&tx[i]);
+        c[13] = f4Load(&ty[i]);
+        c[14] = f4Load(&tz[i]);
+        c[15] = one;
+        u32 k;
+        for(k = 0; k < 16; k += 4) {
+            f4Transpose(c[k], c[k + 1], c[k + 2], c[k + 3]);
+            f4Store(&out[i].m[k], c[k]);
+            f4Store(&out[i + 1].m[k], c[k + 1]);
+            f4Store(&out[i + 2].m[k], c[k + 2]);
+            f4Store(&out[i + 3].m[k], c[k + 3]);
+        }
+    }
+#endif
+    for(; i < n; i++) {
+        const f32 x = qx[i];
+        const f32 y = qy[i];
+        const f32 z = qz[i];
+        const f32 w = qw[i];
+        f32 * m = out[i].m;
+        m[0] = (1.0f - 2.0f * (y * y + z * z)) * sx[i];
+        m[1] = 2.0f * (x * y + w * z) * sx[i];
+        m[2] = 2.0f * (x * z - w * y) * sx[i];
+        m[3] = 0.0f;
+        m[4] = 2.0f * (x * y - w * z) * sy[i];
+        m[5] = (1.0f - 2.0f * (x * x + z * z)) * sy[i];
+        m[6] = 2.0f * (y * z + w * x) * sy[i];
+        m[7] = 0.0f;
+        m[8] = 2.0f * (x * z + w * y) * sz[i];
+        m[9] = 2.0f * (y * z - w * x) * sz[i];
+        m[10] = (1.0f - 2.0f * (x * x + y * y)) * sz[i];
+        m[11] = 0.0f;
+        m[12] = tx[i];
+        m[13] = ty[i];
+        m[14] = tz[i];
+        m[15] = 1.0f;
+    }
+}
+
+/* Turn n local joint matrices into model space matrices, in place, by     */
+/* multiplying each by its parent's. Parents must come before children.    */
+/* Joints with a parent of -1 (or not before them) are roots.              */
+static void mat4Hierarchy(mat4_t * mats, const i32 * parent, u32 n) {
+    u32 i;
+    for(i = 0; i < n; i++) {
+        const i32 p = parent[i];
+        if(p >= 0 && (u32)p < i) {
+            mat4Mul(&mats[i], &mats[p], &mats[i]);
+        }
+    }
+}
+
+/* Returns: a * b, which rotates by b and then by a */
+static quat_t quatMul(quat_t a, quat_t b) {
+    quat_t q;
+    q.x = a.w * b.x + a.x * b.w + a.y * b.z - a.z * b.y;
+    q.y = a.w * b.y - a.x * b.z + a.y * b.w + a.z * b.x;
+    q.z = a.w * b.z + a.x * b.y - a.y * b.x + a.z * b.w;
+    q.w = a.w * b.w - a.x * b.x - a.y * b.y - a.z * b.z;
+    return q;
+}
+
+/* Returns: q scaled to unit length (a zero quaternion stays zero) */
+static quat_t quatNormalize(quat_t q) {
+    f32 len2 = q.x * q.x + q.y * q.y + q.z * q.z + q.w * q.w;
+    len2 = len2 > MATH3D_TINY ? len2 : MATH3D_TINY;
+    const f32 inv = 1.0f / m3Sqrt(len2);
+    q.x *= inv;
+    q.y *= inv;
+    q.z *= inv;
+    q.w *= inv;
+    return q;
+}
+
+/* Scale a batch of n quaternions {x, y, z, w} (stride apart) to unit */
+/* length, in place. Zero quaternions stay zero.                      */
+static void quatNormalizeBatch(f32 * q, u32 stride, u32 n) {
+    f32 * qx = q;
+    f32 * qy = &q[stride];
+    f32 * qz = &q[stride * 2];
+    f32 * qw = &q[stride * 3];
+    u32 i = 0;
+#ifdef MATH3D_SIMD
+    const f4_t one = f4Splat(1.0f);
+    const f4_t tiny = f4Splat(MATH3D_TINY);
+    for(; i + 4 <= n; i += 4) {
+        const f4_t x = f4Load(&qx[i]);
+        const f4_t y = f4Load(&qy[i]);
+        const f4_t z = f4Load(&qz[i]);
+        const f4_t w = f4Load(&qw[i]);
+        const f4_t len2 = f4Add(f4Add(f4Mul(x, x), f4Mul(y, y)),
+            f4Add(f4Mul(z, z), f4Mul(w, w)));
+        const f4_t inv = f4Div(one, f4Sqrt(f4Max(len2, tiny)));
+        f4Store(&qx[i], f4Mul(x, inv));
+        f4Store(&qy[i], f4Mul(y, inv));
+        f4Store(&qz[i], f4Mul(z, inv));
+        f4Store(&qw[i], f4Mul(w, inv));
+    }
+#endif
+    for(; i < n; i++) {
+        quat_t v;
+        v.x = qx[i];
+        v.y = qy[i];
+        v.z = qz[i];
+        v.w = qw[i];
+        v = quatNormalize(v);
+        qx[i] = v.x;
+        qy[i] = v.y;
+        qz[i] = v.z;
+        qw[i] = v.w;
+    }
+}
+
+/* Get the frustum planes of a view-projection matrix, for WebGL clip space */
+static void frustumFromMat4(frustum_t * f, const mat4_t * m) {
+    /* Clip space is -w <= x, y, z <= w, so each plane is row 3 of the   */
+    /* matrix plus or minus row 0, 1, or 2: left, right, bottom, top,    */
+    /* near, far.                                                        */
+    const f32 * e = m->m;
+    u32 k;
+    for(k = 0; k < 6; k++) {
+        const u32 r = k >> 1;
+        const f32 s = (k & 1) ? -1.0f : 1.0f;
+        const f32 a = e[3] + s * e[r];
+        const f32 b = e[7] + s * e[4 + r];
+        const f32 c = e[11] + s * e[8 + r];
+        const f32 d = e[15] + s * e[12 + r];
+        f32 len2 = a * a + b * b + c * c;
+        len2 = len2 > MATH3D_TINY ? len2 : MATH3D_TINY;
+        const f32 inv = 1.0f / m3Sqrt(len2);
+        f->a[k] = a * inv;
+        f->b[k] = b * inv;
+        f->c[k] = c * inv;
+        f->d[k] = d * inv;
+    }
+}
+
+/* Find which of n spheres {x, y, z, radius} (stride apart) touch the */
+/* frustum, writing their indexes to visible (room for n).            */
+/* Returns: number of visible spheres                                 */
+static u32 frustumCullSpheres(const frustum_t * f, const f32 * s, u32 stride,
+    u32 n, u32 * visible) {
+    const f32 * sx = s;
+    const f32 * sy = &s[stride];
+    const f32 * sz = &s[stride * 2];
+    const f32 * sr = &s[stride * 3];
+    u32 count = 0;
+    u32 i = 0;
+    u32 k;
+#ifdef MATH3D_SIMD
+    f4_t pa[6], pb[6], pc[6], pd[6];
+    for(k = 0; k < 6; k++) {
+        pa[k] = f4Splat(f->a[k]);
+        pb[k] = f4Splat(f->b[k]);
+        pc[k] = f4Splat(f->c[k]);
+        pd[k] = f4Splat(f->d[k]);
+    }
+    for(; i + 4 <= n; i += 4) {
+        const f4_t x = f4Load(&sx[i]);
+        const f4_t y = f4Load(&sy[i]);
+        const f4_t z = f4Load(&sz[i]);
+        const f4_t r = f4Sub(f4Splat(0.0f), f4Load(&sr[i]));
+        u32 mask = 15;
+        for(k = 0; k < 6; k++) {
+            const f4_t d = f4Add(f4Add(f4Mul(pa[k], x), f4Mul(pb[k], y)),
+                f4Add(f4Mul(pc[k], z), pd[k]));
+            mask &= f4Mask(f4Ge(d, r));
+        }
+        /* Write every index, but only advance past the visible ones */
+        for(k = 0; k < 4; k++) {
+            visible[count] = i + k;
+            count += (mask >> k) & 1;
+        }
+    }
+#endif
+    for(; i < n; i++) {
+        u32 in = 1;
+        for(k = 0; k < 6; k++) {
+            const f32 d = f->a[k] * sx[i] + f->b[k] * sy[i]
+                + f->c[k] * sz[i] + f->d[k];
+            in &= d >= -sr[i];
+        }
+        visible[count] = i;
+        count += in;
+    }
+    return count;
+}
+
+/* Find which of n boxes {center x, y, z, half size x, y, z} (stride apart) */
+/* touch the frustum, writing their indexes to visible (room for n).       */
+/* Returns: number of visible boxes                                         */
+static u32 frustumCullBoxes(const frustum_t * f, const f32 * b, u32 stride,
+    u32 n, u32 * visible) {
+    const f32 * cx = b;
+    const f32 * cy = &b[stride];
+    const f32 * cz = &b[stride * 2];
+    const f32 * ex = &b[stride * 3];
+    const f32 * ey = &b[stride * 4];
+    const f32 * ez = &b[stride * 5];
+    /* A box reaches as far toward a plane as its center's distance plus */
+    /* its half sizes weighted by the size of the plane's normal parts   */
+    f32 aa[6], ab[6], ac[6];
+    u32 count = 0;
+    u32 i = 0;
+    u32 k;
+    for(k = 0; k < 6; k++) {
+        aa[k] = f->a[k] < 0.0f ? -f->a[k] : f->a[k];
+        ab[k] = f->b[k] < 0.0f ? -f->b[k] : f->b[k];
+        ac[k] = f->c[k] < 0.0f ? -f->c[k] : f->c[k];
+    }
+#ifdef MATH3D_SIMD
+    f4_t pa[6], pb[6], pc[6], pd[6], qa[6], qb[6], qc[6];
+    const f4_t zero = f4Splat(0.0f);
+    for(k = 0; k < 6; k++) {
+        pa[k] = f4Splat(f->a[k]);
+        pb[k] = f4Splat(f->b[k]);
+        pc[k] = f4Splat(f->c[k]);
+        pd[k] = f4Splat(f->d[k]);
+        qa[k] = f4Splat(aa[k]);
+        qb[k] = f4Splat(ab[k]);
+        qc[k] = f4Splat(ac[k]);
+    }
+    for(; i + 4 <= n; i += 4) {
+        const f4_t x = f4Load(&cx[i]);
+        const f4_t y = f4Load(&cy[i]);
+        const f4_t z = f4Load(&cz[i]);
+        const f4_t hx = f4Load(&ex[i]);
+        const f4_t hy = f4Load(&ey[i]);
+        const f4_t hz = f4Load(&ez[i]);
+        u32 mask = 15;
+        for(k = 0; k < 6; k++) {
+            const f4_t d = f4Add(f4Add(f4Mul(pa[k], x), f4Mul(pb[k], y)),
+                f4Add(f4Mul(pc[k], z), pd[k]));
+            const f4_t reach = f4Add(f4Add(f4Mul(qa[k], hx),
+                f4Mul(qb[k], hy)), f4Mul(qc[k], hz));
+            mask &= f4Mask(f4Ge(f4Add(d, reach), zero));
+        }
+        for(k = 0; k < 4; k++) {
+            visible[count] = i + k;
+            count += (mask >> k) & 1;
+        }
+    }
+#endif
+    for(; i < n; i++) {
+        u32 in = 1;
+        for(k = 0; k < 6; k++) {
+            const f32 d = f->a[k] * cx[i] + f->b[k] * cy[i]
+                + f->c[k] * cz[i] + f->d[k];
+            const f32 reach = aa[k] * ex[i] + ab[k] * ey[i] + ac[k] * ez[i];
+            in &= d + reach >= 0.0f;
+        }
+        visible[count] = i;
+        count += in;
+    }
+    return count;
+}
+
+#endif /* MKB_MATH3D_C */
@@ -0,0 +1,104 @@
+/* Copyright (c) 2023 Sam Blenny
+ * SPDX-License-Identifier: CC-BY-NC-SA-4.0
+ *
+ * 3D math for WebGL: matrices, quaternions, batch transforms, frustum
+ * culling, and matrix palettes, with SIMD versions of the batch passes.
+ */
+#ifndef MKB_MATH3D_H
+#define MKB_MATH3D_H
+
+/*
+ * Batches are parallel arrays of f32, all in one block with a stride
+ * between them. For example, a batch of points with stride s keeps x
+ * values at p[0..n-1], y at p[s..s+n-1], z at p[2*s..], and w at p[3*s..].
+ * This keeps each pass streaming through whole vectors of one component.
+ */
+
+/* Fields of a pose batch for mat4ComposeBatch(): translation, rotation */
+/* quaternion, and scale                                                */
+#define POSE_TX     (0)
+#define POSE_TY     (1)
+#define POSE_TZ     (2)
+#define POSE_QX     (3)
+#define POSE_QY     (4)
+#define POSE_QZ     (5)
+#define POSE_QW     (6)
+#define POSE_SX     (7)
+#define POSE_SY     (8)
+#define POSE_SZ     (9)
+#define POSE_FIELDS (10)
+
+/* 4x4 matrix in column major order, like WebGL uses: m[col * 4 + row] */
+typedef struct mat4 {
+    f32 m[16];
+} mat4_t;
+
+/* Rotation quaternion (w is the real part) */
+typedef struct quat {
+    f32 x;
+    f32 y;
+    f32 z;
+    f32 w;
+} quat_t;
+
+/* View frustum as 6 planes {a, b, c, d} with unit normals pointing inward, */
+/* so a point is inside a plane when a*x + b*y + c*z + d >= 0               */
+typedef struct frustum {
+    f32 a[6];
+    f32 b[6];
+    f32 c[6];
+    f32 d[6];
+} frustum_t;
+
+/* Set m to the identity matrix */
+static void mat4Identity(mat4_t * m);
+
+/* Set out = a * b. Out may be the same matrix as a or b. */
+static void mat4Mul(mat4_t * out, const mat4_t * a, const mat4_t * b);
+
+/* Set out[i] = a[i] * b[i] for n matrices. Out may be the same as a or b. */
+static void mat4MulBatch(mat4_t * out, const mat4_t * a, const mat4_t * b,
+    u32 n);
+
+/* Transform a batch of n points {x, y, z, w} (stride apart) by m, writing */
+/* to out, which may be the same as in                                    */
+static void mat4TransformBatch(const mat4_t * m, const f32 * in, f32 * out,
+    u32 stride, u32 n);
+
+/* Build a matrix for each of n poses (POSE_FIELDS arrays, stride apart)  */
+/* that scales, then rotates, then translates. Rotations should be unit   */
+/* quaternions.                                                            */
+static void mat4ComposeBatch(const f32 * pose, u32 stride, mat4_t * out,
+    u32 n);
+
+/* Turn n local joint matrices into model space matrices, in place, by     */
+/* multiplying each by its parent's. Parents must come before children.    */
+/* Joints with a parent of -1 (or not before them) are roots.              */
+static void mat4Hierarchy(mat4_t * mats, const i32 * parent, u32 n);
+
+/* Returns: a * b, which rotates by b and then by a */
+static quat_t quatMul(quat_t a, quat_t b);
+
+/* Returns: q scaled to unit length (a zero quaternion stays zero) */
+static quat_t quatNormalize(quat_t q);
+
+/* Scale a batch of n quaternions {x, y, z, w} (stride apart) to unit */
+/* length, in place. Zero quaternions stay zero.                      */
+static void quatNormalizeBatch(f32 * q, u32 stride, u32 n);
+
+/* Get the frustum planes of a view-projection matrix, for WebGL clip space */
+static void frustumFromMat4(frustum_t * f, const mat4_t * m);
+
+/* Find which of n spheres {x, y, z, radius} (stride apart) touch the */
+/* frustum, writing their indexes to visible (room for n).            */
+/* Returns: number of visible spheres                                 */
+static u32 frustumCullSpheres(const frustum_t * f, const f32 * s, u32 stride,
+    u32 n, u32 * visible);
+
+/* Find which of n boxes {center x, y, z, half size x, y, z} (stride apart) */
+/* touch the frustum, writing their indexes to visible (room for n).       */
+/* Returns: number of visible boxes                                         */
+static u32 frustumCullBoxes(const frustum_t * f, const f32 * b, u32 stride,
+    u32 n, u32 * visible);
+
+#endif /* MKB_MATH3D_H */
@@ -0,0 +1,1060 @@
+/* Copyright (c) 2023 Sam Blenny
+ * SPDX-License-Identifier: CC-BY-NC-SA-4.0
+ *
+ * Headless native benchmark for the engine. This includes the wasm module
+ * source, stubs out its js imports, then drives init() and next() with
+ * scripted gamepad input and reports per-frame time percentiles. After that,
+ * it measures entity updates and spatial queries at several entity counts,
+ * then A* searches and flow fields on several map sizes, then field of view
+ * and lighting at several wall densities, then particle updates, then the
+ * audio mixer, which also writes what it mixed to a WAV file, then 3D math
+ * batches, then sprite animation, then packing and decoding asset
+ * containers, then the job system with different numbers of threads. A
+ * summary of the engine's own frame time telemetry comes right after the
+ * frame times. Snapshot and re-simulation costs get measured after that,
+ * while the demo's game state is still in place.
+ *
+ * Usage: ./mkb_bench [frames]
+ */
+
+/* This unlocks clock_gettime(), pthreads, and sysconf() since the Makefile */
+/* uses `-ansi`                                                             */
+#define _POSIX_C_SOURCE 200112L
+/* Run the engine's jobs on threads, and benchmark the job system */
+#define MKB_THREADS
+#include <stdint.h>         /* uint8_t, uint16_t, int32_t, ... */
+#include <stdio.h>          /* printf() */
+#include <stdlib.h>         /* malloc(), free(), qsort(), atol() */
+#include <time.h>           /* clock_gettime() */
+#include <unistd.h>         /* sysconf() */
+/* Make room in the NPC entity store for the largest entity benchmark */
+#define ENTITY_MAX          (1 << 20)
+#define SPATIAL_BUCKETS_MAX (1 << 18)
+#define PARTICLE_MAX        (1 << 17)
+#include "mkb_wasm.c"
+#include "assetpack.c"
+
+
+/* Default number of frames to run */
+#define BENCH_FRAMES (2000000)
+
+/* One step of the input script: hold buttons for a number of frames */
+typedef struct bench_input {
+    u32 buttons;
+    u32 frames;
+} bench_input_t;
+
+/* Input script gets replayed in a loop. It covers walking, running,     */
+/* diagonals, bumping into the map edge, idle frames, and line drawing. */
+static const bench_input_t BENCH_SCRIPT[] = {
+    {0,                  30},
+    {GP_R,              120},
+    {GP_R|GP_B,         120},
+    {GP_D|GP_L,          90},
+    {0,                  10},
+    {GP_U,               60},
+    {GP_U|GP_L|GP_B,    200},
+    {GP_A,               20},
+    {GP_A|GP_D|GP_R,     45},
+    {GP_SELECT,           5},
+    {0,                  60},
+    {GP_D,              240},
+    {GP_L|GP_B,         240},
+};
+#define BENCH_SCRIPT_LEN (sizeof(BENCH_SCRIPT) / sizeof(BENCH_SCRIPT[0]))
+
+/* Entity counts for the entity benchmark, and the total number of entity */
+/* updates to run at each count                                           */
+static const u32 BENCH_ENTITIES[] = {10000, 100000, 1000000};
+#define BENCH_ENTITY_UPDATES (50000000)
+#define BENCH_QUERIES        (100000)
+
+/* Map sizes for the pathfinding benchmark. About 1 in 5 tiles is blocked. */
+static const u32 BENCH_MAPS[] = {256, 512, 1024};
+#define BENCH_SEARCHES    (200)
+#define BENCH_FLOW_BUILDS (200)
+#define BENCH_AGENTS      (1000)
+#define BENCH_FLOW_ROUNDS (1000)
+
+/* Iterations for the snapshot benchmark */
+#define BENCH_SNAPS   (10000)
+#define BENCH_REWINDS (1000)
+
+/* Rollback lengths in ticks for the re-simulation benchmark, and the */
+/* total number of ticks to re-simulate at each length                */
+static const u32 BENCH_RESIMS[] = {8, 30, 120, SNAP_RING_FRAMES};
+#define BENCH_RESIM_TICKS (100000)
+
+/* Wall densities for the FOV benchmark, in 1/64ths of tiles, and the number */
+/* of one tile steps to take on a 1024 tile square map at each density     */
+static const u32 BENCH_WALLS[] = {0, 1, 4, 13};
+#define BENCH_FOV_STEPS   (200000)
+#define BENCH_LIGHT_QUERY (1000000)
+
+/* Particles for the particle benchmark, and ticks to run. Each particle */
+/* lives 32 to 95 ticks, and dead ones get replaced each tick.          */
+#define BENCH_PARTICLES      (100000)
+#define BENCH_PARTICLE_TICKS (2000)
+
+/* Audio benchmark: output rate, seconds to mix, and the WAV file to write */
+#define BENCH_AUDIO_RATE    (48000)
+#define BENCH_AUDIO_SECONDS (10)
+#define BENCH_AUDIO_WAV     "mkb_audio.wav"
+
+/* 3D math benchmark: items per batch, and rounds to run. Objects for the */
+/* cull benchmark are spread over a cube this many units across, around a */
+/* camera with a 90 degree field of view.                                 */
+#define BENCH_MATH_ITEMS  (100000)
+#define BENCH_MATH_ROUNDS (200)
+#define BENCH_MATH_SPREAD (400)
+#define BENCH_MATH_JOINTS (64  /* Joints per skeleton */)
+
+/* Animation benchmark: sprites, ticks to run, and clips to pick from.   */
+/* Clips have 1 to 8 keyframes of 1 to 16 ticks, and half of them loop. */
+#define BENCH_ANIM_SPRITES (10000)
+#define BENCH_ANIM_TICKS   (10000)
+#define BENCH_ANIM_CLIPS   (32)
+
+/* Asset container benchmark: bytes per asset, times to encode and decode */
+/* each one, and bytes per read when streaming                            */
+#define BENCH_ASSET_LEN     (1 << 20)
+#define BENCH_ASSET_ENCODES (4)
+#define BENCH_ASSET_DECODES (20)
+#define BENCH_ASSET_READ    (4096)
+
+/* Job system benchmark: entities and sprites, fewest items per piece, and */
+/* graph runs per thread count                                             */
+#define BENCH_JOB_ITEMS (1 << 20)
+#define BENCH_JOB_GRAIN (16384)
+#define BENCH_JOB_RUNS  (20)
+
+
+/* ============================================ */
+/* == Stubs for functions imported from js   == */
+/* ============================================ */
+
+void js_trace(u32 code) {
+}
+
+void repaint() {
+}
+
+/* Read the monotonic clock in microseconds */
+u32 js_clock_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (u32)ts.tv_sec * 1000000u + (u32)ts.tv_nsec / 1000u;
+}
+
+
+/* =============== */
+/* == Benchmark == */
+/* =============== */
+
+/* Read the monotonic clock in nanoseconds */
+static u32 bench_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (u32)ts.tv_sec * 1000000000u + (u32)ts.tv_nsec;
+}
+
+/* Comparison function for sorting frame times with qsort() */
+static int bench_cmp(const void * a, const void * b) {
+    const u32 x = *(const u32 *)a;
+    const u32 y = *(const u32 *)b;
+    return (x > y) - (x < y);
+}
+
+/* Print the frame time at percentile p (in tenths of a percent) */
+static void bench_percentile(const char * name, const u32 * t, u32 n, u32 p) {
+    u32 i = (u32)(((uint64_t)(n - 1) * p) / 1000);
+    printf("  %-6s %8u ns\n", name, t[i]);
+}
+
+/* Time entity updates and view-sized spatial queries with n entities */
+static void bench_entities(u32 n) {
+    u32 seed = 1;
+    u32 i;
+    const i32 w = WORLD.tilesWide << ENTITY_SUB_SHIFT;
+    const i32 h = WORLD.tilesHigh << ENTITY_SUB_SHIFT;
+    u32 buckets = 1;
+    while(buckets < n / 4) {
+        buckets <<= 1;  /* Aim for a few entities per bucket */
+    }
+    entityClear(&NPCS, buckets);
+    for(i = 0; i < n; i++) {
+        seed = seed * 1664525u + 1013904223u;
+        const i32 x = (seed >> 8) % w;
+        seed = seed * 1664525u + 1013904223u;
+        const i32 y = (seed >> 8) % h;
+        seed = seed * 1664525u + 1013904223u;
+        const i32 vx = (i32)((seed >> 16) & 31) - 16;
+        const i32 vy = (i32)((seed >> 24) & 31) - 16;
+        entitySpawn(&NPCS, x, y, vx, vy, 1, ENTITY_ACTIVE);
+    }
+    /* Updates: integrate, then rebuild the spatial hash */
+    const u32 iters = BENCH_ENTITY_UPDATES / n;
+    uint64_t t_move = 0;
+    uint64_t t_hash = 0;
+    for(i = 0; i < iters; i++) {
+        const u32 t0 = bench_ns();
+        entityIntegrate(&NPCS, w, h);
+        const u32 t1 = bench_ns();
+        spatialBuild(&NPCS);
+        t_move += t1 - t0;
+        t_hash += bench_ns() - t1;
+    }
+    /* Queries: view-sized rectangles scattered around the world */
+    uint64_t found = 0;
+    const i32 qw = VIEW_WIDE << ENTITY_SUB_SHIFT;
+    const i32 qh = VIEW_HIGH << ENTITY_SUB_SHIFT;
+    const u32 t2 = bench_ns();
+    for(i = 0; i < BENCH_QUERIES; i++) {
+        seed = seed * 1664525u + 1013904223u;
+        const i32 x = (seed >> 8) % (w - qw);
+        seed = seed * 1664525u + 1013904223u;
+        const i32 y = (seed >> 8) % (h - qh);
+        found += spatialQuery(&NPCS, x, y, x + qw - 1, y + qh - 1,
+            VISIBLE, VISIBLE_MAX);
+    }
+    const u32 t_query = bench_ns() - t2;
+    printf("  %7u %9.2f %9.2f %9.1f %7.2f\n", n,
+        (double)t_move / ((double)iters * n),
+        (double)t_hash / ((double)iters * n),
+        (double)t_query / BENCH_QUERIES,
+        (double)found / BENCH_QUERIES);
+}
+
+/* Benchmark pathfinding on a size x size map with random obstacles */
+static void bench_paths(u32 size) {
+    static u32 out[PATH_STEPS_MAX];
+    static i32 agent_x[BENCH_AGENTS];
+    static i32 agent_y[BENCH_AGENTS];
+    u32 seed = 1;
+    u32 i;
+    pathInit(&PATHS, size, size);
+    for(i = 0; i < size * size; i++) {
+        seed = seed * 1664525u + 1013904223u;
+        if(((seed >> 16) % 5) == 0) {
+            pathSetBlocked(&PATHS, i % size, i / size, 1);
+        }
+    }
+    /* A* between random open tiles */
+    u32 found = 0;
+    uint64_t steps = 0;
+    uint64_t t_find = 0;
+    for(i = 0; i < BENCH_SEARCHES; i++) {
+        i32 c[4];
+        u32 j;
+        for(j = 0; j < 4; j += 2) {
+            do {
+                seed = seed * 1664525u + 1013904223u;
+                c[j] = (seed >> 8) % size;
+                seed = seed * 1664525u + 1013904223u;
+                c[j + 1] = (seed >> 8) % size;
+            } while(pathBlocked(&PATHS, c[j], c[j + 1]));
+        }
+        const u32 t0 = bench_ns();
+        const i32 n = pathFind(&PATHS, c[0], c[1], c[2], c[3],
+            out, PATH_STEPS_MAX);
+        t_find += bench_ns() - t0;
+        if(n >= 0) {
+            found += 1;
+            steps += n;
+        }
+    }
+    /* Flow fields for random goals. Each goal is new, so each is a miss. */
+    uint64_t t_build = 0;
+    const flow_field_t * f = 0;
+    for(i = 0; i < BENCH_FLOW_BUILDS; i++) {
+        seed = seed * 1664525u + 1013904223u;
+        const i32 gx = FLOW_RADIUS + (seed >> 8) % (size - FLOW_SIZE);
+        seed = seed * 1664525u + 1013904223u;
+        const i32 gy = FLOW_RADIUS + (seed >> 8) % (size - FLOW_SIZE);
+        pathSetBlocked(&PATHS, gx, gy, 0);
+        const u32 t0 = bench_ns();
+        f = flowField(&PATHS, gx, gy);
+        t_build += bench_ns() - t0;
+    }
+    /* Agents scattered around the last goal, each taking one step per */
+    /* round. Agents that arrive or get stuck stay put.                */
+    for(i = 0; i < BENCH_AGENTS; i++) {
+        seed = seed * 1664525u + 1013904223u;
+        agent_x[i] = f->left + (seed >> 8) % FLOW_SIZE;
+        seed = seed * 1664525u + 1013904223u;
+        agent_y[i] = f->top + (seed >> 8) % FLOW_SIZE;
+    }
+    u32 moves = 0;
+    const u32 t1 = bench_ns();
+    for(i = 0; i < BENCH_FLOW_ROUNDS; i++) {
+        u32 j;
+        for(j = 0; j < BENCH_AGENTS; j++) {
+            i32 nx;
+            i32 ny;
+            if(flowStep(&PATHS, f, agent_x[j], agent_y[j], &nx, &ny)) {
+                agent_x[j] = nx;
+                agent_y[j] = ny;
+                moves += 1;
+            }
+        }
+    }
+    const u32 t_step = bench_ns() - t1;
+    printf("  %5u %9.1f %6u/%-3u %5u %9.1f %7.2f %8u\n", size,
+        (double)t_find / BENCH_SEARCHES / 1000, found, BENCH_SEARCHES,
+        found ? (u32)(steps / found) : 0,
+        (double)t_build / BENCH_FLOW_BUILDS / 1000,
+        (double)t_step / ((double)BENCH_FLOW_ROUNDS * BENCH_AGENTS), moves);
+}
+
+/* Benchmark field of view for a random walk on a map with walls at a */
+/* density of walls/64, comparing fovLook() to casting all 8 octants   */
+static void bench_fov(u32 walls) {
+    static u32 rows[FOV_SIZE];
+    u32 seed = 1;
+    u32 i;
+    fovInit(&FOV, 1024, 1024);
+    for(i = 0; i < 1024 * 1024; i++) {
+        seed = seed * 1664525u + 1013904223u;
+        if(((seed >> 16) & 63) < walls) {
+            fovSetOpaque(&FOV, i & 1023, i >> 10, 1);
+        }
+    }
+    /* Random walk, one tile per step, looking after each step */
+    const u32 walk_seed = seed;
+    i32 x = 512;
+    i32 y = 512;
+    const u32 t0 = bench_ns();
+    for(i = 0; i < BENCH_FOV_STEPS; i++) {
+        seed = seed * 1664525u + 1013904223u;
+        x = (x + ((seed >> 16) % 3) - 1) & 1023;
+        y = (y + ((seed >> 24) % 3) - 1) & 1023;
+        fovLook(&FOV, x, y, FOV_RADIUS);
+    }
+    const u32 t_look = bench_ns() - t0;
+    /* Same walk, casting every octant */
+    seed = walk_seed;
+    x = 512;
+    y = 512;
+    const u32 t1 = bench_ns();
+    for(i = 0; i < BENCH_FOV_STEPS; i++) {
+        seed = seed * 1664525u + 1013904223u;
+        x = (x + ((seed >> 16) % 3) - 1) & 1023;
+        y = (y + ((seed >> 24) % 3) - 1) & 1023;
+        fovWindow(&FOV, x, y, FOV_RADIUS);
+        u32 j;
+        for(j = 0; j < FOV_SIZE; j++) {
+            rows[j] = 0;
+        }
+        for(j = 0; j < 8; j++) {
+            fovCast(&FOV, rows, j, FOV_RADIUS, 1, 1, 1, 0, 1);
+        }
+    }
+    const u32 t_cast = bench_ns() - t1;
+    /* Cached light queries around 16 lights */
+    for(i = 0; i < LIGHT_MAX; i++) {
+        lightSet(&FOV, i, 500 + (i & 3) * 8, 500 + (i >> 2) * 8, 10, 64);
+    }
+    u32 sum = 0;
+    const u32 t2 = bench_ns();
+    for(i = 0; i < BENCH_LIGHT_QUERY; i++) {
+        sum += lightLevel(&FOV, 495 + (i % 40), 495 + ((i / 40) % 40));
+    }
+    const u32 t_light = bench_ns() - t2;
+    printf("  %5u %9.1f %9.1f %7.2f %9.1f %7u\n", walls * 100 / 64,
+        (double)t_look / BENCH_FOV_STEPS, (double)t_cast / BENCH_FOV_STEPS,
+        (double)FOV.casts / BENCH_FOV_STEPS,
+        (double)t_light / BENCH_LIGHT_QUERY, sum / BENCH_LIGHT_QUERY);
+}
+
+/* Benchmark quick-save, quick-load, and rewind on the demo's game state, */
+/* and report the size of the deltas that the frames left in the ring    */
+static void bench_snap(void) {
+    u32 i;
+    u32 delta_words = 0;
+    for(i = 0; i < REWIND.frames; i++) {
+        delta_words += REWIND.len[(REWIND.first + i) % SNAP_RING_FRAMES];
+    }
+    printf("snapshots (%u bytes, %u NPCs):\n", snapshotSave(), NPCS.count);
+    printf("  %-15s %8.1f bytes (%u frames)\n", "delta per frame",
+        REWIND.frames ? 4.0 * delta_words / REWIND.frames : 0.0,
+        REWIND.frames);
+    u32 len = 0;
+    const u32 t0 = bench_ns();
+    for(i = 0; i < BENCH_SNAPS; i++) {
+        len = snapshotSave();
+    }
+    const u32 t1 = bench_ns();
+    for(i = 0; i < BENCH_SNAPS; i++) {
+        snapshotLoad(len);
+    }
+    const u32 t2 = bench_ns();
+    printf("  %-15s %8.2f us\n", "save", (t1 - t0) / 1e3 / BENCH_SNAPS);
+    printf("  %-15s %8.2f us\n", "load", (t2 - t1) / 1e3 / BENCH_SNAPS);
+    /* Run 60 frames, then rewind them */
+    uint64_t t_run = 0;
+    uint64_t t_rewind = 0;
+    for(i = 0; i < BENCH_REWINDS; i++) {
+        u32 j;
+        const u32 t3 = bench_ns();
+        for(j = 0; j < 60; j++) {
+            next(16 + (j & 1));
+        }
+        const u32 t4 = bench_ns();
+        rewindFrames(60);
+        t_run += t4 - t3;
+        t_rewind += bench_ns() - t4;
+    }
+    printf("  %-15s %8.2f us\n", "60 frames", t_run / 1e3 / BENCH_REWINDS);
+    printf("  %-15s %8.2f us\n", "rewind 60", t_rewind / 1e3 / BENCH_REWINDS);
+}
+
+/* Benchmark resimulate() at several rollback lengths. Inputs come from a
+ * loopback: each frame's gamepad state gets read back from GAMEPAD after the
+ * frame runs, and replaying them should land on the same state every time.
+ */
+static void bench_resim(void) {
+    static u32 inputs[SNAP_RING_FRAMES];
+    static u32 want[SNAP_WORDS_MAX];
+    const u32 words = snapWords(SNAP_REGIONS, SNAP_REGION_COUNT);
+    u32 i;
+    u32 f;
+    /* Start the ring over, then fill it with ticks of scripted input */
+    snapshotLoad(snapshotSave());
+    for(f = 0; REWIND.frames < SNAP_RING_FRAMES; f++) {
+        const u32 done = REWIND.frames;
+        GAMEPAD = BENCH_SCRIPT[(f / 20) % BENCH_SCRIPT_LEN].buttons;
+        next(16 + (f & 1));
+        for(i = done; i < REWIND.frames; i++) {
+            inputs[i] = GAMEPAD;
+        }
+    }
+    snapSave(SNAP_REGIONS, SNAP_REGION_COUNT, want);
+    printf("resim (ticks re-simulated from a snapshot, %u NPCs):\n",
+        NPCS.count);
+    printf("  %7s %9s %9s %7s\n", "ticks", "us/tick", "ticks/ms", "same");
+    for(i = 0; i < sizeof(BENCH_RESIMS) / sizeof(BENCH_RESIMS[0]); i++) {
+        const u32 n = BENCH_RESIMS[i];
+        const u32 rounds = BENCH_RESIM_TICKS / n;
+        u32 j;
+        for(j = 0; j < n; j++) {
+            RESIM_INPUT[j] = inputs[SNAP_RING_FRAMES - n + j];
+        }
+        const u32 t0 = bench_ns();
+        for(j = 0; j < rounds; j++) {
+            resimulate(n);
+        }
+        const double us = (bench_ns() - t0) / 1e3 / (rounds * n);
+        snapSave(SNAP_REGIONS, SNAP_REGION_COUNT, SNAPSHOT);
+        u32 same = 1;
+        for(j = 0; j < words; j++) {
+            same = same && SNAPSHOT[j] == want[j];
+        }
+        printf("  %7u %9.2f %9.1f %7s\n", n, us, 1e3 / us,
+            same ? "yes" : "no");
+    }
+}
+
+/* Benchmark the particle passes with the pool kept near BENCH_PARTICLES */
+/* by replacing dead particles each tick                                 */
+static void bench_particles(void) {
+    particle_pool_t * p = &PARTICLES;
+    u32 seed = 7;
+    uint64_t t_integrate = 0;
+    uint64_t t_compact = 0;
+    uint64_t t_emit = 0;
+    uint64_t t_instances = 0;
+    u32 killed = 0;
+    u32 i;
+    particleClear(p);
+    for(i = 0; i < BENCH_PARTICLE_TICKS; i++) {
+        const u32 t0 = bench_ns();
+        while(p->count < BENCH_PARTICLES) {
+            seed = seed * 1664525u + 1013904223u;
+            particleEmit(p, 500 << ENTITY_SUB_SHIFT, 500 << ENTITY_SUB_SHIFT,
+                (i32)((seed >> 8) & 63) - 32, -(i32)((seed >> 16) & 63),
+                32 + (seed >> 26), seed);
+        }
+        const u32 t1 = bench_ns();
+        particleIntegrate(p, PARTICLE_GRAVITY);
+        const u32 t2 = bench_ns();
+        killed += particleCompact(p);
+        const u32 t3 = bench_ns();
+        PARTICLE_COUNT = particleInstances(p, PARTICLE_INSTANCES,
+            PARTICLE_MAX, 490 << ENTITY_SUB_SHIFT, 490 << ENTITY_SUB_SHIFT);
+        const u32 t4 = bench_ns();
+        t_emit += t1 - t0;
+        t_integrate += t2 - t1;
+        t_compact += t3 - t2;
+        t_instances += t4 - t3;
+    }
+    const double n = (double)BENCH_PARTICLES * BENCH_PARTICLE_TICKS;
+    printf("particles (%u, %u lanes, ns per particle per tick):\n",
+        BENCH_PARTICLES, PARTICLE_LANES);
+    printf("  %-15s %8.3f\n", "integrate", t_integrate / n);
+    printf("  %-15s %8.3f (%.1f%% dead)\n", "compact", t_compact / n,
+        100.0 * killed / n);
+    printf("  %-15s %8.3f\n", "instances", t_instances / n);
+    printf("  %-15s %8.3f\n", "emit", t_emit / n);
+    printf("  %-15s %8.1f us\n", "tick",
+        (t_integrate + t_compact + t_instances + t_emit) / 1e3
+        / BENCH_PARTICLE_TICKS);
+}
+
+/* Write n as a little endian number of len bytes */
+static void bench_le(FILE * f, u32 n, u32 len) {
+    for(; len > 0; len--) {
+        fputc(n & 0xff, f);
+        n >>= 8;
+    }
+}
+
+/* Mix all voices for BENCH_AUDIO_SECONDS, with half of them resampling, */
+/* and write the result to a 16 bit stereo WAV file                      */
+static void bench_audio(void) {
+    const u32 blocks = BENCH_AUDIO_SECONDS * BENCH_AUDIO_RATE / AUDIO_BLOCK;
+    const u32 base = STEP_SOUND_FRAMES;
+    uint64_t t_mix = 0;
+    u32 i;
+    startAudio(BENCH_AUDIO_RATE);
+    /* Sound 1 loops a triangle wave of 100 Hz, and sound 2 is the footstep */
+    /* at a different rate                                                  */
+    for(i = 0; i < 480; i++) {
+        SOUND_PCM[base + i] = (i < 240 ? (i32)i : 480 - (i32)i) * 100 - 12000;
+    }
+    defineSound(1, base, 480, 0, 480, BENCH_AUDIO_RATE);
+    defineSound(2, 0, STEP_SOUND_FRAMES, 0, 0, 32000);
+    for(i = 0; i < VOICE_MAX; i++) {
+        const u32 pitch = (i & 1) ? PITCH_UNITY + i * 1500 : PITCH_UNITY;
+        const i32 pan = (i32)(i * 16) - AUDIO_UNITY;
+        playSound(1, AUDIO_UNITY / 16, pan, pitch);
+    }
+    FILE * f = fopen(BENCH_AUDIO_WAV, "wb");
+    if(f) {
+        const u32 bytes = blocks * AUDIO_BLOCK * 4;
+        fwrite("RIFF", 1, 4, f);
+        bench_le(f, 36 + bytes, 4);
+        fwrite("WAVEfmt ", 1, 8, f);
+        bench_le(f, 16, 4);                        /* fmt chunk size */
+        bench_le(f, 1, 2);                         /* PCM            */
+        bench_le(f, 2, 2);                         /* Channels       */
+        bench_le(f, BENCH_AUDIO_RATE, 4);
+        bench_le(f, BENCH_AUDIO_RATE * 4, 4);      /* Bytes per sec  */
+        bench_le(f, 4, 2);                         /* Bytes per frame */
+        bench_le(f, 16, 2);                        /* Bits per sample */
+        fwrite("data", 1, 4, f);
+        bench_le(f, bytes, 4);
+    }
+    for(i = 0; i < blocks; i++) {
+        /* A footstep every quarter second, on the last voice */
+        if(i % (BENCH_AUDIO_RATE / AUDIO_BLOCK / 4) == 0) {
+            stopVoice(VOICE_MAX - 1);
+            playSound(2, AUDIO_UNITY, 0, PITCH_UNITY);
+        }
+        const u32 t0 = bench_ns();
+        audioMixBlock(AUDIO_RING);
+        t_mix += bench_ns() - t0;
+        if(f) {
+            /* Interleave the planar block, back in the i16 range */
+            u32 j;
+            for(j = 0; j < AUDIO_BLOCK * 2; j++) {
+                const f32 smp = AUDIO_RING[(j & 1) * AUDIO_BLOCK + j / 2];
+                bench_le(f, (u16)(i16)(smp * 32768), 2);
+            }
+        }
+    }
+    if(f) {
+        fclose(f);
+    }
+    const double us = t_mix / 1e3 / blocks;
+    const double block_us = 1e6 * AUDIO_BLOCK / BENCH_AUDIO_RATE;
+    printf("audio (%u voices, %u Hz, %u frames per block):\n", VOICE_MAX,
+        BENCH_AUDIO_RATE, AUDIO_BLOCK);
+    printf("  %-15s %8.2f us (%.0fx real time)\n", "mix block", us,
+        block_us / us);
+    printf("  %-15s %8s\n", "wrote", f ? BENCH_AUDIO_WAV : "(failed)");
+    startAudio(0);
+}
+
+/* Measure batch transforms, frustum culling, and building matrix palettes */
+static void bench_math3d(void) {
+    const u32 n = BENCH_MATH_ITEMS;
+    f32 * pts = malloc(n * 4 * sizeof(f32));
+    f32 * out = malloc(n * 4 * sizeof(f32));
+    f32 * bounds = malloc(n * 6 * sizeof(f32));
+    f32 * pose = malloc(n * POSE_FIELDS * sizeof(f32));
+    u32 * visible = malloc(n * sizeof(u32));
+    i32 * parent = malloc(n * sizeof(i32));
+    mat4_t * mats = malloc(n * sizeof(mat4_t));
+    mat4_t * inv_bind = malloc(n * sizeof(mat4_t));
+    u32 seed = 11;
+    u32 i;
+    u32 r;
+    if(!pts || !out || !bounds || !pose || !visible || !parent || !mats
+        || !inv_bind) {
+        printf("math3d: out of memory\n");
+        return;
+    }
+    /* Random points, bounds, and poses. Each skeleton's joints have */
+    /* parents earlier in the same skeleton.                         */
+    for(i = 0; i < n * 6; i++) {
+        seed = seed * 1664525u + 1013904223u;
+        const f32 u = (f32)(seed >> 8) / (1 << 24);
+        bounds[i] = i < n * 3 ? (u - 0.5f) * BENCH_MATH_SPREAD : u * 4.0f;
+        if(i < n * 4) {
+            pts[i] = i < n * 3 ? u * 10.0f : 1.0f;
+        }
+    }
+    for(i = 0; i < n * POSE_FIELDS; i++) {
+        seed = seed * 1664525u + 1013904223u;
+        pose[i] = (f32)(seed >> 8) / (1 << 24) - 0.5f;
+    }
+    for(i = 0; i < n; i++) {
+        seed = seed * 1664525u + 1013904223u;
+        const u32 j = i % BENCH_MATH_JOINTS;
+        parent[i] = j == 0 ? -1 : (i32)(i - 1 - (seed >> 16) % j);
+        mat4Identity(&inv_bind[i]);
+    }
+    /* Perspective camera at the origin looking down -z, with near and */
+    /* far planes at 0.1 and half the spread                           */
+    mat4_t proj;
+    const f32 z_near = 0.1f;
+    const f32 z_far = BENCH_MATH_SPREAD / 2;
+    for(i = 0; i < 16; i++) {
+        proj.m[i] = 0.0f;
+    }
+    proj.m[0] = 1.0f;
+    proj.m[5] = 1.0f;
+    proj.m[10] = (z_far + z_near) / (z_near - z_far);
+    proj.m[11] = -1.0f;
+    proj.m[14] = 2.0f * z_far * z_near / (z_near - z_far);
+    frustum_t f;
+    frustumFromMat4(&f, &proj);
+    uint64_t t[7] = {0, 0, 0, 0, 0, 0, 0};
+    u32 seen_spheres = 0;
+    u32 seen_boxes = 0;
+    for(r = 0; r < BENCH_MATH_ROUNDS; r++) {
+        const u32 t0 = bench_ns();
+        mat4TransformBatch(&proj, pts, out, n, n);
+        const u32 t1 = bench_ns();
+        seen_spheres = frustumCullSpheres(&f, bounds, n, n, visible);
+        const u32 t2 = bench_ns();
+        seen_boxes = frustumCullBoxes(&f, bounds, n, n, visible);
+        const u32 t3 = bench_ns();
+        quatNormalizeBatch(&pose[POSE_QX * n], n, n);
+        const u32 t4 = bench_ns();
+        mat4ComposeBatch(pose, n, mats, n);
+        const u32 t5 = bench_ns();
+        mat4Hierarchy(mats, parent, n);
+        const u32 t6 = bench_ns();
+        mat4MulBatch(mats, mats, inv_bind, n);
+        const u32 t7 = bench_ns();
+        t[0] += t1 - t0;
+        t[1] += t2 - t1;
+        t[2] += t3 - t2;
+        t[3] += t4 - t3;
+        t[4] += t5 - t4;
+        t[5] += t6 - t5;
+        t[6] += t7 - t6;
+    }
+    const double items = (double)n * BENCH_MATH_ROUNDS;
+#ifdef MATH3D_SIMD
+    const char * lanes = "4 lanes";
+#else
+    const char * lanes = "scalar";
+#endif
+    printf("math3d (%u items, %s, ns per item):\n", n, lanes);
+    printf("  %-15s %8.3f\n", "transform", t[0] / items);
+    printf("  %-15s %8.3f (%.1f%% visible)\n", "cull spheres", t[1] / items,
+        100.0 * seen_spheres / n);
+    printf("  %-15s %8.3f (%.1f%% visible)\n", "cull boxes", t[2] / items,
+        100.0 * seen_boxes / n);
+    printf("  %-15s %8.3f\n", "normalize", t[3] / items);
+    printf("  %-15s %8.3f\n", "compose", t[4] / items);
+    printf("  %-15s %8.3f\n", "hierarchy", t[5] / items);
+    printf("  %-15s %8.3f\n", "palette", t[6] / items);
+    free(pts);
+    free(out);
+    free(bounds);
+    free(pose);
+    free(visible);
+    free(parent);
+    free(mats);
+    free(inv_bind);
+}
+
+/* Measure the animation pass for BENCH_ANIM_SPRITES sprites playing */
+/* random clips at random speeds                                      */
+static void bench_anim(void) {
+    anim_clips_t * clips = malloc(sizeof(anim_clips_t));
+    anim_set_t * set = malloc(sizeof(anim_set_t));
+    u16 * out = malloc(BENCH_ANIM_SPRITES * sizeof(u16));
+    u16 frame[8];
+    u16 ticks[8];
+    u32 seed = 13;
+    u32 sum = 0;
+    u32 i;
+    u32 j;
+    if(!clips || !set || !out) {
+        printf("anim: out of memory\n");
+        return;
+    }
+    animClipsClear(clips);
+    for(i = 0; i < BENCH_ANIM_CLIPS; i++) {
+        seed = seed * 1664525u + 1013904223u;
+        const u32 n = 1 + (seed >> 29);
+        for(j = 0; j < n; j++) {
+            seed = seed * 1664525u + 1013904223u;
+            frame[j] = (seed >> 24) & 15;
+            ticks[j] = 1 + ((seed >> 16) & 15);
+        }
+        animClip(clips, i, frame, ticks, n, (i & 1) ? ANIM_LOOP : 0);
+    }
+    set->count = 0;
+    animResize(set, BENCH_ANIM_SPRITES);
+    for(i = 0; i < BENCH_ANIM_SPRITES; i++) {
+        seed = seed * 1664525u + 1013904223u;
+        set->base[i] = (seed >> 8) & 0xff0;
+        animPlay(set, i, (seed >> 16) % BENCH_ANIM_CLIPS,
+            ANIM_SPEED_UNITY / 2 + (seed >> 24) % (ANIM_SPEED_UNITY * 2));
+    }
+    const u32 t0 = bench_ns();
+    for(i = 0; i < BENCH_ANIM_TICKS; i++) {
+        animEval(set, clips, 1, out, 0, BENCH_ANIM_SPRITES);
+        sum += out[i % BENCH_ANIM_SPRITES];
+    }
+    const u32 dt = bench_ns() - t0;
+    printf("anim (%u sprites, %u clips, checksum %u):\n", BENCH_ANIM_SPRITES,
+        BENCH_ANIM_CLIPS, sum & 0xffff);
+    printf("  %-15s %8.3f ns\n", "per sprite",
+        (double)dt / BENCH_ANIM_SPRITES / BENCH_ANIM_TICKS);
+    printf("  %-15s %8.2f us\n", "per tick", dt / 1e3 / BENCH_ANIM_TICKS);
+    free(clips);
+    free(set);
+    free(out);
+}
+
+/* Fill data with len bytes of a kind of asset (BENCH_ASSET_KINDS order) */
+static void bench_asset_data(u8 * data, u32 len, u32 kind) {
+    u32 seed = 17 + kind;
+    u32 i;
+    for(i = 0; i < len; i++) {
+        seed = seed * 1664525u + 1013904223u;
+        const u32 r = seed >> 24;
+        if(kind == 0) {
+            /* Tiles: 8x8 pixel tiles of 2 bit patterns, 1/16 noisy pixels */
+            const u32 tile = i >> 6;
+            const u32 x = i & 7;
+            const u32 y = (i >> 3) & 7;
+            data[i] = r < 16 ? r & 3 : ((x ^ y) + tile * 7 / 5) & 3;
+        } else if(kind == 1) {
+            /* Map: runs of the same tile, averaging 8 long */
+            data[i] = i == 0 || r >= 32 ? (i ? data[i - 1] : 0) : r & 15;
+        } else if(kind == 2) {
+            /* Audio: 16 bit samples of a triangle wave with a little noise */
+            const u32 frame = i >> 1;
+            const i32 tri = (i32)(frame % 200) - 100;
+            const i32 s = (tri < 0 ? -tri : tri) * 300 + (i32)(r & 7);
+            data[i] = (i & 1) ? (u8)((u32)s >> 8) : (u8)s;
+        } else {
+            /* Noise, which doesn't compress */
+            data[i] = r;
+        }
+    }
+}
+
+/* Measure packing and decoding one BENCH_ASSET_LEN byte asset of each kind */
+static void bench_assets(void) {
+    static const char * kinds[] = {"tiles", "map", "audio", "noise"};
+    const u32 cap = BENCH_ASSET_LEN + ASSET_HEADER_LEN + ASSET_ENTRY_LEN
+        + ASSET_ALIGN;
+    u8 * data = malloc(BENCH_ASSET_LEN);
+    u8 * blob = malloc(cap);
+    u8 * buf = malloc(ASSET_CHUNK);
+    asset_pool_t * pool = malloc(sizeof(asset_pool_t));
+    const double mb = (double)BENCH_ASSET_LEN / (1 << 20);
+    u32 kind;
+    u32 i;
+    u32 j;
+    if(!data || !blob || !buf || !pool) {
+        printf("assets: out of memory\n");
+        return;
+    }
+    printf("assets (%u KiB each, MiB/s of decompressed data):\n",
+        BENCH_ASSET_LEN >> 10);
+    printf("  %-6s %7s %9s %9s %9s\n", "kind", "ratio", "encode", "decode",
+        "stream");
+    for(kind = 0; kind < sizeof(kinds) / sizeof(kinds[0]); kind++) {
+        asset_builder_t b;
+        asset_pack_t pack;
+        bench_asset_data(data, BENCH_ASSET_LEN, kind);
+        /* Encode: build a container with the asset compressed */
+        u32 t0 = bench_ns();
+        for(i = 0; i < BENCH_ASSET_ENCODES; i++) {
+            assetBuildBegin(&b, blob, cap, 1);
+            assetBuildAdd(&b, ASSET_AUDIO, data, BENCH_ASSET_LEN, 1);
+        }
+        const u32 t_encode = bench_ns() - t0;
+        if(!assetOpen(&pack, blob, assetBuildEnd(&b))) {
+            printf("assets: can't open %s\n", kinds[kind]);
+            return;
+        }
+        const u32 offset = _asset_u32(blob, assetEntry(0) + ASSET_OFFSET);
+        const u32 size = _asset_u32(blob, assetEntry(0) + ASSET_SIZE);
+        const u32 lz = _asset_u16(blob, assetEntry(0) + ASSET_FLAGS);
+        /* Decode: every chunk with lzDecode() straight into one buffer */
+        u32 t_decode = 0;
+        if(lz) {
+            const u32 chunks = assetChunks(BENCH_ASSET_LEN);
+            t0 = bench_ns();
+            for(i = 0; i < BENCH_ASSET_DECODES; i++) {
+                for(j = 0; j < chunks; j++) {
+                    const u32 start = _asset_u32(blob, offset + j * 4);
+                    const u32 end = _asset_u32(blob, offset + j * 4 + 4);
+                    lzDecode(&blob[offset + start], end - start, buf,
+                        ASSET_CHUNK);
+                }
+            }
+            t_decode = bench_ns() - t0;
+        }
+        /* Stream: read the asset in BENCH_ASSET_READ byte pieces through */
+        /* an empty pool, checking the data                               */
+        u32 bad = 0;
+        t0 = bench_ns();
+        for(i = 0; i < BENCH_ASSET_DECODES; i++) {
+            assetPoolClear(pool);
+            for(j = 0; j < BENCH_ASSET_LEN; j += BENCH_ASSET_READ) {
+                assetRead(&pack, pool, 0, j, buf, BENCH_ASSET_READ);
+                bad += buf[0] != data[j];
+            }
+        }
+        const u32 t_stream = bench_ns() - t0;
+        printf("  %-6s %6.1f%% %9.0f ", kinds[kind],
+            100.0 * size / BENCH_ASSET_LEN,
+            mb * BENCH_ASSET_ENCODES / (t_encode / 1e9));
+        if(lz) {
+            printf("%9.0f ", mb * BENCH_ASSET_DECODES / (t_decode / 1e9));
+        } else {
+            printf("%9s ", "raw");
+        }
+        printf("%9.0f%s\n", mb * BENCH_ASSET_DECODES / (t_stream / 1e9),
+            bad ? " (mismatch!)" : "");
+    }
+    free(data);
+    free(blob);
+    free(buf);
+    free(pool);
+}
+
+/* Inputs for the job benchmark's jobs */
+static anim_clips_t * BENCH_JOB_CLIPS;
+static anim_set_t * BENCH_JOB_ANIMS;
+static u16 * BENCH_JOB_FRAMES;
+
+/* Job: move entities begin to end - 1 */
+static void bench_job_move(void * arg, u32 begin, u32 end) {
+    entityIntegrateRange(&NPCS, begin, end,
+        WORLD.tilesWide << ENTITY_SUB_SHIFT,
+        WORLD.tilesHigh << ENTITY_SUB_SHIFT);
+}
+
+/* Job: rebuild the entity spatial hash */
+static void bench_job_hash(void * arg, u32 begin, u32 end) {
+    spatialBuild(&NPCS);
+}
+
+/* Job: move particles begin to end - 1 */
+static void bench_job_particles(void * arg, u32 begin, u32 end) {
+    particleIntegrateRange(&PARTICLES, begin, end, PARTICLE_GRAVITY);
+}
+
+/* Job: animate sprites begin to end - 1 */
+static void bench_job_anim(void * arg, u32 begin, u32 end) {
+    animEval(BENCH_JOB_ANIMS, BENCH_JOB_CLIPS, 1, BENCH_JOB_FRAMES, begin,
+        end);
+}
+
+/* Run a graph of update stages on BENCH_JOB_ITEMS entities and sprites  */
+/* and a full particle pool, with 1, 2, 4, ... threads. Moving entities, */
+/* particles, and sprites are parallel-fors that run alongside each      */
+/* other, but rebuilding the spatial hash waits for the entities and     */
+/* runs on one thread, which limits how far it scales.                   */
+static void bench_jobs(void) {
+    static job_graph_t graph;
+    static job_system_t js;
+    const u16 frames[2] = {0, 1};
+    const u16 ticks[2] = {3, 5};
+    const long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    u32 seed = 21;
+    double base = 0;
+    u32 threads;
+    u32 i;
+    BENCH_JOB_CLIPS = malloc(sizeof(anim_clips_t));
+    BENCH_JOB_ANIMS = malloc(sizeof(anim_set_t));
+    BENCH_JOB_FRAMES = malloc(BENCH_JOB_ITEMS * sizeof(u16));
+    if(!BENCH_JOB_CLIPS || !BENCH_JOB_ANIMS || !BENCH_JOB_FRAMES) {
+        printf("jobs: out of memory\n");
+        return;
+    }
+    /* Entities */
+    const i32 w = WORLD.tilesWide << ENTITY_SUB_SHIFT;
+    const i32 h = WORLD.tilesHigh << ENTITY_SUB_SHIFT;
+    entityClear(&NPCS, BENCH_JOB_ITEMS / 4);
+    for(i = 0; i < BENCH_JOB_ITEMS; i++) {
+        seed = seed * 1664525u + 1013904223u;
+        const i32 x = (seed >> 8) % w;
+        seed = seed * 1664525u + 1013904223u;
+        const i32 y = (seed >> 8) % h;
+        entitySpawn(&NPCS, x, y, (i32)((seed >> 16) & 31) - 16,
+            (i32)((seed >> 24) & 31) - 16, 1, ENTITY_ACTIVE);
+    }
+    /* Particles, which live longer than the benchmark runs */
+    particleClear(&PARTICLES);
+    while(PARTICLES.count < PARTICLE_MAX) {
+        seed = seed * 1664525u + 1013904223u;
+        particleEmit(&PARTICLES, 0, 0, (i32)((seed >> 8) & 63) - 32,
+            -(i32)((seed >> 16) & 63), 1 << 30, seed);
+    }
+    /* Sprites */
+    animClipsClear(BENCH_JOB_CLIPS);
+    animClip(BENCH_JOB_CLIPS, 0, frames, ticks, 2, ANIM_LOOP);
+    BENCH_JOB_ANIMS->count = 0;
+    animResize(BENCH_JOB_ANIMS, BENCH_JOB_ITEMS);
+    for(i = 0; i < BENCH_JOB_ITEMS; i++) {
+        animPlay(BENCH_JOB_ANIMS, i, 0, ANIM_SPEED_UNITY / 2 + (i & 255));
+    }
+    /* The graph: hashing waits for moving, and the rest run alongside */
+    jobGraphClear(&graph);
+    const i32 move = jobFor(&graph, bench_job_move, 0, BENCH_JOB_ITEMS,
+        BENCH_JOB_GRAIN);
+    const i32 hash = jobAdd(&graph, bench_job_hash, 0);
+    jobFor(&graph, bench_job_particles, 0, PARTICLE_MAX, BENCH_JOB_GRAIN);
+    jobFor(&graph, bench_job_anim, 0, BENCH_JOB_ITEMS, BENCH_JOB_GRAIN);
+    jobAfter(&graph, hash, move);
+    /* Time the serial part on its own, to show the limit on speedup */
+    u32 t0 = bench_ns();
+    for(i = 0; i < BENCH_JOB_RUNS; i++) {
+        bench_job_hash(0, 0, 1);
+    }
+    const double serial = (bench_ns() - t0) / 1e6 / BENCH_JOB_RUNS;
+    printf("jobs (%u entities and sprites, %u particles, %ld cores):\n",
+        BENCH_JOB_ITEMS, PARTICLE_MAX, cores);
+    printf("  spatial hash alone (serial): %.3f ms\n", serial);
+    printf("  %7s %9s %9s %9s\n", "threads", "ms/run", "speedup", "steals");
+    for(threads = 1; threads <= JOB_THREADS_MAX; threads *= 2) {
+        if(jobInit(&js, threads) != threads) {
+            printf("  %7u threads wouldn't start\n", threads);
+            jobShutdown(&js);
+            break;
+        }
+        jobRun(&js, &graph);  /* Warm up */
+        const u32 steals = js.steals;
+        t0 = bench_ns();
+        for(i = 0; i < BENCH_JOB_RUNS; i++) {
+            jobRun(&js, &graph);
+        }
+        const double ms = (bench_ns() - t0) / 1e6 / BENCH_JOB_RUNS;
+        base = threads == 1 ? ms : base;
+        printf("  %7u %9.3f %8.2fx %9.1f\n", threads, ms, base / ms,
+            (double)(js.steals - steals) / BENCH_JOB_RUNS);
+        jobShutdown(&js);
+    }
+    free(BENCH_JOB_CLIPS);
+    free(BENCH_JOB_ANIMS);
+    free(BENCH_JOB_FRAMES);
+}
+
+/* Report what the engine's own telemetry saw during the frames */
+static void bench_telemetry(void) {
+    static const char * names[TELEM_STAGES] = {
+        "input", "sim", "effects", "anim", "render",
+    };
+    const telemetry_t * t = &TELEMETRY;
+    u32 i;
+    printf("telemetry (%u frames, %u over %u us budget):\n", t->frames,
+        t->over_budget, t->budget_us);
+    printf("  %-8s %8.2f us mean, %u us max\n", "frame",
+        (double)t->total_us / t->frames, t->max_us);
+    for(i = 0; i < TELEM_STAGES; i++) {
+        printf("  %-8s %8.2f us mean, %u us max\n", names[i],
+            (double)t->stage_total[i] / t->frames, t->stage_max[i]);
+    }
+    printf("  %-8s %8u us\n", "p50 >=", telemPercentile(t, 500));
+    printf("  %-8s %8u us\n", "p99 >=", telemPercentile(t, 990));
+}
+
+int main(int argc, char ** argv) {
+    u32 frames = BENCH_FRAMES;
+    if(argc > 1 && atol(argv[1]) > 0) {
+        frames = (u32)atol(argv[1]);
+    }
+    u32 * times = (u32 *)malloc(frames * sizeof(u32));
+    if(times == 0) {
+        printf("out of memory\n");
+        return 1;
+    }
+    /* Run the frames, alternating 16 and 17 ms to approximate 60 fps */
+    init();
+    u32 step = 0;
+    u32 held = 0;
+    uint64_t total = 0;
+    u32 list_words = 0;
+    u32 i;
+    for(i = 0; i < frames; i++) {
+        if(held >= BENCH_SCRIPT[step].frames) {
+            held = 0;
+            step = (step + 1) % BENCH_SCRIPT_LEN;
+        }
+        GAMEPAD = BENCH_SCRIPT[step].buttons;
+        held += 1;
+        const u32 start = bench_ns();
+        next(16 + (i & 1));
+        const u32 dt = bench_ns() - start;
+        times[i] = dt;
+        total += dt;
+        list_words += RENDER_LIST_LEN;
+    }
+    /* Report */
+    qsort((void *)times, frames, sizeof(u32), bench_cmp);
+    printf("frames: %u\n", frames);
+    printf("render list words: %u\n", list_words);
+    printf("frame time (includes clock overhead):\n");
+    printf("  %-6s %8u ns\n", "mean", (u32)(total / frames));
+    bench_percentile("p50",   times, frames, 500);
+    bench_percentile("p90",   times, frames, 900);
+    bench_percentile("p99",   times, frames, 990);
+    bench_percentile("p99.9", times, frames, 999);
+    bench_percentile("max",   times, frames, 1000);
+    free(times);
+    bench_telemetry();
+    bench_snap();
+    bench_resim();
+    /* Entity benchmarks */
+    printf("entities (ns per entity for move and hash, ns per query):\n");
+    printf("  %7s %9s %9s %9s %7s\n", "count", "move", "hash", "query",
+        "found");
+    for(i = 0; i < sizeof(BENCH_ENTITIES) / sizeof(BENCH_ENTITIES[0]); i++) {
+        bench_entities(BENCH_ENTITIES[i]);
+    }
+    /* Pathfinding benchmarks */
+    printf("paths (us per A* search and flow build, ns per flow step):\n");
+    printf("  %5s %9s %10s %5s %9s %7s %8s\n", "size", "search", "found",
+        "steps", "build", "step", "moves");
+    for(i = 0; i < sizeof(BENCH_MAPS) / sizeof(BENCH_MAPS[0]); i++) {
+        bench_paths(BENCH_MAPS[i]);
+    }
+    /* Field of view benchmarks */
+    printf("fov (ns per step for fovLook() and for casting all octants, "
+        "ns per light query):\n");
+    printf("  %5s %9s %9s %7s %9s %7s\n", "wall%", "look", "cast all",
+        "octants", "light", "level");
+    for(i = 0; i < sizeof(BENCH_WALLS) / sizeof(BENCH_WALLS[0]); i++) {
+        bench_fov(BENCH_WALLS[i]);
+    }
+    bench_particles();
+    bench_audio();
+    bench_math3d();
+    bench_anim();
+    bench_assets();
+    bench_jobs();
+    return 0;
+}
@@ -15,4 +15,7 @@ typedef  int16_t i16;
 typedef  int32_t i32;
 typedef uint32_t u32;
 
+/* Floating point type for 3D math (see math3d.h) */
+typedef float f32;
+
 #endif /* MKB_ENGINE_H */
@@ -0,0 +1,179 @@
+/* Copyright (c) 2023 Sam Blenny
+ * SPDX-License-Identifier: CC-BY-NC-SA-4.0
+ *
+ * Asset packer: builds an asset container (see asset.h) from files. Assets
+ * get ids in the order they're listed, and get compressed unless that
+ * doesn't make them smaller, or they come after -r (for raw). Before
+ * writing the container, the packer reads every asset back to check it.
+ *
+ * Usage: ./mkb_pack out.mkba [-r] type:file ...
+ *   type is one of tiles, map, font, or audio
+ *
+ * For example, this stores a font as is, so it can be used in place:
+ *   ./mkb_pack demo.mkba tiles:tiles.bin map:world.mktm -r font:font.bin
+ */
+
+#include <stdint.h>         /* uint8_t, uint16_t, int32_t, ... */
+#include <stdio.h>          /* printf(), fopen(), fread(), ... */
+#include <stdlib.h>         /* malloc(), calloc(), free() */
+#include <string.h>         /* strcmp(), strncmp(), strchr(), strlen() */
+#include "mkb_engine.h"
+#include "asset.c"
+#include "assetpack.c"
+
+
+/* Names of asset types, indexed by type */
+static const char * PACK_TYPES[] = {"", "tiles", "map", "font", "audio"};
+#define PACK_TYPE_COUNT (sizeof(PACK_TYPES) / sizeof(PACK_TYPES[0]))
+
+/* One file to pack */
+typedef struct pack_file {
+    u32 type;
+    u32 compress;
+    const char * path;
+    u8 * data;
+    u32 len;
+} pack_file_t;
+
+/* Parse "type:path" into f.                         */
+/* Returns: 1 = Success, 0 = unknown type or no path */
+static u32 pack_parse(const char * arg, pack_file_t * f) {
+    const char * colon = strchr(arg, ':');
+    u32 t;
+    if(colon == 0 || colon[1] == 0) {
+        return 0;
+    }
+    for(t = 1; t < PACK_TYPE_COUNT; t++) {
+        const u32 n = strlen(PACK_TYPES[t]);
+        if(colon - arg == n && strncmp(arg, PACK_TYPES[t], n) == 0) {
+            f->type = t;
+            f->path = colon + 1;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/* Read all of f->path into f->data.  */
+/* Returns: 1 = Success, 0 = failed   */
+static u32 pack_read(pack_file_t * f) {
+    FILE * in = fopen(f->path, "rb");
+    if(in == 0) {
+        return 0;
+    }
+    long len = -1;
+    if(fseek(in, 0, SEEK_END) == 0) {
+        len = ftell(in);
+    }
+    if(len < 0 || len > 0x7fffffff || fseek(in, 0, SEEK_SET) != 0) {
+        fclose(in);
+        return 0;
+    }
+    f->len = (u32)len;
+    f->data = malloc(f->len ? f->len : 1);
+    const u32 ok = f->data != 0 && fread(f->data, 1, f->len, in) == f->len;
+    fclose(in);
+    return ok;
+}
+
+/* Open the container in out and read every asset back, to check that it */
+/* decodes to what went in. Also prints a table of the assets.          */
+/* Returns: 1 = Success, 0 = failed                                     */
+static u32 pack_verify(const u8 * out, u32 len, const pack_file_t * files,
+    u32 count) {
+    asset_pack_t pack;
+    asset_pool_t * pool = malloc(sizeof(asset_pool_t));
+    u8 * buf = malloc(ASSET_CHUNK);
+    u32 id;
+    if(pool == 0 || buf == 0 || !assetOpen(&pack, out, len)) {
+        printf("can't open the container\n");
+        return 0;
+    }
+    assetPoolClear(pool);
+    printf("  id  type      length      packed  ratio  file\n");
+    for(id = 0; id < count; id++) {
+        const pack_file_t * f = &files[id];
+        const u32 size = _asset_u32(out, assetEntry(id) + ASSET_SIZE);
+        const u32 length = assetLength(&pack, id);
+        u32 pos = 0;
+        u32 i;
+        if(assetType(&pack, id) != f->type || length != f->len) {
+            printf("bad index entry for %s\n", f->path);
+            return 0;
+        }
+        while(pos < length) {
+            const u32 got = assetRead(&pack, pool, id, pos, buf, ASSET_CHUNK);
+            for(i = 0; i < got && buf[i] == f->data[pos + i]; i++) {
+            }
+            if(got == 0 || i < got) {
+                printf("%s doesn't decode right at %u\n", f->path, pos + i);
+                return 0;
+            }
+            pos += got;
+        }
+        printf("%4u  %-6s %10u  %10u  %4.0f%%  %s\n", id, PACK_TYPES[f->type],
+            length, size, length ? 100.0 * size / length : 100.0, f->path);
+    }
+    free(buf);
+    free(pool);
+    return 1;
+}
+
+int main(int argc, char ** argv) {
+    pack_file_t * files = calloc(argc, sizeof(pack_file_t));
+    u32 count = 0;
+    u32 raw = 0;
+    u32 cap = ASSET_HEADER_LEN;
+    int i;
+    if(argc < 3 || files == 0) {
+        printf("Usage: %s out.mkba [-r] type:file ...\n", argv[0]);
+        printf("  type is one of tiles, map, font, or audio\n");
+        printf("  -r stores the next file without compressing it\n");
+        return 1;
+    }
+    for(i = 2; i < argc; i++) {
+        if(strcmp(argv[i], "-r") == 0) {
+            raw = 1;
+            continue;
+        }
+        pack_file_t * f = &files[count];
+        if(!pack_parse(argv[i], f)) {
+            printf("bad asset (want type:file): %s\n", argv[i]);
+            return 1;
+        }
+        if(!pack_read(f)) {
+            printf("can't read %s\n", f->path);
+            return 1;
+        }
+        f->compress = !raw;
+        raw = 0;
+        /* Assets only get compressed when that makes them smaller, so */
+        /* this is enough room                                         */
+        cap += ASSET_ENTRY_LEN + ASSET_ALIGN + f->len;
+        count += 1;
+    }
+    u8 * out = malloc(cap);
+    asset_builder_t b;
+    if(out == 0 || !assetBuildBegin(&b, out, cap, count)) {
+        printf("out of memory\n");
+        return 1;
+    }
+    for(i = 0; i < (int)count; i++) {
+        const pack_file_t * f = &files[i];
+        if(assetBuildAdd(&b, f->type, f->data, f->len, f->compress) < 0) {
+            printf("no room for %s\n", f->path);
+            return 1;
+        }
+    }
+    const u32 len = assetBuildEnd(&b);
+    if(!pack_verify(out, len, files, count)) {
+        return 1;
+    }
+    FILE * fout = fopen(argv[1], "wb");
+    if(fout == 0 || fwrite(out, 1, len, fout) != len || fclose(fout) != 0) {
+        printf("can't write %s\n", argv[1]);
+        return 1;
+    }
+    printf("wrote %s (%u bytes)\n", argv[1], len);
+    return 0;
+}
@@ -0,0 +1,2171 @@
+/* Copyright (c) 2023 Sam Blenny
+ * SPDX-License-Identifier: CC-BY-NC-SA-4.0
+ *
+ * Test the engine natively by including the wasm module source and stubbing
+ * out the functions it imports from js.
+ */
+
+/* This unlocks pthreads since the Makefile uses `-ansi` */
+#define _POSIX_C_SOURCE 200112L
+/* Test the job system with threads, though the wasm module has none */
+#define MKB_THREADS
+#include <stdint.h>         /* uint8_t, uint16_t, int32_t, ... */
+#include <stdio.h>          /* printf() */
+#include <string.h>         /* strlen(), memcpy() */
+/* Leave NPCs out of the demo world so render lists are predictable */
+#define DEMO_NPCS (0)
+#include "mkb_wasm.c"
+#include "assetpack.c"
+
+
+/* ============================== */
+/* == Test scoring global vars == */
+/* ============================== */
+
+/* Global buffer to hold names of failing tests */
+static char FAIL_LOG[1024];
+static u32 FAIL_LOG_LEN = 0;
+
+/* Global var for counting passed tests */
+static int TEST_SCORE_PASS = 0;
+
+/* Global var for counting failed tests */
+static int TEST_SCORE_FAIL = 0;
+
+
+/* ==================================== */
+/* == Test scoring utility functions == */
+/* ==================================== */
+
+/* Record score for passed test and print the pass message */
+static void score_pass(const char * name) {
+    TEST_SCORE_PASS += 1;
+    printf("[%s: pass]\n\n", name);
+}
+
+/* Record score for failed test and print the FAIL message */
+static void score_fail(const char * name) {
+    TEST_SCORE_FAIL += 1;
+    printf("[%s: FAIL]\n\n", name);
+    char buf[128];
+    sprintf(buf, "[  %-22.22s ]\n", name);
+    u32 length = strlen(buf);
+    if(FAIL_LOG_LEN + length < sizeof(FAIL_LOG)) {
+        memcpy((void *)&FAIL_LOG[FAIL_LOG_LEN], buf, length);
+        FAIL_LOG_LEN += length;
+    }
+}
+
+/* Check for match between expected words and the render list.  */
+/* Returns: 1 when lists match, 0 when lists do not match       */
+static int test_render_match(const u32 * expected, u32 len) {
+    u32 i;
+    if(len != RENDER_LIST_LEN) {
+        printf(">>> expected render list length: %d <<<\n", len);
+        printf(">>>   actual render list length: %d <<<\n", RENDER_LIST_LEN);
+        return 0;
+    }
+    for(i = 0; i < len; i++) {
+        if(expected[i] != RENDER_LIST[i]) {
+            printf(">>> i:%3d: expected %08X, actual %08X <<<\n",
+                i, expected[i], RENDER_LIST[i]);
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/* Score a render list check */
+static void test_render_score(const char * name, const u32 * expected,
+    u32 len) {
+    if(test_render_match(expected, len)) {
+        score_pass(name);
+    } else {
+        score_fail(name);
+    }
+}
+
+/* Run one frame long enough for at least one simulation tick */
+static void test_tick(void) {
+    next(SIM_TICK_US / 1000 + 1);
+}
+
+/* Run frames until one has a non-empty render list, up to max_frames. */
+/* Returns: number of frames run                                       */
+static u32 test_tick_until_drawn(u32 max_frames) {
+    u32 n;
+    for(n = 1; n <= max_frames; n++) {
+        test_tick();
+        if(RENDER_LIST_LEN > 0) {
+            break;
+        }
+    }
+    return n;
+}
+
+/* Queue an input event for dt_ms after the most recent frame */
+static void test_push_input(u32 dt_ms, u32 buttons) {
+    const u32 i = (INPUT_HEAD & INPUT_QUEUE_MASK) * 2;
+    INPUT_QUEUE[i] = SIM_CLOCK_MS + dt_ms;
+    INPUT_QUEUE[i + 1] = buttons;
+    INPUT_HEAD += 1;
+}
+
+/* Build a render list command header word */
+#define HDR(OP, WORDS) (((WORDS) << 16) | (OP))
+
+
+/* ============================================ */
+/* == Stubs for functions imported from js   == */
+/* ============================================ */
+
+void js_trace(u32 code) {
+    /* Trace codes aren't interesting for the tests */
+}
+
+void repaint() {
+}
+
+/* Fake clock that ticks TEST_CLOCK_STEP us each time it gets read */
+static u32 TEST_CLOCK_US = 0;
+static u32 TEST_CLOCK_STEP = 0;
+
+u32 js_clock_us(void) {
+    TEST_CLOCK_US += TEST_CLOCK_STEP;
+    return TEST_CLOCK_US;
+}
+
+
+/* =========================== */
+/* == Render list tests     == */
+/* =========================== */
+
+/* Player starts in the middle of the world, with the camera centered */
+#define START_X (WORLD_TILES / 2)
+#define START_Y (WORLD_TILES / 2)
+#define CAM_X   (START_X - VIEW_WIDE / 2)
+#define CAM_Y   (START_Y - VIEW_HIGH / 2)
+
+/* Player sprite tile for facing F, with walk cycle frame N (0 is standing) */
+#define PLAYER_TILE(F, N) (PLAYER_SPRITE + (F) * PLAYER_FRAMES + (N))
+
+/* init() should describe a full frame */
+static void test_rInit(void) {
+    const u32 expected[] = {
+        HDR(RC_DIRTY, 5), 0, 0, VIEW_WIDE, VIEW_HIGH,
+        HDR(RC_CAMERA, 3), CAM_X, CAM_Y,
+        HDR(RC_VERTICES, 3), 0, TILE_VERTS,
+        HDR(RC_TILES, 2), 0,
+        HDR(RC_SPRITES, 4), START_X, START_Y, PLAYER_SPRITE,
+    };
+    init();
+    test_render_score("rInit", expected, sizeof(expected) / 4);
+}
+
+/* Frames with no input and no motion should have an empty render list */
+static void test_rIdle(void) {
+    next(16);
+    test_render_score("rIdle", 0, 0);
+}
+
+/* Holding right past the debounce delay should move the player one tile, */
+/* and the camera should scroll along with the player                     */
+static void test_rMove(void) {
+    const u32 face[] = {
+        HDR(RC_DIRTY, 5), 0, 0, VIEW_WIDE, VIEW_HIGH,
+        HDR(RC_CAMERA, 3), CAM_X, CAM_Y,
+        HDR(RC_TILES, 2), 0,
+        HDR(RC_SPRITES, 4), START_X, START_Y, PLAYER_TILE(FACE_RIGHT, 1),
+    };
+    const u32 step[] = {
+        HDR(RC_DIRTY, 5), 0, 0, VIEW_WIDE, VIEW_HIGH,
+        HDR(RC_CAMERA, 3), CAM_X + 1, CAM_Y,
+        HDR(RC_VERTICES, 3), 0, TILE_VERTS,
+        HDR(RC_TILES, 2), 0,
+        HDR(RC_SPRITES, 4), START_X + 1, START_Y, PLAYER_TILE(FACE_RIGHT, 1),
+    };
+    /* Button-down changes gamepad state, so the whole frame is dirty */
+    GAMEPAD = GP_R;
+    test_tick();
+    test_render_score("rMoveFace", face, sizeof(face) / 4);
+    /* After debounce delay, the player steps and the camera scrolls, */
+    /* which changes every row of tiles                                */
+    test_tick_until_drawn(20);
+    test_render_score("rMoveStep", step, sizeof(step) / 4);
+    GAMEPAD = 0;
+    test_tick();
+}
+
+/* Holding A should switch from drawing tiles to drawing lines */
+static void test_rLines(void) {
+    const u32 expected[] = {
+        HDR(RC_DIRTY, 5), 0, 0, VIEW_WIDE, VIEW_HIGH,
+        HDR(RC_CAMERA, 3), CAM_X + 1, CAM_Y,
+        HDR(RC_LINES, 3), 0, TILE_VERTS,
+        HDR(RC_SPRITES, 4), START_X + 1, START_Y, PLAYER_TILE(FACE_RIGHT, 0),
+    };
+    GAMEPAD = GP_A;
+    test_tick();
+    test_render_score("rLines", expected, sizeof(expected) / 4);
+    GAMEPAD = 0;
+    test_tick();
+}
+
+/* At the edge of the world, the camera stops scrolling, so only the      */
+/* player's old and new tiles should be dirty                             */
+static void test_rEdge(void) {
+    const u32 expected[] = {
+        HDR(RC_DIRTY, 5), 1, 0, 1, 1,
+        HDR(RC_DIRTY, 5), 0, 0, 1, 1,
+        HDR(RC_CAMERA, 3), 0, 0,
+        HDR(RC_TILES, 2), 0,
+        HDR(RC_SPRITES, 4), 0, 0, PLAYER_TILE(FACE_LEFT, 1),
+    };
+    PLAYER_X = 1;
+    PLAYER_Y = 0;
+    GAMEPAD = GP_L;
+    test_tick();
+    test_tick_until_drawn(20);
+    test_render_score("rEdge", expected, sizeof(expected) / 4);
+    GAMEPAD = 0;
+    test_tick();
+}
+
+/* Tile layer vertices should match the tiles, and only rows whose tiles */
+/* changed should get rebuilt and listed for upload                      */
+static void test_rVertices(void) {
+    const u32 expected[] = {
+        HDR(RC_VERTICES, 3), 2 * TILEMESH_ROW_VERTS, 2 * TILEMESH_ROW_VERTS,
+        HDR(RC_VERTICES, 3), 5 * TILEMESH_ROW_VERTS, TILEMESH_ROW_VERTS,
+    };
+    static u16 tiles[VIEW_HIGH * VIEW_WIDE];
+    static u8 verts[TILEMESH_VERTS * TILEMESH_VERTEX_BYTES];
+    static tilemesh_t mesh;
+    const u32 rows = (1 << 2) | (1 << 3) | (1 << 5);
+    u32 i;
+    for(i = 0; i < VIEW_HIGH * VIEW_WIDE; i++) {
+        tiles[i] = 1000 + i;
+    }
+    tilemeshReset(&mesh);
+    u32 ok = tilemeshBuild(&mesh, tiles, verts) == (1 << VIEW_HIGH) - 1
+        && tilemeshBuild(&mesh, tiles, verts) == 0;
+    /* The second vertex of tile (3, 2) is its bottom left corner */
+    const u8 * v = &verts[(2 * VIEW_WIDE + 3) * TILEMESH_TILE_VERTS * 4 + 4];
+    ok = ok && v[0] == 3 && v[1] == 3 && v[2] == 2 * VIEW_WIDE + 3
+        && v[3] == (u8)(1000 + 2 * VIEW_WIDE + 3);
+    tiles[2 * VIEW_WIDE + 3] = 7;
+    tiles[3 * VIEW_WIDE] = 7;
+    tiles[5 * VIEW_WIDE + VIEW_WIDE - 1] = 7;
+    ok = ok && tilemeshBuild(&mesh, tiles, verts) == rows && v[3] == 7
+        && v[-1] == 7 && v[23] == (u8)(1000 + 2 * VIEW_WIDE + 4);
+    /* Adjacent rows share one command */
+    renderBegin();
+    renderVertexRows(rows);
+    ok = ok && test_render_match(expected, sizeof(expected) / 4);
+    /* The demo's vertices match its view */
+    ok = ok && TILE_VERTICES[3] == (u8)VIEW_TILES[0]
+        && TILE_VERTICES[TILE_VERTS * 4 - 1]
+            == (u8)VIEW_TILES[VIEW_WIDE * VIEW_HIGH - 1];
+    if(ok) {
+        score_pass("rVertices");
+    } else {
+        score_fail("rVertices");
+    }
+}
+
+/* Consecutive sprites should share one header, and a full list should drop */
+/* commands rather than write past the end                                  */
+static void test_rSprites(void) {
+    const u32 expected[] = {
+        HDR(RC_SPRITES, 7), 1, 2, 3, 4, 5, 6,
+        HDR(RC_TILES, 2), 0,
+        HDR(RC_SPRITES, 4), 7, 8, 9,
+    };
+    renderBegin();
+    renderSprite(1, 2, 3);
+    renderSprite(4, 5, 6);
+    renderTiles(0);
+    renderSprite(7, 8, 9);
+    test_render_score("rSprites", expected, sizeof(expected) / 4);
+    /* Fill the list, then make sure the length stays in bounds */
+    renderBegin();
+    u32 i;
+    for(i = 0; i < RENDER_LIST_MAX; i++) {
+        renderSprite(i, i, i);
+        renderDirty(i, i, 1, 1);
+    }
+    if(RENDER_LIST_LEN <= RENDER_LIST_MAX
+        && RENDER_LIST[0] == HDR(RC_SPRITES, 4)
+        && RENDER_LIST[4] == HDR(RC_DIRTY, 5)) {
+        score_pass("rOverflow");
+    } else {
+        score_fail("rOverflow");
+    }
+}
+
+
+/* ==================== */
+/* == Tile map tests == */
+/* ==================== */
+
+/* Get the tile id at (x, y). Tiles outside the map are 0. */
+static u16 test_tile(tilemap_t * map, u32 x, u32 y) {
+    if(x >= map->tilesWide || y >= map->tilesHigh) {
+        return 0;
+    }
+    const u16 * chunk = tilemapChunk(map, x >> TILEMAP_CHUNK_SHIFT,
+        y >> TILEMAP_CHUNK_SHIFT);
+    return chunk[((y & TILEMAP_CHUNK_MASK) << TILEMAP_CHUNK_SHIFT)
+        + (x & TILEMAP_CHUNK_MASK)];
+}
+
+/* Pack a 2x2 chunk map where each tile's id encodes its own position */
+static u32 test_tilemap_blob(u8 * blob, u32 blob_size) {
+    static u16 chunk[TILEMAP_CHUNK_TILES];
+    u32 pos = TILEMAP_HEADER_LEN + 4 * 4;
+    u32 n;
+    u32 i;
+    memcpy((void *)blob, "MKTM\x02\x00\x02\x00", TILEMAP_HEADER_LEN);
+    for(n = 0; n < 4; n++) {
+        for(i = 0; i < TILEMAP_CHUNK_TILES; i++) {
+            const u32 x = (n & 1) * TILEMAP_CHUNK + (i & TILEMAP_CHUNK_MASK);
+            const u32 y = (n >> 1) * TILEMAP_CHUNK + (i >> TILEMAP_CHUNK_SHIFT);
+            chunk[i] = (y << 8) | x;
+        }
+        blob[TILEMAP_HEADER_LEN + n * 4    ] = (u8)  pos;
+        blob[TILEMAP_HEADER_LEN + n * 4 + 1] = (u8) (pos >> 8);
+        blob[TILEMAP_HEADER_LEN + n * 4 + 2] = (u8) (pos >> 16);
+        blob[TILEMAP_HEADER_LEN + n * 4 + 3] = 0;
+        pos += tilemapPackChunk(chunk, &blob[pos], blob_size - pos);
+    }
+    return pos;
+}
+
+/* Packed chunks should decode back to the same tiles, runs should compress */
+/* repeated tiles, and malformed blobs should be rejected                   */
+static void test_tPack(void) {
+    static u8 blob[TILEMAP_HEADER_LEN + 16 + 4 * TILEMAP_CHUNK_TILES * 4];
+    static u16 flat[TILEMAP_CHUNK_TILES];
+    static tilemap_t map;
+    u8 small[8];
+    const u32 len = test_tilemap_blob(blob, sizeof(blob));
+    u32 ok = tilemapLoad(&map, blob, len)
+        && map.tilesWide == 2 * TILEMAP_CHUNK
+        && map.tilesHigh == 2 * TILEMAP_CHUNK
+        && test_tile(&map, 0, 0) == 0
+        && test_tile(&map, 33, 2) == ((2 << 8) | 33)
+        && test_tile(&map, 63, 63) == ((63 << 8) | 63)
+        && test_tile(&map, 64, 0) == 0
+        && !tilemapLoad(&map, blob, 12)
+        && !tilemapLoad(&map, (const u8 *)"MKTX\x01\x00\x01\x00", 8);
+    /* A chunk of all the same tile packs into one run */
+    u32 i;
+    for(i = 0; i < TILEMAP_CHUNK_TILES; i++) {
+        flat[i] = 7;
+    }
+    ok = ok && tilemapPackChunk(flat, small, sizeof(small)) == 4
+        && small[0] == (TILEMAP_CHUNK_TILES & 255)
+        && small[1] == (TILEMAP_CHUNK_TILES >> 8) && small[2] == 7
+        && tilemapPackChunk(flat, small, 3) == 0;
+    if(ok) {
+        score_pass("tPack");
+    } else {
+        score_fail("tPack");
+    }
+}
+
+/* Corrupt blobs should be rejected or decode as 0 tiles, without reading */
+/* past the end of the blob                                              */
+static void test_tCorrupt(void) {
+    static u8 blob[TILEMAP_HEADER_LEN + 16 + 4 * TILEMAP_CHUNK_TILES * 4];
+    static tilemap_t map;
+    const u32 len = test_tilemap_blob(blob, sizeof(blob));
+    /* 0xffff x 0xffff chunks needs a chunk table of 4 * 0xfffe0001 bytes, */
+    /* which wraps a u32 to something that looks small enough             */
+    u8 huge[TILEMAP_HEADER_LEN + 16];
+    memcpy((void *)huge, "MKTM\xff\xff\xff\xff", TILEMAP_HEADER_LEN);
+    u32 ok = !tilemapLoad(&map, huge, sizeof(huge))
+        && !tilemapLoad(&map, blob, TILEMAP_HEADER_LEN + 15);
+    /* A chunk offset near 0xffffffff would wrap pos + 4 past the check */
+    blob[TILEMAP_HEADER_LEN + 4] = 0xfe;
+    blob[TILEMAP_HEADER_LEN + 5] = 0xff;
+    blob[TILEMAP_HEADER_LEN + 6] = 0xff;
+    blob[TILEMAP_HEADER_LEN + 7] = 0xff;
+    ok = ok && tilemapLoad(&map, blob, len)
+        && test_tile(&map, 33, 2) == 0
+        && test_tile(&map, 63, 31) == 0
+        && test_tile(&map, 2, 33) == ((33 << 8) | 2);
+    if(ok) {
+        score_pass("tCorrupt");
+    } else {
+        score_fail("tCorrupt");
+    }
+}
+
+/* Culling should copy the visible tiles, including across chunk corners */
+static void test_tCull(void) {
+    static u8 blob[TILEMAP_HEADER_LEN + 16 + 4 * TILEMAP_CHUNK_TILES * 4];
+    static tilemap_t map;
+    tilemapLoad(&map, blob, test_tilemap_blob(blob, sizeof(blob)));
+    /* Camera clamps to the map edges */
+    u32 ok = cameraFollow(&map, 1000, 1000)
+        && CAMERA_X == 2 * TILEMAP_CHUNK - VIEW_WIDE
+        && CAMERA_Y == 2 * TILEMAP_CHUNK - VIEW_HIGH
+        && cameraFollow(&map, 0, 0) && CAMERA_X == 0 && CAMERA_Y == 0
+        && !cameraFollow(&map, 3, 2);
+    /* View straddles all 4 chunks */
+    cameraFollow(&map, TILEMAP_CHUNK, TILEMAP_CHUNK);
+    tilemapCull(&map);
+    u32 x;
+    u32 y;
+    for(y = 0; y < VIEW_HIGH; y++) {
+        for(x = 0; x < VIEW_WIDE; x++) {
+            const u32 wx = CAMERA_X + x;
+            const u32 wy = CAMERA_Y + y;
+            ok = ok && VIEW_TILES[y * VIEW_WIDE + x] == ((wy << 8) | wx);
+        }
+    }
+    ok = ok && CAMERA_X < TILEMAP_CHUNK && CAMERA_Y < TILEMAP_CHUNK;
+    if(ok) {
+        score_pass("tCull");
+    } else {
+        score_fail("tCull");
+    }
+}
+
+/* Walking around should only decompress chunks as they come into view, */
+/* and the cache should evict the least recently used chunk when full   */
+static void test_tCache(void) {
+    u32 ok = 1;
+    u32 x;
+    /* The world is already loaded by init(). Scroll one screen at a time */
+    /* to the right along the top row of chunks.                          */
+    tilemapLoad(&WORLD, WORLD.blob, WORLD.blobLen);
+    cameraFollow(&WORLD, 0, 0);
+    tilemapCull(&WORLD);
+    ok = ok && WORLD.decodes == 1;
+    for(x = 0; x < WORLD.tilesWide; x++) {
+        cameraFollow(&WORLD, x, 0);
+        tilemapCull(&WORLD);
+    }
+    ok = ok && WORLD.decodes == WORLD_CHUNKS;
+    /* Scrolling back over the most recent chunks hits the cache */
+    for(x = WORLD.tilesWide; x > WORLD.tilesWide - 4 * TILEMAP_CHUNK; x--) {
+        cameraFollow(&WORLD, x - 1, 0);
+        tilemapCull(&WORLD);
+    }
+    ok = ok && WORLD.decodes == WORLD_CHUNKS;
+    /* But the first chunk got evicted long ago */
+    cameraFollow(&WORLD, 0, 0);
+    tilemapCull(&WORLD);
+    ok = ok && WORLD.decodes == WORLD_CHUNKS + 1
+        && test_tile(&WORLD, 20, 40) == ((20 >> 4) + (40 >> 4));
+    if(ok) {
+        score_pass("tCache");
+    } else {
+        score_fail("tCache");
+    }
+}
+
+
+/* ================== */
+/* == Entity tests == */
+/* ================== */
+
+/* Entities should move by their velocity and bounce off the world edges */
+static void test_eIntegrate(void) {
+    static entity_store_t es;
+    entityClear(&es, 64);
+    u32 ok = entitySpawn(&es, 10, 10, 5, -3, 1, ENTITY_ACTIVE) == 0
+        && entitySpawn(&es, 98, 1, 4, -4, 2, ENTITY_ACTIVE) == 1;
+    entityIntegrate(&es, 100, 100);
+    ok = ok && es.x[0] == 15 && es.y[0] == 7 && es.vx[0] == 5
+        && es.vy[0] == -3
+        && es.x[1] == 99 && es.y[1] == 0 && es.vx[1] == -4 && es.vy[1] == 4;
+    entityIntegrate(&es, 100, 100);
+    ok = ok && es.x[1] == 95 && es.y[1] == 4;
+    /* Fill the store */
+    while(entitySpawn(&es, 0, 0, 0, 0, 0, 0) >= 0) {
+    }
+    ok = ok && es.count == ENTITY_MAX;
+    if(ok) {
+        score_pass("eIntegrate");
+    } else {
+        score_fail("eIntegrate");
+    }
+}
+
+/* Spatial queries should find exactly the same entities as a brute force */
+/* search, even when cells from different places share a hash bucket      */
+static void test_eSpatial(void) {
+    static entity_store_t es;
+    static u32 found[ENTITY_MAX];
+    u32 seed = 1;
+    u32 i;
+    u32 q;
+    u32 ok = 1;
+    entityClear(&es, 64);
+    for(i = 0; i < ENTITY_MAX; i++) {
+        seed = seed * 1664525u + 1013904223u;
+        const i32 x = (seed >> 8) & 0x3ffff;
+        seed = seed * 1664525u + 1013904223u;
+        const i32 y = (seed >> 8) & 0x3ffff;
+        entitySpawn(&es, x, y, 0, 0, 0, (i % 10) ? ENTITY_ACTIVE : 0);
+    }
+    spatialBuild(&es);
+    for(q = 0; q < 50 && ok; q++) {
+        seed = seed * 1664525u + 1013904223u;
+        const i32 x0 = (seed >> 8) & 0x3ffff;
+        seed = seed * 1664525u + 1013904223u;
+        const i32 y0 = (seed >> 8) & 0x3ffff;
+        const i32 x1 = x0 + (q * 997) % 0x8000;
+        const i32 y1 = y0 + (q * 1499) % 0x8000;
+        const u32 n = spatialQuery(&es, x0, y0, x1, y1, found, ENTITY_MAX);
+        /* Count matches the brute force way, and check every found id */
+        u32 count = 0;
+        for(i = 0; i < es.count; i++) {
+            count += (es.flags[i] & ENTITY_ACTIVE) && es.x[i] >= x0
+                && es.x[i] <= x1 && es.y[i] >= y0 && es.y[i] <= y1;
+        }
+        ok = ok && n == count;
+        for(i = 0; i < n && ok; i++) {
+            const u32 id = found[i];
+            ok = (es.flags[id] & ENTITY_ACTIVE) && es.x[id] >= x0
+                && es.x[id] <= x1 && es.y[id] >= y0 && es.y[id] <= y1;
+        }
+    }
+    /* Results past out_max get counted but not written */
+    found[1] = 0xffffffff;
+    ok = ok && spatialQuery(&es, 0, 0, 0x3ffff, 0x3ffff, found, 1)
+        == ENTITY_MAX - (ENTITY_MAX + 9) / 10 && found[1] == 0xffffffff;
+    if(ok) {
+        score_pass("eSpatial");
+    } else {
+        score_fail("eSpatial");
+    }
+}
+
+/* NPCs in view should get drawn after the player, and NPCs moving to a   */
+/* different tile should trigger a redraw                                 */
+static void test_eRender(void) {
+    const u32 expected[] = {
+        HDR(RC_DIRTY, 5), 0, 0, VIEW_WIDE, VIEW_HIGH,
+        HDR(RC_CAMERA, 3), 0, 0,
+        HDR(RC_TILES, 2), 0,
+        HDR(RC_SPRITES, 7), 0, 0, PLAYER_TILE(FACE_LEFT, 0), 3, 4, 5,
+    };
+    entityClear(&NPCS, NPC_BUCKETS);
+    entitySpawn(&NPCS, (3 << ENTITY_SUB_SHIFT) - 1, 4 << ENTITY_SUB_SHIFT,
+        1, 0, 5, ENTITY_ACTIVE);
+    /* Out of view */
+    entitySpawn(&NPCS, 500 << ENTITY_SUB_SHIFT, 4 << ENTITY_SUB_SHIFT,
+        1, 0, 6, ENTITY_ACTIVE);
+    test_tick();
+    test_render_score("eRender", expected, sizeof(expected) / 4);
+    test_tick();
+    test_render_score("eRenderIdle", 0, 0);
+    entityClear(&NPCS, NPC_BUCKETS);
+    VISIBLE_SUM = 0;
+}
+
+
+/* ======================== */
+/* == Pathfinding tests  == */
+/* ======================== */
+
+/* Shared by the path tests, since path_t is too big for the stack */
+static path_t TEST_PATH;
+
+/* A* should find a shortest path around a wall, through a gap that it */
+/* can't reach by cutting a corner, and fail when there's no path      */
+static void test_pFind(void) {
+    path_t * p = &TEST_PATH;
+    u32 out[64];
+    u32 i;
+    u32 ok = pathInit(p, 20, 20) && !pathInit(p, 0, 20)
+        && !pathInit(p, PATH_TILES_MAX, 2);
+    pathInit(p, 20, 20);
+    /* Wall at x = 10 with a gap at the bottom */
+    for(i = 0; i < 19; i++) {
+        pathSetBlocked(p, 10, i, 1);
+    }
+    ok = ok && pathBlocked(p, 10, 0) && !pathBlocked(p, 10, 19)
+        && pathBlocked(p, -1, 0) && pathBlocked(p, 20, 0);
+    /* 14 steps down to (9, 19), 2 through the gap, then 14 up to the goal */
+    const i32 steps = pathFind(p, 5, 5, 15, 5, out, 64);
+    ok = ok && steps == 30 && out[29] == 5 * 20 + 15;
+    u32 prev = 5 * 20 + 5;
+    for(i = 0; ok && i < 30; i++) {
+        const i32 dx = (i32)(out[i] % 20) - (i32)(prev % 20);
+        const i32 dy = (i32)(out[i] / 20) - (i32)(prev / 20);
+        ok = dx >= -1 && dx <= 1 && dy >= -1 && dy <= 1
+            && !pathBlocked(p, out[i] % 20, out[i] / 20);
+        prev = out[i];
+    }
+    ok = ok && out[14] == 19 * 20 + 10;
+    /* Steps past out_max get counted but not written */
+    const u32 first = out[0];
+    out[0] = 0;
+    out[1] = 0xffffffff;
+    ok = ok && pathFind(p, 5, 5, 15, 5, out, 1) == 30
+        && out[0] == first && out[1] == 0xffffffff;
+    /* Zero steps from the goal to itself */
+    ok = ok && pathFind(p, 5, 5, 5, 5, out, 64) == 0;
+    /* Close the gap */
+    pathSetBlocked(p, 10, 19, 1);
+    ok = ok && pathFind(p, 5, 5, 15, 5, out, 64) == -1
+        && pathFind(p, 10, 5, 15, 5, out, 64) == -1;
+    /* Diagonal between two blocked tiles */
+    pathInit(p, 2, 2);
+    pathSetBlocked(p, 1, 0, 1);
+    pathSetBlocked(p, 0, 1, 1);
+    ok = ok && pathFind(p, 0, 0, 1, 1, out, 64) == -1;
+    if(ok) {
+        score_pass("pFind");
+    } else {
+        score_fail("pFind");
+    }
+}
+
+/* Flow fields should lead agents to the goal, stay cached until a tile */
+/* changes in a chunk they overlap, and reuse the least recently used   */
+/* cache slot                                                           */
+static void test_pFlow(void) {
+    path_t * p = &TEST_PATH;
+    u32 ok = pathInit(p, 256, 256);
+    flow_field_t * f = flowField(p, 100, 100);
+    ok = ok && p->flowBuilds == 1 && flowField(p, 100, 100) == f
+        && p->flowBuilds == 1;
+    /* Walk to the goal around a wall across the diagonal. Each step should */
+    /* get closer, and the costs of the steps should add up to the distance */
+    /* of the start tile.                                                   */
+    pathSetBlocked(p, 85, 115, 1);
+    pathSetBlocked(p, 84, 114, 1);
+    pathSetBlocked(p, 86, 116, 1);
+    f = flowField(p, 100, 100);
+    ok = ok && p->flowBuilds == 2;
+    i32 x = 70;
+    i32 y = 130;
+    i32 nx;
+    i32 ny;
+    u32 dist = f->dist[(y - f->top) * FLOW_SIZE + (x - f->left)];
+    ok = ok && dist > 30 * PATH_COST_DIAGONAL && dist != FLOW_UNREACHED;
+    u32 steps = 0;
+    while(steps < 100 && flowStep(p, f, x, y, &nx, &ny)) {
+        const u32 cost = (nx != x && ny != y)
+            ? PATH_COST_DIAGONAL : PATH_COST_STRAIGHT;
+        ok = ok && !pathBlocked(p, nx, ny) && cost <= dist
+            && f->dist[(ny - f->top) * FLOW_SIZE + (nx - f->left)]
+            == dist - cost;
+        dist -= cost;
+        x = nx;
+        y = ny;
+        steps += 1;
+    }
+    ok = ok && x == 100 && y == 100 && dist == 0;
+    /* Outside the field */
+    ok = ok && !flowStep(p, f, 0, 0, &nx, &ny);
+    /* Changing a tile in a chunk the field doesn't overlap keeps it */
+    pathSetBlocked(p, 250, 250, 1);
+    ok = ok && flowField(p, 100, 100) == f && p->flowBuilds == 2;
+    /* Other goals fill the cache, then evict the least recently used */
+    u32 i;
+    for(i = 1; i < FLOW_CACHE_SLOTS; i++) {
+        ok = ok && flowField(p, 100 + i, 100) != f;
+    }
+    ok = ok && flowField(p, 100, 100) == f
+        && p->flowBuilds == FLOW_CACHE_SLOTS + 1;
+    flowField(p, 50, 50);
+    ok = ok && flowField(p, 100, 100) == f
+        && p->flowBuilds == FLOW_CACHE_SLOTS + 2;
+    if(ok) {
+        score_pass("pFlow");
+    } else {
+        score_fail("pFlow");
+    }
+}
+
+/* ========================== */
+/* == Field of view tests  == */
+/* ========================== */
+
+/* Shared by the FOV tests, since fov_t is too big for the stack */
+static fov_t TEST_FOV;
+
+/* Views that skip octants without walls should match casting all 8 */
+/* octants, on maps with walls near the edges and in the open        */
+static void test_fSkip(void) {
+    fov_t * f = &TEST_FOV;
+    u32 seed = 7;
+    u32 i;
+    u32 j;
+    u32 ok = fovInit(f, 100, 80) && !fovInit(f, FOV_TILES_MAX, 2);
+    fovInit(f, 100, 80);
+    for(i = 0; i < 100 * 80; i++) {
+        seed = seed * 1664525u + 1013904223u;
+        /* Mostly open on the left, denser on the right */
+        if(((seed >> 16) & 63) < (i % 100) / 4) {
+            fovSetOpaque(f, i % 100, i / 100, 1);
+        }
+    }
+    for(i = 0; i < 200 && ok; i++) {
+        seed = seed * 1664525u + 1013904223u;
+        const i32 x = (seed >> 8) % 100;
+        const i32 y = (seed >> 20) % 80;
+        const u32 radius = 4 + i % (FOV_RADIUS + 3);
+        const u32 r = radius < FOV_RADIUS ? radius : FOV_RADIUS;
+        u32 rows[FOV_SIZE];
+        fovLook(f, x, y, radius);
+        for(j = 0; j < FOV_SIZE; j++) {
+            rows[j] = 0;
+        }
+        for(j = 0; j < 8; j++) {
+            fovCast(f, rows, j, r, 1, 1, 1, 0, 1);
+        }
+        rows[FOV_RADIUS] |= 1u << FOV_RADIUS;
+        for(j = 0; j < FOV_SIZE && ok; j++) {
+            ok = rows[j] == f->view.rows[j];
+        }
+    }
+    /* The open left side should skip some octants */
+    ok = ok && f->looks == 200 && f->casts < 200 * 8;
+    if(ok) {
+        score_pass("fSkip");
+    } else {
+        score_fail("fSkip");
+    }
+}
+
+/* Walls should cast shadows, and views should stay cached until the */
+/* origin moves or a tile in range changes                            */
+static void test_fView(void) {
+    fov_t * f = &TEST_FOV;
+    fovInit(f, 64, 64);
+    u32 ok = fovLook(f, 20, 20, 10) && !fovLook(f, 20, 20, 10)
+        && f->looks == 1 && f->casts == 0;
+    ok = ok && fovVisible(f, &f->view, 30, 20)
+        && !fovVisible(f, &f->view, 31, 20)
+        && fovVisible(f, &f->view, 27, 27)
+        && !fovVisible(f, &f->view, 28, 28);
+    /* A wall 3 tiles east hides the tiles behind it, but is visible. Only */
+    /* the 2 octants next to the east axis need casting.                   */
+    fovSetOpaque(f, 23, 19, 1);
+    fovSetOpaque(f, 23, 20, 1);
+    fovSetOpaque(f, 23, 21, 1);
+    ok = ok && fovLook(f, 20, 20, 10) && f->casts == 2;
+    ok = ok && fovVisible(f, &f->view, 23, 20)
+        && !fovVisible(f, &f->view, 24, 20)
+        && !fovVisible(f, &f->view, 29, 21)
+        && fovVisible(f, &f->view, 20, 29)
+        && fovVisible(f, &f->view, 11, 20);
+    /* Changes out of range, or that don't change anything, keep the view */
+    fovSetOpaque(f, 50, 50, 1);
+    fovSetOpaque(f, 23, 20, 1);
+    ok = ok && !fovLook(f, 20, 20, 10);
+    /* Moving one tile only casts the octants that have walls */
+    const u32 casts = f->casts;
+    ok = ok && fovLook(f, 20, 21, 10) && f->casts - casts <= 4;
+    /* Tiles outside the grid are never visible */
+    ok = ok && fovLook(f, 0, 0, 10) && fovVisible(f, &f->view, 0, 0)
+        && !fovVisible(f, &f->view, -1, 0);
+    if(ok) {
+        score_pass("fView");
+    } else {
+        score_fail("fView");
+    }
+}
+
+/* Light should fade with distance, stop at walls, add up across sources, */
+/* and stay cached until a light moves or a tile near it changes          */
+static void test_fLight(void) {
+    fov_t * f = &TEST_FOV;
+    fovInit(f, 64, 64);
+    lightSet(f, 0, 10, 10, 5, 200);
+    u32 ok = lightLevel(f, 10, 10) == 200 && lightLevel(f, 13, 10) > 0
+        && lightLevel(f, 13, 10) < lightLevel(f, 12, 10)
+        && lightLevel(f, 16, 10) == 0 && f->looks == 1;
+    /* Cached: more queries don't recompute */
+    ok = ok && lightLevel(f, 11, 11) > 0 && f->looks == 1;
+    /* A wall between the light and a tile casts a shadow */
+    fovSetOpaque(f, 12, 10, 1);
+    ok = ok && lightLevel(f, 12, 10) > 0 && lightLevel(f, 14, 10) == 0
+        && f->looks == 2;
+    /* A second light adds up, and levels saturate */
+    lightSet(f, 1, 14, 10, 5, 255);
+    ok = ok && lightLevel(f, 14, 10) == LIGHT_FULL
+        && lightLevel(f, 11, 10) > 150;
+    /* Turning lights off and bad ids */
+    lightSet(f, 0, 10, 10, 5, 0);
+    lightSet(f, 1, 14, 10, 5, 0);
+    lightSet(f, LIGHT_MAX, 10, 10, 5, 100);
+    ok = ok && lightLevel(f, 10, 10) == 0;
+    if(ok) {
+        score_pass("fLight");
+    } else {
+        score_fail("fLight");
+    }
+}
+
+/* =============================== */
+/* == Simulation timestep tests == */
+/* =============================== */
+
+/* A tap that starts and ends between two frames should still be seen */
+static void test_sInputTap(void) {
+    test_tick();
+    test_push_input(3, GP_U);
+    test_push_input(5, 0);
+    next(20);
+    const u32 seen = RENDER_LIST_LEN > 0;
+    /* The release gets applied on the following tick */
+    test_tick();
+    if(seen && GAMEPAD == 0 && INPUT_TAIL == INPUT_HEAD) {
+        score_pass("sInputTap");
+    } else {
+        score_fail("sInputTap");
+    }
+}
+
+/* Holding a button for the same time should take the same number of steps */
+/* at any frame rate                                                      */
+static void test_sFrameRate(void) {
+    const u32 frame_ms[] = {7, 16, 33, 50};
+    u32 steps[4];
+    u32 f;
+    u32 t;
+    for(f = 0; f < 4; f++) {
+        PLAYER_X = WORLD_TILES / 2;
+        test_push_input(0, GP_R);
+        test_push_input(2000, 0);
+        for(t = 0; t < 2100; t += frame_ms[f]) {
+            next(frame_ms[f]);
+        }
+        steps[f] = PLAYER_X - WORLD_TILES / 2;
+    }
+    if(steps[0] > 0 && steps[0] == steps[1] && steps[1] == steps[2]
+        && steps[2] == steps[3]) {
+        score_pass("sFrameRate");
+    } else {
+        printf(">>> steps: %d %d %d %d <<<\n",
+            steps[0], steps[1], steps[2], steps[3]);
+        score_fail("sFrameRate");
+    }
+}
+
+/* A very long frame should run at most SIM_MAX_TICKS ticks and then drop */
+/* the backlog                                                           */
+static void test_sCatchUp(void) {
+    u32 ok = simFrame(100000) == SIM_MAX_TICKS;
+    u32 i;
+    for(i = 0; i < SIM_MAX_TICKS; i++) {
+        simTick();
+    }
+    simFrameEnd();
+    ok = ok && SIM_ALPHA < 65536 && simFrame(0) == 0;
+    simFrameEnd();
+    if(ok) {
+        score_pass("sCatchUp");
+    } else {
+        score_fail("sCatchUp");
+    }
+}
+
+/* ====================== */
+/* == Snapshot tests   == */
+/* ====================== */
+
+/* Shared by the snapshot tests, since they're too big for the stack */
+static u32 TEST_SNAP_A[70000];
+static u32 TEST_SNAP_B[70000];
+static u32 TEST_SNAP_D[SNAP_DELTA_MAX(70000)];
+static snap_ring_t TEST_RING;
+
+/* Returns: checksum of n words */
+static u32 test_sum(const u32 * w, u32 n) {
+    u32 sum = n;
+    u32 i;
+    for(i = 0; i < n; i++) {
+        sum = (sum * 31) + w[i];
+    }
+    return sum;
+}
+
+/* Returns: checksum of the current game state */
+static u32 test_state_sum(void) {
+    const u32 words = snapWords(SNAP_REGIONS, SNAP_REGION_COUNT);
+    snapSave(SNAP_REGIONS, SNAP_REGION_COUNT, TEST_SNAP_A);
+    return test_sum(TEST_SNAP_A, words);
+}
+
+/* Deltas should turn each snapshot into the other, and stay small when */
+/* little changed, even across runs longer than a token can hold        */
+static void test_nDelta(void) {
+    u32 * a = TEST_SNAP_A;
+    u32 * b = TEST_SNAP_B;
+    u32 * d = TEST_SNAP_D;
+    u32 seed = 3;
+    u32 i;
+    for(i = 0; i < 4096; i++) {
+        seed = seed * 1664525u + 1013904223u;
+        a[i] = seed;
+        b[i] = (i % 97 == 5 || (i >= 1000 && i < 1010)) ? ~seed : seed;
+    }
+    /* 43 scattered words and a run of 10 take a token each, plus the */
+    /* words themselves                                                */
+    u32 len = snapDelta(a, b, 4096, d);
+    u32 ok = len == (43 + 1) + (43 + 10) && snapDelta(a, a, 4096, d) == 0;
+    snapDelta(a, b, 4096, d);
+    snapApply(a, d, len);
+    ok = ok && test_sum(a, 4096) == test_sum(b, 4096);
+    snapApply(a, d, len);
+    ok = ok && test_sum(a, 4096) != test_sum(b, 4096);
+    /* Every other word changed is the worst case */
+    for(i = 0; i < 4096; i++) {
+        b[i] = a[i] ^ (i & 1);
+    }
+    len = snapDelta(a, b, 4096, d);
+    ok = ok && len <= SNAP_DELTA_MAX(4096);
+    snapApply(a, d, len);
+    ok = ok && test_sum(a, 4096) == test_sum(b, 4096);
+    /* Runs longer than SNAP_RUN_MAX take an extra token */
+    for(i = 0; i < 70000; i++) {
+        a[i] = 0;
+        b[i] = i < 69990 ? 0 : i;
+    }
+    len = snapDelta(a, b, 70000, d);
+    ok = ok && len == 1 + 1 + 10;
+    snapApply(a, d, len);
+    ok = ok && test_sum(a, 70000) == test_sum(b, 70000);
+    for(i = 0; i < 70000; i++) {
+        b[i] = i + 1;
+    }
+    len = snapDelta(a, b, 70000, d);
+    ok = ok && len == 2 + 70000;
+    snapApply(a, d, len);
+    ok = ok && test_sum(a, 70000) == test_sum(b, 70000);
+    if(ok) {
+        score_pass("nDelta");
+    } else {
+        score_fail("nDelta");
+    }
+}
+
+/* Loading a quick-save should put the game state back exactly, and the */
+/* game should carry on from there the same way it did the first time  */
+static void test_nSnap(void) {
+    u32 i;
+    entityClear(&NPCS, NPC_BUCKETS);
+    entitySpawn(&NPCS, (START_X - 3) << ENTITY_SUB_SHIFT,
+        START_Y << ENTITY_SUB_SHIFT, 9, -4, 5, ENTITY_ACTIVE);
+    entitySpawn(&NPCS, (START_X + 2) << ENTITY_SUB_SHIFT,
+        (START_Y + 1) << ENTITY_SUB_SHIFT, 0, 0, 6,
+        ENTITY_ACTIVE | NPC_CHASER);
+    test_tick();
+    const u32 len = snapshotSave();
+    const u32 saved = test_state_sum();
+    test_push_input(0, GP_R);
+    for(i = 0; i < 30; i++) {
+        test_tick();
+    }
+    const u32 after = test_state_sum();
+    u32 ok = len == snapWords(SNAP_REGIONS, SNAP_REGION_COUNT) * 4
+        && after != saved && !snapshotLoad(len - 4) && snapshotLoad(len)
+        && test_state_sum() == saved;
+    /* The load forces a full redraw */
+    test_tick();
+    ok = ok && RENDER_LIST_LEN > 0 && RENDER_LIST[0] == HDR(RC_DIRTY, 5);
+    snapshotLoad(len);
+    test_push_input(0, GP_R);
+    for(i = 0; i < 30; i++) {
+        test_tick();
+    }
+    ok = ok && test_state_sum() == after;
+    test_push_input(0, 0);
+    test_tick();
+    if(ok) {
+        score_pass("nSnap");
+    } else {
+        score_fail("nSnap");
+    }
+}
+
+/* Rewinding should go back through the states of recent frames, up to */
+/* as many as the ring holds                                           */
+static void test_nRewind(void) {
+    u32 sums[20];
+    u32 i;
+    for(i = 0; i < 20; i++) {
+        test_tick();
+        sums[i] = test_state_sum();
+    }
+    u32 ok = rewindFrames(1) == 1 && test_state_sum() == sums[18]
+        && rewindFrames(5) == 5 && test_state_sum() == sums[13];
+    /* History after a rewind carries on from the rewound state */
+    test_tick();
+    ok = ok && rewindFrames(1) == 1 && test_state_sum() == sums[13];
+    for(i = 0; i < SNAP_RING_FRAMES + 10; i++) {
+        test_tick();
+    }
+    ok = ok && rewindFrames(SNAP_RING_FRAMES + 10) == SNAP_RING_FRAMES;
+    test_tick();
+    if(ok) {
+        score_pass("nRewind");
+    } else {
+        score_fail("nRewind");
+    }
+}
+
+/* Replaying ticks with the inputs they had should land on exactly the
+ * same state, and replaying them with different inputs should change it.
+ * Inputs come from a loopback: the gamepad states get scripted into the
+ * input queue, then read back from GAMEPAD after each frame.
+ */
+static void test_nResim(void) {
+    u32 inputs[SNAP_RING_FRAMES];
+    u32 i;
+    u32 f;
+    /* Start the ring over so its length counts ticks */
+    snapshotLoad(snapshotSave());
+    for(f = 0; REWIND.frames < 60; f++) {
+        const u32 buttons = (f & 16) ? GP_R | GP_B : GP_D;
+        const u32 done = REWIND.frames;
+        test_push_input(0, (f & 7) == 7 ? 0 : buttons);
+        test_tick();
+        for(i = done; i < REWIND.frames; i++) {
+            inputs[i] = GAMEPAD;
+        }
+    }
+    const u32 ticks = REWIND.frames;
+    const u32 want = test_state_sum();
+    for(i = 0; i < 40; i++) {
+        RESIM_INPUT[i] = inputs[ticks - 40 + i];
+    }
+    u32 ok = resimulate(40) == 40 && test_state_sum() == want;
+    for(i = 0; i < 40; i++) {
+        RESIM_INPUT[i] = GP_L;
+    }
+    ok = ok && resimulate(40) == 40 && test_state_sum() != want
+        && REWIND.frames == ticks;
+    for(i = 0; i < 40; i++) {
+        RESIM_INPUT[i] = inputs[ticks - 40 + i];
+    }
+    ok = ok && resimulate(40) == 40 && test_state_sum() == want;
+    /* Replaying everything from the start works too */
+    for(i = 0; i < ticks; i++) {
+        RESIM_INPUT[i] = inputs[i];
+    }
+    ok = ok && resimulate(ticks + 5) == ticks && test_state_sum() == want;
+    test_push_input(0, 0);
+    test_tick();
+    test_tick();
+    if(ok) {
+        score_pass("nResim");
+    } else {
+        score_fail("nResim");
+    }
+}
+
+/* When big deltas fill the arena, the ring should wrap around and drop */
+/* the oldest ones                                                      */
+static void test_nArena(void) {
+    snap_ring_t * ring = &TEST_RING;
+    const u32 words = SNAP_WORDS_MAX;
+    u32 sums[12];
+    u32 seed = 5;
+    u32 i;
+    u32 j;
+    u32 ok = !snapRingInit(ring, SNAP_WORDS_MAX + 1)
+        && snapRingInit(ring, words) && snapRingLatest(ring) == 0;
+    for(i = 0; i < 12; i++) {
+        u32 * next = snapRingNext(ring);
+        for(j = 0; j < words; j++) {
+            seed = seed * 1664525u + 1013904223u;
+            next[j] = seed | 1;  /* Never the same twice in a row */
+        }
+        sums[i] = test_sum(next, words);
+        snapRingPush(ring);
+        ok = ok && test_sum(snapRingLatest(ring), words) == sums[i];
+    }
+    /* Each delta is as big as a snapshot, so not all 11 fit */
+    u32 n = 0;
+    while(ok && snapRingRewind(ring, 1) == 1) {
+        n += 1;
+        ok = test_sum(snapRingLatest(ring), words) == sums[11 - n];
+    }
+    ok = ok && n > 0 && n < 11 && ring->frames == 0;
+    if(ok) {
+        score_pass("nArena");
+    } else {
+        score_fail("nArena");
+    }
+}
+
+
+/* Returns: 1 if none of the deltas held in ring overlap each other */
+static u32 test_ring_disjoint(const snap_ring_t * ring) {
+    u32 i;
+    u32 j;
+    for(i = 0; i < ring->frames; i++) {
+        const u32 a = (ring->first + i) % SNAP_RING_FRAMES;
+        for(j = i + 1; j < ring->frames; j++) {
+            const u32 b = (ring->first + j) % SNAP_RING_FRAMES;
+            if(ring->start[a] < ring->start[b] + ring->len[b]
+                && ring->start[b] < ring->start[a] + ring->len[a]) {
+                return 0;
+            }
+        }
+    }
+    return 1;
+}
+
+/* Deltas of all sizes should be able to wrap around the arena many times, */
+/* rewinding part way now and then, without the ones held ever overlapping */
+/* or rewinding to the wrong state                                         */
+static void test_nWrap(void) {
+    snap_ring_t * ring = &TEST_RING;
+    static u32 sums[1200];
+    const u32 words = 8192;
+    u32 seed = 11;
+    u32 wraps = 0;
+    u32 pushed = 0;
+    u32 i;
+    u32 j;
+    u32 ok = snapRingInit(ring, words);
+    for(j = 0; j < words; j++) {
+        ring->buf[0][j] = ring->buf[1][j] = j;
+    }
+    for(i = 0; ok && i < 1200; i++) {
+        const u32 head = ring->head;
+        u32 * next = snapRingNext(ring);
+        /* Change the first n words, where n is anything from none to all */
+        seed = seed * 1664525u + 1013904223u;
+        const u32 n = i % 7 == 0 ? 0 : (seed >> 8) % (words + 1);
+        const u32 * latest = pushed ? snapRingLatest(ring) : ring->buf[0];
+        for(j = 0; j < words; j++) {
+            next[j] = j < n ? latest[j] ^ (seed | 1) : latest[j];
+        }
+        sums[pushed] = test_sum(next, words);
+        snapRingPush(ring);
+        pushed += 1;
+        wraps += ring->head < head;
+        ok = test_ring_disjoint(ring)
+            && test_sum(snapRingLatest(ring), words) == sums[pushed - 1];
+        /* Now and then, go back a few frames and carry on from there */
+        if(i % 97 == 96) {
+            pushed -= snapRingRewind(ring, 5);
+            ok = ok && test_sum(snapRingLatest(ring), words)
+                == sums[pushed - 1];
+        }
+    }
+    /* Rewinding everything held should give back each state in turn */
+    while(ok && snapRingRewind(ring, 1) == 1) {
+        pushed -= 1;
+        ok = test_sum(snapRingLatest(ring), words) == sums[pushed - 1];
+    }
+    ok = ok && wraps > 10 && ring->frames == 0;
+    if(ok) {
+        score_pass("nWrap");
+    } else {
+        score_fail("nWrap");
+    }
+}
+
+/* ==================== */
+/* == Particle tests == */
+/* ==================== */
+
+/* Shared by the particle tests */
+static particle_pool_t TEST_PARTICLES;
+static u32 TEST_INSTANCES[PARTICLE_MAX * PARTICLE_INSTANCE_WORDS];
+
+/* Integrating should give the same results for particles in full vectors */
+/* and in the scalar tail, and instance data should interleave properly   */
+static void test_xIntegrate(void) {
+    particle_pool_t * p = &TEST_PARTICLES;
+    u32 * out = TEST_INSTANCES;
+    u32 ok = 1;
+    u32 i;
+    particleClear(p);
+    for(i = 0; i < 11; i++) {
+        const i32 n = (i32)i;
+        particleEmit(p, n * 100, -n * 50, n - 5, 2 * n, 10 + n, 0xff000000 | i);
+    }
+    particleIntegrate(p, 3);
+    particleIntegrate(p, 3);
+    for(i = 0; i < 11; i++) {
+        const i32 n = (i32)i;
+        ok = ok && p->x[i] == n * 100 + 2 * (n - 5)
+            && p->y[i] == -n * 50 + 4 * n + 3 && p->vy[i] == 2 * n + 6
+            && p->life[i] == 8 + n;
+    }
+    ok = ok && particleInstances(p, out, 100, 1000, -2000) == 11;
+    for(i = 0; i < 11; i++) {
+        const u32 * o = &out[i * PARTICLE_INSTANCE_WORDS];
+        ok = ok && (i32)o[0] == p->x[i] - 1000 && (i32)o[1] == p->y[i] + 2000
+            && o[2] == (0xff000000 | i) && (i32)o[3] == p->life[i];
+    }
+    /* Only up to max get written */
+    out[6 * PARTICLE_INSTANCE_WORDS] = 12345;
+    ok = ok && particleInstances(p, out, 6, 0, 0) == 6
+        && out[6 * PARTICLE_INSTANCE_WORDS] == 12345;
+    if(ok) {
+        score_pass("xIntegrate");
+    } else {
+        score_fail("xIntegrate");
+    }
+}
+
+/* Compacting should remove just the dead particles, keep the live ones in */
+/* order, and leave room to emit more                                      */
+static void test_xCompact(void) {
+    particle_pool_t * p = &TEST_PARTICLES;
+    u32 ok = 1;
+    u32 live = 0;
+    u32 i;
+    particleClear(p);
+    for(i = 0; i < 37; i++) {
+        /* The first dead particle comes after a few full vectors */
+        const i32 life = i < 20 ? 5 : (i32)((i * 7) % 5) - 1;
+        particleEmit(p, i, 0, 0, 0, life, i);
+        live += life > 0;
+    }
+    ok = particleCompact(p) == 37 - live && p->count == live;
+    for(i = 1; i < p->count; i++) {
+        ok = ok && p->life[i] > 0 && p->x[i] > p->x[i - 1]
+            && p->color[i] == (u32)p->x[i];
+    }
+    /* A full pool takes no more, and empties when everything dies */
+    particleClear(p);
+    for(i = 0; i < PARTICLE_MAX; i++) {
+        particleEmit(p, 0, 0, 0, 0, 1 + (i & 1), 0);
+    }
+    ok = ok && !particleEmit(p, 0, 0, 0, 0, 1, 0);
+    particleIntegrate(p, 0);
+    ok = ok && particleCompact(p) == PARTICLE_MAX / 2
+        && particleEmit(p, 0, 0, 0, 0, 1, 0);
+    particleIntegrate(p, 0);
+    ok = ok && particleCompact(p) == PARTICLE_MAX / 2 + 1 && p->count == 0;
+    if(ok) {
+        score_pass("xCompact");
+    } else {
+        score_fail("xCompact");
+    }
+}
+
+/* Player steps should kick up dust near the player's tile, and the dust */
+/* should settle after a while                                           */
+static void test_xDust(void) {
+    const u32 x0 = PLAYER_X;
+    u32 i;
+    for(i = 0; i < DUST_LIFE; i++) {
+        test_tick();  /* Let dust from earlier tests settle */
+    }
+    test_push_input(0, PLAYER_X > 0 ? GP_L : GP_R);
+    for(i = 0; i < 30 && PLAYER_X == x0; i++) {
+        test_tick();
+    }
+    const i32 tx = (PLAYER_X - CAMERA_X) << ENTITY_SUB_SHIFT;
+    const i32 dx = (i32)PARTICLE_INSTANCES[0] - tx;
+    const i32 dy = (i32)PARTICLE_INSTANCES[1]
+        - (i32)((PLAYER_Y - CAMERA_Y) << ENTITY_SUB_SHIFT);
+    u32 ok = PLAYER_X != x0 && PARTICLE_COUNT == DUST_PARTICLES
+        && dx > 0 && dx < ENTITY_SUB && dy > 0 && dy < ENTITY_SUB
+        && PARTICLE_INSTANCES[2] == DUST_COLOR;
+    test_push_input(0, 0);
+    for(i = 0; i < DUST_LIFE + 2; i++) {
+        test_tick();
+    }
+    ok = ok && PARTICLE_COUNT == 0;
+    if(ok) {
+        score_pass("xDust");
+    } else {
+        score_fail("xDust");
+    }
+}
+
+
+/* ================= */
+/* == Audio tests == */
+/* ================= */
+
+/* Shared by the audio tests */
+static f32 TEST_BLOCK[AUDIO_BLOCK * 2];
+
+/* Returns: left sample of frame i of TEST_BLOCK, back in the i16 range */
+static i32 test_left(u32 i) {
+    return (i32)(TEST_BLOCK[i] * 32768);
+}
+
+/* Returns: right sample of frame i of TEST_BLOCK, back in the i16 range */
+static i32 test_right(u32 i) {
+    return (i32)(TEST_BLOCK[AUDIO_BLOCK + i] * 32768);
+}
+
+/* Put a ramp of n samples in SOUND_PCM from start: 0, step, 2 * step, ... */
+static void test_ramp(u32 start, u32 n, i32 step) {
+    u32 i;
+    for(i = 0; i < n; i++) {
+        SOUND_PCM[start + i] = (i32)i * step;
+    }
+}
+
+/* Voices at their sound's own rate should copy samples across, with gains */
+/* for volume and pan, and stop at the end of the sound                    */
+static void test_aMix(void) {
+    u32 ok = !startAudio(100) && startAudio(48000)
+        && !defineSound(1, SOUND_PCM_MAX - 10, 64, 0, 0, 48000)
+        && !defineSound(1, 2000, 64, 10, 65, 48000)
+        && defineSound(1, 2000, 64, 0, 0, 48000);
+    u32 i;
+    test_ramp(2000, 64, 100);
+    const i32 v = playSound(1, AUDIO_UNITY, 0, PITCH_UNITY);
+    const i32 w = playSound(1, AUDIO_UNITY / 2, -AUDIO_UNITY, PITCH_UNITY);
+    audioMixBlock(TEST_BLOCK);
+    ok = ok && v >= 0 && w >= 0 && v != w;
+    for(i = 0; i < AUDIO_BLOCK; i++) {
+        const i32 want = i < 64 ? (i32)i * 100 : 0;
+        ok = ok && test_left(i) == want + want / 2 && test_right(i) == want;
+    }
+    /* Both voices ended, and louder mixes clip */
+    ok = ok && !VOICES[v].active && !VOICES[w].active;
+    test_ramp(2000, 64, 500);
+    playSound(1, AUDIO_UNITY, 0, PITCH_UNITY);
+    playSound(1, AUDIO_UNITY, 0, PITCH_UNITY);
+    audioMixBlock(TEST_BLOCK);
+    ok = ok && test_left(40) == 32767 && test_left(1) == 1000;
+    startAudio(0);
+    if(ok) {
+        score_pass("aMix");
+    } else {
+        score_fail("aMix");
+    }
+}
+
+/* Pitch and sample rate should resample with linear interpolation, and */
+/* loops should wrap around                                             */
+static void test_aPitch(void) {
+    u32 ok = startAudio(48000) && defineSound(2, 3000, 512, 0, 0, 48000)
+        && defineSound(3, 3000, 512, 0, 0, 24000)
+        && defineSound(4, 3000, 32, 16, 32, 48000);
+    u32 i;
+    test_ramp(3000, 512, 10);
+    /* Double pitch skips every other sample */
+    i32 v = playSound(2, AUDIO_UNITY, AUDIO_UNITY, 2 * PITCH_UNITY);
+    audioMixBlock(TEST_BLOCK);
+    for(i = 0; i < AUDIO_BLOCK; i++) {
+        ok = ok && test_left(i) == 0 && test_right(i) == (i32)i * 20;
+    }
+    stopVoice(v);
+    /* A half rate sound gets samples in between */
+    v = playSound(3, AUDIO_UNITY, AUDIO_UNITY, PITCH_UNITY);
+    audioMixBlock(TEST_BLOCK);
+    for(i = 0; i < AUDIO_BLOCK; i++) {
+        ok = ok && test_right(i) == (i32)i * 5;
+    }
+    stopVoice(v);
+    /* A loop plays frames 0 to 31, then 16 to 31 over and over */
+    v = playSound(4, AUDIO_UNITY, AUDIO_UNITY, PITCH_UNITY);
+    audioMixBlock(TEST_BLOCK);
+    for(i = 0; i < AUDIO_BLOCK; i++) {
+        const i32 f = i < 32 ? i : 16 + (i - 32) % 16;
+        ok = ok && test_right(i) == f * 10;
+    }
+    /* Changing pitch mid-loop keeps it in the loop */
+    setVoice(v, AUDIO_UNITY, AUDIO_UNITY, 3 * PITCH_UNITY);
+    audioMixBlock(TEST_BLOCK);
+    for(i = 0; i < AUDIO_BLOCK; i++) {
+        ok = ok && test_right(i) >= 160 && test_right(i) < 320;
+    }
+    ok = ok && VOICES[v].active;
+    startAudio(0);
+    if(ok) {
+        score_pass("aPitch");
+    } else {
+        score_fail("aPitch");
+    }
+}
+
+/* The ring should stay AUDIO_LEAD_BLOCKS ahead of the front end, and */
+/* player steps should play the footstep sound                        */
+static void test_aRing(void) {
+    u32 ok = audioRender() == 0 && startAudio(48000)
+        && audioRender() == AUDIO_LEAD_BLOCKS && audioRender() == 0;
+    AUDIO_TAIL += 5;
+    ok = ok && audioRender() == 5 && AUDIO_HEAD == AUDIO_LEAD_BLOCKS + 5;
+    /* A step plays during the frame, and the frame renders the ring */
+    const u32 x0 = PLAYER_X;
+    u32 i;
+    test_push_input(0, PLAYER_X > 0 ? GP_L : GP_R);
+    for(i = 0; i < 30 && PLAYER_X == x0; i++) {
+        AUDIO_TAIL = AUDIO_HEAD;
+        test_tick();
+    }
+    u32 steps = 0;
+    for(i = 0; i < VOICE_MAX; i++) {
+        steps += VOICES[i].active && VOICES[i].sound == STEP_SOUND;
+    }
+    ok = ok && PLAYER_X != x0 && steps == 1
+        && AUDIO_HEAD - AUDIO_TAIL == AUDIO_LEAD_BLOCKS;
+    test_push_input(0, 0);
+    test_tick();
+    startAudio(0);
+    if(ok) {
+        score_pass("aRing");
+    } else {
+        score_fail("aRing");
+    }
+}
+
+/* ===================== */
+/* == Animation tests == */
+/* ===================== */
+
+/* Shared by the animation tests, since they're too big for the stack */
+static anim_clips_t TEST_CLIPS;
+static anim_set_t TEST_ANIMS;
+
+/* Run animEval for ticks, then check the frames of the first 3 slots */
+/* Returns: 1 when they match, 0 when they don't                      */
+static u32 test_anim_eval(u32 ticks, u32 f0, u32 f1, u32 f2) {
+    u16 out[3];
+    animEval(&TEST_ANIMS, &TEST_CLIPS, ticks, out, 0, 3);
+    if(out[0] == f0 && out[1] == f1 && out[2] == f2) {
+        return 1;
+    }
+    printf(">>> ticks %d: expected %d %d %d, actual %d %d %d <<<\n",
+        ticks, f0, f1, f2, out[0], out[1], out[2]);
+    return 0;
+}
+
+/* Frames should show for their durations, loops should wrap, one-shot   */
+/* clips should hold their last frame, and speed should scale play time  */
+static void test_kEval(void) {
+    const u16 frame[] = {4, 5, 6};
+    const u16 ticks[] = {2, 1, 3};
+    const u16 zero[] = {0, 0};
+    anim_set_t * set = &TEST_ANIMS;
+    animClipsClear(&TEST_CLIPS);
+    u32 ok = animClip(&TEST_CLIPS, 0, frame, ticks, 3, ANIM_LOOP)
+        && animClip(&TEST_CLIPS, 1, frame, ticks, 2, 0)
+        && !animClip(&TEST_CLIPS, ANIM_CLIPS_MAX, frame, ticks, 3, 0)
+        && !animClip(&TEST_CLIPS, 2, frame, zero, 2, 0);
+    /* Slot 0 loops {4, 4, 5, 6, 6, 6} with a base of 100, slot 1 plays */
+    /* {4, 4, 5} once, and slot 2 loops at double speed                 */
+    animResize(set, 0);
+    animResize(set, 3);
+    set->base[0] = 100;
+    animPlay(set, 1, 1, ANIM_SPEED_UNITY);
+    animPlay(set, 2, 0, ANIM_SPEED_UNITY * 2);
+    ok = ok && test_anim_eval(0, 104, 4, 4)
+        && test_anim_eval(1, 104, 4, 5)
+        && test_anim_eval(1, 105, 5, 6)
+        && test_anim_eval(5, 104, 5, 5)
+        && test_anim_eval(1000000, 106, 5, 6);
+    /* Playing the same clip keeps its place, and a new clip restarts */
+    animPlay(set, 0, 0, ANIM_SPEED_UNITY / 2);
+    animPlay(set, 1, 0, ANIM_SPEED_UNITY);
+    ok = ok && test_anim_eval(0, 106, 4, 6)
+        && test_anim_eval(2, 104, 5, 5);
+    if(ok) {
+        score_pass("kEval");
+    } else {
+        score_fail("kEval");
+    }
+}
+
+/* The player should face the dpad direction and walk while it's held,  */
+/* with new walk frames getting drawn even when the player can't move   */
+static void test_kPlayer(void) {
+    PLAYER_X = 0;
+    PLAYER_Y = 0;
+    GAMEPAD = GP_U;
+    test_tick();
+    u32 ok = ANIM_FRAMES[ANIM_PLAYER] == PLAYER_TILE(FACE_UP, 1);
+    const u32 n = test_tick_until_drawn(WALK_FRAME_TICKS + 1);
+    ok = ok && n <= WALK_FRAME_TICKS && RENDER_LIST_LEN > 0
+        && RENDER_LIST[RENDER_LIST_LEN - 1] == PLAYER_TILE(FACE_UP, 2)
+        && PLAYER_Y == 0;
+    GAMEPAD = 0;
+    test_tick();
+    ok = ok && RENDER_LIST[RENDER_LIST_LEN - 1] == PLAYER_TILE(FACE_UP, 0);
+    test_tick();
+    ok = ok && RENDER_LIST_LEN == 0;
+    if(ok) {
+        score_pass("kPlayer");
+    } else {
+        score_fail("kPlayer");
+    }
+}
+
+
+/* =================== */
+/* == 3D math tests == */
+/* =================== */
+
+/* Returns: 1 if a and b are within a rounding error of each other */
+static u32 test_near(f32 a, f32 b) {
+    const f32 d = a - b;
+    return d < 1e-4f && d > -1e-4f;
+}
+
+/* Matrices built from poses should scale, then rotate, then translate, */
+/* and transforming points should match doing it by hand                 */
+static void test_mTransform(void) {
+    const f32 h = 0.70710678f;  /* 90 degrees about z is {0, 0, h, h} */
+    f32 pose[POSE_FIELDS * 5];
+    mat4_t m[5];
+    u32 i;
+    for(i = 0; i < 5; i++) {
+        pose[POSE_TX * 5 + i] = 10.0f * i;
+        pose[POSE_TY * 5 + i] = 20.0f;
+        pose[POSE_TZ * 5 + i] = 30.0f;
+        pose[POSE_QX * 5 + i] = 0.0f;
+        pose[POSE_QY * 5 + i] = 0.0f;
+        pose[POSE_QZ * 5 + i] = h;
+        pose[POSE_QW * 5 + i] = h;
+        pose[POSE_SX * 5 + i] = 2.0f;
+        pose[POSE_SY * 5 + i] = 2.0f;
+        pose[POSE_SZ * 5 + i] = 2.0f;
+    }
+    mat4ComposeBatch(pose, 5, m, 5);
+    /* Point (x, y, z) should go to (10i - 2y, 20 + 2x, 30 + 2z) */
+    u32 ok = 1;
+    for(i = 0; i < 5; i++) {
+        const f32 * e = m[i].m;
+        ok = ok && test_near(e[0], 0.0f) && test_near(e[1], 2.0f)
+            && test_near(e[4], -2.0f) && test_near(e[5], 0.0f)
+            && test_near(e[10], 2.0f) && e[12] == 10.0f * i
+            && e[13] == 20.0f && e[14] == 30.0f
+            && e[3] == 0.0f && e[7] == 0.0f && e[11] == 0.0f
+            && e[15] == 1.0f;
+    }
+    /* Batch transform with a tail past the last 4, in place */
+    VIEW_PROJ = m[1];
+    for(i = 0; i < 7; i++) {
+        POINTS[i] = (f32)i;
+        POINTS[POINT_MAX + i] = i + 1.0f;
+        POINTS[POINT_MAX * 2 + i] = i + 2.0f;
+        POINTS[POINT_MAX * 3 + i] = 1.0f;
+    }
+    transformPoints(7);
+    for(i = 0; i < 7; i++) {
+        ok = ok && test_near(POINTS[i], 10.0f - 2.0f * (i + 1.0f))
+            && test_near(POINTS[POINT_MAX + i], 20.0f + 2.0f * i)
+            && test_near(POINTS[POINT_MAX * 2 + i], 30.0f + 2.0f * (i + 2))
+            && test_near(POINTS[POINT_MAX * 3 + i], 1.0f);
+    }
+    /* Multiplying a translation by itself in place doubles it */
+    mat4Identity(&m[0]);
+    m[0].m[12] = 1.0f;
+    m[0].m[13] = 2.0f;
+    m[0].m[14] = 3.0f;
+    mat4Mul(&m[0], &m[0], &m[0]);
+    ok = ok && m[0].m[12] == 2.0f && m[0].m[13] == 4.0f
+        && m[0].m[14] == 6.0f && m[0].m[0] == 1.0f && m[0].m[15] == 1.0f;
+    mat4Identity(&VIEW_PROJ);
+    if(ok) {
+        score_pass("mTransform");
+    } else {
+        score_fail("mTransform");
+    }
+}
+
+/* Skinning matrices should chain joints to their parents and apply the */
+/* inverse bind matrices                                                */
+static void test_mPalette(void) {
+    const f32 * q = &JOINT_POSE[POSE_QX * JOINT_MAX];
+    /* A chain of 3 joints, with the root turned 90 degrees about z */
+    JOINT_POSE[POSE_TX * JOINT_MAX] = 1.0f;
+    JOINT_POSE[POSE_TY * JOINT_MAX + 1] = 2.0f;
+    JOINT_POSE[POSE_TZ * JOINT_MAX + 2] = 3.0f;
+    JOINT_PARENT[1] = 0;
+    JOINT_PARENT[2] = 1;
+    JOINT_INV_BIND[2].m[12] = 1.0f;
+    JOINT_INV_BIND[2].m[14] = -3.0f;
+    rotateJoint(0, 0.0f, 0.0f, 1.0f, 1.0f);
+    u32 ok = test_near(q[JOINT_MAX * 2], 0.70710678f)
+        && test_near(q[JOINT_MAX * 3], 0.70710678f);
+    buildPalette(3);
+    /* Joint 2 ends up at (-1, 0, 3), and its palette matrix moves the */
+    /* bind position (-1, 0, 3) there, turned to (-1, 1, 0)            */
+    const f32 * w = JOINT_WORLD[2].m;
+    const f32 * p = JOINT_PALETTE[2].m;
+    ok = ok && test_near(w[12], -1.0f) && test_near(w[13], 0.0f)
+        && test_near(w[14], 3.0f) && test_near(p[12], -1.0f)
+        && test_near(p[13], 1.0f) && test_near(p[14], 0.0f)
+        && test_near(JOINT_PALETTE[0].m[1], 1.0f)
+        && test_near(JOINT_PALETTE[0].m[4], -1.0f);
+    jointsReset();
+    if(ok) {
+        score_pass("mPalette");
+    } else {
+        score_fail("mPalette");
+    }
+}
+
+/* Culling should keep spheres and boxes that touch the view, and drop the */
+/* ones outside. The view here is the box from -2 to 2 on each axis.       */
+static void test_mCull(void) {
+    static const f32 obj[7][4] = {
+        { 0.0f,  0.0f,  0.0f, 0.1f},  /* Inside                 */
+        { 2.6f,  0.0f,  0.0f, 0.5f},  /* Past right             */
+        { 2.3f,  0.0f,  0.0f, 0.5f},  /* Over the right edge    */
+        { 0.0f, -3.0f,  0.0f, 0.5f},  /* Below                  */
+        { 0.0f,  0.0f,  2.4f, 0.5f},  /* Over the far edge      */
+        { 0.0f,  0.0f, -5.0f, 1.0f},  /* In front of near plane */
+        {-2.4f,  0.0f,  0.0f, 0.5f},  /* Over the left edge     */
+    };
+    u32 i;
+    u32 k;
+    mat4Identity(&VIEW_PROJ);
+    VIEW_PROJ.m[0] = 0.5f;
+    VIEW_PROJ.m[5] = 0.5f;
+    VIEW_PROJ.m[10] = 0.5f;
+    for(i = 0; i < 7; i++) {
+        for(k = 0; k < 3; k++) {
+            OBJECT_BOUNDS[OBJECT_MAX * k + i] = obj[i][k];
+            OBJECT_BOUNDS[OBJECT_MAX * (k + 3) + i] = obj[i][3];
+        }
+    }
+    /* Spheres use the 4th array as radius, and boxes use 4th to 6th as */
+    /* half sizes, so the same bounds work for both                     */
+    u32 ok = cullSpheres(7) == 4 && OBJECT_VISIBLE[0] == 0
+        && OBJECT_VISIBLE[1] == 2 && OBJECT_VISIBLE[2] == 4
+        && OBJECT_VISIBLE[3] == 6;
+    ok = ok && cullBoxes(7) == 4 && OBJECT_VISIBLE[0] == 0
+        && OBJECT_VISIBLE[1] == 2 && OBJECT_VISIBLE[2] == 4
+        && OBJECT_VISIBLE[3] == 6;
+    /* A wide box that stops just short of the view is still out */
+    OBJECT_BOUNDS[0] = -4.0f;
+    OBJECT_BOUNDS[OBJECT_MAX * 3] = 1.9f;
+    ok = ok && cullBoxes(7) == 3 && OBJECT_VISIBLE[0] == 2;
+    mat4Identity(&VIEW_PROJ);
+    if(ok) {
+        score_pass("mCull");
+    } else {
+        score_fail("mCull");
+    }
+}
+
+
+/* ===================== */
+/* == Telemetry tests == */
+/* ===================== */
+
+/* Shared by the telemetry tests */
+static telemetry_t TEST_TELEM;
+
+/* Buckets should be 1 us wide up to 8 us, then 4 per doubling, and each */
+/* bucket's start should land in that bucket                              */
+static void test_yBuckets(void) {
+    u32 ok = telemBucket(0) == 0 && telemBucket(7) == 7
+        && telemBucket(8) == 8 && telemBucket(9) == 8
+        && telemBucket(10) == 9 && telemBucket(16) == 12
+        && telemBucket(16666) == 52 && telemBucket(114687) == 62
+        && telemBucket(114688) == 63 && telemBucket(0xffffffff) == 63;
+    u32 b;
+    for(b = 0; b < TELEM_BUCKETS; b++) {
+        const u32 start = telemBucketStart(b);
+        ok = ok && telemBucket(start) == b
+            && (b == 0 || telemBucket(start - 1) == b - 1);
+    }
+    if(ok) {
+        score_pass("yBuckets");
+    } else {
+        score_fail("yBuckets");
+    }
+}
+
+/* Frames should count in the histogram, ring, totals, and over budget */
+/* count, and percentiles should come from the histogram               */
+static void test_yFrames(void) {
+    telemetry_t * t = &TEST_TELEM;
+    u32 i;
+    telemReset(t, 1000);
+    u32 ok = telemPercentile(t, 500) == 0;
+    /* 300 frames of 0, 10, ..., 2990 us */
+    for(i = 0; i < 300; i++) {
+        telemBegin(t);
+        telemStage(t, TELEM_SIM, i * 10);
+        telemStage(t, TELEM_SIM, 1);
+        telemStage(t, TELEM_STAGES, 1);
+        telemFrame(t, i * 10);
+    }
+    ok = ok && t->frames == 300 && t->over_budget == 199
+        && t->max_us == 2990 && t->last_us == 2990
+        && t->total_us == 448500 && t->stage_last[TELEM_SIM] == 2991
+        && t->stage_max[TELEM_SIM] == 2991 && t->stage_last[TELEM_INPUT] == 0
+        && t->stage_total[TELEM_SIM] == 448800;
+    /* The ring holds the newest frames, with frame n at n & mask */
+    for(i = 300 - TELEM_RING; i < 300; i++) {
+        ok = ok && t->ring[i & TELEM_RING_MASK] == i * 10;
+    }
+    /* Frame 150 is 1500 us, in the bucket from 1280 to 1535 us */
+    ok = ok && telemPercentile(t, 500) == 1280
+        && telemPercentile(t, 0) == 0 && telemPercentile(t, 1000) == 2560;
+    if(ok) {
+        score_pass("yFrames");
+    } else {
+        score_fail("yFrames");
+    }
+}
+
+/* next() should time each frame, with stage times adding up to the frame */
+static void test_yNext(void) {
+    resetTelemetry(0);
+    TEST_CLOCK_STEP = 3;
+    test_tick();
+    test_tick();
+    TEST_CLOCK_STEP = 0;
+    u32 sum = 0;
+    u32 i;
+    for(i = 0; i < TELEM_STAGES; i++) {
+        sum += TELEMETRY.stage_last[i];
+    }
+    const u32 ok = TELEMETRY.frames == 2 && TELEMETRY.last_us > 0
+        && TELEMETRY.last_us == sum && TELEMETRY.ring[1] == sum
+        && TELEMETRY.stage_last[TELEM_SIM] > 0
+        && TELEMETRY.budget_us == SIM_TICK_US && TELEMETRY.over_budget == 0;
+    if(ok) {
+        score_pass("yNext");
+    } else {
+        score_fail("yNext");
+    }
+}
+
+
+/* ===================== */
+/* == Container tests == */
+/* ===================== */
+
+/* Shared by the container tests */
+static u8 TEST_ASSET_DATA[3 * ASSET_CHUNK];
+static u8 TEST_ASSET_PACK[4 * ASSET_CHUNK];
+static u8 TEST_ASSET_BUF[2 * ASSET_CHUNK];
+static asset_pool_t TEST_ASSET_POOL;
+
+/* Fill TEST_ASSET_DATA with n bytes of noise, from a seed */
+static void test_asset_noise(u32 n, u32 seed) {
+    u32 i;
+    for(i = 0; i < n; i++) {
+        seed ^= seed << 13;
+        seed ^= seed >> 17;
+        seed ^= seed << 5;
+        TEST_ASSET_DATA[i] = (u8)seed;
+    }
+}
+
+/* Returns: 1 if n bytes of a match b */
+static u32 test_asset_same(const u8 * a, const u8 * b, u32 n) {
+    return memcmp(a, b, n) == 0;
+}
+
+/* Hand made chunks should decode, including overlapping matches and long */
+/* lengths, and malformed chunks should fail rather than go out of bounds */
+static void test_cLz(void) {
+    /* "abcd", then 8 bytes from 4 back, then "xy" */
+    static const u8 seq[] = {0x44, 'a', 'b', 'c', 'd', 4, 0, 0x20, 'x', 'y'};
+    /* "z", then 9 bytes from 1 back, then nothing */
+    static const u8 run[] = {0x15, 'z', 1, 0, 0x00};
+    static const u8 dist0[] = {0x10, 'a', 0, 0};
+    static const u8 distFar[] = {0x10, 'a', 2, 0};
+    static const u8 noDist[] = {0x10, 'a', 1};
+    static const u8 shortLit[] = {0x50, 'a', 'b'};
+    static const u8 noLength[] = {0xf0};
+    u8 * out = TEST_ASSET_BUF;
+    u32 ok = lzDecode(seq, sizeof(seq), out, 64) == 14
+        && test_asset_same(out, (const u8 *)"abcdabcdabcdxy", 14)
+        && lzDecode(seq, sizeof(seq), out, 13) == 0
+        && lzDecode(run, sizeof(run), out, 64) == 10
+        && test_asset_same(out, (const u8 *)"zzzzzzzzzz", 10)
+        && lzDecode(dist0, sizeof(dist0), out, 64) == 0
+        && lzDecode(distFar, sizeof(distFar), out, 64) == 0
+        && lzDecode(noDist, sizeof(noDist), out, 64) == 0
+        && lzDecode(shortLit, sizeof(shortLit), out, 64) == 0
+        && lzDecode(noLength, sizeof(noLength), out, 64) == 0;
+    /* Round trip 300 bytes of noise (a long literal run), then 600 zeros */
+    /* (a long match)                                                     */
+    u8 * packed = TEST_ASSET_PACK;
+    test_asset_noise(300, 1);
+    memset(&TEST_ASSET_DATA[300], 0, 600);
+    const u32 size = lzEncode(TEST_ASSET_DATA, 900, packed, LZ_BOUND(900));
+    ok = ok && size > 300 && size < 330
+        && lzDecode(packed, size, out, ASSET_CHUNK) == 900
+        && test_asset_same(out, TEST_ASSET_DATA, 900)
+        && lzEncode(TEST_ASSET_DATA, 900, packed, 100) == 0;
+    if(ok) {
+        score_pass("cLz");
+    } else {
+        score_fail("cLz");
+    }
+}
+
+/* Containers should round trip raw and compressed assets, read across */
+/* chunk boundaries, reuse decoded chunks, and refuse malformed blobs  */
+static void test_cPack(void) {
+    const u32 mapLen = 3 * ASSET_CHUNK - 100;
+    const u32 noiseLen = 5000;
+    u8 * blob = TEST_ASSET_PACK;
+    u8 * buf = TEST_ASSET_BUF;
+    asset_pool_t * pool = &TEST_ASSET_POOL;
+    asset_builder_t b;
+    asset_pack_t pack;
+    u32 i;
+    /* Asset 0: raw tiles. Asset 1: a map that compresses. Asset 2: noise */
+    /* that doesn't, so it gets stored raw.                               */
+    u32 ok = assetBuildBegin(&b, blob, sizeof(TEST_ASSET_PACK), 3);
+    test_asset_noise(100, 2);
+    ok = ok && assetBuildAdd(&b, ASSET_TILES, TEST_ASSET_DATA, 100, 0) == 0;
+    for(i = 0; i < mapLen; i++) {
+        TEST_ASSET_DATA[i] = (i / 40) % 7 + (i % 40 == 0);
+    }
+    ok = ok && assetBuildAdd(&b, ASSET_MAP, TEST_ASSET_DATA, mapLen, 1) == 1;
+    test_asset_noise(noiseLen, 3);
+    ok = ok && assetBuildAdd(&b, ASSET_AUDIO, TEST_ASSET_DATA, noiseLen, 1)
+        == 2 && assetBuildAdd(&b, ASSET_FONT, TEST_ASSET_DATA, 1, 0) == -1;
+    const u32 len = assetBuildEnd(&b);
+    assetPoolClear(pool);
+    ok = ok && assetOpen(&pack, blob, len) && pack.count == 3
+        && assetType(&pack, 0) == ASSET_TILES && assetLength(&pack, 0) == 100
+        && assetType(&pack, 1) == ASSET_MAP
+        && assetLength(&pack, 1) == mapLen
+        && assetType(&pack, 2) == ASSET_AUDIO && assetType(&pack, 3) == 0
+        && _asset_u16(blob, assetEntry(1) + ASSET_FLAGS) == ASSET_LZ
+        && _asset_u32(blob, assetEntry(1) + ASSET_SIZE) < mapLen / 10
+        && _asset_u16(blob, assetEntry(2) + ASSET_FLAGS) == 0;
+    for(i = 0; i < 3; i++) {
+        ok = ok && _asset_u32(blob, assetEntry(i) + ASSET_OFFSET)
+            % ASSET_ALIGN == 0;
+    }
+    /* Raw reads come from the blob without decoding */
+    ok = ok && assetRead(&pack, pool, 2, noiseLen - 10, buf, 64) == 10
+        && test_asset_same(buf, &TEST_ASSET_DATA[noiseLen - 10], 10)
+        && pool->decodes == 0;
+    /* Reading across a chunk boundary decodes both chunks, once */
+    for(i = 0; i < mapLen; i++) {
+        TEST_ASSET_DATA[i] = (i / 40) % 7 + (i % 40 == 0);
+    }
+    const u32 edge = ASSET_CHUNK - 10;
+    ok = ok && assetRead(&pack, pool, 1, edge, buf, 20) == 20
+        && test_asset_same(buf, &TEST_ASSET_DATA[edge], 20)
+        && pool->decodes == 2
+        && assetRead(&pack, pool, 1, edge, buf, 20) == 20
+        && pool->decodes == 2
+        && assetRead(&pack, pool, 1, 0, buf, 2 * ASSET_CHUNK)
+            == 2 * ASSET_CHUNK
+        && test_asset_same(buf, TEST_ASSET_DATA, 2 * ASSET_CHUNK)
+        && pool->decodes == 2
+        && assetRead(&pack, pool, 1, 2 * ASSET_CHUNK, buf, ASSET_CHUNK)
+            == ASSET_CHUNK - 100
+        && test_asset_same(buf, &TEST_ASSET_DATA[2 * ASSET_CHUNK],
+            ASSET_CHUNK - 100)
+        && pool->decodes == 3 && assetRead(&pack, pool, 1, mapLen, buf, 1)
+            == 0 && assetRead(&pack, pool, 9, 0, buf, 1) == 0;
+    /* Malformed containers: bad magic, too many assets, a misaligned    */
+    /* asset, and a chunk table that runs backward                       */
+    const u32 e1 = assetEntry(1);
+    const u32 offset1 = _asset_u32(blob, e1 + ASSET_OFFSET);
+    blob[0] = 'X';
+    ok = ok && !assetOpen(&pack, blob, len);
+    blob[0] = 'M';
+    blob[5] = 1;
+    ok = ok && !assetOpen(&pack, blob, len);
+    blob[5] = 0;
+    blob[e1 + ASSET_OFFSET] += 1;
+    ok = ok && !assetOpen(&pack, blob, len);
+    blob[e1 + ASSET_OFFSET] -= 1;
+    const u32 start1 = _asset_u32(blob, offset1 + 4);
+    memcpy(&blob[offset1 + 4], &blob[offset1], 4);
+    ok = ok && !assetOpen(&pack, blob, len) && !assetOpen(&pack, blob, 4);
+    _pack_u32(blob, offset1 + 4, start1);
+    /* A corrupt chunk fails to read, and doesn't stay in the pool */
+    const u8 saved = blob[offset1 + start1];
+    assetPoolClear(pool);
+    blob[offset1 + start1] = 0xf0;
+    ok = ok && assetOpen(&pack, blob, len)
+        && assetRead(&pack, pool, 1, ASSET_CHUNK, buf, 8) == 0;
+    blob[offset1 + start1] = saved;
+    ok = ok && assetRead(&pack, pool, 1, ASSET_CHUNK, buf, 8) == 8
+        && pool->decodes == 2;
+    if(ok) {
+        score_pass("cPack");
+    } else {
+        score_fail("cPack");
+    }
+}
+
+/* The exports should load a container from ASSET_BLOB, read assets into */
+/* ASSET_OUT, and decode audio into SOUND_PCM                            */
+static void test_cLoad(void) {
+    const u32 frames = 20000;
+    i16 * pcm = (i16 *)TEST_ASSET_DATA;
+    asset_builder_t b;
+    u32 i;
+    for(i = 0; i < frames; i++) {
+        pcm[i] = (i16)((i % 100) * 300 - 15000);
+    }
+    u32 ok = assetBuildBegin(&b, ASSET_BLOB, ASSET_BLOB_MAX, 2)
+        && assetBuildAdd(&b, ASSET_FONT, (const u8 *)"font", 4, 0) == 0
+        && assetBuildAdd(&b, ASSET_AUDIO, TEST_ASSET_DATA, frames * 2, 1)
+            == 1;
+    const u32 len = assetBuildEnd(&b);
+    ok = ok && loadAssets(len) == 2 && getAssetType(0) == ASSET_FONT
+        && getAssetType(1) == ASSET_AUDIO && getAssetLength(1) == frames * 2
+        && readAsset(0, 0, 99) == 4 && test_asset_same(ASSET_OUT,
+            (const u8 *)"font", 4)
+        && readAsset(1, 0, 1 << 20) == ASSET_CHUNK
+        && test_asset_same(ASSET_OUT, TEST_ASSET_DATA, ASSET_CHUNK)
+        && loadSoundAsset(0, 0) == 0
+        && loadSoundAsset(1, SOUND_PCM_MAX - frames + 1) == 0
+        && loadSoundAsset(1, 100) == frames;
+    for(i = 0; i < frames; i++) {
+        ok = ok && SOUND_PCM[100 + i] == pcm[i];
+    }
+    ASSET_BLOB[0] = 0;
+    ok = ok && loadAssets(len) == -1 && getAssetType(0) == 0
+        && readAsset(0, 0, 4) == 0 && loadAssets(ASSET_BLOB_MAX + 1) == -1;
+    if(ok) {
+        score_pass("cLoad");
+    } else {
+        score_fail("cLoad");
+    }
+}
+
+
+/* =============== */
+/* == Job tests == */
+/* =============== */
+
+/* Shared by the job tests */
+#define TEST_JOB_ITEMS (100000)
+#define TEST_JOB_GRAIN (1000)
+static job_system_t TEST_JOBS;
+static job_graph_t TEST_GRAPH;
+static u8 TEST_JOB_HITS[TEST_JOB_ITEMS];
+static u32 TEST_JOB_PIECES = 0;
+static u32 TEST_JOB_SHORT = 0;
+static u32 TEST_JOB_SEQ = 0;
+static u32 TEST_JOB_ORDER[JOB_MAX];
+
+/* Job: count each item in the range, and pieces shorter than the grain */
+static void test_job_hits(void * arg, u32 begin, u32 end) {
+    u32 i;
+    for(i = begin; i < end; i++) {
+        TEST_JOB_HITS[i] += 1;
+    }
+    __atomic_add_fetch(&TEST_JOB_PIECES, 1, __ATOMIC_RELAXED);
+    if(end - begin < TEST_JOB_GRAIN) {
+        __atomic_add_fetch(&TEST_JOB_SHORT, 1, __ATOMIC_RELAXED);
+    }
+}
+
+/* Job: note when job *arg ran */
+static void test_job_order(void * arg, u32 begin, u32 end) {
+    TEST_JOB_ORDER[*(const u32 *)arg] =
+        __atomic_add_fetch(&TEST_JOB_SEQ, 1, __ATOMIC_RELAXED);
+}
+
+/* Returns: 1 if every item got hit n times */
+static u32 test_job_all_hit(u32 n) {
+    u32 i;
+    for(i = 0; i < TEST_JOB_ITEMS; i++) {
+        if(TEST_JOB_HITS[i] != n) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/* A parallel-for should hit every item once per run, in pieces of at */
+/* least the grain (except the last), on 4 threads and on 1           */
+static void test_jFor(void) {
+    memset(TEST_JOB_HITS, 0, sizeof(TEST_JOB_HITS));
+    TEST_JOB_PIECES = 0;
+    TEST_JOB_SHORT = 0;
+    jobGraphClear(&TEST_GRAPH);
+    u32 ok = jobInit(&TEST_JOBS, 4) == 4 && jobInit(&TEST_JOBS, 2) == 4
+        && jobFor(&TEST_GRAPH, test_job_hits, 0, TEST_JOB_ITEMS,
+            TEST_JOB_GRAIN) == 0;
+    jobRun(&TEST_JOBS, &TEST_GRAPH);
+    ok = ok && test_job_all_hit(1) && TEST_JOB_PIECES > 1
+        && TEST_JOB_PIECES <= TEST_JOB_ITEMS / TEST_JOB_GRAIN
+        && TEST_JOB_SHORT == 0;
+    jobRun(&TEST_JOBS, &TEST_GRAPH);
+    ok = ok && test_job_all_hit(2);
+    /* An empty range runs no pieces */
+    TEST_JOB_PIECES = 0;
+    jobRange(&TEST_GRAPH, 0, 0);
+    jobRun(&TEST_JOBS, &TEST_GRAPH);
+    ok = ok && TEST_JOB_PIECES == 0;
+    /* One thread runs the whole range as one piece */
+    jobShutdown(&TEST_JOBS);
+    jobRange(&TEST_GRAPH, 0, TEST_JOB_ITEMS);
+    ok = ok && jobInit(&TEST_JOBS, 1) == 1;
+    jobRun(&TEST_JOBS, &TEST_GRAPH);
+    ok = ok && test_job_all_hit(3) && TEST_JOB_PIECES == 1
+        && TEST_JOBS.steals == 0;
+    jobShutdown(&TEST_JOBS);
+    if(ok) {
+        score_pass("jFor");
+    } else {
+        score_fail("jFor");
+    }
+}
+
+/* Returns: 1 if every job ran after the jobs it waits for */
+static u32 test_job_in_order(void) {
+    const job_graph_t * g = &TEST_GRAPH;
+    u32 i;
+    u32 j;
+    for(i = 0; i < g->count; i++) {
+        for(j = 0; j < g->job[i].dependents; j++) {
+            const u32 d = g->job[i].dependent[j];
+            if(TEST_JOB_ORDER[d] <= TEST_JOB_ORDER[i]) {
+                return 0;
+            }
+        }
+    }
+    return 1;
+}
+
+/* Jobs should run after the jobs they wait for, every run, and graphs */
+/* should refuse bad dependencies and jobs past JOB_MAX                */
+static void test_jGraph(void) {
+    static u32 ids[JOB_MAX];
+    u32 ok = 1;
+    u32 i;
+    u32 run;
+    jobGraphClear(&TEST_GRAPH);
+    for(i = 0; i < 8; i++) {
+        ids[i] = i;
+        ok = ok && jobAdd(&TEST_GRAPH, test_job_order, &ids[i]) == (i32)i;
+    }
+    /* 0 -> {1, 2} -> 3 -> 5, with 4 independent and 5 -> {6, 7} */
+    ok = ok && jobAfter(&TEST_GRAPH, 1, 0) && jobAfter(&TEST_GRAPH, 2, 0)
+        && jobAfter(&TEST_GRAPH, 3, 1) && jobAfter(&TEST_GRAPH, 3, 2)
+        && jobAfter(&TEST_GRAPH, 5, 3) && jobAfter(&TEST_GRAPH, 5, 4)
+        && jobAfter(&TEST_GRAPH, 6, 5) && jobAfter(&TEST_GRAPH, 7, 5)
+        && !jobAfter(&TEST_GRAPH, 7, 7) && !jobAfter(&TEST_GRAPH, 8, 0)
+        && jobInit(&TEST_JOBS, 4) == 4;
+    for(run = 0; run < 100; run++) {
+        TEST_JOB_SEQ = 0;
+        jobRun(&TEST_JOBS, &TEST_GRAPH);
+        ok = ok && TEST_JOB_SEQ == 8 && test_job_in_order();
+    }
+    jobShutdown(&TEST_JOBS);
+    /* Without extra threads, jobs run in dependency order too */
+    TEST_JOB_SEQ = 0;
+    jobRun(&TEST_JOBS, &TEST_GRAPH);
+    ok = ok && TEST_JOBS.threads == 1 && TEST_JOB_SEQ == 8
+        && test_job_in_order();
+    /* Limits: job 0 already has 2 dependents */
+    for(i = 2; i < JOB_DEPENDENTS_MAX; i++) {
+        ok = ok && jobAfter(&TEST_GRAPH, 1 + i % 7, 0);
+    }
+    ok = ok && !jobAfter(&TEST_GRAPH, 7, 0);
+    for(i = 8; i < JOB_MAX; i++) {
+        ids[i] = i;
+        ok = ok && jobAdd(&TEST_GRAPH, test_job_order, &ids[i]) == (i32)i;
+    }
+    ok = ok && jobAdd(&TEST_GRAPH, test_job_order, &ids[0]) == -1;
+    if(ok) {
+        score_pass("jGraph");
+    } else {
+        score_fail("jGraph");
+    }
+}
+
+
+int main() {
+    /* Render List */
+    test_rInit();
+    test_rIdle();
+    test_rMove();
+    test_rLines();
+    test_rEdge();
+    test_rVertices();
+    test_rSprites();
+
+    /* Tile Maps */
+    test_tPack();
+    test_tCorrupt();
+    test_tCull();
+    test_tCache();
+
+    /* Entities */
+    test_eIntegrate();
+    test_eSpatial();
+    test_eRender();
+
+    /* Pathfinding */
+    test_pFind();
+    test_pFlow();
+
+    /* Field of View */
+    test_fSkip();
+    test_fView();
+    test_fLight();
+
+    /* Simulation Timestep */
+    test_sInputTap();
+    test_sFrameRate();
+    test_sCatchUp();
+
+    /* Snapshots */
+    test_nDelta();
+    test_nSnap();
+    test_nRewind();
+    test_nResim();
+    test_nArena();
+    test_nWrap();
+
+    /* Particles */
+    test_xIntegrate();
+    test_xCompact();
+    test_xDust();
+
+    /* Audio */
+    test_aMix();
+    test_aPitch();
+    test_aRing();
+
+    /* Animation */
+    test_kEval();
+    test_kPlayer();
+
+    /* 3D Math */
+    test_mTransform();
+    test_mPalette();
+    test_mCull();
+
+    /* Telemetry */
+    test_yBuckets();
+    test_yFrames();
+    test_yNext();
+
+    /* Containers */
+    test_cLz();
+    test_cPack();
+    test_cLoad();
+
+    /* Jobs */
+    test_jFor();
+    test_jGraph();
+
+    /* If any tests failed, print the failed test log */
+    if(TEST_SCORE_FAIL > 0) {
+        printf("[=========================]\n"
+               "[ List of Failing Tests   ]\n"
+               "%.*s"
+               "[=========================]\n", (int)FAIL_LOG_LEN, FAIL_LOG);
+    }
+    /* Summarize scores */
+    char * fmt =
+        "[==============]\n"
+        "[ Test Results ]\n"
+        "[ Pass: %3d    ]\n"
+        "[ Fail: %3d    ]\n"
+        "[==============]\n";
+    printf(fmt, TEST_SCORE_PASS, TEST_SCORE_FAIL);
+    return (TEST_SCORE_FAIL == 0) ? 0 : 1;
+}
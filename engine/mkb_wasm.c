@@ -7,14 +7,73 @@
 #include <stdint.h>
 #include "mkb_engine.h"  /* u8, u32, i32, ... */
 
+#ifdef WASM_MEMCPY
+/*****************************************************************************/
+/* DIY stdlib replacement: this works around lack of wasm32 standard library */
+/*****************************************************************************/
+/* Clang turns struct copies and clearing loops into memcpy() and memset() */
+/* calls, which would otherwise be left as imports that nothing provides.  */
+#   ifdef __wasm_bulk_memory__
+    /* With the bulk-memory feature (clang -mbulk-memory), these builtins  */
+    /* compile to single memory.copy and memory.fill instructions.        */
+    void *memcpy(void *dest, const void *src, unsigned long n) {
+        return __builtin_memcpy(dest, src, n);
+    }
+    void *memset(void *s, int c, unsigned long n) {
+        return __builtin_memset(s, c, n);
+    }
+#   else
+    /* For the MVP instruction set, go a word at a time when the pointers */
+    /* allow it.                                                           */
+    typedef uint32_t __attribute__((__may_alias__)) u32_alias;
+    void *memcpy(void *dest, const void *src, unsigned long n) {
+        uint8_t * d = (uint8_t *)dest;
+        const uint8_t * s = (const uint8_t *)src;
+        if((((unsigned long)d | (unsigned long)s) & 3) == 0) {
+            for(; n >= 4; n -= 4, d += 4, s += 4) {
+                *(u32_alias *)d = *(const u32_alias *)s;
+            }
+        }
+        for(; n > 0; n--) {
+            *d++ = *s++;
+        }
+        return dest;
+    }
+    void *memset(void *s, int c, unsigned long n) {
+        uint8_t * d = (uint8_t *)s;
+        const uint32_t word = (uint8_t)c * 0x01010101UL;
+        for(; n > 0 && ((unsigned long)d & 3) != 0; n--) {
+            *d++ = c;
+        }
+        for(; n >= 4; n -= 4, d += 4) {
+            *(u32_alias *)d = word;
+        }
+        for(; n > 0; n--) {
+            *d++ = c;
+        }
+        return s;
+    }
+#   endif
+#endif
 
-/**************************************/
-/* Exported Symbols: Global Variables */
-/**************************************/
-
-/* Gamepad button state bitfield */
-__attribute__((visibility("default")))
-u32 GAMEPAD;
+/* Including C source here lets LLVM optimize the whole module as a single */
+/* translation unit. This should give better results than relying on LTO.  */
+#include "render.c"
+#include "sim.c"
+#include "tilemap.c"
+#include "tilemesh.c"
+#include "entity.c"
+#include "path.c"
+#include "fov.c"
+#include "snap.c"
+#include "particle.c"
+#include "audio.c"
+#define ANIM_MAX (ENTITY_MAX + 1)  /* The player, then one slot per NPC */
+#include "anim.c"
+#include "math3d.c"
+#include "telemetry.c"
+#include "asset.c"
+#include "job.c"
 
 
 /******************************************************/
@@ -26,28 +85,137 @@ extern void js_trace(u32 code);
 
 extern void repaint();
 
-extern void drawTiles();
-
-extern void setPlayerTile(u32 tile);
-
-extern void drawLines();
+/* Returns: a monotonic clock in microseconds, for telemetry. It can wrap. */
+extern u32 js_clock_us(void);
 
 
 /**************************/
 /* Non-exported Constants */
 /**************************/
 
-/* Tile Resolution */
-#define TILES_WIDE (15)
-#define TILES_HIGH (10)
+/* World size in chunks (each chunk is TILEMAP_CHUNK tiles square) */
+#define WORLD_CHUNKS (32)
+#define WORLD_TILES  (WORLD_CHUNKS * TILEMAP_CHUNK)
 
-/* Delays in ms for walking and running */
+/* Room for the packed world map. Each chunk of the demo world packs down */
+/* to 2 runs per row, and 4 bytes per run.                                */
+#define WORLD_BLOB_MAX (TILEMAP_HEADER_LEN + \
+    WORLD_CHUNKS * WORLD_CHUNKS * (4 + TILEMAP_CHUNK * 2 * 4))
+
+/* Delays in us for walking and running */
 /* Diagonal paces are regular paces scaled by approximately sqrt(2) */
-#define RUN_MS       (140)
-#define WALK_MS      (RUN_MS * 2)
-#define WALK_DIAG_MS ((WALK_MS * 90) >> 6)
-#define RUN_DIAG_MS  ((RUN_MS * 90) >> 6)
-#define DEBOUNCE_MS  (100)
+#define RUN_US       (140000)
+#define WALK_US      (RUN_US * 2)
+#define WALK_DIAG_US ((WALK_US * 90) >> 6)
+#define RUN_DIAG_US  ((RUN_US * 90) >> 6)
+#define DEBOUNCE_US  (100000)
+
+/* Room for an asset container loaded by js */
+#ifndef ASSET_BLOB_MAX
+#define ASSET_BLOB_MAX (1 << 20)
+#endif
+
+/* Threads for the frame's jobs. The wasm module has no threads, but native */
+/* builds with MKB_THREADS can use more.                                   */
+#ifndef JOB_THREADS
+#define JOB_THREADS (1)
+#endif
+
+/* Ids of the frame's jobs (see frameJobs()), and the fewest animation */
+/* slots to evaluate per piece                                         */
+#define JOB_ANIM    (0)
+#define JOB_SPATIAL (1)
+#define JOB_VISIBLE (2)
+#define ANIM_GRAIN  (1024)
+
+/* Frame time budget for telemetry: one simulation tick */
+#define FRAME_BUDGET_US (SIM_TICK_US)
+
+/* Number of wandering NPCs to spawn around the player's starting point */
+#ifndef DEMO_NPCS
+#define DEMO_NPCS (256)
+#endif
+
+/* Number of NPCs that chase the player rather than wander. They all share */
+/* one flow field toward the player's tile.                                */
+#ifndef DEMO_CHASERS
+#define DEMO_CHASERS (64)
+#endif
+
+/* Chaser speed in 1/256 tile per tick */
+#define CHASE_SPEED (12)
+
+/* NPC entity flag for chasers (ENTITY_ACTIVE uses bit 0) */
+#define NPC_CHASER (2)
+
+/* How far the player can see in tiles. NPCs out of sight don't get drawn. */
+/* This is far enough to see the corners of the view.                     */
+#define SIGHT_RADIUS (12)
+
+/* Most steps findPath() can write to PATH_STEPS */
+#define PATH_STEPS_MAX (1024)
+
+/* Most NPCs that snapshots cover. Must be a multiple of 4, and no more */
+/* than ENTITY_MAX. The native benchmark makes the entity store bigger,  */
+/* but snapshots stay the size of the demo's.                            */
+#define NPC_MAX (4096)
+
+/* Dust puffs for player steps: particle count, life in ticks, and color */
+#define DUST_PARTICLES (12)
+#define DUST_LIFE      (24)
+#define DUST_COLOR     (0xc0a0c0e0)
+
+/* Footstep sound: its id, length, and sample rate. The demo synthesizes it */
+/* at the start of SOUND_PCM.                                               */
+#define STEP_SOUND        (0)
+#define STEP_SOUND_FRAMES (1200)
+#define STEP_SOUND_RATE   (24000)
+#define STEP_VOLUME       (160)
+
+/* Room for 3D objects to cull, points to transform, and skeleton joints */
+#define OBJECT_MAX (4096)
+#define POINT_MAX  (4096)
+#define JOINT_MAX  (256)
+
+/* Downward pull on particles in 1/256 tile per tick per tick */
+#define PARTICLE_GRAVITY (2)
+
+/* Seed for the game's random number generator */
+#define RNG_SEED (12345)
+
+/* Spatial hash buckets for NPCs. Should be a power of 2 around DEMO_NPCS. */
+#define NPC_BUCKETS (256)
+
+/* Most NPCs that can be drawn in one frame */
+#define VISIBLE_MAX (256)
+
+/* Player sprite tile number */
+#define PLAYER_SPRITE (0)
+
+/* Sprite frames: the player has PLAYER_FRAMES for each way it can face */
+/* (standing, then 3 walking), starting from PLAYER_SPRITE. Each kind of */
+/* NPC has NPC_FRAMES walking frames, starting from NPC_SPRITE.          */
+#define PLAYER_FRAMES (4)
+#define NPC_SPRITE    (16)
+#define NPC_FRAMES    (2)
+#define NPC_KINDS     (8)
+
+/* Ways the player can face, in the order of its sprite frames */
+#define FACE_DOWN  (0)
+#define FACE_UP    (1)
+#define FACE_LEFT  (2)
+#define FACE_RIGHT (3)
+
+/* Animation clips, ticks per walking frame, and the animation slot for */
+/* the player (NPC n uses slot n + 1)                                   */
+#define CLIP_STAND       (0)
+#define CLIP_WALK        (1)
+#define CLIP_NPC         (2)
+#define WALK_FRAME_TICKS (8)
+#define ANIM_PLAYER      (0)
+
+/* Vertices in the tile layer's triangle list (6 per tile) */
+#define TILE_VERTS (TILEMESH_VERTS)
 
 /* Gamepad Button Bitfield Masks */
 #define GP_A        (1)
@@ -61,23 +229,209 @@ extern void drawLines();
 #define GP_DPAD   (GP_U|GP_D|GP_L|GP_R)
 
 
+/**************************************/
+/* Exported Symbols: Global Variables */
+/**************************************/
+
+/* Tiles of the most recent findPath() result, as y * world width + x */
+__attribute__((visibility("default")))
+u32 PATH_STEPS[PATH_STEPS_MAX];
+
+/* Tile layer vertices for the front end to draw (see tilemesh.h). Render */
+/* lists say which ones changed with RC_VERTICES commands.                */
+__attribute__((visibility("default")))
+u8 TILE_VERTICES[TILE_VERTS * TILEMESH_VERTEX_BYTES];
+
+/* Quick-save snapshot. js can copy it somewhere after snapshotSave(), and */
+/* copy it back before snapshotLoad().                                     */
+__attribute__((visibility("default")))
+u32 SNAPSHOT[SNAP_WORDS_MAX];
+
+/* Particle instance data for the front end to draw, as of the most recent */
+/* frame: PARTICLE_INSTANCE_WORDS words per particle, with positions in    */
+/* 1/256 tile units relative to the camera                                  */
+__attribute__((visibility("default")))
+u32 PARTICLE_INSTANCES[PARTICLE_MAX * PARTICLE_INSTANCE_WORDS];
+__attribute__((visibility("default")))
+u32 PARTICLE_COUNT;
+
+/* View-projection matrix for 3D culling and transforms, set by js */
+__attribute__((visibility("default")))
+mat4_t VIEW_PROJ;
+
+/* Bounds of 3D objects for cullSpheres() and cullBoxes(), as 6 parallel
+ * arrays of OBJECT_MAX f32s: spheres use {x, y, z, radius}, and boxes use
+ * {center x, y, z, half size x, y, z}. The indexes of visible objects get
+ * written to OBJECT_VISIBLE.
+ */
+__attribute__((visibility("default")))
+f32 OBJECT_BOUNDS[6 * OBJECT_MAX];
+__attribute__((visibility("default")))
+u32 OBJECT_VISIBLE[OBJECT_MAX];
+
+/* Points for transformPoints(), as 4 parallel arrays of POINT_MAX f32s */
+/* for {x, y, z, w}                                                     */
+__attribute__((visibility("default")))
+f32 POINTS[4 * POINT_MAX];
+
+/* Skeleton for buildPalette(): joint poses relative to their parents, as
+ * POSE_FIELDS parallel arrays of JOINT_MAX f32s (see math3d.h), parent
+ * joint indexes (-1 for roots), and inverse bind matrices. The skinning
+ * matrices for a shader go in JOINT_PALETTE.
+ */
+__attribute__((visibility("default")))
+f32 JOINT_POSE[POSE_FIELDS * JOINT_MAX];
+__attribute__((visibility("default")))
+i32 JOINT_PARENT[JOINT_MAX];
+__attribute__((visibility("default")))
+mat4_t JOINT_INV_BIND[JOINT_MAX];
+__attribute__((visibility("default")))
+mat4_t JOINT_PALETTE[JOINT_MAX];
+
+/* Sprite frame for each animation slot as of the most recent frame: the */
+/* player in slot ANIM_PLAYER, and NPC n in slot n + 1                   */
+__attribute__((visibility("default")))
+u16 ANIM_FRAMES[ANIM_MAX];
+
+/* Asset container for js to load (see asset.h for the format), and bytes */
+/* read from it by readAsset()                                           */
+__attribute__((visibility("default")))
+__attribute__((aligned(ASSET_ALIGN)))
+u8 ASSET_BLOB[ASSET_BLOB_MAX];
+__attribute__((visibility("default")))
+u8 ASSET_OUT[ASSET_CHUNK];
+
+/* Frame time telemetry (see telemetry.h for layout) */
+__attribute__((visibility("default")))
+telemetry_t TELEMETRY;
+
+/* Gamepad button states for resimulate() to use, one per tick, oldest */
+/* first                                                                */
+__attribute__((visibility("default")))
+u32 RESIM_INPUT[SNAP_RING_FRAMES];
+
+
 /*********************************/
 /* Non-exported Global Variables */
 /*********************************/
 
 /* Previous gamepad button state packed into a bitfield */
-static u8 PREV_GAMEPAD = 0;
+static u32 PREV_GAMEPAD = 0;
+
+/* Player character's current location in world tile coordinates */
+static u32 PLAYER_X = WORLD_TILES / 2;
+static u32 PLAYER_Y = WORLD_TILES / 2;
+
+/* Player location as of the most recent render list */
+static u32 DRAWN_X = WORLD_TILES / 2;
+static u32 DRAWN_Y = WORLD_TILES / 2;
 
-/* Player character's current location in tile coordinates */
-static u8 PLAYER_X = 7;
-static u8 PLAYER_Y = 5;
+/* Tile ids that TILE_VERTICES was built from */
+static tilemesh_t TILE_MESH;
 
-/* Hold time for pressed dpad buttons */
-static u32 DPAD_MS = 0;
+/* World map and its packed blob */
+static tilemap_t WORLD;
+static u8 WORLD_BLOB[WORLD_BLOB_MAX];
+
+/* Non-player characters */
+static entity_store_t NPCS;
+
+/* Pathfinding state for the world map */
+static path_t PATHS;
+
+/* Field of view and lights for the world map */
+static fov_t FOV;
+
+/* Ids of NPCs in view, and a checksum of their tile positions as of the */
+/* most recent render list                                               */
+static u32 VISIBLE[VISIBLE_MAX];
+static u32 VISIBLE_COUNT = 0;
+static u32 VISIBLE_SUM = 0;
+
+/* Hold time in us for pressed dpad buttons */
+static u32 DPAD_US = 0;
 
 /* Debounce flag for dpad buttons */
 static u32 DPAD_DEBOUNCED = 0;
 
+/* Random number generator state. Game logic should only use randomness */
+/* from rngNext(), so that snapshots capture it along with everything    */
+/* else.                                                                 */
+static u32 RNG_STATE = RNG_SEED;
+
+/* Particles for visual effects */
+static particle_pool_t PARTICLES;
+
+/* Random number state for effects. This is separate from RNG_STATE, so */
+/* effects don't change how the game plays out.                          */
+static u32 EFFECT_RNG = RNG_SEED;
+
+/* Animation clips and playback. These are only for looks, so they stay */
+/* out of snapshots, like particles.                                    */
+static anim_clips_t CLIPS;
+static anim_set_t ANIMS;
+
+/* Way the player is facing, and the player's sprite frame as of the most */
+/* recent render list                                                     */
+static u32 PLAYER_FACING = FACE_DOWN;
+static u32 DRAWN_FRAME = PLAYER_SPRITE;
+
+/* Job system, and the frame's jobs with their inputs and outputs */
+static job_system_t JOBS;
+static job_graph_t FRAME_JOBS;
+static u32 FRAME_TICKS = 0;
+static u32 FRAME_VISIBLE = 0;
+
+/* Loaded asset container, and buffers for its decoded chunks */
+static asset_pack_t ASSETS;
+static asset_pool_t ASSET_POOL;
+
+/* Snapshots of recent ticks for rewindFrames() and resimulate() */
+static snap_ring_t REWIND;
+
+/* Model space joint matrices, from buildPalette() */
+static mat4_t JOINT_WORLD[JOINT_MAX];
+
+/* Set when the whole view needs redrawing on the next frame (after loading */
+/* a snapshot, for example)                                                 */
+static u32 FORCE_REDRAW = 0;
+
+/* State that snapshots cover: everything that game logic reads or writes
+ * from one tick to the next. Since gameTick() only uses this state, integer
+ * math, and GAMEPAD, running the same ticks from the same snapshot always
+ * ends up in the same state. Some things stay out:
+ * - The spatial hash, flow fields, and views get rebuilt from this state.
+ * - NPCs past NPC_MAX (the demo never spawns that many).
+ * - The tile map, blocked tiles, and opaque tiles only change by calls from
+ *   js, not by game logic.
+ * - The sim clock and input queue belong to the front end's real time, so
+ *   they keep going when the game state goes back.
+ */
+static const snap_region_t SNAP_REGIONS[] = {
+    {&GAMEPAD, sizeof(GAMEPAD)},
+    {&PREV_GAMEPAD, sizeof(PREV_GAMEPAD)},
+    {&PLAYER_X, sizeof(PLAYER_X)},
+    {&PLAYER_Y, sizeof(PLAYER_Y)},
+    {&DPAD_US, sizeof(DPAD_US)},
+    {&DPAD_DEBOUNCED, sizeof(DPAD_DEBOUNCED)},
+    {&RNG_STATE, sizeof(RNG_STATE)},
+    {&CAMERA_X, sizeof(CAMERA_X)},
+    {&CAMERA_Y, sizeof(CAMERA_Y)},
+    {&NPCS.count, sizeof(NPCS.count)},
+    {&NPCS.buckets, sizeof(NPCS.buckets)},
+    {NPCS.x, NPC_MAX * sizeof(NPCS.x[0])},
+    {NPCS.y, NPC_MAX * sizeof(NPCS.y[0])},
+    {NPCS.vx, NPC_MAX * sizeof(NPCS.vx[0])},
+    {NPCS.vy, NPC_MAX * sizeof(NPCS.vy[0])},
+    {NPCS.tile, NPC_MAX * sizeof(NPCS.tile[0])},
+    {NPCS.flags, NPC_MAX * sizeof(NPCS.flags[0])},
+};
+#define SNAP_REGION_COUNT (sizeof(SNAP_REGIONS) / sizeof(SNAP_REGIONS[0]))
+
+/* Flags for what needs to be redrawn after a tick */
+#define RedrawTile (1  /* Player moved, so redraw old and new tiles */)
+#define RedrawFull (2  /* Redraw the whole view                     */)
+
 /* Types of motion that can be triggered by dpad buttons */
 typedef enum e_DpMove {
     DpWait = 0,
@@ -90,31 +444,33 @@ typedef enum e_DpMove {
 /* Non-exported Functions */
 /**************************/
 
-/* Update timer to handle button debounce and repeat.  */
-/* The repeat interval is determined by pace_ms        */
-/* Returns: 0: don't do the thing yet, 1: do the thing */
-static DpMove updateDpadTimer(u16 interval_ms, u32 pace_ms) {
+/* Update timer to handle button debounce and repeat, once per tick. */
+/* The repeat interval is determined by pace_us. The timer counts in  */
+/* whole ticks of SIM_TICK_US, so it doesn't depend on frame times.   */
+/* Returns: 0: don't do the thing yet, 1: do the thing                */
+static DpMove updateDpadTimer(u32 pace_us) {
+    const u32 interval_us = SIM_TICK_US;
     /* Debounce the button press. This allows for precise diagonal motion */
     /* and for quick presses to face a new direction without taking steps */
     if(!DPAD_DEBOUNCED) {
         /* For initial button-down, immediately face in that direction */
-        if(DPAD_MS == 0) {
-            DPAD_MS = interval_ms;
+        if(DPAD_US == 0) {
+            DPAD_US = interval_us;
             return DpFace;
         }
         /* After debounce delay expires, take a step */
-        DPAD_MS += interval_ms;
-        if(DPAD_MS >= DEBOUNCE_MS) {
+        DPAD_US += interval_us;
+        if(DPAD_US >= DEBOUNCE_US) {
             DPAD_DEBOUNCED = 1;
-            DPAD_MS %= DEBOUNCE_MS; /* make sure 1st repeat isn't too soon */
+            DPAD_US %= DEBOUNCE_US; /* make sure 1st repeat isn't too soon */
             return DpStep;
         }
     }
     /* Once initial debounce period is over, update timer and decide */
     /* when enough time has passed to trigger a repeating step.      */
-    DPAD_MS += interval_ms;
-    if(DPAD_MS >= pace_ms) {
-        DPAD_MS %= pace_ms;
+    DPAD_US += interval_us;
+    if(DPAD_US >= pace_us) {
+        DPAD_US %= pace_us;
         return DpStep;
     }
     return DpWait;
@@ -144,7 +500,7 @@ static u32 dpadUp() {
 
 /* Move player down. Returns 1 when redraw needed, otherwise 0. */
 static u32 dpadDown() {
-    if(PLAYER_Y < TILES_HIGH - 1) {
+    if(PLAYER_Y < WORLD.tilesHigh - 1) {
         PLAYER_Y += 1;
         return 1;
     }
@@ -162,7 +518,7 @@ static u32 dpadLeft() {
 
 /* Move player right. Returns 1 when redraw needed, otherwise 0. */
 static u32 dpadRight() {
-    if(PLAYER_X < TILES_WIDE - 1) {
+    if(PLAYER_X < WORLD.tilesWide - 1) {
         PLAYER_X += 1;
         return 1;
     }
@@ -171,34 +527,338 @@ static u32 dpadRight() {
 
 /* Clear the dpad timers */
 static void dpadNone() {
-    DPAD_MS = 0;
+    DPAD_US = 0;
     DPAD_DEBOUNCED = 0;
 }
 
-/* Tell the front-end to update the player's tile coordinates */
-static void updatePlayerTile() {
-    u8 tile = (PLAYER_Y * TILES_WIDE) + PLAYER_X;
-    setPlayerTile(tile);
+/* Returns: the next number from the game's random number generator */
+static u32 rngNext(void) {
+    /* Numerical Recipes LCG. The low bits repeat quickly, so callers */
+    /* should use the high bits.                                      */
+    RNG_STATE = RNG_STATE * 1664525u + 1013904223u;
+    return RNG_STATE;
 }
 
+/* Emit a puff of dust particles from the bottom of tile (x, y) */
+static void effectDust(u32 x, u32 y) {
+    const i32 px = (x << ENTITY_SUB_SHIFT) + (ENTITY_SUB >> 1);
+    const i32 py = ((y + 1) << ENTITY_SUB_SHIFT) - 1;
+    u32 i;
+    for(i = 0; i < DUST_PARTICLES; i++) {
+        EFFECT_RNG = EFFECT_RNG * 1664525u + 1013904223u;
+        const i32 vx = (i32)((EFFECT_RNG >> 16) & 15) - 8;
+        const i32 vy = -(i32)((EFFECT_RNG >> 24) & 15) - 4;
+        particleEmit(&PARTICLES, px, py, vx, vy, DUST_LIFE, DUST_COLOR);
+    }
+}
 
-/*******************************/
-/* Exported Symbols: Functions */
-/*******************************/
+/* Play a footstep sound, panned toward where the player is in the view */
+static void effectStep(void) {
+    const i32 x = (i32)(PLAYER_X - CAMERA_X) * 2 - (VIEW_WIDE - 1);
+    const i32 pan = x * (AUDIO_UNITY / 2) / VIEW_WIDE;
+    EFFECT_RNG = EFFECT_RNG * 1664525u + 1013904223u;
+    const u32 pitch = PITCH_UNITY - (PITCH_UNITY >> 3)
+        + ((EFFECT_RNG >> 16) & ((PITCH_UNITY >> 2) - 1));
+    audioPlay(STEP_SOUND, STEP_VOLUME, pan, pitch);
+}
 
-/* Initialization function (gets called by js) */
-__attribute__((visibility("default")))
-i32 init(void) {
-    js_trace(12345);
-    updatePlayerTile();
-    drawTiles();
-    return 0;
+/* Synthesize the footstep sound into SOUND_PCM: a burst of low passed */
+/* noise that fades out                                                */
+static void soundSynth(void) {
+    u32 seed = RNG_SEED;
+    i32 smooth = 0;
+    u32 i;
+    for(i = 0; i < STEP_SOUND_FRAMES; i++) {
+        seed = seed * 1664525u + 1013904223u;
+        smooth = (smooth * 3 + (i32)(seed >> 16) - 32768) / 4;
+        SOUND_PCM[i] = smooth * (i32)(STEP_SOUND_FRAMES - i)
+            / STEP_SOUND_FRAMES;
+    }
 }
 
-/* Prepare the next frame */
-/* elapsed_ms: number of milliseconds since previous frame */
-__attribute__((visibility("default")))
-void next(u32 elapsed_ms) {
+/* Reset the 3D view to the identity matrix, and the skeleton to root */
+/* joints with no rotation and unit scale                              */
+static void jointsReset(void) {
+    u32 i;
+    mat4Identity(&VIEW_PROJ);
+    for(i = 0; i < POSE_FIELDS * JOINT_MAX; i++) {
+        JOINT_POSE[i] = 0.0f;
+    }
+    for(i = 0; i < JOINT_MAX; i++) {
+        JOINT_POSE[POSE_QW * JOINT_MAX + i] = 1.0f;
+        JOINT_POSE[POSE_SX * JOINT_MAX + i] = 1.0f;
+        JOINT_POSE[POSE_SY * JOINT_MAX + i] = 1.0f;
+        JOINT_POSE[POSE_SZ * JOINT_MAX + i] = 1.0f;
+        JOINT_PARENT[i] = -1;
+        mat4Identity(&JOINT_INV_BIND[i]);
+    }
+}
+
+/* Define the demo's animation clips. Frame numbers are relative to each */
+/* sprite's first frame for the way it's facing.                         */
+static void animDefine(void) {
+    static const u16 stand[] = {0};
+    static const u16 walk[] = {1, 2, 1, 3};
+    static const u16 npc[] = {0, 1};
+    static const u16 ticks[] = {WALK_FRAME_TICKS, WALK_FRAME_TICKS,
+        WALK_FRAME_TICKS, WALK_FRAME_TICKS};
+    animClipsClear(&CLIPS);
+    animClip(&CLIPS, CLIP_STAND, stand, ticks, 1, ANIM_LOOP);
+    animClip(&CLIPS, CLIP_WALK, walk, ticks, 4, ANIM_LOOP);
+    animClip(&CLIPS, CLIP_NPC, npc, ticks, 2, ANIM_LOOP);
+}
+
+/* Pick clips for the player and NPCs. The player walks while the dpad is */
+/* held, faster when running, and NPCs walk while they're moving.        */
+static void animUpdate(void) {
+    const u32 dpad = GAMEPAD & GP_DPAD;
+    const u32 old_count = ANIMS.count;
+    u32 i;
+    animResize(&ANIMS, 1 + NPCS.count);
+    if(dpad & GP_L) {
+        PLAYER_FACING = FACE_LEFT;
+    } else if(dpad & GP_R) {
+        PLAYER_FACING = FACE_RIGHT;
+    } else if(dpad & GP_U) {
+        PLAYER_FACING = FACE_UP;
+    } else if(dpad & GP_D) {
+        PLAYER_FACING = FACE_DOWN;
+    }
+    ANIMS.base[ANIM_PLAYER] = PLAYER_SPRITE + PLAYER_FACING * PLAYER_FRAMES;
+    animPlay(&ANIMS, ANIM_PLAYER, dpad ? CLIP_WALK : CLIP_STAND,
+        (GAMEPAD & GP_B) ? ANIM_SPEED_UNITY * WALK_US / RUN_US
+        : ANIM_SPEED_UNITY);
+    /* New NPC slots start at different places in the clip so NPCs don't */
+    /* all step in time                                                  */
+    for(i = old_count > 1 ? old_count : 1; i < ANIMS.count; i++) {
+        ANIMS.clip[i] = CLIP_NPC;
+        ANIMS.time[i] = (i % (NPC_FRAMES * WALK_FRAME_TICKS))
+            << ANIM_TIME_SHIFT;
+    }
+    for(i = 1; i < ANIMS.count; i++) {
+        const u32 id = i - 1;
+        ANIMS.base[i] = NPCS.tile[id];
+        ANIMS.speed[i] = (NPCS.vx[id] | NPCS.vy[id]) ? ANIM_SPEED_UNITY : 0;
+    }
+}
+
+/* Pack the demo world into WORLD_BLOB, one chunk at a time */
+static u32 worldPack(void) {
+    static u16 chunk[TILEMAP_CHUNK_TILES];
+    u8 * blob = WORLD_BLOB;
+    u32 pos = TILEMAP_HEADER_LEN + WORLD_CHUNKS * WORLD_CHUNKS * 4;
+    u32 n;
+    blob[0] = 'M';
+    blob[1] = 'K';
+    blob[2] = 'T';
+    blob[3] = 'M';
+    blob[4] = (u8)  WORLD_CHUNKS;
+    blob[5] = (u8) (WORLD_CHUNKS >> 8);
+    blob[6] = blob[4];
+    blob[7] = blob[5];
+    for(n = 0; n < WORLD_CHUNKS * WORLD_CHUNKS; n++) {
+        const u32 left = (n % WORLD_CHUNKS) * TILEMAP_CHUNK;
+        const u32 top = (n / WORLD_CHUNKS) * TILEMAP_CHUNK;
+        u32 i;
+        for(i = 0; i < TILEMAP_CHUNK_TILES; i++) {
+            const u32 x = left + (i & TILEMAP_CHUNK_MASK);
+            const u32 y = top + (i >> TILEMAP_CHUNK_SHIFT);
+            chunk[i] = ((x >> 4) + (y >> 4)) % 150;
+        }
+        const u32 o = TILEMAP_HEADER_LEN + n * 4;
+        blob[o    ] = (u8)  pos;
+        blob[o + 1] = (u8) (pos >> 8);
+        blob[o + 2] = (u8) (pos >> 16);
+        blob[o + 3] = (u8) (pos >> 24);
+        const u32 len = tilemapPackChunk(chunk, &blob[pos],
+            WORLD_BLOB_MAX - pos);
+        if(len == 0) {
+            return 0;
+        }
+        pos += len;
+    }
+    return pos;
+}
+
+/* Spawn NPCs with pseudo-random positions and velocities near the player */
+static void npcSpawn(void) {
+    u32 i;
+    entityClear(&NPCS, NPC_BUCKETS);
+    for(i = 0; i < DEMO_NPCS; i++) {
+        u32 seed = rngNext();
+        const i32 x = (PLAYER_X - 32 + ((seed >> 10) & 63)) << ENTITY_SUB_SHIFT;
+        seed = rngNext();
+        const i32 y = (PLAYER_Y - 32 + ((seed >> 10) & 63)) << ENTITY_SUB_SHIFT;
+        seed = rngNext();
+        const i32 vx = (i32)((seed >> 16) & 31) - 16;
+        const i32 vy = (i32)((seed >> 24) & 31) - 16;
+        const u8 flags = ENTITY_ACTIVE | (i < DEMO_CHASERS ? NPC_CHASER : 0);
+        entitySpawn(&NPCS, x, y, vx, vy,
+            NPC_SPRITE + (i % NPC_KINDS) * NPC_FRAMES, flags);
+    }
+    spatialBuild(&NPCS);
+}
+
+/* Point each chaser at the center of its next tile toward the player. */
+/* Chasers outside the flow field keep wandering, and chasers that     */
+/* reach the player's tile stop.                                       */
+static void npcChase(void) {
+    const flow_field_t * f = 0;
+    const i32 half = ENTITY_SUB >> 1;
+    u32 i;
+    for(i = 0; i < NPCS.count; i++) {
+        if(!(NPCS.flags[i] & NPC_CHASER)) {
+            continue;
+        }
+        /* Only get the flow field once there's a chaser to use it */
+        if(!f) {
+            f = flowField(&PATHS, PLAYER_X, PLAYER_Y);
+        }
+        const i32 x = NPCS.x[i] >> ENTITY_SUB_SHIFT;
+        const i32 y = NPCS.y[i] >> ENTITY_SUB_SHIFT;
+        i32 nx;
+        i32 ny;
+        if(flowStep(&PATHS, f, x, y, &nx, &ny)) {
+            const i32 dx = (nx << ENTITY_SUB_SHIFT) + half - NPCS.x[i];
+            const i32 dy = (ny << ENTITY_SUB_SHIFT) + half - NPCS.y[i];
+            NPCS.vx[i] = dx > 0 ? CHASE_SPEED : (dx < 0 ? -CHASE_SPEED : 0);
+            NPCS.vy[i] = dy > 0 ? CHASE_SPEED : (dy < 0 ? -CHASE_SPEED : 0);
+        } else if(x == (i32)PLAYER_X && y == (i32)PLAYER_Y) {
+            NPCS.vx[i] = 0;
+            NPCS.vy[i] = 0;
+        }
+    }
+}
+
+/* Returns: NPC id's sprite frame as of the most recent animation pass */
+static u32 npcFrame(u32 id) {
+    return ANIM_FRAMES[id + 1];
+}
+
+/* Find the NPCs in view of the camera that the player can see, saving */
+/* their ids in VISIBLE.                                               */
+/* Returns: checksum of their ids, tile positions, and sprite frames   */
+static u32 npcVisible(void) {
+    const i32 x0 = CAMERA_X << ENTITY_SUB_SHIFT;
+    const i32 y0 = CAMERA_Y << ENTITY_SUB_SHIFT;
+    const i32 x1 = ((CAMERA_X + VIEW_WIDE) << ENTITY_SUB_SHIFT) - 1;
+    const i32 y1 = ((CAMERA_Y + VIEW_HIGH) << ENTITY_SUB_SHIFT) - 1;
+    u32 n = spatialQuery(&NPCS, x0, y0, x1, y1, VISIBLE, VISIBLE_MAX);
+    u32 sum = 0;
+    u32 count = 0;
+    u32 i;
+    n = n < VISIBLE_MAX ? n : VISIBLE_MAX;
+    fovLook(&FOV, PLAYER_X, PLAYER_Y, SIGHT_RADIUS);
+    for(i = 0; i < n; i++) {
+        const u32 id = VISIBLE[i];
+        const u32 tx = NPCS.x[id] >> ENTITY_SUB_SHIFT;
+        const u32 ty = NPCS.y[id] >> ENTITY_SUB_SHIFT;
+        if(fovVisible(&FOV, &FOV.view, tx, ty)) {
+            VISIBLE[count] = id;
+            count += 1;
+            sum = (sum * 31) + (id ^ (tx << 10) ^ (ty << 21));
+            sum = (sum * 31) + npcFrame(id);
+        }
+    }
+    VISIBLE_COUNT = count;
+    return sum + count;
+}
+
+/* Job: run the animation pass on slots begin to end - 1 */
+static void animJob(void * arg, u32 begin, u32 end) {
+    animEval(&ANIMS, &CLIPS, FRAME_TICKS, ANIM_FRAMES, begin, end);
+}
+
+/* Job: rebuild the NPC spatial hash */
+static void spatialJob(void * arg, u32 begin, u32 end) {
+    spatialBuild(&NPCS);
+}
+
+/* Job: find the NPCs in view, which needs their frames and spatial hash */
+static void visibleJob(void * arg, u32 begin, u32 end) {
+    FRAME_VISIBLE = npcVisible();
+}
+
+/* Start the job system, and set up the frame's jobs: the animation pass, */
+/* spread over threads, alongside the NPC spatial hash, then visibility   */
+static void frameJobsInit(void) {
+    jobInit(&JOBS, JOB_THREADS);
+    jobGraphClear(&FRAME_JOBS);
+    jobFor(&FRAME_JOBS, animJob, 0, 0, ANIM_GRAIN);
+    jobAdd(&FRAME_JOBS, spatialJob, 0);
+    jobAdd(&FRAME_JOBS, visibleJob, 0);
+    jobAfter(&FRAME_JOBS, JOB_VISIBLE, JOB_ANIM);
+    jobAfter(&FRAME_JOBS, JOB_VISIBLE, JOB_SPATIAL);
+}
+
+/* Run the frame's jobs, advancing animations by ticks */
+/* Returns: checksum of the NPCs in view               */
+static u32 frameJobs(u32 ticks) {
+    FRAME_TICKS = ticks;
+    jobRange(&FRAME_JOBS, JOB_ANIM, ANIMS.count);
+    jobRun(&JOBS, &FRAME_JOBS);
+    return FRAME_VISIBLE;
+}
+
+/* Append RC_VERTICES commands for rows of tile layer vertices, one per run */
+/* of adjacent rows in the rows bitfield                                   */
+static void renderVertexRows(u32 rows) {
+    u32 y = 0;
+    while(rows >> y) {
+        if(!((rows >> y) & 1)) {
+            y += 1;
+            continue;
+        }
+        const u32 first = y;
+        while((rows >> y) & 1) {
+            y += 1;
+        }
+        renderVertices(first * TILEMESH_ROW_VERTS,
+            (y - first) * TILEMESH_ROW_VERTS);
+    }
+}
+
+/* Build the render list for a frame. Dirty rectangles cover the whole view */
+/* if full is set or the camera scrolled, otherwise just the player's old   */
+/* and new tiles.                                                           */
+static void renderFrame(u32 full, u32 lines) {
+    const u32 old_x = CAMERA_X;
+    const u32 old_y = CAMERA_Y;
+    if(cameraFollow(&WORLD, PLAYER_X, PLAYER_Y)) {
+        full = 1;
+    }
+    tilemapCull(&WORLD);
+    if(full) {
+        renderDirty(0, 0, VIEW_WIDE, VIEW_HIGH);
+    } else {
+        renderDirty(DRAWN_X - old_x, DRAWN_Y - old_y, 1, 1);
+        renderDirty(PLAYER_X - CAMERA_X, PLAYER_Y - CAMERA_Y, 1, 1);
+    }
+    renderCamera(CAMERA_X, CAMERA_Y);
+    renderVertexRows(tilemeshBuild(&TILE_MESH, VIEW_TILES, TILE_VERTICES));
+    if(lines) {
+        renderLines(0, TILE_VERTS);
+    } else {
+        renderTiles(0);
+    }
+    renderSprite(PLAYER_X, PLAYER_Y, ANIM_FRAMES[ANIM_PLAYER]);
+    VISIBLE_SUM = npcVisible();
+    u32 i;
+    for(i = 0; i < VISIBLE_COUNT; i++) {
+        const u32 id = VISIBLE[i];
+        renderSprite(NPCS.x[id] >> ENTITY_SUB_SHIFT,
+            NPCS.y[id] >> ENTITY_SUB_SHIFT, npcFrame(id));
+    }
+    DRAWN_X = PLAYER_X;
+    DRAWN_Y = PLAYER_Y;
+    DRAWN_FRAME = ANIM_FRAMES[ANIM_PLAYER];
+}
+
+/* Run game logic for one simulation tick. This must be deterministic:  */
+/* the same state and GAMEPAD always give the same result, which is     */
+/* what lets resimulate() replay ticks with different inputs.           */
+/* Returns: bitfield of RedrawTile and RedrawFull flags                 */
+static u32 gameTick(void) {
     /* Check if any gamepad buttons changed */
     u32 diff = PREV_GAMEPAD ^ GAMEPAD;
     PREV_GAMEPAD = GAMEPAD;
@@ -210,12 +870,12 @@ void next(u32 elapsed_ms) {
     u32 b_down = buttons & GP_B;
     u32 pace;
     if(dpadIsDiagonal(buttons)) {
-        pace = b_down ? RUN_DIAG_MS : WALK_DIAG_MS;
+        pace = b_down ? RUN_DIAG_US : WALK_DIAG_US;
     } else {
-        pace = b_down ? RUN_MS : WALK_MS;
+        pace = b_down ? RUN_US : WALK_US;
     }
     if(dpad_bits) {
-        action = updateDpadTimer(elapsed_ms, pace);
+        action = updateDpadTimer(pace);
     } else {
         dpadNone();
     }
@@ -225,13 +885,377 @@ void next(u32 elapsed_ms) {
         if(buttons & GP_L) { moved += dpadLeft();  }
         if(buttons & GP_R) { moved += dpadRight(); }
     }
-    /* Redraw if needed */
-    if(moved || diff) {
-        updatePlayerTile();
-        if(GAMEPAD & (GP_SELECT|GP_START|GP_A)) {
-            drawLines();
-        } else {
-            drawTiles();
+    /* Move NPCs */
+    npcChase();
+    entityIntegrate(&NPCS, WORLD.tilesWide << ENTITY_SUB_SHIFT,
+        WORLD.tilesHigh << ENTITY_SUB_SHIFT);
+    return (moved ? RedrawTile : 0) | (diff ? RedrawFull : 0);
+}
+
+/* Add the time since mark to a telemetry stage.   */
+/* Returns: the clock, to use as the next mark     */
+static u32 telemMark(u32 stage, u32 mark) {
+    const u32 now = js_clock_us();
+    telemStage(&TELEMETRY, stage, now - mark);
+    return now;
+}
+
+/* Save the game state as the latest snapshot in the rewind ring */
+static void rewindPush(void) {
+    snapSave(SNAP_REGIONS, SNAP_REGION_COUNT, snapRingNext(&REWIND));
+    snapRingPush(&REWIND);
+}
+
+
+/*******************************/
+/* Exported Symbols: Functions */
+/*******************************/
+
+/* Initialization function (gets called by js) */
+__attribute__((visibility("default")))
+i32 init(void) {
+    js_trace(12345);
+    if(!tilemapLoad(&WORLD, WORLD_BLOB, worldPack())) {
+        return -1;
+    }
+    if(!pathInit(&PATHS, WORLD.tilesWide, WORLD.tilesHigh)
+        || !fovInit(&FOV, WORLD.tilesWide, WORLD.tilesHigh)
+        || !snapRingInit(&REWIND, snapWords(SNAP_REGIONS, SNAP_REGION_COUNT))) {
+        return -1;
+    }
+    RNG_STATE = RNG_SEED;
+    npcSpawn();
+    particleClear(&PARTICLES);
+    soundSynth();
+    jointsReset();
+    telemReset(&TELEMETRY, FRAME_BUDGET_US);
+    animDefine();
+    animResize(&ANIMS, 0);
+    PLAYER_FACING = FACE_DOWN;
+    animUpdate();
+    frameJobsInit();
+    frameJobs(0);
+    renderBegin();
+    tilemeshReset(&TILE_MESH);
+    renderFrame(1, 0);
+    rewindPush();
+    return 0;
+}
+
+/* Block or unblock world tile (x, y) for pathfinding */
+__attribute__((visibility("default")))
+void setBlocked(u32 x, u32 y, u32 blocked) {
+    pathSetBlocked(&PATHS, x, y, blocked);
+}
+
+/* Make world tile (x, y) opaque or clear, for sight and light */
+__attribute__((visibility("default")))
+void setOpaque(u32 x, u32 y, u32 opaque) {
+    fovSetOpaque(&FOV, x, y, opaque);
+}
+
+/* Move light id to world tile (x, y), or turn it off with intensity 0 */
+__attribute__((visibility("default")))
+void setLight(u32 id, u32 x, u32 y, u32 radius, u32 intensity) {
+    lightSet(&FOV, id, x, y, radius, intensity);
+}
+
+/* Returns: light level at world tile (x, y), from 0 to LIGHT_FULL */
+__attribute__((visibility("default")))
+u32 lightAt(u32 x, u32 y) {
+    return lightLevel(&FOV, x, y);
+}
+
+/* Save the game state to SNAPSHOT. Returns: snapshot size in bytes. */
+__attribute__((visibility("default")))
+u32 snapshotSave(void) {
+    snapSave(SNAP_REGIONS, SNAP_REGION_COUNT, SNAPSHOT);
+    return snapWords(SNAP_REGIONS, SNAP_REGION_COUNT) * 4;
+}
+
+/* Restore the game state from a snapshot of len bytes in SNAPSHOT. The  */
+/* rewind history starts over from there.                                */
+/* Returns: 1 = Success, 0 = len doesn't match this build's snapshot size */
+__attribute__((visibility("default")))
+u32 snapshotLoad(u32 len) {
+    const u32 words = snapWords(SNAP_REGIONS, SNAP_REGION_COUNT);
+    if(len != words * 4) {
+        return 0;
+    }
+    snapLoad(SNAP_REGIONS, SNAP_REGION_COUNT, SNAPSHOT);
+    spatialBuild(&NPCS);
+    snapRingInit(&REWIND, words);
+    rewindPush();
+    FORCE_REDRAW = RedrawFull;
+    return 1;
+}
+
+/* Go back up to frames ticks of game time.  */
+/* Returns: number of ticks it went back     */
+__attribute__((visibility("default")))
+u32 rewindFrames(u32 frames) {
+    const u32 n = snapRingRewind(&REWIND, frames);
+    snapLoad(SNAP_REGIONS, SNAP_REGION_COUNT, snapRingLatest(&REWIND));
+    spatialBuild(&NPCS);
+    FORCE_REDRAW = RedrawFull;
+    return n;
+}
+
+/* Go back up to frames ticks, then run them again with the gamepad states */
+/* in RESIM_INPUT instead of the ones they had. This is for rollback: when  */
+/* an input turns out to be different from what the game predicted, put    */
+/* the real inputs in RESIM_INPUT and replay the ticks since then.          */
+/* Returns: number of ticks re-simulated                                   */
+__attribute__((visibility("default")))
+u32 resimulate(u32 frames) {
+    /* The camera only moves when a frame gets drawn, so it stays put */
+    const u32 camera_x = CAMERA_X;
+    const u32 camera_y = CAMERA_Y;
+    const u32 n = snapRingRewind(&REWIND, frames);
+    u32 i;
+    snapLoad(SNAP_REGIONS, SNAP_REGION_COUNT, snapRingLatest(&REWIND));
+    CAMERA_X = camera_x;
+    CAMERA_Y = camera_y;
+    for(i = 0; i < n; i++) {
+        GAMEPAD = RESIM_INPUT[i];
+        gameTick();
+        rewindPush();
+    }
+    spatialBuild(&NPCS);
+    FORCE_REDRAW = RedrawFull;
+    return n;
+}
+
+/* Turn on audio at a sample rate (usually the AudioContext's), or turn it */
+/* off with rate 0. This forgets sounds defined before, then defines the   */
+/* demo's sounds.                                                          */
+/* Returns: 1 = Success, 0 = rate is out of range                          */
+__attribute__((visibility("default")))
+u32 startAudio(u32 rate) {
+    if(!audioInit(rate)) {
+        return 0;
+    }
+    if(rate != 0) {
+        audioSound(STEP_SOUND, 0, STEP_SOUND_FRAMES, 0, 0, STEP_SOUND_RATE);
+    }
+    return 1;
+}
+
+/* Define sound id as mono samples in SOUND_PCM (see audioSound()) */
+/* Returns: 1 = Success, 0 = bad arguments or audio is off        */
+__attribute__((visibility("default")))
+u32 defineSound(u32 id, u32 start, u32 frames, u32 loop_start, u32 loop_end,
+    u32 rate) {
+    return audioSound(id, start, frames, loop_start, loop_end, rate);
+}
+
+/* Play sound id (see audioPlay()). Returns: voice id, or -1. */
+__attribute__((visibility("default")))
+i32 playSound(u32 id, u32 volume, i32 pan, u32 pitch) {
+    return audioPlay(id, volume, pan, pitch);
+}
+
+/* Change the volume, pan, and pitch of voice v */
+__attribute__((visibility("default")))
+void setVoice(u32 v, u32 volume, i32 pan, u32 pitch) {
+    audioVoice(v, volume, pan, pitch);
+}
+
+/* Stop voice v */
+__attribute__((visibility("default")))
+void stopVoice(u32 v) {
+    audioStop(v);
+}
+
+/* Load an asset container of len bytes that js put in ASSET_BLOB */
+/* Returns: number of assets, or -1 if the container is malformed */
+__attribute__((visibility("default")))
+i32 loadAssets(u32 len) {
+    ASSETS.count = 0;
+    assetPoolClear(&ASSET_POOL);
+    if(len > ASSET_BLOB_MAX || !assetOpen(&ASSETS, ASSET_BLOB, len)) {
+        return -1;
+    }
+    return ASSETS.count;
+}
+
+/* Returns: type of asset id (ASSET_TILES, ...), or 0 if there's no such */
+/* asset                                                                  */
+__attribute__((visibility("default")))
+u32 getAssetType(u32 id) {
+    return assetType(&ASSETS, id);
+}
+
+/* Returns: decompressed length of asset id in bytes */
+__attribute__((visibility("default")))
+u32 getAssetLength(u32 id) {
+    return assetLength(&ASSETS, id);
+}
+
+/* Copy up to n bytes of asset id from offset to ASSET_OUT, decoding as */
+/* needed. n gets clamped to the size of ASSET_OUT.                     */
+/* Returns: bytes copied                                                */
+__attribute__((visibility("default")))
+u32 readAsset(u32 id, u32 offset, u32 n) {
+    n = n < ASSET_CHUNK ? n : ASSET_CHUNK;
+    return assetRead(&ASSETS, &ASSET_POOL, id, offset, ASSET_OUT, n);
+}
+
+/* Decode audio asset id (16 bit mono samples) into SOUND_PCM from start, */
+/* a chunk at a time, so the whole asset never needs decoding at once.    */
+/* Define the sound with defineSound() afterward.                         */
+/* Returns: frames loaded, or 0 for a missing or malformed asset          */
+__attribute__((visibility("default")))
+u32 loadSoundAsset(u32 id, u32 start) {
+    const u32 bytes = assetLength(&ASSETS, id);
+    if(assetType(&ASSETS, id) != ASSET_AUDIO || start > SOUND_PCM_MAX
+        || bytes / 2 > SOUND_PCM_MAX - start) {
+        return 0;
+    }
+    /* Samples are little-endian, like wasm memory */
+    u8 * dst = (u8 *)&SOUND_PCM[start];
+    if(assetRead(&ASSETS, &ASSET_POOL, id, 0, dst, bytes) != bytes) {
+        return 0;
+    }
+    return bytes / 2;
+}
+
+/* Find which of the first n bounding spheres in OBJECT_BOUNDS are in view */
+/* of VIEW_PROJ, writing their indexes to OBJECT_VISIBLE.                  */
+/* Returns: number of visible objects                                      */
+__attribute__((visibility("default")))
+u32 cullSpheres(u32 n) {
+    frustum_t f;
+    frustumFromMat4(&f, &VIEW_PROJ);
+    n = n < OBJECT_MAX ? n : OBJECT_MAX;
+    return frustumCullSpheres(&f, OBJECT_BOUNDS, OBJECT_MAX, n,
+        OBJECT_VISIBLE);
+}
+
+/* Find which of the first n boxes in OBJECT_BOUNDS are in view of     */
+/* VIEW_PROJ, writing their indexes to OBJECT_VISIBLE.                 */
+/* Returns: number of visible objects                                  */
+__attribute__((visibility("default")))
+u32 cullBoxes(u32 n) {
+    frustum_t f;
+    frustumFromMat4(&f, &VIEW_PROJ);
+    n = n < OBJECT_MAX ? n : OBJECT_MAX;
+    return frustumCullBoxes(&f, OBJECT_BOUNDS, OBJECT_MAX, n,
+        OBJECT_VISIBLE);
+}
+
+/* Transform the first n points in POINTS by VIEW_PROJ, in place */
+__attribute__((visibility("default")))
+void transformPoints(u32 n) {
+    n = n < POINT_MAX ? n : POINT_MAX;
+    mat4TransformBatch(&VIEW_PROJ, POINTS, POINTS, POINT_MAX, n);
+}
+
+/* Rotate joint j by quaternion {x, y, z, w}, on top of its current pose */
+__attribute__((visibility("default")))
+void rotateJoint(u32 j, f32 x, f32 y, f32 z, f32 w) {
+    quat_t r;
+    quat_t p;
+    if(j >= JOINT_MAX) {
+        return;
+    }
+    f32 * q = &JOINT_POSE[POSE_QX * JOINT_MAX + j];
+    r.x = x;
+    r.y = y;
+    r.z = z;
+    r.w = w;
+    p.x = q[0];
+    p.y = q[JOINT_MAX];
+    p.z = q[JOINT_MAX * 2];
+    p.w = q[JOINT_MAX * 3];
+    p = quatNormalize(quatMul(r, p));
+    q[0] = p.x;
+    q[JOINT_MAX] = p.y;
+    q[JOINT_MAX * 2] = p.z;
+    q[JOINT_MAX * 3] = p.w;
+}
+
+/* Build skinning matrices for the first n joints into JOINT_PALETTE, from */
+/* JOINT_POSE, JOINT_PARENT, and JOINT_INV_BIND. This normalizes the pose  */
+/* rotations in place.                                                     */
+__attribute__((visibility("default")))
+void buildPalette(u32 n) {
+    n = n < JOINT_MAX ? n : JOINT_MAX;
+    quatNormalizeBatch(&JOINT_POSE[POSE_QX * JOINT_MAX], JOINT_MAX, n);
+    mat4ComposeBatch(JOINT_POSE, JOINT_MAX, JOINT_WORLD, n);
+    mat4Hierarchy(JOINT_WORLD, JOINT_PARENT, n);
+    mat4MulBatch(JOINT_PALETTE, JOINT_WORLD, JOINT_INV_BIND, n);
+}
+
+/* Find a path between two world tiles, writing its tiles to PATH_STEPS  */
+/* Returns: number of steps (at most PATH_STEPS_MAX get written), or -1 */
+__attribute__((visibility("default")))
+i32 findPath(u32 x0, u32 y0, u32 x1, u32 y1) {
+    return pathFind(&PATHS, x0, y0, x1, y1, PATH_STEPS, PATH_STEPS_MAX);
+}
+
+/* Zero the telemetry counters and set the frame budget in microseconds */
+/* (0 means one simulation tick)                                        */
+__attribute__((visibility("default")))
+void resetTelemetry(u32 budget_us) {
+    telemReset(&TELEMETRY, budget_us ? budget_us : FRAME_BUDGET_US);
+}
+
+/* Returns: shortest frame time in us in the telemetry histogram bucket */
+/* that holds the frame at per_mille of the way through (500 = median)  */
+__attribute__((visibility("default")))
+u32 frameTimePercentile(u32 per_mille) {
+    return telemPercentile(&TELEMETRY, per_mille);
+}
+
+/* Prepare the next frame */
+/* elapsed_ms: number of milliseconds since previous frame */
+__attribute__((visibility("default")))
+void next(u32 elapsed_ms) {
+    const u32 start = js_clock_us();
+    u32 mark = start;
+    u32 redraw = FORCE_REDRAW;
+    telemBegin(&TELEMETRY);
+    const u32 ticks = simFrame(elapsed_ms);
+    u32 i;
+    FORCE_REDRAW = 0;
+    for(i = 0; i < ticks; i++) {
+        simTick();
+        mark = telemMark(TELEM_INPUT, mark);
+        const u32 r = gameTick();
+        rewindPush();  /* Keep a snapshot of each tick */
+        mark = telemMark(TELEM_SIM, mark);
+        /* Effects */
+        if(r & RedrawTile) {
+            effectDust(PLAYER_X, PLAYER_Y);
+            effectStep();
         }
+        particleIntegrate(&PARTICLES, PARTICLE_GRAVITY);
+        particleCompact(&PARTICLES);
+        mark = telemMark(TELEM_EFFECTS, mark);
+        redraw |= r;
+    }
+    simFrameEnd();
+    mark = telemMark(TELEM_INPUT, mark);
+    animUpdate();
+    /* Check if any NPCs in view moved to a different tile or changed frames */
+    if(frameJobs(ticks) != VISIBLE_SUM) {
+        redraw |= RedrawFull;  /* NPC sprites can be anywhere */
+    }
+    if(ANIM_FRAMES[ANIM_PLAYER] != DRAWN_FRAME) {
+        redraw |= RedrawTile;
+    }
+    mark = telemMark(TELEM_ANIM, mark);
+    /* Redraw if needed. An empty render list means nothing changed. */
+    renderBegin();
+    if(redraw) {
+        renderFrame(redraw & RedrawFull, GAMEPAD & (GP_SELECT|GP_START|GP_A));
     }
+    mark = telemMark(TELEM_RENDER, mark);
+    PARTICLE_COUNT = particleInstances(&PARTICLES, PARTICLE_INSTANCES,
+        PARTICLE_MAX, CAMERA_X << ENTITY_SUB_SHIFT,
+        CAMERA_Y << ENTITY_SUB_SHIFT);
+    audioRender();
+    mark = telemMark(TELEM_EFFECTS, mark);
+    telemFrame(&TELEMETRY, mark - start);
 }
@@ -0,0 +1,240 @@
+/* Copyright (c) 2023 Sam Blenny
+ * SPDX-License-Identifier: CC-BY-NC-SA-4.0
+ *
+ * Particle pool for visual effects, with structure-of-arrays layout and SIMD
+ * update passes.
+ *
+ * Each pass streams through a few of the pool's arrays, several particles at
+ * a time, using wasm simd128 for wasm builds with -msimd128, or SSE2 or AVX2
+ * for native builds (AVX2 needs -mavx2 or -march=native). Without any of
+ * those, the passes fall back to plain loops. Positions are fixed point, so
+ * every path gives the same results.
+ *
+ * Dead particles get removed by compacting the arrays in place, which keeps
+ * the live ones packed at the front in the order they were emitted.
+ */
+#ifndef MKB_PARTICLE_C
+#define MKB_PARTICLE_C
+
+#include "mkb_engine.h"
+#include "particle.h"
+
+/* Vector macros for the integrate and compact passes: pv_t holds
+ * PARTICLE_LANES i32 lanes, and pvAllAlive() tests if every lane is > 0.
+ * Loads and stores don't need to be aligned.
+ */
+#if defined(__wasm_simd128__)
+#include <wasm_simd128.h>
+typedef v128_t pv_t;
+#define PARTICLE_LANES (4)
+#define pvLoad(P)     wasm_v128_load(P)
+#define pvStore(P, V) wasm_v128_store((P), (V))
+#define pvAdd(A, B)   wasm_i32x4_add((A), (B))
+#define pvSub(A, B)   wasm_i32x4_sub((A), (B))
+#define pvSplat(N)    wasm_i32x4_splat(N)
+#define pvAllAlive(V) \
+    wasm_i32x4_all_true(wasm_i32x4_gt((V), wasm_i32x4_splat(0)))
+#elif defined(__AVX2__)
+#include <immintrin.h>
+typedef __m256i pv_t;
+#define PARTICLE_LANES (8)
+#define pvLoad(P)     _mm256_loadu_si256((const __m256i *)(P))
+#define pvStore(P, V) _mm256_storeu_si256((__m256i *)(P), (V))
+#define pvAdd(A, B)   _mm256_add_epi32((A), (B))
+#define pvSub(A, B)   _mm256_sub_epi32((A), (B))
+#define pvSplat(N)    _mm256_set1_epi32(N)
+#define pvAllAlive(V) (_mm256_movemask_epi8( \
+    _mm256_cmpgt_epi32((V), _mm256_setzero_si256())) == -1)
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+typedef __m128i pv_t;
+#define PARTICLE_LANES (4)
+#define pvLoad(P)     _mm_loadu_si128((const __m128i *)(P))
+#define pvStore(P, V) _mm_storeu_si128((__m128i *)(P), (V))
+#define pvAdd(A, B)   _mm_add_epi32((A), (B))
+#define pvSub(A, B)   _mm_sub_epi32((A), (B))
+#define pvSplat(N)    _mm_set1_epi32(N)
+#define pvAllAlive(V) (_mm_movemask_epi8( \
+    _mm_cmpgt_epi32((V), _mm_setzero_si128())) == 0xffff)
+#else
+#define PARTICLE_LANES (1)
+#endif
+
+/* 4 lane vector macros for the instance pass, which interleaves 4 arrays by
+ * transposing 4x4 blocks. pqZip32() interleaves the low (L = 0) or high
+ * (L = 1) halves of A and B 32 bits at a time, and pqZip64() does the same
+ * 64 bits at a time. AVX2 builds use SSE2 for this.
+ */
+#if defined(__wasm_simd128__)
+typedef v128_t pq_t;
+#define PARTICLE_QUADS
+#define pqLoad(P)       wasm_v128_load(P)
+#define pqStore(P, V)   wasm_v128_store((P), (V))
+#define pqSub(A, B)     wasm_i32x4_sub((A), (B))
+#define pqSplat(N)      wasm_i32x4_splat(N)
+#define pqZip32(A, B, L) \
+    wasm_i32x4_shuffle((A), (B), 2*(L), 4+2*(L), 1+2*(L), 5+2*(L))
+#define pqZip64(A, B, L) \
+    wasm_i32x4_shuffle((A), (B), 2*(L), 1+2*(L), 4+2*(L), 5+2*(L))
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+typedef __m128i pq_t;
+#define PARTICLE_QUADS
+#define pqLoad(P)       _mm_loadu_si128((const __m128i *)(P))
+#define pqStore(P, V)   _mm_storeu_si128((__m128i *)(P), (V))
+#define pqSub(A, B)     _mm_sub_epi32((A), (B))
+#define pqSplat(N)      _mm_set1_epi32(N)
+#define pqZip32(A, B, L) \
+    ((L) ? _mm_unpackhi_epi32((A), (B)) : _mm_unpacklo_epi32((A), (B)))
+#define pqZip64(A, B, L) \
+    ((L) ? _mm_unpackhi_epi64((A), (B)) : _mm_unpacklo_epi64((A), (B)))
+#endif
+
+
+/**************************/
+/* Non-exported Functions */
+/**************************/
+
+/* Remove all particles */
+static void particleClear(particle_pool_t * p) {
+    p->count = 0;
+}
+
+/* Add a particle. Returns: 1 = Success, 0 = pool is full */
+static u32 particleEmit(particle_pool_t * p, i32 x, i32 y, i32 vx, i32 vy,
+    i32 life, u32 color) {
+    if(p->count >= PARTICLE_MAX) {
+        return 0;
+    }
+    const u32 i = p->count;
+    p->x[i] = x;
+    p->y[i] = y;
+    p->vx[i] = vx;
+    p->vy[i] = vy;
+    p->life[i] = life;
+    p->color[i] = color;
+    p->count += 1;
+    return 1;
+}
+
+/* Same as particleIntegrate(), for particles begin to end - 1 only, so   */
+/* separate ranges can run on different threads                          */
+static void particleIntegrateRange(particle_pool_t * p, u32 begin, u32 end,
+    i32 gravity) {
+    const u32 n = end < p->count ? end : p->count;
+    u32 i = begin;
+#if PARTICLE_LANES > 1
+    const pv_t g = pvSplat(gravity);
+    const pv_t one = pvSplat(1);
+    for(; i + PARTICLE_LANES <= n; i += PARTICLE_LANES) {
+        const pv_t vy = pvLoad(&p->vy[i]);
+        pvStore(&p->x[i], pvAdd(pvLoad(&p->x[i]), pvLoad(&p->vx[i])));
+        pvStore(&p->y[i], pvAdd(pvLoad(&p->y[i]), vy));
+        pvStore(&p->vy[i], pvAdd(vy, g));
+        pvStore(&p->life[i], pvSub(pvLoad(&p->life[i]), one));
+    }
+#endif
+    for(; i < n; i++) {
+        p->x[i] += p->vx[i];
+        p->y[i] += p->vy[i];
+        p->vy[i] += gravity;
+        p->life[i] -= 1;
+    }
+}
+
+/* Move all particles by their velocity, add gravity to their y velocity, */
+/* and count down their life                                              */
+static void particleIntegrate(particle_pool_t * p, i32 gravity) {
+    particleIntegrateRange(p, 0, p->count, gravity);
+}
+
+/* Remove dead particles, keeping the live ones in order.  */
+/* Returns: number of particles removed                    */
+static u32 particleCompact(particle_pool_t * p) {
+    const u32 n = p->count;
+    u32 i = 0;
+    /* Nothing moves until the first dead particle, so find it a vector */
+    /* at a time                                                        */
+#if PARTICLE_LANES > 1
+    for(; i + PARTICLE_LANES <= n; i += PARTICLE_LANES) {
+        if(!pvAllAlive(pvLoad(&p->life[i]))) {
+            break;
+        }
+    }
+#endif
+    while(i < n && p->life[i] > 0) {
+        i++;
+    }
+    /* From there on, move vectors where every particle is alive down in  */
+    /* one piece. In other vectors, copy every particle down and only      */
+    /* advance past the live ones, which avoids a hard to predict branch.  */
+    u32 j = i;
+    while(i < n) {
+#if PARTICLE_LANES > 1
+        if(i + PARTICLE_LANES <= n && pvAllAlive(pvLoad(&p->life[i]))) {
+            pvStore(&p->x[j], pvLoad(&p->x[i]));
+            pvStore(&p->y[j], pvLoad(&p->y[i]));
+            pvStore(&p->vx[j], pvLoad(&p->vx[i]));
+            pvStore(&p->vy[j], pvLoad(&p->vy[i]));
+            pvStore(&p->life[j], pvLoad(&p->life[i]));
+            pvStore(&p->color[j], pvLoad(&p->color[i]));
+            i += PARTICLE_LANES;
+            j += PARTICLE_LANES;
+            continue;
+        }
+        const u32 end = i + PARTICLE_LANES < n ? i + PARTICLE_LANES : n;
+#else
+        const u32 end = n;
+#endif
+        for(; i < end; i++) {
+            p->x[j] = p->x[i];
+            p->y[j] = p->y[i];
+            p->vx[j] = p->vx[i];
+            p->vy[j] = p->vy[i];
+            p->life[j] = p->life[i];
+            p->color[j] = p->color[i];
+            j += p->life[i] > 0;
+        }
+    }
+    p->count = j;
+    return n - j;
+}
+
+/* Write instance data for up to max particles to out, with positions made
+ * relative to (left, top), PARTICLE_INSTANCE_WORDS words per particle.
+ * Returns: number of particles written
+ */
+static u32 particleInstances(const particle_pool_t * p, u32 * out, u32 max,
+    i32 left, i32 top) {
+    const u32 n = p->count < max ? p->count : max;
+    u32 i = 0;
+#ifdef PARTICLE_QUADS
+    const pq_t l = pqSplat(left);
+    const pq_t t = pqSplat(top);
+    for(; i + 4 <= n; i += 4) {
+        const pq_t x = pqSub(pqLoad(&p->x[i]), l);
+        const pq_t y = pqSub(pqLoad(&p->y[i]), t);
+        const pq_t c = pqLoad(&p->color[i]);
+        const pq_t f = pqLoad(&p->life[i]);
+        const pq_t xy0 = pqZip32(x, y, 0);  /* x0 y0 x1 y1 */
+        const pq_t xy1 = pqZip32(x, y, 1);  /* x2 y2 x3 y3 */
+        const pq_t cf0 = pqZip32(c, f, 0);  /* c0 f0 c1 f1 */
+        const pq_t cf1 = pqZip32(c, f, 1);  /* c2 f2 c3 f3 */
+        u32 * o = &out[i * PARTICLE_INSTANCE_WORDS];
+        pqStore(o,      pqZip64(xy0, cf0, 0));
+        pqStore(o + 4,  pqZip64(xy0, cf0, 1));
+        pqStore(o + 8,  pqZip64(xy1, cf1, 0));
+        pqStore(o + 12, pqZip64(xy1, cf1, 1));
+    }
+#endif
+    for(; i < n; i++) {
+        u32 * o = &out[i * PARTICLE_INSTANCE_WORDS];
+        o[0] = p->x[i] - left;
+        o[1] = p->y[i] - top;
+        o[2] = p->color[i];
+        o[3] = p->life[i];
+    }
+    return n;
+}
+
+#endif /* MKB_PARTICLE_C */
@@ -0,0 +1,61 @@
+/* Copyright (c) 2023 Sam Blenny
+ * SPDX-License-Identifier: CC-BY-NC-SA-4.0
+ *
+ * Particle pool for visual effects, with structure-of-arrays layout and SIMD
+ * update passes.
+ */
+#ifndef MKB_PARTICLE_H
+#define MKB_PARTICLE_H
+
+/* Capacity of a particle pool. Must be a multiple of 8. */
+#ifndef PARTICLE_MAX
+#define PARTICLE_MAX (4096)
+#endif
+
+/* u32 words per particle in the instance data: {x, y, color, life} */
+#define PARTICLE_INSTANCE_WORDS (4)
+
+/* Particles stored as parallel arrays, alive ones first. Positions and
+ * velocities are fixed point world coordinates in the same units as entity
+ * positions. Life counts down once per tick, and a particle dies when it
+ * gets to 0. Particles are only for looks, so game logic never reads them,
+ * and they stay out of snapshots.
+ */
+typedef struct particle_pool {
+    u32 count;
+    i32 x[PARTICLE_MAX];
+    i32 y[PARTICLE_MAX];
+    i32 vx[PARTICLE_MAX];       /* Velocity (fixed point units per tick) */
+    i32 vy[PARTICLE_MAX];
+    i32 life[PARTICLE_MAX];     /* Ticks left to live                    */
+    u32 color[PARTICLE_MAX];    /* RGBA, with red in the low byte        */
+} particle_pool_t;
+
+/* Remove all particles */
+static void particleClear(particle_pool_t * p);
+
+/* Add a particle. Returns: 1 = Success, 0 = pool is full */
+static u32 particleEmit(particle_pool_t * p, i32 x, i32 y, i32 vx, i32 vy,
+    i32 life, u32 color);
+
+/* Move all particles by their velocity, add gravity to their y velocity, */
+/* and count down their life                                              */
+static void particleIntegrate(particle_pool_t * p, i32 gravity);
+
+/* Same as particleIntegrate(), for particles begin to end - 1 only, so   */
+/* separate ranges can run on different threads                          */
+static void particleIntegrateRange(particle_pool_t * p, u32 begin, u32 end,
+    i32 gravity);
+
+/* Remove dead particles, keeping the live ones in order.  */
+/* Returns: number of particles removed                    */
+static u32 particleCompact(particle_pool_t * p);
+
+/* Write instance data for up to max particles to out, with positions made
+ * relative to (left, top), PARTICLE_INSTANCE_WORDS words per particle.
+ * Returns: number of particles written
+ */
+static u32 particleInstances(const particle_pool_t * p, u32 * out, u32 max,
+    i32 left, i32 top);
+
+#endif /* MKB_PARTICLE_H */
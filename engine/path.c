@@ -0,0 +1,394 @@
+/* Copyright (c) 2023 Sam Blenny
+ * SPDX-License-Identifier: CC-BY-NC-SA-4.0
+ *
+ * Pathfinding over a tile grid: A* for single trips, plus a cache of flow
+ * fields for many agents that share a goal.
+ *
+ * A* uses a binary heap for the open set with lazy deletion: improving a
+ * tile's cost pushes a new entry rather than searching the heap for the old
+ * one, and stale entries get skipped when they come out because the tile is
+ * already in the closed set.
+ *
+ * Flow fields are for crowds. When hundreds of NPCs chase the player, one
+ * Dijkstra pass out from the player's tile gives every NPC nearby its next
+ * step, so the per-NPC cost stays constant instead of one A* search each.
+ */
+#ifndef MKB_PATH_C
+#define MKB_PATH_C
+
+#include "mkb_engine.h"
+#include "tilemap.h"
+#include "path.h"
+
+
+/**************************/
+/* Non-exported Functions */
+/**************************/
+
+/* Neighbor offsets: 4 straight directions, then 4 diagonals */
+static const i32 PATH_DX[8] = {1, -1, 0,  0, 1,  1, -1, -1};
+static const i32 PATH_DY[8] = {0,  0, 1, -1, 1, -1,  1, -1};
+
+/* Set the grid size, with all tiles open and no cached flow fields. */
+/* Returns: 1 = Success, 0 = grid is too big                         */
+static u32 pathInit(path_t * p, u32 tiles_wide, u32 tiles_high) {
+    const u32 row_words = (tiles_wide + 31) >> 5;
+    if(tiles_wide == 0 || tiles_high == 0
+        || tiles_high > PATH_TILES_MAX / (row_words * 32)) {
+        return 0;
+    }
+    p->tilesWide = tiles_wide;
+    p->tilesHigh = tiles_high;
+    p->rowWords = row_words;
+    p->clock = 0;
+    p->flowBuilds = 0;
+    p->heapLen = 0;
+    u32 i;
+    for(i = 0; i < row_words * tiles_high; i++) {
+        p->blocked[i] = 0;
+    }
+    for(i = 0; i < FLOW_CACHE_SLOTS; i++) {
+        p->flow[i].valid = 0;
+        p->flow[i].used = 0;
+    }
+    return 1;
+}
+
+/* Returns: 1 if tile (x, y) is blocked or outside the grid, otherwise 0 */
+static u32 pathBlocked(const path_t * p, i32 x, i32 y) {
+    if((u32)x >= p->tilesWide || (u32)y >= p->tilesHigh) {
+        return 1;
+    }
+    return (p->blocked[y * p->rowWords + (x >> 5)] >> (x & 31)) & 1;
+}
+
+/* Block or unblock tile (x, y), and invalidate any cached flow fields that
+ * overlap its tilemap chunk
+ */
+static void pathSetBlocked(path_t * p, i32 x, i32 y, u32 blocked) {
+    if((u32)x >= p->tilesWide || (u32)y >= p->tilesHigh) {
+        return;
+    }
+    u32 * word = &p->blocked[y * p->rowWords + (x >> 5)];
+    const u32 bit = 1u << (x & 31);
+    *word = blocked ? (*word | bit) : (*word & ~bit);
+    const i32 cx = x >> TILEMAP_CHUNK_SHIFT;
+    const i32 cy = y >> TILEMAP_CHUNK_SHIFT;
+    u32 i;
+    for(i = 0; i < FLOW_CACHE_SLOTS; i++) {
+        flow_field_t * f = &p->flow[i];
+        if(cx >= f->chunkX0 && cx <= f->chunkX1
+            && cy >= f->chunkY0 && cy <= f->chunkY1) {
+            f->valid = 0;
+        }
+    }
+}
+
+/* Test if a step in direction d from (x, y) is allowed. Diagonal steps */
+/* can't cut the corner of a blocked tile.                              */
+static u32 pathCanStep(const path_t * p, i32 x, i32 y, u32 d) {
+    const i32 dx = PATH_DX[d];
+    const i32 dy = PATH_DY[d];
+    if(pathBlocked(p, x + dx, y + dy)) {
+        return 0;
+    }
+    return d < 4 || (!pathBlocked(p, x + dx, y) && !pathBlocked(p, x, y + dy));
+}
+
+/* Add an entry to the heap. Returns: 1 = Success, 0 = heap is full */
+static u32 heapPush(path_t * p, u32 cost, u32 tile) {
+    if(p->heapLen >= PATH_HEAP_MAX) {
+        return 0;
+    }
+    path_node_t * heap = p->heap;
+    u32 i = p->heapLen;
+    p->heapLen += 1;
+    /* Sift up */
+    while(i > 0) {
+        const u32 parent = (i - 1) >> 1;
+        if(heap[parent].cost <= cost) {
+            break;
+        }
+        heap[i] = heap[parent];
+        i = parent;
+    }
+    heap[i].cost = cost;
+    heap[i].tile = tile;
+    return 1;
+}
+
+/* Remove the lowest cost entry from the heap (which must not be empty) */
+static path_node_t heapPop(path_t * p) {
+    path_node_t * heap = p->heap;
+    const path_node_t top = heap[0];
+    p->heapLen -= 1;
+    const u32 n = p->heapLen;
+    const path_node_t last = heap[n];
+    u32 i = 0;
+    /* Sift down */
+    for(;;) {
+        u32 child = (i << 1) + 1;
+        if(child >= n) {
+            break;
+        }
+        if(child + 1 < n && heap[child + 1].cost < heap[child].cost) {
+            child += 1;
+        }
+        if(last.cost <= heap[child].cost) {
+            break;
+        }
+        heap[i] = heap[child];
+        i = child;
+    }
+    heap[i] = last;
+    return top;
+}
+
+/* Octile distance: a lower bound on the cost from (x0, y0) to (x1, y1) */
+static u32 pathHeuristic(i32 x0, i32 y0, i32 x1, i32 y1) {
+    const u32 dx = x0 > x1 ? x0 - x1 : x1 - x0;
+    const u32 dy = y0 > y1 ? y0 - y1 : y1 - y0;
+    const u32 lo = dx < dy ? dx : dy;
+    return PATH_COST_STRAIGHT * (dx + dy)
+        - (2 * PATH_COST_STRAIGHT - PATH_COST_DIAGONAL) * lo;
+}
+
+/* Find a shortest path from (x0, y0) to (x1, y1) with A*, moving in 8
+ * directions without cutting corners of blocked tiles. The path's tiles get
+ * written to out as y * tilesWide + x, not counting the start, up to out_max
+ * of them.
+ * Returns: number of steps (may be more than out_max), or -1 if there is no
+ *          path or the search ran out of heap space
+ */
+static i32 pathFind(path_t * p, i32 x0, i32 y0, i32 x1, i32 y1,
+    u32 * out, u32 out_max) {
+    if(pathBlocked(p, x0, y0) || pathBlocked(p, x1, y1)) {
+        return -1;
+    }
+    const u32 w = p->tilesWide;
+    const u32 words = (w * p->tilesHigh + 31) >> 5;
+    u32 i;
+    for(i = 0; i < words; i++) {
+        p->closed[i] = 0;
+        p->seen[i] = 0;
+    }
+    const u32 start = y0 * w + x0;
+    const u32 goal = y1 * w + x1;
+    p->heapLen = 0;
+    p->cost[start] = 0;
+    p->seen[start >> 5] |= 1u << (start & 31);
+    heapPush(p, pathHeuristic(x0, y0, x1, y1), start);
+    while(p->heapLen > 0) {
+        const u32 tile = heapPop(p).tile;
+        if((p->closed[tile >> 5] >> (tile & 31)) & 1) {
+            continue;  /* Stale entry for a tile that's already done */
+        }
+        p->closed[tile >> 5] |= 1u << (tile & 31);
+        if(tile == goal) {
+            break;
+        }
+        const i32 x = tile % w;
+        const i32 y = tile / w;
+        u32 d;
+        for(d = 0; d < 8; d++) {
+            if(!pathCanStep(p, x, y, d)) {
+                continue;
+            }
+            const i32 nx = x + PATH_DX[d];
+            const i32 ny = y + PATH_DY[d];
+            const u32 n = ny * w + nx;
+            if((p->closed[n >> 5] >> (n & 31)) & 1) {
+                continue;
+            }
+            const u32 g = p->cost[tile]
+                + (d < 4 ? PATH_COST_STRAIGHT : PATH_COST_DIAGONAL);
+            const u32 seen = (p->seen[n >> 5] >> (n & 31)) & 1;
+            if(seen && g >= p->cost[n]) {
+                continue;
+            }
+            p->cost[n] = g;
+            p->from[n] = d;
+            p->seen[n >> 5] |= 1u << (n & 31);
+            if(!heapPush(p, g + pathHeuristic(nx, ny, x1, y1), n)) {
+                return -1;
+            }
+        }
+    }
+    if(!((p->closed[goal >> 5] >> (goal & 31)) & 1)) {
+        return -1;
+    }
+    /* Count the steps by walking back from the goal, then walk back again */
+    /* to fill in out from the far end                                     */
+    u32 steps = 0;
+    u32 tile;
+    for(tile = goal; tile != start; steps++) {
+        const u32 d = p->from[tile];
+        tile -= PATH_DY[d] * (i32)w + PATH_DX[d];
+    }
+    i = steps;
+    for(tile = goal; tile != start; ) {
+        i -= 1;
+        if(i < out_max) {
+            out[i] = tile;
+        }
+        const u32 d = p->from[tile];
+        tile -= PATH_DY[d] * (i32)w + PATH_DX[d];
+    }
+    return steps;
+}
+
+/* Build flow field f for a goal with Dijkstra's algorithm, searching out */
+/* from the goal. Moves cost the same both ways, so the cost from the     */
+/* goal to a tile is also the cost from that tile to the goal.            */
+static void flowBuild(path_t * p, flow_field_t * f, i32 goal_x, i32 goal_y) {
+    const i32 left = goal_x - FLOW_RADIUS;
+    const i32 top = goal_y - FLOW_RADIUS;
+    i32 x0 = left < 0 ? 0 : left;
+    i32 y0 = top < 0 ? 0 : top;
+    i32 x1 = left + FLOW_SIZE - 1;
+    i32 y1 = top + FLOW_SIZE - 1;
+    x1 = x1 < (i32)p->tilesWide ? x1 : (i32)p->tilesWide - 1;
+    y1 = y1 < (i32)p->tilesHigh ? y1 : (i32)p->tilesHigh - 1;
+    f->goalX = goal_x;
+    f->goalY = goal_y;
+    f->left = left;
+    f->top = top;
+    f->chunkX0 = x0 >> TILEMAP_CHUNK_SHIFT;
+    f->chunkY0 = y0 >> TILEMAP_CHUNK_SHIFT;
+    f->chunkX1 = x1 >> TILEMAP_CHUNK_SHIFT;
+    f->chunkY1 = y1 >> TILEMAP_CHUNK_SHIFT;
+    f->valid = 1;
+    p->flowBuilds += 1;
+    u32 i;
+    for(i = 0; i < FLOW_TILES; i++) {
+        f->dist[i] = FLOW_UNREACHED;
+    }
+    if(pathBlocked(p, goal_x, goal_y)) {
+        return;
+    }
+    /* Copy the window into a byte grid with a blocked border, so the  */
+    /* search loop can check neighbors without bounds checks or shifts */
+    u8 * open = p->open;
+    i32 x;
+    i32 y;
+    for(y = -1; y <= FLOW_SIZE; y++) {
+        for(x = -1; x <= FLOW_SIZE; x++) {
+            const u32 pad = (y + 1) * FLOW_PAD_SIZE + x + 1;
+            const u32 inside = (u32)x < FLOW_SIZE && (u32)y < FLOW_SIZE;
+            open[pad] = inside && !pathBlocked(p, left + x, top + y);
+        }
+    }
+    i32 step[8];
+    u32 d;
+    for(d = 0; d < 8; d++) {
+        step[d] = PATH_DY[d] * FLOW_PAD_SIZE + PATH_DX[d];
+    }
+    /* Every step costs at most PATH_COST_DIAGONAL, so the tiles waiting  */
+    /* to be searched never span more than 15 different costs. That means */
+    /* a ring of 16 buckets, one per cost, can stand in for a heap (Dial's */
+    /* algorithm). Bucket entries are linked lists in the heap array, with */
+    /* the cost field holding the link. Each tile gets pushed at most 8    */
+    /* times, so FLOW_TILES * 8 entries is always enough, as long as that  */
+    /* fits in PATH_HEAP_MAX.                                              */
+    u32 head[FLOW_BUCKETS];
+    for(i = 0; i < FLOW_BUCKETS; i++) {
+        head[i] = FLOW_UNREACHED;
+    }
+    path_node_t * pool = p->heap;
+    u32 used = 1;
+    pool[0].cost = FLOW_UNREACHED;
+    pool[0].tile = (FLOW_RADIUS + 1) * FLOW_PAD_SIZE + FLOW_RADIUS + 1;
+    head[0] = 0;
+    f->dist[FLOW_RADIUS * FLOW_SIZE + FLOW_RADIUS] = 0;
+    u32 waiting = 1;
+    u32 cost;
+    for(cost = 0; waiting > 0; cost++) {
+        const u32 b = cost & (FLOW_BUCKETS - 1);
+        while(head[b] != FLOW_UNREACHED) {
+            const u32 pad = pool[head[b]].tile;
+            head[b] = pool[head[b]].cost;
+            waiting -= 1;
+            const u32 tile = pad - FLOW_PAD_SIZE - 1
+                - 2 * (pad / FLOW_PAD_SIZE - 1);
+            if(f->dist[tile] < cost) {
+                continue;  /* Stale entry */
+            }
+            for(d = 0; d < 8; d++) {
+                const u32 n = pad + step[d];
+                if(!open[n] || (d >= 4 && (!open[pad + PATH_DX[d]]
+                    || !open[pad + PATH_DY[d] * FLOW_PAD_SIZE]))) {
+                    continue;
+                }
+                const u32 g = cost
+                    + (d < 4 ? PATH_COST_STRAIGHT : PATH_COST_DIAGONAL);
+                const u32 nt = tile + PATH_DY[d] * FLOW_SIZE + PATH_DX[d];
+                if(g < f->dist[nt]) {
+                    const u32 nb = g & (FLOW_BUCKETS - 1);
+                    f->dist[nt] = g;
+                    pool[used].cost = head[nb];
+                    pool[used].tile = n;
+                    head[nb] = used;
+                    used += 1;
+                    waiting += 1;
+                }
+            }
+        }
+    }
+}
+
+/* Get the flow field for a goal, building it if it isn't cached */
+static flow_field_t * flowField(path_t * p, i32 goal_x, i32 goal_y) {
+    u32 i;
+    u32 lru = 0;
+    p->clock += 1;
+    for(i = 0; i < FLOW_CACHE_SLOTS; i++) {
+        flow_field_t * f = &p->flow[i];
+        if(f->valid && f->goalX == goal_x && f->goalY == goal_y) {
+            f->used = p->clock;
+            return f;
+        }
+        /* Prefer invalid slots, then the least recently used one */
+        const flow_field_t * g = &p->flow[lru];
+        if((g->valid && !f->valid)
+            || (g->valid == f->valid && f->used < g->used)) {
+            lru = i;
+        }
+    }
+    flow_field_t * f = &p->flow[lru];
+    flowBuild(p, f, goal_x, goal_y);
+    f->used = p->clock;
+    return f;
+}
+
+/* Find the next step from (x, y) toward the goal of flow field f.
+ * Returns: 1 and the step in *nx, *ny; or 0 if (x, y) is at the goal, is
+ *          outside the field, or can't reach the goal
+ */
+static u32 flowStep(const path_t * p, const flow_field_t * f, i32 x, i32 y,
+    i32 * nx, i32 * ny) {
+    const i32 fx = x - f->left;
+    const i32 fy = y - f->top;
+    if((u32)fx >= FLOW_SIZE || (u32)fy >= FLOW_SIZE) {
+        return 0;
+    }
+    u32 best = f->dist[fy * FLOW_SIZE + fx];
+    u32 found = 0;
+    u32 d;
+    for(d = 0; d < 8; d++) {
+        const i32 sx = fx + PATH_DX[d];
+        const i32 sy = fy + PATH_DY[d];
+        if((u32)sx >= FLOW_SIZE || (u32)sy >= FLOW_SIZE) {
+            continue;
+        }
+        const u32 dist = f->dist[sy * FLOW_SIZE + sx];
+        if(dist < best && pathCanStep(p, x, y, d)) {
+            best = dist;
+            *nx = x + PATH_DX[d];
+            *ny = y + PATH_DY[d];
+            found = 1;
+        }
+    }
+    return found;
+}
+
+#endif /* MKB_PATH_C */
@@ -0,0 +1,128 @@
+/* Copyright (c) 2023 Sam Blenny
+ * SPDX-License-Identifier: CC-BY-NC-SA-4.0
+ *
+ * Pathfinding over a tile grid: A* for single trips, plus a cache of flow
+ * fields for many agents that share a goal.
+ */
+#ifndef MKB_PATH_H
+#define MKB_PATH_H
+
+/* Most tiles a path grid can have */
+#ifndef PATH_TILES_MAX
+#define PATH_TILES_MAX (1 << 20)
+#endif
+
+/* Capacity of the A* open set. When a search would need more, it gives up. */
+#ifndef PATH_HEAP_MAX
+#define PATH_HEAP_MAX (1 << 18)
+#endif
+
+/* Move costs: straight steps cost 10 and diagonal steps cost 14, which is */
+/* close enough to 10 * sqrt(2) that diagonal paths come out looking right */
+#define PATH_COST_STRAIGHT (10)
+#define PATH_COST_DIAGONAL (14)
+
+/* Flow fields cover the square of tiles within FLOW_RADIUS of their goal */
+#ifndef FLOW_RADIUS
+#define FLOW_RADIUS (48)
+#endif
+#define FLOW_SIZE  (FLOW_RADIUS * 2)
+#define FLOW_TILES (FLOW_SIZE * FLOW_SIZE)
+
+/* Buckets in the flow field search queue. Must be a power of 2 that's */
+/* more than PATH_COST_DIAGONAL.                                        */
+#define FLOW_BUCKETS (16)
+
+/* Flow fields get built on a copy of their window with a 1 tile border */
+#define FLOW_PAD_SIZE  (FLOW_SIZE + 2)
+#define FLOW_PAD_TILES (FLOW_PAD_SIZE * FLOW_PAD_SIZE)
+
+/* Number of flow fields to keep cached */
+#ifndef FLOW_CACHE_SLOTS
+#define FLOW_CACHE_SLOTS (4)
+#endif
+
+/* Flow field distance for tiles that can't reach the goal */
+#define FLOW_UNREACHED (0xffffffff)
+
+/* Distance to the goal from each tile near it, found with Dijkstra's
+ * algorithm. An agent at any tile in the field can take a step toward the
+ * goal by moving to the neighbor with the smallest distance, which costs
+ * the same no matter how far away the goal is.
+ */
+typedef struct flow_field {
+    i32 goalX;                  /* Goal in tile coordinates                */
+    i32 goalY;
+    i32 left;                   /* Tile coordinates of dist[0]             */
+    i32 top;
+    i32 chunkX0;                /* Tilemap chunks the field overlaps, as   */
+    i32 chunkY0;                /* an inclusive rectangle. Changing a tile */
+    i32 chunkX1;                /* in any of them invalidates the field.   */
+    i32 chunkY1;
+    u32 valid;
+    u32 used;                   /* Clock value at last use                 */
+    u32 dist[FLOW_TILES];       /* Cost to reach goal, or FLOW_UNREACHED   */
+} flow_field_t;
+
+/* One entry of the binary heap used for the A* open set and for building */
+/* flow fields. Entries with the lowest cost come out first.              */
+typedef struct path_node {
+    u32 cost;
+    u32 tile;
+} path_node_t;
+
+/* Pathfinding state for one tile grid. Blocked tiles are stored as a bitset
+ * with one bit per tile, so each row is a run of u32 words. The A* scratch
+ * arrays are big enough for the largest grid, and the closed set is another
+ * bitset, so clearing it between searches is cheap.
+ */
+typedef struct path {
+    u32 tilesWide;                       /* Grid size in tiles            */
+    u32 tilesHigh;
+    u32 rowWords;                        /* u32 words per row of bits     */
+    u32 clock;                           /* Use counter for LRU eviction  */
+    u32 flowBuilds;                      /* Flow fields built so far      */
+    u32 blocked[PATH_TILES_MAX / 32];    /* 1 bit per tile, 1 = blocked   */
+    u32 closed[PATH_TILES_MAX / 32];     /* A* closed set                 */
+    u32 seen[PATH_TILES_MAX / 32];       /* A* tiles with a valid cost    */
+    u32 cost[PATH_TILES_MAX];            /* A* cost from start            */
+    u8 from[PATH_TILES_MAX];             /* A* direction to previous tile */
+    u32 heapLen;
+    path_node_t heap[PATH_HEAP_MAX];
+    u8 open[FLOW_PAD_TILES];             /* Flow build: 1 = tile is open  */
+    flow_field_t flow[FLOW_CACHE_SLOTS];
+} path_t;
+
+/* Set the grid size, with all tiles open and no cached flow fields. */
+/* Returns: 1 = Success, 0 = grid is too big                         */
+static u32 pathInit(path_t * p, u32 tiles_wide, u32 tiles_high);
+
+/* Returns: 1 if tile (x, y) is blocked or outside the grid, otherwise 0 */
+static u32 pathBlocked(const path_t * p, i32 x, i32 y);
+
+/* Block or unblock tile (x, y), and invalidate any cached flow fields that
+ * overlap its tilemap chunk
+ */
+static void pathSetBlocked(path_t * p, i32 x, i32 y, u32 blocked);
+
+/* Find a shortest path from (x0, y0) to (x1, y1) with A*, moving in 8
+ * directions without cutting corners of blocked tiles. The path's tiles get
+ * written to out as y * tilesWide + x, not counting the start, up to out_max
+ * of them.
+ * Returns: number of steps (may be more than out_max), or -1 if there is no
+ *          path or the search ran out of heap space
+ */
+static i32 pathFind(path_t * p, i32 x0, i32 y0, i32 x1, i32 y1,
+    u32 * out, u32 out_max);
+
+/* Get the flow field for a goal, building it if it isn't cached */
+static flow_field_t * flowField(path_t * p, i32 goal_x, i32 goal_y);
+
+/* Find the next step from (x, y) toward the goal of flow field f.
+ * Returns: 1 and the step in *nx, *ny; or 0 if (x, y) is at the goal, is
+ *          outside the field, or can't reach the goal
+ */
+static u32 flowStep(const path_t * p, const flow_field_t * f, i32 x, i32 y,
+    i32 * nx, i32 * ny);
+
+#endif /* MKB_PATH_H */
@@ -0,0 +1,129 @@
+/* Copyright (c) 2023 Sam Blenny
+ * SPDX-License-Identifier: CC-BY-NC-SA-4.0
+ *
+ * Render command list: the C side describes each frame as a list of u32 words
+ * in linear memory, and the JS side reads the whole list once per frame.
+ * This replaces making one JS import call for every change to the screen.
+ */
+#ifndef MKB_RENDER_C
+#define MKB_RENDER_C
+
+#include "mkb_engine.h"
+#include "render.h"
+
+
+/**************************************/
+/* Exported Symbols: Global Variables */
+/**************************************/
+
+/* Render command list for the current frame (see render.h for format) */
+__attribute__((visibility("default")))
+u32 RENDER_LIST[RENDER_LIST_MAX];
+
+/* Number of valid u32 words in RENDER_LIST. 0 means nothing to draw. */
+__attribute__((visibility("default")))
+u32 RENDER_LIST_LEN;
+
+
+/*********************************/
+/* Non-exported Global Variables */
+/*********************************/
+
+/* Index of the most recent RC_SPRITES header, or RENDER_LIST_MAX if the */
+/* most recent command was something else                               */
+static u32 RENDER_SPRITE_HDR = RENDER_LIST_MAX;
+
+
+/**************************/
+/* Non-exported Functions */
+/**************************/
+
+/* Start a new command with room for n argument words.             */
+/* Returns: index of the command's first argument, or 0 if full.  */
+static u32 renderAppend(u32 opcode, u32 n) {
+    RENDER_SPRITE_HDR = RENDER_LIST_MAX;
+    if(RENDER_LIST_LEN + 1 + n > RENDER_LIST_MAX) {
+        return 0;  /* Drop commands that don't fit */
+    }
+    u32 i = RENDER_LIST_LEN;
+    RENDER_LIST[i] = ((1 + n) << 16) | opcode;
+    RENDER_LIST_LEN += 1 + n;
+    return i + 1;
+}
+
+/* Clear the render list to start building a new frame */
+static void renderBegin(void) {
+    RENDER_LIST_LEN = 0;
+    RENDER_SPRITE_HDR = RENDER_LIST_MAX;
+}
+
+/* Append a command to draw a tile layer */
+static void renderTiles(u32 layer) {
+    u32 i = renderAppend(RC_TILES, 1);
+    if(i) {
+        RENDER_LIST[i] = layer;
+    }
+}
+
+/* Append a sprite, merging it into the previous command if that was also */
+/* a sprite command. This keeps many sprites down to one header word.     */
+static void renderSprite(u32 x, u32 y, u32 tile) {
+    u32 i;
+    if(RENDER_SPRITE_HDR < RENDER_LIST_MAX) {
+        if(RENDER_LIST_LEN + 3 > RENDER_LIST_MAX) {
+            return;
+        }
+        i = RENDER_LIST_LEN;
+        RENDER_LIST_LEN += 3;
+        RENDER_LIST[RENDER_SPRITE_HDR] += (3 << 16);
+    } else {
+        i = renderAppend(RC_SPRITES, 3);
+        if(!i) {
+            return;
+        }
+        RENDER_SPRITE_HDR = i - 1;
+    }
+    RENDER_LIST[i    ] = x;
+    RENDER_LIST[i + 1] = y;
+    RENDER_LIST[i + 2] = tile;
+}
+
+/* Append a command to draw vertices as a line strip */
+static void renderLines(u32 first, u32 count) {
+    u32 i = renderAppend(RC_LINES, 2);
+    if(i) {
+        RENDER_LIST[i    ] = first;
+        RENDER_LIST[i + 1] = count;
+    }
+}
+
+/* Append a dirty rectangle */
+static void renderDirty(u32 x, u32 y, u32 w, u32 h) {
+    u32 i = renderAppend(RC_DIRTY, 4);
+    if(i) {
+        RENDER_LIST[i    ] = x;
+        RENDER_LIST[i + 1] = y;
+        RENDER_LIST[i + 2] = w;
+        RENDER_LIST[i + 3] = h;
+    }
+}
+
+/* Append the camera position */
+static void renderCamera(u32 x, u32 y) {
+    u32 i = renderAppend(RC_CAMERA, 2);
+    if(i) {
+        RENDER_LIST[i    ] = x;
+        RENDER_LIST[i + 1] = y;
+    }
+}
+
+/* Append a range of tile layer vertices that the front end should upload */
+static void renderVertices(u32 first, u32 count) {
+    u32 i = renderAppend(RC_VERTICES, 2);
+    if(i) {
+        RENDER_LIST[i    ] = first;
+        RENDER_LIST[i + 1] = count;
+    }
+}
+
+#endif /* MKB_RENDER_C */
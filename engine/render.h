@@ -0,0 +1,60 @@
+/* Copyright (c) 2023 Sam Blenny
+ * SPDX-License-Identifier: CC-BY-NC-SA-4.0
+ *
+ * Render command list: the C side describes each frame as a list of u32 words
+ * in linear memory, and the JS side reads the whole list once per frame.
+ */
+#ifndef MKB_RENDER_H
+#define MKB_RENDER_H
+
+/* Capacity of the render list in u32 words */
+#ifndef RENDER_LIST_MAX
+#define RENDER_LIST_MAX (1024)
+#endif
+
+/*
+ * Render list command format:
+ *   word 0:  (word count << 16) | opcode   (word count includes word 0)
+ *   word 1+: arguments (depends on opcode)
+ *
+ * Opcodes:
+ *   RC_TILES    [layer]                        draw a tile layer (layer 0
+ *                                              is VIEW_TILES, see tilemap.h)
+ *   RC_SPRITES  [x, y, tile] * n               draw n sprites (world coords)
+ *   RC_LINES    [first, count]                 draw vertices as a line strip
+ *   RC_DIRTY    [x, y, w, h]                   rectangle changed (view coords)
+ *   RC_CAMERA   [x, y]                         world coords of view top left
+ *   RC_VERTICES [first, count]                 tile layer vertices changed
+ *                                              (TILE_VERTICES, see
+ *                                              tilemesh.h)
+ */
+#define RC_TILES    (1)
+#define RC_SPRITES  (2)
+#define RC_LINES    (3)
+#define RC_DIRTY    (4)
+#define RC_CAMERA   (5)
+#define RC_VERTICES (6)
+
+/* Clear the render list to start building a new frame */
+static void renderBegin(void);
+
+/* Append a command to draw a tile layer */
+static void renderTiles(u32 layer);
+
+/* Append a sprite, merging it into the previous command if that was also */
+/* a sprite command. This keeps many sprites down to one header word.     */
+static void renderSprite(u32 x, u32 y, u32 tile);
+
+/* Append a command to draw vertices as a line strip */
+static void renderLines(u32 first, u32 count);
+
+/* Append a dirty rectangle */
+static void renderDirty(u32 x, u32 y, u32 w, u32 h);
+
+/* Append the camera position */
+static void renderCamera(u32 x, u32 y);
+
+/* Append a range of tile layer vertices that the front end should upload */
+static void renderVertices(u32 first, u32 count);
+
+#endif /* MKB_RENDER_H */
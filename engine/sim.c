@@ -0,0 +1,98 @@
+/* Copyright (c) 2023 Sam Blenny
+ * SPDX-License-Identifier: CC-BY-NC-SA-4.0
+ *
+ * Fixed timestep simulation clock with a queue of timestamped input events.
+ *
+ * Game logic runs in ticks of SIM_TICK_US no matter what the frame rate is,
+ * so timing doesn't drift with frame rate and the cost of a frame is capped
+ * at SIM_MAX_TICKS ticks. Input events carry timestamps, so a button press
+ * takes effect at the tick when it happened rather than at the next frame,
+ * and a tap shorter than a frame still gets seen.
+ */
+#ifndef MKB_SIM_C
+#define MKB_SIM_C
+
+#include "mkb_engine.h"
+#include "sim.h"
+
+
+/**************************************/
+/* Exported Symbols: Global Variables */
+/**************************************/
+
+/* Gamepad button state bitfield, as of the current tick */
+__attribute__((visibility("default")))
+u32 GAMEPAD;
+
+/* Real time in ms as of the end of the most recent frame (wraps around) */
+__attribute__((visibility("default")))
+u32 SIM_CLOCK_MS;
+
+/* How far real time is past the most recent tick, as a fraction of a tick */
+/* from 0 to 65535. Use this to interpolate positions for drawing.         */
+__attribute__((visibility("default")))
+u32 SIM_ALPHA;
+
+/* Input event queue (see sim.h for protocol) */
+__attribute__((visibility("default")))
+u32 INPUT_QUEUE[INPUT_QUEUE_MAX * 2];
+__attribute__((visibility("default")))
+u32 INPUT_HEAD;
+__attribute__((visibility("default")))
+u32 INPUT_TAIL;
+
+
+/*********************************/
+/* Non-exported Global Variables */
+/*********************************/
+
+/* Real time in us that has not been simulated yet */
+static u32 SIM_ACC_US = 0;
+
+
+/**************************/
+/* Non-exported Functions */
+/**************************/
+
+/* Add elapsed_ms of real time to the accumulator.      */
+/* Returns: number of ticks to run for this frame       */
+static u32 simFrame(u32 elapsed_ms) {
+    SIM_CLOCK_MS += elapsed_ms;
+    if(elapsed_ms > SIM_MAX_ELAPSED_MS) {
+        elapsed_ms = SIM_MAX_ELAPSED_MS;
+    }
+    SIM_ACC_US += elapsed_ms * 1000;
+    const u32 ticks = SIM_ACC_US / SIM_TICK_US;
+    return ticks < SIM_MAX_TICKS ? ticks : SIM_MAX_TICKS;
+}
+
+/* Start the next tick: take its time out of the accumulator, then apply */
+/* input events with timestamps up to the end of the tick to GAMEPAD.    */
+/* Only one change gets applied per tick, so game logic sees every press */
+/* and release, even for taps that were shorter than a tick.             */
+static void simTick(void) {
+    SIM_ACC_US -= SIM_TICK_US;
+    const u32 tick_end_ms = SIM_CLOCK_MS - SIM_ACC_US / 1000;
+    while(INPUT_TAIL != INPUT_HEAD) {
+        const u32 i = (INPUT_TAIL & INPUT_QUEUE_MASK) * 2;
+        /* Use signed difference so the comparison works across wraparound */
+        if((i32)(INPUT_QUEUE[i] - tick_end_ms) > 0) {
+            break;
+        }
+        const u32 buttons = INPUT_QUEUE[i + 1];
+        INPUT_TAIL += 1;
+        if(buttons != GAMEPAD) {
+            GAMEPAD = buttons;
+            break;
+        }
+    }
+}
+
+/* Finish a frame: drop any backlog beyond what SIM_MAX_TICKS allowed,  */
+/* then update SIM_ALPHA for interpolating between the last two ticks   */
+static void simFrameEnd(void) {
+    SIM_ACC_US %= SIM_TICK_US;
+    SIM_ALPHA = (SIM_ACC_US << 16) / SIM_TICK_US;
+}
+
+#endif /* MKB_SIM_C */
@@ -0,0 +1,52 @@
+/* Copyright (c) 2023 Sam Blenny
+ * SPDX-License-Identifier: CC-BY-NC-SA-4.0
+ *
+ * Fixed timestep simulation clock with a queue of timestamped input events.
+ */
+#ifndef MKB_SIM_H
+#define MKB_SIM_H
+
+/* Simulation tick rate and length */
+#define SIM_HZ      (60)
+#define SIM_TICK_US (1000000 / SIM_HZ)
+
+/* Most ticks to run in one frame. When frames arrive too slowly for this  */
+/* to keep up (e.g. a slow device or a background tab), the simulation    */
+/* drops the backlog and slows down rather than spending longer catching up. */
+#ifndef SIM_MAX_TICKS
+#define SIM_MAX_TICKS (4)
+#endif
+
+/* Longest elapsed time that a single frame can add to the accumulator */
+#define SIM_MAX_ELAPSED_MS (1000)
+
+/* Input event queue capacity in events. Must be a power of 2. */
+#define INPUT_QUEUE_MAX  (64)
+#define INPUT_QUEUE_MASK (INPUT_QUEUE_MAX - 1)
+
+/*
+ * Input event queue protocol:
+ * - Each event is a pair of u32 words: {timestamp in ms, gamepad buttons}.
+ *   Timestamps use the same clock as SIM_CLOCK_MS, so an event that happens
+ *   d ms after the most recent frame gets timestamp SIM_CLOCK_MS + d.
+ * - Buttons are the full button state as of the event, not a change mask.
+ * - The front end writes event INPUT_HEAD at INPUT_QUEUE[(INPUT_HEAD &
+ *   INPUT_QUEUE_MASK) * 2], then increments INPUT_HEAD. The engine consumes
+ *   events by incrementing INPUT_TAIL. If the queue is full, the front end
+ *   should overwrite the buttons of the newest event instead.
+ */
+
+/* Add elapsed_ms of real time to the accumulator.      */
+/* Returns: number of ticks to run for this frame       */
+static u32 simFrame(u32 elapsed_ms);
+
+/* Start the next tick: take its time out of the accumulator, then apply */
+/* input events with timestamps up to the end of the tick to GAMEPAD.    */
+/* Only one change gets applied per tick.                                */
+static void simTick(void);
+
+/* Finish a frame: drop any backlog beyond what SIM_MAX_TICKS allowed,  */
+/* then update SIM_ALPHA for interpolating between the last two ticks   */
+static void simFrameEnd(void);
+
+#endif /* MKB_SIM_H */
@@ -0,0 +1,211 @@
+/* Copyright (c) 2023 Sam Blenny
+ * SPDX-License-Identifier: CC-BY-NC-SA-4.0
+ *
+ * State snapshots with XOR/RLE deltas.
+ *
+ * Snapshots are plain copies of the regions that make up the engine's state,
+ * one after another, so saving or loading one is a few word copy loops.
+ * Between one frame and the next, most of the state stays the same, so the
+ * XOR of consecutive snapshots is mostly zeros. Run length encoding the zero
+ * words makes a delta about as big as what changed.
+ */
+#ifndef MKB_SNAP_C
+#define MKB_SNAP_C
+
+#include "mkb_engine.h"
+#include "snap.h"
+
+
+/**************************/
+/* Non-exported Functions */
+/**************************/
+
+/* Returns: size in u32 words of a snapshot of n regions */
+static u32 snapWords(const snap_region_t * r, u32 n) {
+    u32 words = 0;
+    u32 i;
+    for(i = 0; i < n; i++) {
+        words += r[i].len >> 2;
+    }
+    return words;
+}
+
+/* Copy n regions into a snapshot */
+static void snapSave(const snap_region_t * r, u32 n, u32 * snap) {
+    u32 i;
+    for(i = 0; i < n; i++) {
+        const u32 * src = (const u32 *)r[i].ptr;
+        const u32 words = r[i].len >> 2;
+        u32 j;
+        for(j = 0; j < words; j++) {
+            snap[j] = src[j];
+        }
+        snap += words;
+    }
+}
+
+/* Copy a snapshot back into n regions */
+static void snapLoad(const snap_region_t * r, u32 n, const u32 * snap) {
+    u32 i;
+    for(i = 0; i < n; i++) {
+        u32 * dst = (u32 *)r[i].ptr;
+        const u32 words = r[i].len >> 2;
+        u32 j;
+        for(j = 0; j < words; j++) {
+            dst[j] = snap[j];
+        }
+        snap += words;
+    }
+}
+
+/* Encode the XOR of snapshots a and b, each words long, into delta, which */
+/* must have room for SNAP_DELTA_MAX(words) words.                         */
+/* Returns: length of delta in words (0 if a and b are the same)           */
+static u32 snapDelta(const u32 * a, const u32 * b, u32 words, u32 * delta) {
+    u32 len = 0;
+    u32 i = 0;
+    while(i < words) {
+        const u32 z0 = i;
+        const u32 z1 = words - i < SNAP_RUN_MAX ? words : i + SNAP_RUN_MAX;
+        /* Skip runs of equal words a block at a time. OR-ing the XORs */
+        /* of a block has no branches, so it can vectorize.            */
+        while(i + SNAP_BLOCK <= z1) {
+            u32 diff = 0;
+            u32 j;
+            for(j = 0; j < SNAP_BLOCK; j++) {
+                diff |= a[i + j] ^ b[i + j];
+            }
+            if(diff) {
+                break;
+            }
+            i += SNAP_BLOCK;
+        }
+        while(i < z1 && a[i] == b[i]) {
+            i++;
+        }
+        if(i == words) {
+            break;  /* Trailing zeros don't need a token */
+        }
+        const u32 token = len;
+        const u32 x0 = i;
+        len += 1;
+        while(i < words && a[i] != b[i] && i - x0 < SNAP_RUN_MAX) {
+            delta[len] = a[i] ^ b[i];
+            len += 1;
+            i++;
+        }
+        delta[token] = ((x0 - z0) << 16) | (i - x0);
+    }
+    return len;
+}
+
+/* XOR a delta of len words into snapshot snap */
+static void snapApply(u32 * snap, const u32 * delta, u32 len) {
+    const u32 * end = delta + len;
+    while(delta < end) {
+        const u32 token = *delta++;
+        u32 n = token & SNAP_RUN_MAX;
+        snap += token >> 16;
+        for(; n > 0; n--) {
+            *snap++ ^= *delta++;
+        }
+    }
+}
+
+/* Empty a ring and set its snapshot size.                   */
+/* Returns: 1 = Success, 0 = snapshot or arena is too small  */
+static u32 snapRingInit(snap_ring_t * ring, u32 words) {
+    if(words > SNAP_WORDS_MAX || SNAP_DELTA_MAX(words) > SNAP_ARENA_WORDS) {
+        return 0;
+    }
+    ring->words = words;
+    ring->primed = 0;
+    ring->cur = 0;
+    ring->frames = 0;
+    ring->first = 0;
+    ring->head = 0;
+    ring->high = 0;
+    return 1;
+}
+
+/* Returns: buffer to save the next snapshot into before snapRingPush() */
+static u32 * snapRingNext(snap_ring_t * ring) {
+    return ring->buf[ring->cur ^ 1];
+}
+
+/* Drop the oldest delta */
+static void snapRingDrop(snap_ring_t * ring) {
+    ring->first = (ring->first + 1) % SNAP_RING_FRAMES;
+    ring->frames -= 1;
+    if(ring->high > 0) {
+        ring->high -= 1;
+    }
+}
+
+/* Make the snapshot in the snapRingNext() buffer the latest one, keeping */
+/* a delta back to the previous latest. Returns: delta length in words.   */
+static u32 snapRingPush(snap_ring_t * ring) {
+    const u32 next = ring->cur ^ 1;
+    if(!ring->primed) {
+        ring->primed = 1;
+        ring->cur = next;
+        return 0;
+    }
+    /* Find room for the largest possible delta, going back to the start */
+    /* of the arena if needed, then drop old deltas in the way.          */
+    const u32 room = SNAP_DELTA_MAX(ring->words);
+    if(ring->frames == SNAP_RING_FRAMES) {
+        snapRingDrop(ring);
+    }
+    if(ring->frames == 0) {
+        ring->head = 0;
+    } else if(ring->head + room > SNAP_ARENA_WORDS) {
+        /* The deltas past head are older than the ones before it, so they */
+        /* go first. Then the ones before head are the ones past it.       */
+        while(ring->high > 0) {
+            snapRingDrop(ring);
+        }
+        ring->high = ring->frames;
+        ring->head = 0;
+    }
+    /* Deltas past head are in arena order, oldest first, so drop them */
+    /* until the oldest starts past the room this one needs            */
+    while(ring->high > 0 && ring->start[ring->first] < ring->head + room) {
+        snapRingDrop(ring);
+    }
+    const u32 len = snapDelta(ring->buf[ring->cur], ring->buf[next],
+        ring->words, &ring->arena[ring->head]);
+    const u32 entry = (ring->first + ring->frames) % SNAP_RING_FRAMES;
+    ring->start[entry] = ring->head;
+    ring->len[entry] = len;
+    ring->frames += 1;
+    ring->head += len;
+    ring->cur = next;
+    return len;
+}
+
+/* Returns: the latest snapshot, or 0 if there isn't one yet */
+static const u32 * snapRingLatest(const snap_ring_t * ring) {
+    return ring->primed ? ring->buf[ring->cur] : 0;
+}
+
+/* Step the latest snapshot back by up to frames deltas, dropping them.  */
+/* Returns: number of frames it went back                              */
+static u32 snapRingRewind(snap_ring_t * ring, u32 frames) {
+    u32 n;
+    for(n = 0; n < frames && ring->frames > 0; n++) {
+        ring->frames -= 1;
+        const u32 entry = (ring->first + ring->frames) % SNAP_RING_FRAMES;
+        snapApply(ring->buf[ring->cur], &ring->arena[ring->start[entry]],
+            ring->len[entry]);
+        ring->head = ring->start[entry];
+        /* If that was one of the deltas past head, the rest of them are */
+        /* now before it                                                 */
+        if(ring->high > ring->frames) {
+            ring->high = 0;
+        }
+    }
+    return n;
+}
+
+#endif /* MKB_SNAP_C */
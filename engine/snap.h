@@ -0,0 +1,106 @@
+/* Copyright (c) 2023 Sam Blenny
+ * SPDX-License-Identifier: CC-BY-NC-SA-4.0
+ *
+ * State snapshots: copy a list of memory regions to and from one contiguous
+ * buffer, and keep a ring of XOR/RLE deltas between consecutive snapshots.
+ */
+#ifndef MKB_SNAP_H
+#define MKB_SNAP_H
+
+/* Largest snapshot in u32 words */
+#ifndef SNAP_WORDS_MAX
+#define SNAP_WORDS_MAX (1 << 15)
+#endif
+
+/* Most deltas a ring can hold */
+#ifndef SNAP_RING_FRAMES
+#define SNAP_RING_FRAMES (240)
+#endif
+
+/* Space for deltas in u32 words. Must be at least SNAP_DELTA_MAX(words) */
+/* for the snapshot size.                                                */
+#ifndef SNAP_ARENA_WORDS
+#define SNAP_ARENA_WORDS (1 << 18)
+#endif
+
+/* Largest delta for a snapshot of n words: alternating changed and */
+/* unchanged words need one token per changed word                  */
+#define SNAP_DELTA_MAX(n) ((n) + ((n) + 1) / 2 + 1)
+
+/*
+ * Delta format: a run of tokens, each a u32 word of (zero_words << 16) |
+ * xor_words, followed by xor_words words. To apply a token, skip zero_words
+ * words of the snapshot, then XOR the next xor_words words with the words
+ * that follow the token. Since XOR undoes itself, the same delta turns the
+ * older snapshot into the newer one and the newer one back into the older.
+ */
+#define SNAP_RUN_MAX (0xffff)
+
+/* Words per block when skipping runs of unchanged words */
+#define SNAP_BLOCK (16)
+
+/* A region of state to include in snapshots. Lengths are in bytes, and    */
+/* must be a multiple of 4. Regions must be 4-byte aligned.               */
+typedef struct snap_region {
+    void * ptr;
+    u32 len;
+} snap_region_t;
+
+/* Ring of deltas behind the most recent snapshot. Two snapshot buffers take
+ * turns being the latest, so pushing a snapshot doesn't need an extra copy.
+ * Deltas go in an arena, oldest first, and the oldest ones get dropped to
+ * make room for new ones. When a delta might not fit before the end of the
+ * arena, it goes at the start instead. So the deltas held can be in two
+ * parts: the oldest ones, past head, from before the last time that
+ * happened, and newer ones from the start of the arena up to head.
+ */
+typedef struct snap_ring {
+    u32 words;                       /* Snapshot size in u32 words       */
+    u32 primed;                      /* 1 once there's a latest snapshot */
+    u32 cur;                         /* Index of latest in buf           */
+    u32 frames;                      /* Number of deltas held            */
+    u32 first;                       /* Entry index of the oldest delta  */
+    u32 head;                        /* Arena offset for the next delta  */
+    u32 high;                        /* Oldest deltas that sit past head */
+    u32 start[SNAP_RING_FRAMES];     /* Arena offset of each delta       */
+    u32 len[SNAP_RING_FRAMES];       /* Length of each delta in words    */
+    u32 buf[2][SNAP_WORDS_MAX];
+    u32 arena[SNAP_ARENA_WORDS];
+} snap_ring_t;
+
+/* Returns: size in u32 words of a snapshot of n regions */
+static u32 snapWords(const snap_region_t * r, u32 n);
+
+/* Copy n regions into a snapshot */
+static void snapSave(const snap_region_t * r, u32 n, u32 * snap);
+
+/* Copy a snapshot back into n regions */
+static void snapLoad(const snap_region_t * r, u32 n, const u32 * snap);
+
+/* Encode the XOR of snapshots a and b, each words long, into delta, which */
+/* must have room for SNAP_DELTA_MAX(words) words.                         */
+/* Returns: length of delta in words (0 if a and b are the same)           */
+static u32 snapDelta(const u32 * a, const u32 * b, u32 words, u32 * delta);
+
+/* XOR a delta of len words into snapshot snap */
+static void snapApply(u32 * snap, const u32 * delta, u32 len);
+
+/* Empty a ring and set its snapshot size.                   */
+/* Returns: 1 = Success, 0 = snapshot or arena is too small  */
+static u32 snapRingInit(snap_ring_t * ring, u32 words);
+
+/* Returns: buffer to save the next snapshot into before snapRingPush() */
+static u32 * snapRingNext(snap_ring_t * ring);
+
+/* Make the snapshot in the snapRingNext() buffer the latest one, keeping */
+/* a delta back to the previous latest. Returns: delta length in words.   */
+static u32 snapRingPush(snap_ring_t * ring);
+
+/* Returns: the latest snapshot, or 0 if there isn't one yet */
+static const u32 * snapRingLatest(const snap_ring_t * ring);
+
+/* Step the latest snapshot back by up to frames deltas, dropping them.  */
+/* Returns: number of frames it went back                              */
+static u32 snapRingRewind(snap_ring_t * ring, u32 frames);
+
+#endif /* MKB_SNAP_H */
@@ -0,0 +1,126 @@
+/* Copyright (c) 2023 Sam Blenny
+ * SPDX-License-Identifier: CC-BY-NC-SA-4.0
+ *
+ * Frame time telemetry: a fixed size block of counters that the front end
+ * can read straight out of linear memory.
+ *
+ * This is meant to stay on in release builds, so recording a frame only
+ * costs a few adds and one histogram lookup, and nothing allocates. The
+ * caller reads the clock, since wasm has to import one from javascript.
+ */
+#ifndef MKB_TELEMETRY_C
+#define MKB_TELEMETRY_C
+
+#include "mkb_engine.h"
+#include "telemetry.h"
+
+
+/**************************/
+/* Non-exported Functions */
+/**************************/
+
+/* Zero all the counters and set the frame budget */
+static void telemReset(telemetry_t * t, u32 budget_us) {
+    u32 i;
+    t->frames = 0;
+    t->over_budget = 0;
+    t->budget_us = budget_us;
+    t->last_us = 0;
+    t->max_us = 0;
+    t->total_us = 0;
+    for(i = 0; i < TELEM_STAGES; i++) {
+        t->stage_last[i] = 0;
+        t->stage_max[i] = 0;
+        t->stage_total[i] = 0;
+    }
+    for(i = 0; i < TELEM_BUCKETS; i++) {
+        t->hist[i] = 0;
+    }
+    for(i = 0; i < TELEM_RING; i++) {
+        t->ring[i] = 0;
+    }
+}
+
+/* Returns: histogram bucket for a frame time */
+static u32 telemBucket(u32 us) {
+    u32 msb = 3;
+    if(us < 8) {
+        return us;
+    }
+    while((us >> msb) > 1) {
+        msb += 1;
+    }
+    /* 4 buckets per power of 2, split by the 2 bits below the top bit */
+    const u32 b = 8 + (msb - 3) * 4 + ((us >> (msb - 2)) & 3);
+    return b < TELEM_BUCKETS ? b : TELEM_BUCKETS - 1;
+}
+
+/* Returns: shortest frame time that counts in bucket b */
+static u32 telemBucketStart(u32 b) {
+    if(b < 8) {
+        return b;
+    }
+    return (4 + (b - 8) % 4) << (1 + (b - 8) / 4);
+}
+
+/* Returns: shortest frame time in the bucket that holds the frame at     */
+/* per_mille of the way through the histogram (500 = median), or 0 if the */
+/* histogram is empty                                                     */
+static u32 telemPercentile(const telemetry_t * t, u32 per_mille) {
+    u32 count = 0;
+    u32 b;
+    for(b = 0; b < TELEM_BUCKETS; b++) {
+        count += t->hist[b];
+    }
+    if(count == 0) {
+        return 0;
+    }
+    /* Rank of the frame to find, counting from 1. Splitting the multiply */
+    /* keeps it from overflowing after billions of frames.                */
+    per_mille = per_mille < 1000 ? per_mille : 999;
+    const u32 rank = (count / 1000) * per_mille
+        + (count % 1000) * per_mille / 1000 + 1;
+    u32 seen = 0;
+    for(b = 0; b < TELEM_BUCKETS - 1; b++) {
+        seen += t->hist[b];
+        if(seen >= rank) {
+            break;
+        }
+    }
+    return telemBucketStart(b);
+}
+
+/* Start timing a frame */
+static void telemBegin(telemetry_t * t) {
+    u32 i;
+    for(i = 0; i < TELEM_STAGES; i++) {
+        t->stage_last[i] = 0;
+    }
+}
+
+/* Add time to a stage of the current frame */
+static void telemStage(telemetry_t * t, u32 stage, u32 us) {
+    if(stage < TELEM_STAGES) {
+        t->stage_last[stage] += us;
+    }
+}
+
+/* Finish timing a frame that took us, counting it in the histogram, */
+/* the ring, and the totals                                          */
+static void telemFrame(telemetry_t * t, u32 us) {
+    u32 i;
+    t->ring[t->frames & TELEM_RING_MASK] = us;
+    t->frames += 1;
+    t->over_budget += us > t->budget_us;
+    t->last_us = us;
+    t->max_us = us > t->max_us ? us : t->max_us;
+    t->total_us += us;
+    t->hist[telemBucket(us)] += 1;
+    for(i = 0; i < TELEM_STAGES; i++) {
+        const u32 s = t->stage_last[i];
+        t->stage_max[i] = s > t->stage_max[i] ? s : t->stage_max[i];
+        t->stage_total[i] += s;
+    }
+}
+
+#endif /* MKB_TELEMETRY_C */
@@ -0,0 +1,70 @@
+/* Copyright (c) 2023 Sam Blenny
+ * SPDX-License-Identifier: CC-BY-NC-SA-4.0
+ *
+ * Frame time telemetry: a fixed size block of counters that the front end
+ * can read straight out of linear memory.
+ */
+#ifndef MKB_TELEMETRY_H
+#define MKB_TELEMETRY_H
+
+/* Histogram buckets. Times under 8 us get a bucket per us, then each    */
+/* doubling of time gets 4 buckets, so the last bucket starts at 114 ms. */
+#define TELEM_BUCKETS (64)
+
+/* Frame times kept in the ring. Must be a power of 2. */
+#define TELEM_RING      (256)
+#define TELEM_RING_MASK (TELEM_RING - 1)
+
+/* Stages of a frame that get timed separately */
+#define TELEM_INPUT   (0  /* Simulation clock and input queue         */)
+#define TELEM_SIM     (1  /* Game logic and rewind snapshots          */)
+#define TELEM_EFFECTS (2  /* Particles and audio                      */)
+#define TELEM_ANIM    (3  /* Frame jobs: animation and NPC visibility */)
+#define TELEM_RENDER  (4  /* Building render lists                    */)
+#define TELEM_STAGES  (5)
+
+/*
+ * Telemetry block. Every field is a u32, so the front end can read it as
+ * an array of words in this order. Times are in microseconds, and totals
+ * wrap around, so take differences between two reads to get averages.
+ */
+typedef struct telemetry {
+    u32 frames;                    /* Frames since the last reset          */
+    u32 over_budget;               /* Frames that took longer than budget  */
+    u32 budget_us;                 /* Frame budget                         */
+    u32 last_us;                   /* Most recent frame's time             */
+    u32 max_us;                    /* Longest frame since the last reset   */
+    u32 total_us;                  /* Sum of frame times                   */
+    u32 stage_last[TELEM_STAGES];  /* Most recent frame's time per stage   */
+    u32 stage_max[TELEM_STAGES];   /* Longest time per stage               */
+    u32 stage_total[TELEM_STAGES]; /* Sum of times per stage               */
+    u32 hist[TELEM_BUCKETS];       /* Frame counts by time                 */
+    u32 ring[TELEM_RING];          /* Frame times, frame n at              */
+                                   /* ring[n & TELEM_RING_MASK]            */
+} telemetry_t;
+
+/* Zero all the counters and set the frame budget */
+static void telemReset(telemetry_t * t, u32 budget_us);
+
+/* Returns: histogram bucket for a frame time */
+static u32 telemBucket(u32 us);
+
+/* Returns: shortest frame time that counts in bucket b */
+static u32 telemBucketStart(u32 b);
+
+/* Returns: shortest frame time in the bucket that holds the frame at     */
+/* per_mille of the way through the histogram (500 = median), or 0 if the */
+/* histogram is empty                                                     */
+static u32 telemPercentile(const telemetry_t * t, u32 per_mille);
+
+/* Start timing a frame */
+static void telemBegin(telemetry_t * t);
+
+/* Add time to a stage of the current frame */
+static void telemStage(telemetry_t * t, u32 stage, u32 us);
+
+/* Finish timing a frame that took us, counting it in the histogram, */
+/* the ring, and the totals                                          */
+static void telemFrame(telemetry_t * t, u32 us);
+
+#endif /* MKB_TELEMETRY_H */
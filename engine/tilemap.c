@@ -0,0 +1,206 @@
+/* Copyright (c) 2023 Sam Blenny
+ * SPDX-License-Identifier: CC-BY-NC-SA-4.0
+ *
+ * Tile maps stored as run-length encoded chunks that get decompressed lazily
+ * into a small cache, plus a camera that scrolls to follow the player.
+ *
+ * Per-frame cost depends only on the size of the view, not the size of the
+ * map: culling touches the few chunks that overlap the view, and a chunk
+ * only gets decompressed when it scrolls into view without being cached.
+ */
+#ifndef MKB_TILEMAP_C
+#define MKB_TILEMAP_C
+
+#include "mkb_engine.h"
+#include "tilemap.h"
+
+
+/**************************************/
+/* Exported Symbols: Global Variables */
+/**************************************/
+
+/* Camera position: world tile coordinates of the view's top left tile */
+__attribute__((visibility("default")))
+u32 CAMERA_X;
+__attribute__((visibility("default")))
+u32 CAMERA_Y;
+
+/* Tile ids visible from the camera, in row-major order */
+__attribute__((visibility("default")))
+u16 VIEW_TILES[VIEW_HIGH * VIEW_WIDE];
+
+
+/**************************/
+/* Non-exported Functions */
+/**************************/
+
+/* Read little-endian u16 from buffer BUF at index I */
+#define _read_u16(BUF, I) ((u16)((BUF)[(I)] | ((BUF)[(I) + 1] << 8)))
+
+/* Read little-endian u32 from buffer BUF at index I */
+#define _read_u32(BUF, I) ((u32)_read_u16(BUF, I) | \
+                           ((u32)_read_u16(BUF, (I) + 2) << 16))
+
+/* Load a packed map blob. The blob must stay valid while the map is in use. */
+/* Returns: 1 = Success, 0 = blob is malformed                               */
+static u32 tilemapLoad(tilemap_t * map, const u8 * blob, u32 blob_len) {
+    if(blob_len < TILEMAP_HEADER_LEN || blob[0] != 'M' || blob[1] != 'K'
+        || blob[2] != 'T' || blob[3] != 'M') {
+        return 0;
+    }
+    const u32 w = _read_u16(blob, 4);
+    const u32 h = _read_u16(blob, 6);
+    /* Check the chunk table fits without computing its size, which can */
+    /* overflow a u32 for big w and h                                   */
+    if(w == 0 || h == 0 || w * h > (blob_len - TILEMAP_HEADER_LEN) / 4) {
+        return 0;
+    }
+    map->blob = blob;
+    map->blobLen = blob_len;
+    map->chunksWide = w;
+    map->chunksHigh = h;
+    map->tilesWide = w << TILEMAP_CHUNK_SHIFT;
+    map->tilesHigh = h << TILEMAP_CHUNK_SHIFT;
+    map->clock = 0;
+    map->decodes = 0;
+    u32 i;
+    for(i = 0; i < TILEMAP_CACHE_SLOTS; i++) {
+        map->slotChunk[i] = -1;
+        map->slotUsed[i] = 0;
+    }
+    return 1;
+}
+
+/* Decompress chunk n into dst. Corrupt runs leave the rest of dst as 0. */
+static void tilemapDecode(tilemap_t * map, u32 n, u16 * dst) {
+    const u8 * blob = map->blob;
+    u32 pos = _read_u32(blob, TILEMAP_HEADER_LEN + n * 4);
+    u32 i = 0;
+    /* tilemapLoad() made sure blobLen >= TILEMAP_HEADER_LEN, so this can't */
+    /* wrap, unlike pos + 4 for a corrupt offset near 0xffffffff            */
+    while(i < TILEMAP_CHUNK_TILES && pos <= map->blobLen - 4) {
+        u32 count = _read_u16(blob, pos);
+        const u16 tile = _read_u16(blob, pos + 2);
+        pos += 4;
+        if(count == 0 || i + count > TILEMAP_CHUNK_TILES) {
+            break;
+        }
+        for(; count > 0; count--) {
+            dst[i++] = tile;
+        }
+    }
+    for(; i < TILEMAP_CHUNK_TILES; i++) {
+        dst[i] = 0;
+    }
+    map->decodes += 1;
+}
+
+/* Get decompressed tiles for the chunk at chunk coordinates (cx, cy), */
+/* decompressing into the least recently used cache slot on a miss.   */
+static const u16 * tilemapChunk(tilemap_t * map, u32 cx, u32 cy) {
+    const i32 n = cy * map->chunksWide + cx;
+    u32 lru = 0;
+    u32 i;
+    map->clock += 1;
+    for(i = 0; i < TILEMAP_CACHE_SLOTS; i++) {
+        if(map->slotChunk[i] == n) {
+            map->slotUsed[i] = map->clock;
+            return map->slotTiles[i];
+        }
+        if(map->slotUsed[i] < map->slotUsed[lru]) {
+            lru = i;
+        }
+    }
+    tilemapDecode(map, n, map->slotTiles[lru]);
+    map->slotChunk[lru] = n;
+    map->slotUsed[lru] = map->clock;
+    return map->slotTiles[lru];
+}
+
+/* RLE pack one chunk of tiles into dst.                    */
+/* Returns: bytes written, or 0 if dst_size is too small   */
+static u32 tilemapPackChunk(const u16 * tiles, u8 * dst, u32 dst_size) {
+    u32 pos = 0;
+    u32 i = 0;
+    while(i < TILEMAP_CHUNK_TILES) {
+        const u16 tile = tiles[i];
+        u32 count = 1;
+        while(i + count < TILEMAP_CHUNK_TILES && tiles[i + count] == tile) {
+            count += 1;
+        }
+        if(pos + 4 > dst_size) {
+            return 0;
+        }
+        dst[pos    ] = (u8)  count;
+        dst[pos + 1] = (u8) (count >> 8);
+        dst[pos + 2] = (u8)  tile;
+        dst[pos + 3] = (u8) (tile >> 8);
+        pos += 4;
+        i += count;
+    }
+    return pos;
+}
+
+/* Center the camera on (x, y), clamped so the view stays inside the map. */
+/* Returns: 1 if the camera moved, 0 if it stayed put                     */
+static u32 cameraFollow(tilemap_t * map, u32 x, u32 y) {
+    const u32 max_x = map->tilesWide > VIEW_WIDE ?
+        map->tilesWide - VIEW_WIDE : 0;
+    const u32 max_y = map->tilesHigh > VIEW_HIGH ?
+        map->tilesHigh - VIEW_HIGH : 0;
+    u32 cam_x = x > VIEW_WIDE / 2 ? x - VIEW_WIDE / 2 : 0;
+    u32 cam_y = y > VIEW_HIGH / 2 ? y - VIEW_HIGH / 2 : 0;
+    cam_x = cam_x > max_x ? max_x : cam_x;
+    cam_y = cam_y > max_y ? max_y : cam_y;
+    const u32 moved = (cam_x != CAMERA_X) || (cam_y != CAMERA_Y);
+    CAMERA_X = cam_x;
+    CAMERA_Y = cam_y;
+    return moved;
+}
+
+/* Copy the tiles visible from the camera into VIEW_TILES, touching only the */
+/* chunks that overlap the view                                              */
+static void tilemapCull(tilemap_t * map) {
+    const u32 x0 = CAMERA_X;
+    const u32 y0 = CAMERA_Y;
+    const u32 x1 = x0 + VIEW_WIDE;  /* exclusive */
+    const u32 y1 = y0 + VIEW_HIGH;
+    u32 cx;
+    u32 cy;
+    for(cy = y0 >> TILEMAP_CHUNK_SHIFT; cy <= (y1 - 1) >> TILEMAP_CHUNK_SHIFT;
+        cy++) {
+        for(cx = x0 >> TILEMAP_CHUNK_SHIFT;
+            cx <= (x1 - 1) >> TILEMAP_CHUNK_SHIFT; cx++) {
+            /* Intersection of this chunk with the view, in world coords */
+            const u32 left = cx << TILEMAP_CHUNK_SHIFT;
+            const u32 top = cy << TILEMAP_CHUNK_SHIFT;
+            const u32 ix0 = left > x0 ? left : x0;
+            const u32 iy0 = top > y0 ? top : y0;
+            const u32 ix1 = left + TILEMAP_CHUNK < x1 ? left + TILEMAP_CHUNK
+                : x1;
+            const u32 iy1 = top + TILEMAP_CHUNK < y1 ? top + TILEMAP_CHUNK
+                : y1;
+            u32 x;
+            u32 y;
+            if(cx >= map->chunksWide || cy >= map->chunksHigh) {
+                /* View extends past the edge of a tiny map */
+                for(y = iy0; y < iy1; y++) {
+                    for(x = ix0; x < ix1; x++) {
+                        VIEW_TILES[(y - y0) * VIEW_WIDE + (x - x0)] = 0;
+                    }
+                }
+                continue;
+            }
+            const u16 * chunk = tilemapChunk(map, cx, cy);
+            for(y = iy0; y < iy1; y++) {
+                const u16 * src = &chunk[(y - top) << TILEMAP_CHUNK_SHIFT];
+                u16 * dst = &VIEW_TILES[(y - y0) * VIEW_WIDE];
+                for(x = ix0; x < ix1; x++) {
+                    dst[x - x0] = src[x - left];
+                }
+            }
+        }
+    }
+}
+
+#endif /* MKB_TILEMAP_C */
@@ -0,0 +1,70 @@
+/* Copyright (c) 2023 Sam Blenny
+ * SPDX-License-Identifier: CC-BY-NC-SA-4.0
+ *
+ * Tile maps stored as run-length encoded chunks that get decompressed lazily
+ * into a small cache, plus a camera that scrolls to follow the player.
+ */
+#ifndef MKB_TILEMAP_H
+#define MKB_TILEMAP_H
+
+/* Chunk size in tiles (chunks are square). Must be a power of 2. */
+#define TILEMAP_CHUNK_SHIFT (5)
+#define TILEMAP_CHUNK       (1 << TILEMAP_CHUNK_SHIFT)
+#define TILEMAP_CHUNK_MASK  (TILEMAP_CHUNK - 1)
+#define TILEMAP_CHUNK_TILES (TILEMAP_CHUNK * TILEMAP_CHUNK)
+
+/* Number of decompressed chunks to keep cached. A view that is smaller */
+/* than a chunk can overlap at most 4 chunks, so 16 leaves lots of room */
+/* for the camera to wander back and forth across chunk edges.          */
+#ifndef TILEMAP_CACHE_SLOTS
+#define TILEMAP_CACHE_SLOTS (16)
+#endif
+
+/* Visible area in tiles */
+#define VIEW_WIDE (15)
+#define VIEW_HIGH (10)
+
+/*
+ * Packed map blob layout (all integers are little-endian):
+ *   offset 0: 'M' 'K' 'T' 'M'    magic number
+ *   offset 4: u16                map width in chunks
+ *   offset 6: u16                map height in chunks
+ *   offset 8: u32[w * h]         offset of each chunk's data from start of
+ *                                blob, in row-major order
+ *   then:     chunk data         runs of {u16 count, u16 tile id} that add
+ *                                up to TILEMAP_CHUNK_TILES tiles per chunk
+ */
+#define TILEMAP_HEADER_LEN (8)
+
+/* Loaded map, with a cache of decompressed chunks */
+typedef struct tilemap {
+    const u8 * blob;                 /* Packed map blob                   */
+    u32 blobLen;
+    u32 chunksWide;                  /* Map size in chunks                */
+    u32 chunksHigh;
+    u32 tilesWide;                   /* Map size in tiles                 */
+    u32 tilesHigh;
+    u32 clock;                       /* Use counter for LRU eviction      */
+    u32 decodes;                     /* Chunks decompressed so far        */
+    i32 slotChunk[TILEMAP_CACHE_SLOTS];  /* Chunk index per slot, or -1   */
+    u32 slotUsed[TILEMAP_CACHE_SLOTS];   /* Clock value at last use       */
+    u16 slotTiles[TILEMAP_CACHE_SLOTS][TILEMAP_CHUNK_TILES];
+} tilemap_t;
+
+/* Load a packed map blob. The blob must stay valid while the map is in use. */
+/* Returns: 1 = Success, 0 = blob is malformed                               */
+static u32 tilemapLoad(tilemap_t * map, const u8 * blob, u32 blob_len);
+
+/* RLE pack one chunk of tiles into dst.                    */
+/* Returns: bytes written, or 0 if dst_size is too small   */
+static u32 tilemapPackChunk(const u16 * tiles, u8 * dst, u32 dst_size);
+
+/* Center the camera on (x, y), clamped so the view stays inside the map. */
+/* Returns: 1 if the camera moved, 0 if it stayed put                     */
+static u32 cameraFollow(tilemap_t * map, u32 x, u32 y);
+
+/* Copy the tiles visible from the camera into VIEW_TILES, touching only the */
+/* chunks that overlap the view                                              */
+static void tilemapCull(tilemap_t * map);
+
+#endif /* MKB_TILEMAP_H */
@@ -0,0 +1,74 @@
+/* Copyright (c) 2023 Sam Blenny
+ * SPDX-License-Identifier: CC-BY-NC-SA-4.0
+ *
+ * Vertex data for the tile layer, built from the visible tiles a row at a
+ * time, so the front end only uploads rows that changed.
+ *
+ * Building vertices here means the front end never touches individual
+ * vertices: it copies the changed rows out of linear memory with one
+ * bufferSubData() call per run of rows.
+ */
+#ifndef MKB_TILEMESH_C
+#define MKB_TILEMESH_C
+
+#include "mkb_engine.h"
+#include "tilemap.h"   /* VIEW_WIDE, VIEW_HIGH */
+#include "tilemesh.h"
+
+
+/**************************/
+/* Non-exported Functions */
+/**************************/
+
+/* Forget the previous build, so the next one rebuilds every row */
+static void tilemeshReset(tilemesh_t * mesh) {
+    mesh->built = 0;
+}
+
+/* Write the 6 vertices of the tile at view position (x, y) to v */
+static void tilemeshTile(u8 * v, u32 x, u32 y, u8 map_tile) {
+    /* Corner offsets for triangles {top left, bottom left, top right} and */
+    /* {top right, bottom left, bottom right}                              */
+    static const u8 dx[TILEMESH_TILE_VERTS] = {0, 0, 1, 1, 0, 1};
+    static const u8 dy[TILEMESH_TILE_VERTS] = {0, 1, 0, 0, 1, 1};
+    const u8 tile = (u8) (y * VIEW_WIDE + x);
+    u32 i;
+    for(i = 0; i < TILEMESH_TILE_VERTS; i++) {
+        v[i * 4    ] = (u8) (x + dx[i]);
+        v[i * 4 + 1] = (u8) (y + dy[i]);
+        v[i * 4 + 2] = tile;
+        v[i * 4 + 3] = map_tile;
+    }
+}
+
+/* Rebuild vertices in verts (TILEMESH_VERTS of them) for rows of tiles that
+ * changed since the last build.
+ * Returns: bitfield of rows rebuilt (bit y for row y)
+ */
+static u32 tilemeshBuild(tilemesh_t * mesh, const u16 * tiles, u8 * verts) {
+    u32 rows = 0;
+    u32 x;
+    u32 y;
+    for(y = 0; y < VIEW_HIGH; y++) {
+        const u16 * src = &tiles[y * VIEW_WIDE];
+        u16 * old = &mesh->tiles[y * VIEW_WIDE];
+        u32 changed = !mesh->built;
+        for(x = 0; x < VIEW_WIDE; x++) {
+            changed |= src[x] != old[x];
+        }
+        if(!changed) {
+            continue;
+        }
+        u8 * v = &verts[y * TILEMESH_ROW_VERTS * TILEMESH_VERTEX_BYTES];
+        for(x = 0; x < VIEW_WIDE; x++) {
+            old[x] = src[x];
+            tilemeshTile(&v[x * TILEMESH_TILE_VERTS * TILEMESH_VERTEX_BYTES],
+                x, y, (u8) src[x]);
+        }
+        rows |= 1 << y;
+    }
+    mesh->built = 1;
+    return rows;
+}
+
+#endif /* MKB_TILEMESH_C */
@@ -0,0 +1,39 @@
+/* Copyright (c) 2023 Sam Blenny
+ * SPDX-License-Identifier: CC-BY-NC-SA-4.0
+ *
+ * Vertex data for the tile layer, built from the visible tiles a row at a
+ * time, so the front end only uploads rows that changed.
+ */
+#ifndef MKB_TILEMESH_H
+#define MKB_TILEMESH_H
+
+/* Vertex layout: 4 bytes per vertex, {x, y, tile, map tile}, where (x, y) is
+ * a corner of the tile in view coordinates, tile is the tile's index in the
+ * view (y * VIEW_WIDE + x), and map tile is the low byte of its tile id.
+ * Each tile is 2 triangles, 6 vertices, counter-clockwise.
+ */
+#define TILEMESH_VERTEX_BYTES (4)
+#define TILEMESH_TILE_VERTS   (6)
+#define TILEMESH_ROW_VERTS    (VIEW_WIDE * TILEMESH_TILE_VERTS)
+#define TILEMESH_VERTS        (VIEW_HIGH * TILEMESH_ROW_VERTS)
+
+/* Mesh state: the tile ids that the vertices were built from. Rows get
+ * rebuilt when any of their tile ids change (scrolling, animated tiles,
+ * map edits), so this is only 1 row of work when nothing moves. Row masks
+ * are u32 bitfields, so VIEW_HIGH must be 32 or less.
+ */
+typedef struct tilemesh {
+    u32 built;                          /* 0 = rebuild everything      */
+    u16 tiles[VIEW_HIGH * VIEW_WIDE];   /* Tile ids as of the last build */
+} tilemesh_t;
+
+/* Forget the previous build, so the next one rebuilds every row */
+static void tilemeshReset(tilemesh_t * mesh);
+
+/* Rebuild vertices in verts (TILEMESH_VERTS of them) for rows of tiles that
+ * changed since the last build.
+ * Returns: bitfield of rows rebuilt (bit y for row y)
+ */
+static u32 tilemeshBuild(tilemesh_t * mesh, const u16 * tiles, u8 * verts);
+
+#endif /* MKB_TILEMESH_H */
@@ -21,9 +21,29 @@ if(gl === null) {
 const GLD = {};  /* Dictionary to hold gl state objects during init chain */
 
 /* WASM module stuff, including shared memory regions */
-const wasmModule = "markab-engine.wasm";
+const wasmModule = wasmPickModule();
 var WASM_EXPORT;   /* Wrapper object for symbols exported by wasm module */
-var GAMEPAD;       /* Wrapper object for shared gampad memory region */
+var INPUT_QUEUE;   /* Wrapper object for shared input event queue */
+var INPUT_HEAD;    /* Wrapper object for input queue head index (js writes) */
+var INPUT_TAIL;    /* Wrapper object for input queue tail index (wasm writes) */
+var SIM_CLOCK_MS;  /* Wrapper object for wasm simulation clock */
+var RENDER_LIST;      /* Address of wasm render command list (u32 words) */
+var RENDER_LIST_LEN;  /* Address of render command list length (u32) */
+var TILE_VERTICES;    /* Address of tile layer vertices (4 bytes each) */
+var TELEMETRY;        /* Address of frame time telemetry block (u32 words) */
+var AUDIO_RING;       /* View of the wasm audio block ring (f32 samples) */
+var AUDIO_HEAD;       /* View of the count of blocks rendered (wasm writes) */
+var AUDIO_TAIL;       /* View of the count of blocks taken (js writes) */
+
+/* Audio output (see audio.h). The AudioContext can only start after a user */
+/* gesture, so it gets made on the first key press.                         */
+const AUDIO_BLOCK = 128;      /* Frames per block */
+const AUDIO_RING_BLOCKS = 32;
+const AUDIO_LEAD_BLOCKS = 12; /* Most blocks to have queued in the worklet */
+var AUDIO_CTX;                /* AudioContext */
+var AUDIO_NODE;               /* AudioWorkletNode that plays the blocks */
+var AUDIO_SENT = 0;           /* Number of blocks sent to the worklet */
+var AUDIO_POOL = [];          /* Batch buffers the worklet has sent back */
 
 /* Animation Control */
 var PREV_TIMESTAMP;     /* Timestamp of previous animation frame */
@@ -57,7 +77,9 @@ function glInit1VertexShader() {
     `   precision mediump float;
         attribute vec2 a_position;
         attribute float a_tile_number;
+        attribute float a_map_tile;
         varying float v_tile_number;
+        varying float v_map_tile;
         void main() {
             // Scale and translate from tile coords to clip space coords
             vec2 pos = a_position / vec2(15.0, 10.0);
@@ -65,6 +87,7 @@ function glInit1VertexShader() {
             pos *= vec2(2.0, -2.0);
             gl_Position = vec4(pos, 0.0, 1.0);
             v_tile_number = a_tile_number;
+            v_map_tile = a_map_tile;
         }
     `;
     GLD.vShader = gl.createShader(gl.VERTEX_SHADER);
@@ -83,9 +106,10 @@ function glInit2FragmentShader() {
     `   precision mediump float;
         uniform float player_tile;
         varying float v_tile_number;
+        varying float v_map_tile;
         void main() {
             vec2 tile = mod(gl_FragCoord.xy, 32.0);
-            float lum = v_tile_number / (15.0 * 10.0);
+            float lum = v_map_tile / (15.0 * 10.0);
             float grn = (player_tile == v_tile_number) ? 0.9 : 0.0;
             float x = (tile.x < 2.0) || (tile.y < 2.0) ? 0.7 : lum;
             gl_FragColor = vec4(x, grn, x, 1.0); /* magenta */
@@ -129,56 +153,21 @@ function glInit3Program() {
 
 /* WebGL incremental init chain step 4: Bind vertex data */
 function glInit4Vertices() {
-    /* Add a buffer of triangles to tile the screen                     */
+    /* Make a buffer for triangles to tile the screen                    */
     /* - NDC coordinates are left-handed: +x=right +y=up +z=into_screen */
     /* - Default front-face winding order is counter-clockwise          */
-    /* - Vertices are aligned on 4-byte boundary: (x, y, tile, padding) */
+    /* - Vertices are aligned on 4-byte boundary: (x, y, tile, map_tile) */
+    /* - The wasm module builds the vertices in TILE_VERTICES, and its   */
+    /*   render list says which ones to upload (see tilemesh.h)          */
     const columns = 240/16;
     const rows = 160/16;
     const vertsPerTile = 6;
-    const bytesPerTile = 24;  /* 6 vert/tile * 4 bytes/vert -> 24 bytes/tile */
     GLD.columns = columns;
     GLD.rows = rows;
     GLD.vertexCount = columns * rows * vertsPerTile;
-    GLD.vertices = new Uint8Array(columns * rows * bytesPerTile);
-    for(let y = 0; y < rows; y++) {
-        for(let x = 0; x < columns; x++) {
-            let tile = (y * columns) + x;
-            let i = tile * bytesPerTile;
-            GLD.vertices[i   ] = x;      /*  X--/ */
-            GLD.vertices[i+ 1] = y;      /*  | /  */
-            GLD.vertices[i+ 2] = tile;   /*  |/   */
-            GLD.vertices[i+ 3] = 0;
-
-            GLD.vertices[i+ 4] = x;      /*  +--/ */
-            GLD.vertices[i+ 5] = y+1;    /*  | /  */
-            GLD.vertices[i+ 6] = tile;   /*  X/   */
-            GLD.vertices[i+ 7] = 0;
-
-            GLD.vertices[i+ 8] = x+1;    /*  +--X */
-            GLD.vertices[i+ 9] = y;      /*  | /  */
-            GLD.vertices[i+10] = tile;   /*  |/   */
-            GLD.vertices[i+11] = 0;
-
-            GLD.vertices[i+12] = x+1;    /*    /X */
-            GLD.vertices[i+13] = y;      /*   / | */
-            GLD.vertices[i+14] = tile;   /*  /--+ */
-            GLD.vertices[i+15] = 0;
-
-            GLD.vertices[i+16] = x;      /*    /| */
-            GLD.vertices[i+17] = y+1;    /*   / | */
-            GLD.vertices[i+18] = tile;   /*  X--+ */
-            GLD.vertices[i+19] = 0;
-
-            GLD.vertices[i+20] = x+1;    /*    /| */
-            GLD.vertices[i+21] = y+1;    /*   / | */
-            GLD.vertices[i+22] = tile;   /*  /--X */
-            GLD.vertices[i+23] = 0;
-        }
-    }
     GLD.vBuf = gl.createBuffer();
     gl.bindBuffer(gl.ARRAY_BUFFER, GLD.vBuf);
-    gl.bufferData(gl.ARRAY_BUFFER, GLD.vertices, gl.STATIC_DRAW);
+    gl.bufferData(gl.ARRAY_BUFFER, GLD.vertexCount * 4, gl.DYNAMIC_DRAW);
     /* Bind the interleaved x,y position and tile_number vertex attributes */
     /* vertexAttribPointer(index, size, type, normalized, stride, pointer) */
     const gltype = gl.UNSIGNED_BYTE;
@@ -190,6 +179,9 @@ function glInit4Vertices() {
     const a_tile_number = gl.getAttribLocation(GLD.program, 'a_tile_number');
     gl.vertexAttribPointer(a_tile_number, 2, gltype, normalize, stride, 2);
     gl.enableVertexAttribArray(a_tile_number);
+    const a_map_tile = gl.getAttribLocation(GLD.program, 'a_map_tile');
+    gl.vertexAttribPointer(a_map_tile, 1, gltype, normalize, stride, 3);
+    gl.enableVertexAttribArray(a_map_tile);
 
     /* Schedule next init function */
     window.requestAnimationFrame(glInit5LoadWasm);
@@ -200,26 +192,82 @@ function glInit5LoadWasm() {
     /* Load the wasm module with callback to start the event loop */
     wasmloadModule(() => {
         WASM_EXPORT.init();
+        drawRenderList();
         window.requestAnimationFrame(frameZero);  /* Start event loop */
     });
 }
 
-/* Draw the grid of tiles, 15 wide by 10 high */
-function drawTiles() {
-    const first = 0;
-    gl.drawArrays(gl.TRIANGLES, first, GLD.vertexCount);
-}
-
-/* Tell shaders which tile the player character is on */
-function setPlayerTile(n) {
-    const tile = n < 0 ? 0 : (n > 150 ? 150 : n);
-    gl.uniform1f(GLD.playerTile, tile);
+/* Render list opcodes (see render.h) */
+const RC_TILES    = 1;
+const RC_SPRITES  = 2;
+const RC_LINES    = 3;
+const RC_DIRTY    = 4;
+const RC_CAMERA   = 5;
+const RC_VERTICES = 6;
+
+/* Copy count vertices from wasm memory into the vertex buffer, from first */
+function uploadVertices(buf, first, count) {
+    if(first + count > GLD.vertexCount) {
+        console.error("bad vertex range", first, count);
+        return;
+    }
+    const bytes = new Uint8Array(buf, TILE_VERTICES + first * 4, count * 4);
+    gl.bufferSubData(gl.ARRAY_BUFFER, first * 4, bytes);
 }
 
-/* Draw indexed vertices as a line strip */
-function drawLines() {
-    const first = 0;
-    gl.drawArrays(gl.LINE_STRIP, first, GLD.vertexCount);
+/* Draw the frame described by the wasm module's render command list */
+function drawRenderList() {
+    /* Views must be made fresh each time in case wasm memory has grown */
+    const buf = WASM_EXPORT.memory.buffer;
+    const len = new Uint32Array(buf, RENDER_LIST_LEN, 1)[0];
+    if(len === 0) {
+        return;  /* Nothing changed */
+    }
+    const list = new Uint32Array(buf, RENDER_LIST, len);
+    /* Scan the list first since the player tile uniform has to be set */
+    /* before drawing, even though sprites come after the tile layer.   */
+    let tiles = false;
+    let lines = null;
+    let sprite = null;
+    let camera = [0, 0];
+    let i = 0;
+    while(i < len) {
+        const op = list[i] & 0xffff;
+        const words = list[i] >>> 16;
+        if(words === 0 || i + words > len) {
+            console.error("bad render list at", i);
+            return;
+        }
+        if(op === RC_TILES) {
+            tiles = true;
+        } else if(op === RC_LINES) {
+            lines = [list[i+1], list[i+2]];
+        } else if(op === RC_CAMERA) {
+            camera = [list[i+1], list[i+2]];
+        } else if(op === RC_VERTICES) {
+            uploadVertices(buf, list[i+1], list[i+2]);
+        } else if(op === RC_SPRITES && sprite === null) {
+            /* Shaders only know how to highlight one sprite tile */
+            sprite = [list[i+1], list[i+2]];
+        }
+        /* RC_DIRTY: WebGL redraws the whole canvas, so dirty rects are */
+        /* only useful to a 2D canvas front end                        */
+        i += words;
+    }
+    if(sprite !== null) {
+        /* Sprite coordinates are world coordinates, so subtract camera */
+        const x = sprite[0] - camera[0];
+        const y = sprite[1] - camera[1];
+        const max = GLD.columns * GLD.rows;
+        const n = y * GLD.columns + x;
+        gl.uniform1f(GLD.playerTile, (n < 0 || n > max) ? max : n);
+    }
+    if(tiles) {
+        gl.drawArrays(gl.TRIANGLES, 0, GLD.vertexCount);
+    }
+    if(lines !== null) {
+        gl.drawArrays(gl.LINE_STRIP, lines[0], lines[1]);
+    }
 }
 
 
@@ -237,15 +285,32 @@ function repaint() {
 /* WASM Module Load and Init */
 /*****************************/
 
+/* Pick the SIMD + bulk memory build if this browser supports both, or */
+/* else fall back to the MVP build. These tiny modules each use one of  */
+/* the features, so they only validate if the feature is supported.    */
+function wasmPickModule() {
+    const simd = new Uint8Array([
+        0, 97, 115, 109, 1, 0, 0, 0, 1, 5, 1, 96, 0, 1, 123, 3, 2, 1, 0, 10,
+        10, 1, 8, 0, 65, 0, 253, 15, 253, 98, 11,
+    ]);
+    const bulkMemory = new Uint8Array([
+        0, 97, 115, 109, 1, 0, 0, 0, 1, 4, 1, 96, 0, 0, 3, 2, 1, 0, 5, 3, 1,
+        0, 1, 10, 14, 1, 12, 0, 65, 0, 65, 0, 65, 0, 252, 10, 0, 0, 11,
+    ]);
+    if(WebAssembly.validate(simd) && WebAssembly.validate(bulkMemory)) {
+        return "markab-engine-simd.wasm";
+    }
+    return "markab-engine.wasm";
+}
+
 // Load WASM module, bind shared memory, then invoke callback.
 function wasmloadModule(callback) {
     var importObject = {
         env: {
             js_trace: (code) => {console.log("wasm trace:", code);},
             repaint: repaint,
-            drawLines: drawLines,
-            setPlayerTile: setPlayerTile,
-            drawTiles: drawTiles,
+            /* Wraps around every 71 minutes, which telemetry expects */
+            js_clock_us: () => Math.floor(performance.now() * 1000) >>> 0,
         },
     };
     if ("instantiateStreaming" in WebAssembly) {
@@ -272,14 +337,82 @@ function initSharedMemBindings(result) {
     let wasmBufU8 = new Uint8Array(WASM_EXPORT.memory.buffer);
     let wasmDV = new DataView(WASM_EXPORT.memory.buffer);
 
-    /* Set up the gampad button vector */
-    /* The `| WASM_EXPORT.GAMEPAD` (i.e. not `.value`) is for Safari */
-    const gp = WASM_EXPORT.GAMEPAD.value | WASM_EXPORT.GAMEPAD;
-    GAMEPAD = new Uint32Array(WASM_EXPORT.memory.buffer, gp, 1);
+    /* Set up the input event queue */
+    /* The `| WASM_EXPORT.X` (i.e. not `.value`) is for Safari */
+    const buf = WASM_EXPORT.memory.buffer;
+    const q = WASM_EXPORT.INPUT_QUEUE.value | WASM_EXPORT.INPUT_QUEUE;
+    const h = WASM_EXPORT.INPUT_HEAD.value | WASM_EXPORT.INPUT_HEAD;
+    const t = WASM_EXPORT.INPUT_TAIL.value | WASM_EXPORT.INPUT_TAIL;
+    const c = WASM_EXPORT.SIM_CLOCK_MS.value | WASM_EXPORT.SIM_CLOCK_MS;
+    INPUT_QUEUE = new Uint32Array(buf, q, INPUT_QUEUE_MAX * 2);
+    INPUT_HEAD = new Uint32Array(buf, h, 1);
+    INPUT_TAIL = new Uint32Array(buf, t, 1);
+    SIM_CLOCK_MS = new Uint32Array(buf, c, 1);
+
+    /* Save render command list and tile vertex addresses (views get made */
+    /* per frame)                                                         */
+    RENDER_LIST = WASM_EXPORT.RENDER_LIST.value | WASM_EXPORT.RENDER_LIST;
+    RENDER_LIST_LEN = WASM_EXPORT.RENDER_LIST_LEN.value
+        | WASM_EXPORT.RENDER_LIST_LEN;
+    TILE_VERTICES = WASM_EXPORT.TILE_VERTICES.value
+        | WASM_EXPORT.TILE_VERTICES;
+    TELEMETRY = WASM_EXPORT.TELEMETRY.value | WASM_EXPORT.TELEMETRY;
+
+    /* Set up the audio block ring */
+    const r = WASM_EXPORT.AUDIO_RING.value | WASM_EXPORT.AUDIO_RING;
+    const ah = WASM_EXPORT.AUDIO_HEAD.value | WASM_EXPORT.AUDIO_HEAD;
+    const at = WASM_EXPORT.AUDIO_TAIL.value | WASM_EXPORT.AUDIO_TAIL;
+    AUDIO_RING = new Float32Array(buf, r,
+        AUDIO_RING_BLOCKS * AUDIO_BLOCK * 2);
+    AUDIO_HEAD = new Uint32Array(buf, ah, 1);
+    AUDIO_TAIL = new Uint32Array(buf, at, 1);
     unpressAllButtons();
 }
 
 
+/*************/
+/* Telemetry */
+/*************/
+
+/* Telemetry block layout (see telemetry.h) */
+const TELEM_STAGES  = 5;
+const TELEM_BUCKETS = 64;
+const TELEM_RING    = 256;
+
+/* Read the wasm module's frame time telemetry. This is handy to call from */
+/* the browser console. Times are in microseconds.                         */
+function readTelemetry() {
+    const words = 6 + TELEM_STAGES * 3 + TELEM_BUCKETS + TELEM_RING;
+    const w = new Uint32Array(WASM_EXPORT.memory.buffer, TELEMETRY, words);
+    const stage = (i) => Array.from(w.subarray(6 + TELEM_STAGES * i,
+        6 + TELEM_STAGES * (i + 1)));
+    const hist = 6 + TELEM_STAGES * 3;
+    const ring = hist + TELEM_BUCKETS;
+    const frames = w[0];
+    /* Frame n is at ring[n % TELEM_RING], so put the newest frame last */
+    const recent = [];
+    for(let n = Math.max(0, frames - TELEM_RING); n < frames; n++) {
+        recent.push(w[ring + (n % TELEM_RING)]);
+    }
+    return {
+        frames: frames,
+        overBudget: w[1],
+        budget: w[2],
+        last: w[3],
+        max: w[4],
+        total: w[5],
+        stageNames: ["input", "sim", "effects", "anim", "render"],
+        stageLast: stage(0),
+        stageMax: stage(1),
+        stageTotal: stage(2),
+        hist: Array.from(w.subarray(hist, ring)),
+        recent: recent,
+        p50: WASM_EXPORT.frameTimePercentile(500),
+        p99: WASM_EXPORT.frameTimePercentile(990),
+    };
+}
+
+
 /********************************************************/
 /* Gamepad and Keyboard equivalents (WASD, arrows, etc) */
 /********************************************************/
@@ -294,12 +427,35 @@ const gpDn  =  32;  /* dpad down  */
 const gpL   =  64;  /* dpad left  */
 const gpR   = 128;  /* dpad right */
 
+/* Input event queue capacity (see sim.h) */
+const INPUT_QUEUE_MAX = 64;
+
+/* Queue a gamepad button state change for the wasm module. Events get     */
+/* timestamps on the wasm simulation clock, so the simulation can apply    */
+/* them at the tick when they happened instead of at the next frame.      */
+function pushInput(bits) {
+    const head = INPUT_HEAD[0];
+    const tail = INPUT_TAIL[0];
+    const sinceFrame = (PREV_TIMESTAMP === undefined) ? 0 :
+        Math.max(0, performance.now() - PREV_TIMESTAMP);
+    const stamp = (SIM_CLOCK_MS[0] + sinceFrame) >>> 0;
+    if(head - tail >= INPUT_QUEUE_MAX) {
+        /* Queue is full, so fold this into the newest event */
+        INPUT_QUEUE[((head - 1) % INPUT_QUEUE_MAX) * 2 + 1] = bits;
+        return;
+    }
+    const i = (head % INPUT_QUEUE_MAX) * 2;
+    INPUT_QUEUE[i] = stamp;
+    INPUT_QUEUE[i + 1] = bits;
+    INPUT_HEAD[0] = head + 1;
+}
+
 /* Clear gamepad and WASD-pad buttons and schedule a frame if needed */
 function unpressAllButtons() {
     const oldBits = GAMEPAD_BITS | WASD_BITS;
     WASD_BITS = 0;
     GAMEPAD_BITS = 0;
-    GAMEPAD[0] = 0;
+    pushInput(0);
     if(oldBits != 0) {
         window.requestAnimationFrame(evenFrame);
     }
@@ -327,8 +483,8 @@ function setWASDButtons(bits) {
         /* Run the animation loop */
         PAUSED = 0;
     }
-    /* Update shared memory for gamepad bitfield */
-    GAMEPAD[0] = mergedBits;
+    /* Queue the new gamepad bitfield */
+    pushInput(mergedBits);
 }
 
 /* Update shared memory for gamepad buttons and schedule a frame if needed */
@@ -351,8 +507,8 @@ function setGamepadButtons(bits) {
         /* Trigger a frame since gampad polling loop is not active */
         window.requestAnimationFrame(evenFrame);
     }
-    /* Update shared memory for gamepad bitfield */
-    GAMEPAD[0] = mergedBits;
+    /* Queue the new gamepad bitfield */
+    pushInput(mergedBits);
 }
 
 /* Get a copy of the WASD-pad button status bitfield */
@@ -414,6 +570,7 @@ function handleKeydown(e) {
     if(e.defaultPrevented || e.ctrlKey || e.metaKey || e.shiftKey) {
         return;
     }
+    audioStart();
     /* CAUTION! event.code uses QWERTY layout locations regardless */
     /*          of what the actual keyboard layout may be set to.  */
     var bits = getWASDButtons();
@@ -522,6 +679,67 @@ function handleFocus() {
 }
 
 
+/*****************/
+/* Audio Output  */
+/*****************/
+
+/* Make the AudioContext and worklet node, then tell wasm the sample rate */
+function audioStart() {
+    if(AUDIO_CTX !== undefined || WASM_EXPORT === undefined
+        || !window.AudioWorkletNode) {
+        return;
+    }
+    AUDIO_CTX = new AudioContext();
+    AUDIO_CTX.audioWorklet.addModule("mkb-audio.js")
+        .then(() => {
+            AUDIO_NODE = new AudioWorkletNode(AUDIO_CTX, "mkb-audio",
+                {outputChannelCount: [2]});
+            AUDIO_NODE.connect(AUDIO_CTX.destination);
+            AUDIO_NODE.port.onmessage = (e) => { AUDIO_POOL.push(e.data); };
+            AUDIO_SENT = 0;
+            if(!WASM_EXPORT.startAudio(AUDIO_CTX.sampleRate)) {
+                console.warn("audio rate not supported:",
+                    AUDIO_CTX.sampleRate);
+            }
+        })
+        .catch(function (e) {console.error(e);});
+}
+
+/* Send blocks that wasm has mixed to the worklet, keeping no more than    */
+/* AUDIO_LEAD_BLOCKS ahead of what it has played, then tell wasm they're   */
+/* taken so it can mix more. This runs once per frame. The blocks are      */
+/* already planar f32, so they get copied into a batch buffer whole. Batch */
+/* buffers go to the worklet and back, so after the first few frames, this */
+/* doesn't allocate them.                                                  */
+function audioPump() {
+    if(AUDIO_NODE === undefined) {
+        return;
+    }
+    const played = Math.floor(AUDIO_CTX.currentTime * AUDIO_CTX.sampleRate
+        / AUDIO_BLOCK);
+    const tail = AUDIO_TAIL[0];
+    const ready = (AUDIO_HEAD[0] - tail) >>> 0;
+    const n = Math.min(ready, played + AUDIO_LEAD_BLOCKS - AUDIO_SENT);
+    if(n <= 0) {
+        return;
+    }
+    const size = AUDIO_BLOCK * 2;
+    const out = AUDIO_POOL.length > 0 ? new Float32Array(AUDIO_POOL.pop())
+        : new Float32Array(AUDIO_LEAD_BLOCKS * size);
+    /* Copy up to the end of the ring, then the rest from its start */
+    const first = tail % AUDIO_RING_BLOCKS;
+    const m = Math.min(n, AUDIO_RING_BLOCKS - first);
+    out.set(AUDIO_RING.subarray(first * size, (first + m) * size));
+    if(m < n) {
+        out.set(AUDIO_RING.subarray(0, (n - m) * size), m * size);
+    }
+    AUDIO_NODE.port.postMessage({buffer: out.buffer, blocks: n},
+        [out.buffer]);
+    AUDIO_SENT += n;
+    AUDIO_TAIL[0] = (tail + n) >>> 0;
+}
+
+
 /**************/
 /* Event Loop */
 /**************/
@@ -562,6 +780,8 @@ function evenFrame(timestamp_ms) {
     try {
         /* Transfer control to wasm module to generate next frame */
         WASM_EXPORT.next(ms);
+        drawRenderList();
+        audioPump();
     } catch(e) {
         /* If something goes wrong, stop the animation loop */
         window.cancelAnimationFrame(requestID);
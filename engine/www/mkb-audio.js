@@ -0,0 +1,48 @@
+/* Copyright (c) 2023 Sam Blenny */
+/* SPDX-License-Identifier: CC-BY-NC-SA-4.0 */
+"use strict";
+
+/* AudioWorklet processor that plays blocks mixed by the wasm module. The
+ * main thread posts batches of blocks as {buffer, blocks}, where buffer is
+ * an ArrayBuffer of f32 samples with 128 left samples then 128 right samples
+ * per block. Each call to process() plays one block, or silence if none are
+ * queued. Once a batch has played, its buffer goes back to the main thread
+ * to be used again.
+ */
+class MkbAudio extends AudioWorkletProcessor {
+    constructor() {
+        super();
+        this.queue = [];  /* Batches of blocks, oldest first */
+        this.block = 0;   /* Next block to play in this.queue[0] */
+        this.port.onmessage = (e) => {
+            this.queue.push({
+                samples: new Float32Array(e.data.buffer),
+                blocks: e.data.blocks,
+            });
+        };
+    }
+
+    process(inputs, outputs, parameters) {
+        const out = outputs[0];
+        const n = out[0].length;
+        if(this.queue.length == 0) {
+            return true;
+        }
+        const batch = this.queue[0];
+        const at = this.block * n * 2;
+        out[0].set(batch.samples.subarray(at, at + n));
+        if(out.length > 1) {
+            out[1].set(batch.samples.subarray(at + n, at + n * 2));
+        }
+        this.block += 1;
+        if(this.block >= batch.blocks) {
+            this.queue.shift();
+            this.block = 0;
+            this.port.postMessage(batch.samples.buffer,
+                [batch.samples.buffer]);
+        }
+        return true;
+    }
+}
+
+registerProcessor("mkb-audio", MkbAudio);
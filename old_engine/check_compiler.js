@@ -0,0 +1,81 @@
+/* Copyright (c) 2023 Sam Blenny */
+/* SPDX-License-Identifier: MIT  */
+/*
+ * Check that the compiler module can run code at compile time.
+ *
+ * The native tests run with a big stack, so they don't notice if the
+ * compiler needs more stack than the wasm module has. In wasm, running out
+ * of stack either traps or quietly overwrites other data. This compiles
+ * pairs of sources, where the first uses `[ ... ]` or an immediate word and
+ * the second has the literal it should leave, and fails unless both compile
+ * to the same code. Each source gets a fresh instance, so a trap in one
+ * doesn't spoil the rest.
+ *
+ * Usage: node check_compiler.js www/markab-compiler.wasm
+ */
+"use strict";
+
+const fs = require("fs");
+
+const HEADER_LEN = 16;  /* MK_CACHE_HEADER_LEN, which has a hash of the src */
+
+const PAIRS = [
+    ["[ 1 2 + ] halt\n", "3 halt\n"],
+    [": sq dup * ; [ 3 sq ] halt\n", ": sq dup * ; 9 halt\n"],
+    [": nine 9 ; immediate nine halt\n", ": nine 9 ; 9 halt\n"],
+];
+
+/* Stub out the host functions that the compiler imports */
+const noop = () => {};
+const IMPORTS = {
+    env: {
+        mk_host_log_error: noop,
+        mk_host_stdout_write: noop,
+        mk_host_stdout_fmt_int: noop,
+        mk_host_putchar: noop,
+    },
+};
+
+if(process.argv.length != 3) {
+    console.error("Usage: node check_compiler.js markab-compiler.wasm");
+    process.exit(2);
+}
+const mod = new WebAssembly.Module(fs.readFileSync(process.argv[2]));
+
+/* Compile src in a fresh instance, and report it if that fails */
+/* Returns: hex of the code after the header, or null            */
+function compile(src) {
+    const comp = new WebAssembly.Instance(mod, IMPORTS).exports;
+    const text = new TextEncoder().encode(src);
+    new Uint8Array(comp.memory.buffer, comp.COMP_SRC.value, text.length)
+        .set(text);
+    let len;
+    try {
+        len = comp.compile(text.length);
+    } catch(e) {
+        console.error(`${process.argv[2]}: ${JSON.stringify(src)}: ` +
+            e.message);
+        return null;
+    }
+    if(len <= HEADER_LEN) {
+        console.error(`${process.argv[2]}: ${JSON.stringify(src)}: ` +
+            "compile error");
+        return null;
+    }
+    return Buffer.from(comp.memory.buffer, comp.COMP_OUT.value + HEADER_LEN,
+        len - HEADER_LEN).toString("hex");
+}
+
+let ok = true;
+for(const [src, want] of PAIRS) {
+    const got = compile(src);
+    const expected = compile(want);
+    if(got === null || expected === null) {
+        ok = false;
+    } else if(got !== expected) {
+        console.error(`${process.argv[2]}: ${JSON.stringify(src)} gave ` +
+            `${got}, want ${expected}`);
+        ok = false;
+    }
+}
+process.exit(ok ? 0 : 1);
@@ -19,7 +19,10 @@ halt HALT
 <ASM> I32
 <ASM> STR
 <ASM> BZ
+<ASM> BZL
 <ASM> BNZ
+<ASM> BFOR
+<ASM> BFORL
 <ASM> JMP
 <ASM> JAL
 <ASM> RET
@@ -140,20 +143,37 @@ C_CODE_TEMPLATE = f"""
  * that in mind, this code expects to be #included into libmkb.c, which also
  * #includes op.c. That arrangement allows the compiler to inline opcode
  * implementations into the big switch statement.
+ *
+ * This runs the VM for up to max_cycles, stopping early if it halts. When the
+ * budget runs out first, the VM is left paused mid-code, and calling this
+ * again resumes it where it left off.
+ * Returns: number of cycles used
  */
-static void autogen_step(mk_context_t * ctx) {{
-    int i; /* declare outside of for loop for ANSI C compatibility */
-    for(i=0; i<MK_MAX_CYCLES; i++) {{
+static u32 autogen_slice(mk_context_t * ctx, u32 max_cycles) {{
+    u32 i; /* declare outside of for loop for ANSI C compatibility */
+    for(i=0; i<max_cycles; i++) {{
         switch(vm_next_instruction(ctx)) {{
 {c_bytecode_switch_guts()}
         }};
         if(ctx->halted) {{
-            return;
+            return i + 1;
         }}
     }}
-    /* Making it this far means the MK_MAX_CYCLES limit was exceeded */
-    vm_irq_err(ctx, MK_ERR_CPU_HOG);
-    autogen_step(ctx);
+    return max_cycles;
+}};
+
+/* Run the VM for up to max_cycles, treating a VM that never halts as a bug */
+static void autogen_run(mk_context_t * ctx, u32 max_cycles) {{
+    autogen_slice(ctx, max_cycles);
+    if(!ctx->halted) {{
+        /* Making it this far means the max_cycles limit was exceeded */
+        vm_irq_err(ctx, MK_ERR_CPU_HOG);
+    }}
+}};
+
+/* Run the VM with the default MK_MAX_CYCLES budget */
+static void autogen_step(mk_context_t * ctx) {{
+    autogen_run(ctx, MK_MAX_CYCLES);
 }};
 
 #endif /* LIBMKB_AUTOGEN_C */
@@ -23,6 +23,22 @@ typedef struct comp_context {
     u32 lineStart;
     u32 cursor;
     u32 wordEnd;
+    comp_dict_t * dict;  /* Symbol table for `: name ... ;` words          */
+    u8 mode;             /* MK_comp_ModeProgram or MK_comp_ModeModule      */
+    u8 defining;         /* 1 while compiling the body of a definition     */
+    u16 defJump;         /* Operand address of JMP that skips current def  */
+    u16 lastCall;        /* Address of most recent JAL (for tail calls)    */
+    u32 defPos;          /* Source position of current definition's `:`    */
+    u8 ctlBase;          /* ctlDepth when the current definition started   */
+    u8 ctlDepth;         /* Number of open if{ and for{ structures         */
+    u8 ctlKind[MK_comp_CtlMax];   /* MK_comp_CtlIf or MK_comp_CtlFor       */
+    u16 ctlAddr[MK_comp_CtlMax];  /* BZL operand, or start of loop body    */
+    u32 ctlPos[MK_comp_CtlMax];   /* Source position (for errors)          */
+    u16 lastDef;         /* Most recently defined word (index + 1)         */
+    u8 evaluating;       /* 1 while compiling code inside `[ ... ]`        */
+    u16 evalStart;       /* Address where code inside `[ ... ]` starts     */
+    u8 evalCtlDepth;     /* ctlDepth at the `[`                            */
+    u32 evalPos;         /* Source position of the `[` (for errors)        */
 } comp_context_t;
 
 /* Compiler error status codes */
@@ -38,8 +54,20 @@ typedef enum {
     stat_StrLineEnd,     /* String literal cannot span lines     */
     stat_StrBackslash,   /* String literal ends with trailing \  */
     stat_StrOverflow,    /* String literal is too long           */
+    stat_NameSyntax,     /* Missing or too long name after :     */
+    stat_UnknownWord,    /* Call to a word that was never defined */
+    stat_DictFull,       /* Too many names or forward references */
+    stat_DefSyntax,      /* Nested : or unmatched ;              */
+    stat_CtlSyntax,      /* Unmatched or too deep if{ or for{    */
+    stat_EvalSyntax,     /* Unmatched [ or ], or misplaced ]bytes */
+    stat_EvalError,      /* Compile-time code hit a VM error     */
 } comp_stat;
 
+/* Scratch VM that compile-time code runs in. Each `[ ... ]` or call to */
+/* an immediate word finishes running before the next one starts, so one */
+/* is enough. It's big, so keep it off the stack.                        */
+static mk_context_t COMP_SCRATCH;
+
 
 /* ============ */
 /* == Macros == */
@@ -157,6 +185,34 @@ void log_compiler_error(comp_context_t * comp_ctx, comp_stat status) {
             message = "StrOverflow";
             length = 11;
             break;
+        case stat_NameSyntax:
+            message = "NameSyntax";
+            length = 10;
+            break;
+        case stat_UnknownWord:
+            message = "UnknownWord";
+            length = 11;
+            break;
+        case stat_DictFull:
+            message = "DictFull";
+            length = 8;
+            break;
+        case stat_DefSyntax:
+            message = "DefSyntax";
+            length = 9;
+            break;
+        case stat_CtlSyntax:
+            message = "CtlSyntax";
+            length = 9;
+            break;
+        case stat_EvalSyntax:
+            message = "EvalSyntax";
+            length = 10;
+            break;
+        case stat_EvalError:
+            message = "EvalError";
+            length = 9;
+            break;
     }
     mk_host_stdout_write(message, length);
     mk_host_stdout_write("\n", 1);
@@ -194,14 +250,9 @@ void log_compiler_error(comp_context_t * comp_ctx, comp_stat status) {
     }
 }
 
-/* Hash a name string into a bin offset using multiply-with-carry (MWC) hash */
-static comp_stat
-hash_name(comp_context_t * comp_ctx, u16 * hash_bin_offset) {
-    _assert_valid_comp_context();
-    /* Calculate name's start position and length within the input buffer */
-    const u8 * buf = _word_pointer(comp_ctx);
-    u32 length = _word_length(comp_ctx);
-    /* Calculate the hashmap bin */
+/* Hash a name string into a bin number using multiply-with-carry (MWC) */
+static u16
+hash_bytes(const u8 * buf, u32 length) {
     int i;
     u16 k = MK_comp_HashC;
     for(i = 0; i < length; i++) {
@@ -211,9 +262,89 @@ hash_name(comp_context_t * comp_ctx, u16 * hash_bin_offset) {
         k ^= buf[i];
     }
     k ^= k >> MK_comp_HashB;    /* Compress entropy towards low bits  */
-    k &= MK_comp_HashMask;      /* Mask low bits to get a hashmap bin */
-    *hash_bin_offset = k << 1;  /* Bin number * 2 = Bin pointer       */
-    return stat_OK;             /* Success */
+    return k & MK_comp_HashMask; /* Mask low bits to get a hashmap bin */
+}
+
+/* Find a name in dict, optionally adding it if it's missing.   */
+/* Returns: index + 1 of the symbol, or 0 if not found/no room  */
+static u16
+comp_dict_find(comp_dict_t *dict, const u8 * name, u32 length, u8 create) {
+    if(length < 1 || length > MK_NAME_MAX) {
+        return 0;
+    }
+    /* Walk the hash bin's chain looking for a matching name */
+    const u16 bin = hash_bytes(name, length);
+    u16 n = dict->bins[bin];
+    while(n != 0) {
+        const comp_sym_t * sym = &dict->syms[n - 1];
+        if(sym->name[0] == length) {
+            u32 i;
+            for(i = 0; i < length && sym->name[1 + i] == name[i]; i++) {
+                /* Keep comparing until a byte doesn't match */
+            }
+            if(i == length) {
+                return n;
+            }
+        }
+        n = sym->next;
+    }
+    /* Not found, so add a new undefined symbol at the head of the chain */
+    if(!create || dict->symCount >= MK_SYM_MAX) {
+        return 0;
+    }
+    comp_sym_t * sym = &dict->syms[dict->symCount];
+    sym->name[0] = (u8) length;
+    memcpy(&sym->name[1], name, length);
+    sym->addr = 0;
+    sym->defined = 0;
+    sym->immediate = 0;
+    sym->pending = 0;
+    sym->next = dict->bins[bin];
+    dict->symCount += 1;
+    dict->bins[bin] = dict->symCount;
+    return dict->symCount;
+}
+
+/* Patch the PC-relative u16 operand at site so it jumps to target */
+static void
+patch_rel16(mk_context_t * ctx, u16 site, u16 target) {
+    const u16 n = target - site;
+    ctx->RAM[site] = (u8) n;
+    ctx->RAM[(u16)(site + 1)] = (u8) (n >> 8);
+}
+
+/* Point pending forward references to symbol index sym at address addr */
+static void
+resolve_fixups(mk_context_t * ctx, comp_dict_t * dict, u16 sym, u16 addr) {
+    u16 i = 0;
+    while(i < dict->fixupCount) {
+        comp_fixup_t * f = &dict->fixups[i];
+        if(f->sym == sym) {
+            patch_rel16(ctx, f->site, addr);
+            /* Remove the fixup by moving the last one into its slot */
+            dict->fixupCount -= 1;
+            *f = dict->fixups[dict->fixupCount];
+        } else {
+            i += 1;
+        }
+    }
+}
+
+/* Point the compiler context at source position pos, recomputing the line */
+/* tracker. This is for reporting errors discovered after the fact.        */
+static void
+seek_source_position(comp_context_t * comp_ctx, u32 pos) {
+    u32 i;
+    comp_ctx->lineNum = 1;
+    comp_ctx->lineStart = 0;
+    for(i = 0; i < pos && i < comp_ctx->len; i++) {
+        if(comp_ctx->buf[i] == '\n') {
+            comp_ctx->lineNum += 1;
+            comp_ctx->lineStart = i + 1;
+        }
+    }
+    comp_ctx->cursor = pos;
+    comp_ctx->wordEnd = pos;
 }
 
 
@@ -303,6 +434,19 @@ lex_locate_end_of_word(comp_context_t *comp_ctx) {
     return stat_OK;
 }
 
+/* Advance the cursor past the current word (after it has been compiled) */
+static comp_stat
+lex_advance_past_word(comp_context_t * comp_ctx) {
+    if(comp_ctx->wordEnd + 1 < comp_ctx->len) {
+        comp_ctx->wordEnd += 1;
+        comp_ctx->cursor = comp_ctx->wordEnd;
+        return stat_OK;
+    } else {
+        comp_ctx->cursor = comp_ctx->wordEnd;
+        return stat_EOF;
+    }
+}
+
 /* Skip characters until delimiter, updating the line tracker */
 static comp_stat
 lex_skip_until(comp_context_t * comp_ctx, u8 delimiter) {
@@ -523,6 +667,344 @@ compile_char(comp_context_t *comp_ctx, mk_context_t * ctx) {
     return stat_ParserError;
 }
 
+/* Compile a call (JAL) to the word with symbol index sym. If the word is */
+/* not defined yet, leave a fixup so its address can be patched in later. */
+static comp_stat
+compile_call(comp_context_t * comp_ctx, mk_context_t * ctx, u16 sym) {
+    comp_dict_t * dict = comp_ctx->dict;
+    _assert_dictionary_free_space(3);
+    comp_ctx->lastCall = ctx->DP;
+    _append_dictionary_byte(MK_JAL);
+    const u16 site = ctx->DP;
+    _append_dictionary_byte(0);
+    _append_dictionary_byte(0);
+    if(dict->syms[sym].defined) {
+        patch_rel16(ctx, site, dict->syms[sym].addr);
+        return stat_OK;
+    }
+    if(dict->fixupCount >= MK_FIXUP_MAX) {
+        return stat_DictFull;
+    }
+    comp_fixup_t * f = &dict->fixups[dict->fixupCount];
+    f->site = site;
+    f->sym = sym;
+    f->srcPos = comp_ctx->cursor;
+    dict->fixupCount += 1;
+    return stat_OK;
+}
+
+/* Compile the start of a `: name ... ;` definition. To let top-level code */
+/* keep running in order, the definition gets wrapped in a JMP over it.    */
+static comp_stat
+compile_colon(comp_context_t * comp_ctx, mk_context_t * ctx) {
+    if(comp_ctx->defining || comp_ctx->evaluating) {
+        return stat_DefSyntax;  /* Definitions can't be nested */
+    }
+    comp_ctx->defPos = comp_ctx->cursor;
+    comp_ctx->ctlBase = comp_ctx->ctlDepth;
+    /* Consume the `:` then find the name that follows it */
+    comp_stat status = lex_advance_past_word(comp_ctx);
+    if(status == stat_OK) {
+        status = lex_skip_whitespace(comp_ctx);
+    }
+    if(status != stat_OK) {
+        return stat_NameSyntax;
+    }
+    status = lex_locate_end_of_word(comp_ctx);
+    if(status != stat_OK) {
+        return status;
+    }
+    const u8 * name = _word_pointer(comp_ctx);
+    u32 length = _word_length(comp_ctx);
+    if(length > MK_NAME_MAX) {
+        return stat_NameSyntax;
+    }
+    u16 n = comp_dict_find(comp_ctx->dict, name, length, 1);
+    if(n == 0) {
+        return stat_DictFull;
+    }
+    /* Compile a JMP with placeholder offset to skip over the definition */
+    _assert_dictionary_free_space(3);
+    _append_dictionary_byte(MK_JMP);
+    comp_ctx->defJump = ctx->DP;
+    _append_dictionary_byte(0);
+    _append_dictionary_byte(0);
+    comp_ctx->defining = 1;
+    comp_ctx->lastCall = 0;
+    comp_sym_t * sym = &comp_ctx->dict->syms[n - 1];
+    sym->immediate = 0;
+    comp_ctx->lastDef = n;
+    if(comp_ctx->mode == MK_comp_ModeHot) {
+        if(sym->defined) {
+            /* Redefinition: leave the old body running until the caller */
+            /* patches the word's stub to point at this new body         */
+            sym->pending = ctx->DP;
+            return lex_advance_past_word(comp_ctx);
+        }
+        /* New word: callers JAL to a stub that jumps to the current body */
+        _assert_dictionary_free_space(3);
+        sym->addr = ctx->DP;
+        _append_dictionary_byte(MK_JMP);
+        _append_dictionary_byte(2);  /* Body starts right after the stub */
+        _append_dictionary_byte(0);
+    } else {
+        /* Redefinitions shadow the old address from here on */
+        sym->addr = ctx->DP;
+    }
+    if(!sym->defined) {
+        sym->defined = 1;
+        resolve_fixups(ctx, comp_ctx->dict, n - 1, sym->addr);
+    }
+    return lex_advance_past_word(comp_ctx);
+}
+
+/* Compile the `;` at the end of a definition */
+static comp_stat
+compile_semicolon(comp_context_t * comp_ctx, mk_context_t * ctx) {
+    if(!comp_ctx->defining) {
+        return stat_DefSyntax;  /* `;` without matching `:` */
+    }
+    _assert_dictionary_free_space(1);
+    if(comp_ctx->lastCall != 0 && comp_ctx->lastCall + 3 == ctx->DP) {
+        /* Tail call optimization: turn the final JAL into a JMP so the */
+        /* called word returns directly to our caller.                  */
+        ctx->RAM[comp_ctx->lastCall] = MK_JMP;
+    } else {
+        _append_dictionary_byte(MK_RET);
+    }
+    if(comp_ctx->ctlDepth > comp_ctx->ctlBase) {
+        /* Inside an if{ or for{, `;` is an early return, like in the repl2 */
+        /* kernel, so the definition keeps going                            */
+        comp_ctx->lastCall = 0;
+        return lex_advance_past_word(comp_ctx);
+    }
+    /* Patch the JMP at the start of the definition to skip past it */
+    patch_rel16(ctx, comp_ctx->defJump, ctx->DP);
+    comp_ctx->defining = 0;
+    comp_ctx->lastCall = 0;
+    return lex_advance_past_word(comp_ctx);
+}
+
+
+/* Push a control structure onto the compile-time control stack */
+static comp_stat
+ctl_push(comp_context_t * comp_ctx, u8 kind, u16 addr) {
+    if(comp_ctx->ctlDepth >= MK_comp_CtlMax) {
+        return stat_CtlSyntax;  /* Nested too deep */
+    }
+    comp_ctx->ctlKind[comp_ctx->ctlDepth] = kind;
+    comp_ctx->ctlAddr[comp_ctx->ctlDepth] = addr;
+    comp_ctx->ctlPos[comp_ctx->ctlDepth] = comp_ctx->cursor;
+    comp_ctx->ctlDepth += 1;
+    return stat_OK;
+}
+
+/* Pop a control structure of the given kind from the control stack. This */
+/* fails if the structure doesn't match, or if it was opened outside of   */
+/* the definition that is currently being compiled.                       */
+static comp_stat
+ctl_pop(comp_context_t * comp_ctx, u8 kind, u16 * addr) {
+    const u8 base = comp_ctx->defining ? comp_ctx->ctlBase : 0;
+    if(comp_ctx->ctlDepth <= base
+        || comp_ctx->ctlKind[comp_ctx->ctlDepth - 1] != kind) {
+        return stat_CtlSyntax;
+    }
+    comp_ctx->ctlDepth -= 1;
+    *addr = comp_ctx->ctlAddr[comp_ctx->ctlDepth];
+    /* A JAL just before a branch target can't be turned into a tail call */
+    comp_ctx->lastCall = 0;
+    return stat_OK;
+}
+
+/* Compile `if{`: BZL with a placeholder offset to skip the block if      */
+/* T == 0. The length of the block isn't known yet, and code can't be moved */
+/* later because calls in it are PC-relative, so this always uses the long */
+/* form.                                                                    */
+static comp_stat
+compile_if(comp_context_t * comp_ctx, mk_context_t * ctx) {
+    _assert_dictionary_free_space(3);
+    _append_dictionary_byte(MK_BZL);
+    comp_stat status = ctl_push(comp_ctx, MK_comp_CtlIf, ctx->DP);
+    _append_dictionary_byte(0);
+    _append_dictionary_byte(0);
+    return status;
+}
+
+/* Compile `}if`: patch the matching BZL to branch here */
+static comp_stat
+compile_end_if(comp_context_t * comp_ctx, mk_context_t * ctx) {
+    u16 site;
+    comp_stat status = ctl_pop(comp_ctx, MK_comp_CtlIf, &site);
+    if(status != stat_OK) {
+        return status;
+    }
+    /* BZL adds its offset to the address of the offset's first byte */
+    const u16 n = ctx->DP - site;
+    ctx->RAM[site] = (u8) n;
+    ctx->RAM[site + 1] = (u8) (n >> 8);
+    return stat_OK;
+}
+
+/* Compile `for{`: move loop count from T to R, then start the loop body */
+static comp_stat
+compile_for(comp_context_t * comp_ctx, mk_context_t * ctx) {
+    _assert_dictionary_free_space(1);
+    _append_dictionary_byte(MK_MTR);
+    return ctl_push(comp_ctx, MK_comp_CtlFor, ctx->DP);
+}
+
+/* Compile `}for`: decrement R and branch back to the start of the loop   */
+/* body while R > 0. Use the short BFOR form if the offset fits in a u8.  */
+static comp_stat
+compile_end_for(comp_context_t * comp_ctx, mk_context_t * ctx) {
+    u16 start;
+    comp_stat status = ctl_pop(comp_ctx, MK_comp_CtlFor, &start);
+    if(status != stat_OK) {
+        return status;
+    }
+    _assert_dictionary_free_space(3);
+    /* BFOR and BFORL subtract their offset from the address of the offset */
+    const u16 n = ctx->DP + 1 - start;
+    if(n <= 255) {
+        _append_dictionary_byte(MK_BFOR);
+        _append_dictionary_byte((u8) n);
+    } else {
+        _append_dictionary_byte(MK_BFORL);
+        _append_dictionary_byte((u8) n);
+        _append_dictionary_byte((u8) (n >> 8));
+    }
+    return stat_OK;
+}
+
+/* Run code from ctx.RAM[start..DP] in a scratch copy of the VM so its side  */
+/* effects can't leak into the image being compiled. Then remove that code  */
+/* from the image. On success, scratch holds the VM state after running.    */
+static comp_stat
+eval_span(comp_context_t * comp_ctx, mk_context_t * ctx, u16 start,
+    mk_context_t * scratch) {
+    comp_dict_t * dict = comp_ctx->dict;
+    u16 i;
+    /* Code that calls words which aren't defined yet can't be run */
+    for(i = 0; i < dict->fixupCount; i++) {
+        if(dict->fixups[i].site >= start) {
+            seek_source_position(comp_ctx, dict->fixups[i].srcPos);
+            return stat_UnknownWord;
+        }
+    }
+    _assert_dictionary_free_space(1);
+    _append_dictionary_byte(MK_HALT);
+    *scratch = *ctx;
+    scratch->DSDeep = 0;
+    scratch->RSDeep = 0;
+    scratch->PC = start;
+    scratch->halted = 0;
+    scratch->err = MK_ERR_OK;
+    autogen_run(scratch, MK_comp_EvalCycles);
+    /* Erase the compile-time code */
+    memset((void *)&ctx->RAM[start], MK_NOP, ctx->DP - start);
+    ctx->DP = start;
+    comp_ctx->lastCall = 0;
+    if(scratch->err != MK_ERR_OK) {
+        return stat_EvalError;
+    }
+    return stat_OK;
+}
+
+/* Compile the values on scratch's data stack as literals, deepest first */
+static comp_stat
+compile_eval_results(mk_context_t * ctx, const mk_context_t * scratch) {
+    u32 i;
+    for(i = 0; i < scratch->DSDeep; i++) {
+        i32 n = scratch->DStack[i];
+        if(i + 1 == scratch->DSDeep) {
+            n = scratch->T;
+        } else if(i + 2 == scratch->DSDeep) {
+            n = scratch->S;
+        }
+        comp_stat status = compile_int_literal(ctx, n);
+        if(status != stat_OK) {
+            return status;
+        }
+    }
+    return stat_OK;
+}
+
+/* Compile `[`: start compiling code to be run at compile time */
+static comp_stat
+compile_eval_start(comp_context_t * comp_ctx, mk_context_t * ctx) {
+    if(comp_ctx->evaluating) {
+        return stat_EvalSyntax;  /* Brackets can't be nested */
+    }
+    comp_ctx->evaluating = 1;
+    comp_ctx->evalStart = ctx->DP;
+    comp_ctx->evalCtlDepth = comp_ctx->ctlDepth;
+    comp_ctx->evalPos = comp_ctx->cursor;
+    return stat_OK;
+}
+
+/* Check that `]` or `]bytes` closes a `[` with balanced control structures */
+static comp_stat
+eval_check_end(comp_context_t * comp_ctx) {
+    if(!comp_ctx->evaluating) {
+        return stat_EvalSyntax;
+    }
+    if(comp_ctx->ctlDepth != comp_ctx->evalCtlDepth) {
+        return stat_CtlSyntax;
+    }
+    comp_ctx->evaluating = 0;
+    return stat_OK;
+}
+
+/* Compile `]`: run the code since `[`, then compile its results as literals */
+static comp_stat
+compile_eval_end(comp_context_t * comp_ctx, mk_context_t * ctx) {
+    comp_stat status = eval_check_end(comp_ctx);
+    if(status == stat_OK) {
+        status = eval_span(comp_ctx, ctx, comp_ctx->evalStart, &COMP_SCRATCH);
+    }
+    if(status == stat_OK) {
+        status = compile_eval_results(ctx, &COMP_SCRATCH);
+    }
+    return status;
+}
+
+/* Compile `]bytes`: run the code since `[`, which must leave ( addr len ),  */
+/* then compile len bytes from the scratch VM's RAM at addr as a string     */
+/* literal data block. At runtime, the block pushes its address like "...". */
+static comp_stat
+compile_eval_end_bytes(comp_context_t * comp_ctx, mk_context_t * ctx) {
+    const mk_context_t * scratch = &COMP_SCRATCH;
+    comp_stat status = eval_check_end(comp_ctx);
+    if(status == stat_OK) {
+        status = eval_span(comp_ctx, ctx, comp_ctx->evalStart, &COMP_SCRATCH);
+    }
+    if(status != stat_OK) {
+        return status;
+    }
+    const i32 addr = scratch->S;
+    const i32 len = scratch->T;
+    if(scratch->DSDeep != 2 || len < 0 || len > 255 || addr < 0
+        || addr + len > MK_RamMax + 1) {
+        return stat_EvalError;
+    }
+    _assert_dictionary_free_space(2 + len);
+    _append_dictionary_byte(MK_STR);
+    _append_dictionary_byte((u8) len);
+    memcpy((void *)&ctx->RAM[ctx->DP], (void *)&scratch->RAM[addr], len);
+    ctx->DP += len;
+    return stat_OK;
+}
+
+/* Compile `immediate`: mark the most recent definition to run at compile */
+/* time wherever it gets called, compiling its results as literals.      */
+static comp_stat
+compile_immediate(comp_context_t * comp_ctx) {
+    if(comp_ctx->lastDef == 0 || comp_ctx->defining) {
+        return stat_DefSyntax;
+    }
+    comp_ctx->dict->syms[comp_ctx->lastDef - 1].immediate = 1;
+    return stat_OK;
+}
 
 /* ============ */
 /* == Parser == */
@@ -648,16 +1130,34 @@ parse_int(comp_context_t *comp_ctx, mk_context_t * ctx) {
     }
 }
 
+/* Parse a word that isn't built in by compiling a call to it */
 static comp_stat
 parse_dictionary_word(comp_context_t * comp_ctx, mk_context_t * ctx) {
-    u16 hashmap_bin_offset = 0;
-    int status = hash_name(comp_ctx, &hashmap_bin_offset);
+    _assert_valid_comp_context();
+    const u8 * name = _word_pointer(comp_ctx);
+    u32 length = _word_length(comp_ctx);
+    if(length > MK_NAME_MAX) {
+        return stat_UnknownWord;  /* Too long to have been defined */
+    }
+    /* Calls to names that aren't defined yet get resolved later, either */
+    /* by a definition further down or, for modules, by the linker.       */
+    u16 n = comp_dict_find(comp_ctx->dict, name, length, 1);
+    if(n == 0) {
+        return stat_DictFull;
+    }
+    const u16 start = ctx->DP;
+    comp_stat status = compile_call(comp_ctx, ctx, n - 1);
+    if(status == stat_OK && comp_ctx->dict->syms[n - 1].immediate) {
+        /* Immediate words run now, leaving their results as literals */
+        status = eval_span(comp_ctx, ctx, start, &COMP_SCRATCH);
+        if(status == stat_OK) {
+            status = compile_eval_results(ctx, &COMP_SCRATCH);
+        }
+    }
     if(status != stat_OK) {
         return status;
     }
-    /* TODO: Parse the word */
-
-    return stat_EOF;
+    return lex_advance_past_word(comp_ctx);
 }
 
 /* Parse words that are not int, char, or string literals. */
@@ -722,6 +1222,16 @@ parse_word(comp_context_t * comp_ctx, mk_context_t * ctx) {
         case '.':
             _append_dictionary_byte(MK_DOT);  /* . */
             break;
+        case '[':
+            status = compile_eval_start(comp_ctx, ctx);  /* [ */
+            break;
+        case ']':
+            status = compile_eval_end(comp_ctx, ctx);    /* ] */
+            break;
+        case ':':
+            return compile_colon(comp_ctx, ctx);      /* : */
+        case ';':
+            return compile_semicolon(comp_ctx, ctx);  /* ; */
         default:
             return parse_dictionary_word(comp_ctx, ctx);
         }
@@ -800,6 +1310,12 @@ parse_word(comp_context_t * comp_ctx, mk_context_t * ctx) {
         case ('.' << 16) | ('R' << 8) | 'h':   /* .Rh */
             _append_dictionary_byte(MK_DOTRH);
             break;
+        case ('i' << 16) | ('f' << 8) | '{':   /* if{ */
+            status = compile_if(comp_ctx, ctx);
+            break;
+        case ('}' << 16) | ('i' << 8) | 'f':   /* }if */
+            status = compile_end_if(comp_ctx, ctx);
+            break;
         default:
             return parse_dictionary_word(comp_ctx, ctx);
         }
@@ -827,6 +1343,12 @@ parse_word(comp_context_t * comp_ctx, mk_context_t * ctx) {
         case ('d' << 24) | ('u' << 16) | ('m' << 8) | 'p':  /* dump */
             _append_dictionary_byte(MK_DUMP);
             break;
+        case ('f' << 24) | ('o' << 16) | ('r' << 8) | '{':  /* for{ */
+            status = compile_for(comp_ctx, ctx);
+            break;
+        case ('}' << 24) | ('f' << 16) | ('o' << 8) | 'r':  /* }for */
+            status = compile_end_for(comp_ctx, ctx);
+            break;
         default:
             return parse_dictionary_word(comp_ctx, ctx);
         }
@@ -845,18 +1367,31 @@ parse_word(comp_context_t * comp_ctx, mk_context_t * ctx) {
             break;
         }
         return parse_dictionary_word(comp_ctx, ctx);
+    case 6:
+        if((buf[0]==']') && (buf[1]=='b') && (buf[2]=='y') && (buf[3]=='t')
+            && (buf[4]=='e') && (buf[5]=='s')                /* ]bytes */
+        ) {
+            status = compile_eval_end_bytes(comp_ctx, ctx);
+            break;
+        }
+        return parse_dictionary_word(comp_ctx, ctx);
+    case 9:
+        if((buf[0]=='i') && (buf[1]=='m') && (buf[2]=='m') && (buf[3]=='e')
+            && (buf[4]=='d') && (buf[5]=='i') && (buf[6]=='a') && (buf[7]=='t')
+            && (buf[8]=='e')                                 /* immediate */
+        ) {
+            status = compile_immediate(comp_ctx);
+            break;
+        }
+        return parse_dictionary_word(comp_ctx, ctx);
     default:
         return parse_dictionary_word(comp_ctx, ctx);
     }
-    /* Advance the cursor */
-    if(comp_ctx->wordEnd + 1 < comp_ctx->len) {
-        comp_ctx->wordEnd += 1;
-        comp_ctx->cursor = comp_ctx->wordEnd;
-        return stat_OK;
-    } else {
-        comp_ctx->cursor = comp_ctx->wordEnd;
-        return stat_EOF;
+    if(status != stat_OK) {
+        return status;
     }
+    /* Advance the cursor */
+    return lex_advance_past_word(comp_ctx);
 }
 
 /* Parse words that begin with a hyphen. */
@@ -915,11 +1450,12 @@ parse_token(comp_context_t * comp_ctx, mk_context_t * ctx) {
 /* == Main Entry Point for Compiler == */
 /* =================================== */
 
-/* Compile Markab Script source from text into bytecode in ctx.RAM.       */
-/* Compile error details get logged using mk_host_*() Host API functions. */
-/* Returns: 1 = Success, 0 = Error (details get logged to Host API)       */
-int
-comp_compile_src(mk_context_t *ctx, const u8 * text, u32 text_len) {
+/* Compile source into ctx.RAM at ctx.DP using symbol table dict. In module */
+/* mode, unresolved calls are left in dict.fixups for the linker.          */
+/* Returns: 1 = Success, 0 = Error (details get logged to Host API)         */
+static int
+comp_compile(mk_context_t *ctx, comp_dict_t *dict,
+    const u8 * text, u32 text_len, u8 mode) {
     /* Initialize the compiler context for beginning of the first line */
     comp_context_t comp_ctx = {
         text,      /* .buf         */
@@ -928,6 +1464,22 @@ comp_compile_src(mk_context_t *ctx, const u8 * text, u32 text_len) {
         0,         /* .line_start  */
         0,         /* .word_left   */
         0,         /* .word_right  */
+        dict,      /* .dict        */
+        mode,      /* .mode        */
+        0,         /* .defining    */
+        0,         /* .defJump     */
+        0,         /* .lastCall    */
+        0,         /* .defPos      */
+        0,         /* .ctlBase     */
+        0,         /* .ctlDepth    */
+        {0},       /* .ctlKind     */
+        {0},       /* .ctlAddr     */
+        {0},       /* .ctlPos      */
+        0,         /* .lastDef     */
+        0,         /* .evaluating  */
+        0,         /* .evalStart   */
+        0,         /* .evalCtlDepth */
+        0,         /* .evalPos     */
     };
     /* Loop for long enough to process all the characters of the input text */
     /* Note that one iteration of the loop will typically consume multiple  */
@@ -945,6 +1497,27 @@ comp_compile_src(mk_context_t *ctx, const u8 * text, u32 text_len) {
             break;
         }
     }
+    /* Check for things that can only be detected at the end of input */
+    if(status == stat_OK || status == stat_EOF) {
+        if(comp_ctx.ctlDepth > (comp_ctx.defining ? comp_ctx.ctlBase : 0)) {
+            /* Report the innermost if{ or for{ that is missing its end */
+            seek_source_position(&comp_ctx,
+                comp_ctx.ctlPos[comp_ctx.ctlDepth - 1]);
+            status = stat_CtlSyntax;
+        } else if(comp_ctx.evaluating) {
+            /* Report the `[` that is missing its matching `]` */
+            seek_source_position(&comp_ctx, comp_ctx.evalPos);
+            status = stat_EvalSyntax;
+        } else if(comp_ctx.defining) {
+            /* Report the `:` that is missing its matching `;` */
+            seek_source_position(&comp_ctx, comp_ctx.defPos);
+            status = stat_DefSyntax;
+        } else if(mode != MK_comp_ModeModule && dict->fixupCount > 0) {
+            /* Report the first call to a word that never got defined */
+            seek_source_position(&comp_ctx, dict->fixups[0].srcPos);
+            status = stat_UnknownWord;
+        }
+    }
     switch(status) {
         case stat_OK:   /* Odd, but OK I guess? 0-length input? */
             return 1;
@@ -956,4 +1529,14 @@ comp_compile_src(mk_context_t *ctx, const u8 * text, u32 text_len) {
     }
 }
 
+/* Compile Markab Script source from text into bytecode in ctx.RAM.       */
+/* Compile error details get logged using mk_host_*() Host API functions. */
+/* Returns: 1 = Success, 0 = Error (details get logged to Host API)       */
+int
+comp_compile_src(mk_context_t *ctx, const u8 * text, u32 text_len) {
+    comp_dict_t dict;
+    memset((void *)&dict, 0, sizeof(dict));
+    return comp_compile(ctx, &dict, text, text_len, MK_comp_ModeProgram);
+}
+
 #endif /* LIBMKB_COMP_C */
@@ -13,9 +13,64 @@
 #define MK_comp_HashBins 64
 #define MK_comp_HashMask 63
 
+/* Compiler modes */
+#define MK_comp_ModeProgram (0  /* Undefined words are compile errors */)
+#define MK_comp_ModeModule  (1  /* Undefined words become imports     */)
+#define MK_comp_ModeHot     (2  /* Calls go through per-word JMP stubs */)
+
+/* Control structures (`if{ ... }if`, `for{ ... }for`) */
+#define MK_comp_CtlMax (16  /* Deepest nesting of control structures */)
+#define MK_comp_CtlIf  (1)
+#define MK_comp_CtlFor (2)
+
+/* Cycle budget for running code at compile time with `[ ... ]` or    */
+/* immediate words. Runaway code stops with a compile error.          */
+#ifndef MK_comp_EvalCycles
+#define MK_comp_EvalCycles (1048576)
+#endif
+
+/* Symbol table entry for a word defined with `: name ... ;` */
+typedef struct comp_sym {
+    u8  name[MK_NAME_MAX + 1];  /* Counted string (name[0] is length)  */
+    u16 addr;                   /* Code address (only valid if defined) */
+    u16 next;                   /* Next symbol in hash bin (index + 1)  */
+    u8  defined;                /* 1 = defined, 0 = only referenced     */
+    u8  immediate;              /* 1 = run at compile time when called  */
+    u16 pending;                /* Hot mode: new body waiting for patch */
+} comp_sym_t;
+
+/* Fixup for a JAL whose target word was not defined yet */
+typedef struct comp_fixup {
+    u16 site;    /* Address of the JAL's u16 offset operand          */
+    u16 sym;     /* Index of target symbol in comp_dict_t.syms       */
+    u32 srcPos;  /* Source text position of reference (for errors)   */
+} comp_fixup_t;
+
+/* Symbol table shared by the compiler and the linker */
+typedef struct comp_dict {
+    u16 bins[MK_comp_HashBins];         /* Hash bin heads (index + 1) */
+    u16 symCount;
+    u16 fixupCount;
+    comp_sym_t syms[MK_SYM_MAX];
+    comp_fixup_t fixups[MK_FIXUP_MAX];
+} comp_dict_t;
+
 /* Compile Markab Script source from text into bytecode in ctx.RAM.       */
 /* Compile error details get logged using mk_host_*() Host API functions. */
 /* Returns: 1 = Success, 0 = Error (details get logged to Host API)       */
 int comp_compile_src(mk_context_t *ctx, const u8 * text, u32 text_len);
 
+/* Compile source into ctx.RAM at ctx.DP using symbol table dict. In module */
+/* mode, unresolved calls are left in dict.fixups for the linker. In hot    */
+/* mode, each word starts with a JMP stub, and redefinitions get compiled   */
+/* at DP with their address left in sym.pending for the caller to patch in. */
+/* Returns: 1 = Success, 0 = Error (details get logged to Host API)         */
+static int comp_compile(mk_context_t *ctx, comp_dict_t *dict,
+    const u8 * text, u32 text_len, u8 mode);
+
+/* Find a name in dict, optionally adding it if it's missing.   */
+/* Returns: index + 1 of the symbol, or 0 if not found/no room  */
+static u16 comp_dict_find(comp_dict_t *dict, const u8 * name, u32 length,
+    u8 create);
+
 #endif /* LIBMKB_COMP_H */
@@ -0,0 +1,111 @@
+/* Copyright (c) 2023 Sam Blenny
+ * SPDX-License-Identifier: MIT
+ *
+ * Hot-reload session: recompile word definitions inside a live VM context.
+ *
+ * Words compiled in hot mode start with a 3-byte `JMP rel16` stub, and all
+ * calls to a word go through its stub. That makes the stub the word's entry
+ * in an indirection table. Reloading a word appends its new body at DP, then
+ * rewrites the stub's offset. Since the VM only runs inside mk_hot_init(),
+ * mk_hot_reload(), and mk_hot_call(), the VM is always paused while stubs get
+ * patched, so no call can ever see a half-written offset.
+ */
+#ifndef LIBMKB_HOT_C
+#define LIBMKB_HOT_C
+
+#include "libmkb.h"
+#include "autogen.h"
+#include "comp.h"
+#include "hot.h"
+
+/* There is one live session. It's big, so keep it off the stack. */
+static hot_session_t HOT;
+
+/* Compile text into the session at DP, patch stubs of redefined words to */
+/* their new bodies, then run any top-level code from text.               */
+/* Returns: VM error code, or MK_ERR_COMPILE (session is left unchanged)  */
+static int
+hot_compile_and_run(hot_session_t * hot, const u8 * text, u32 text_len) {
+    mk_context_t * ctx = &hot->ctx;
+    const u16 start = ctx->DP;
+    u16 i;
+    memcpy((void *)&hot->undo, (void *)&hot->dict, sizeof(hot->dict));
+    int ok = comp_compile(ctx, &hot->dict, text, text_len, MK_comp_ModeHot);
+    if(ok && ctx->DP + 1 >= MK_HEAP_MAX) {
+        ok = 0;
+    }
+    if(!ok) {
+        /* Roll back so the old code keeps running as if nothing happened */
+        memset((void *)&ctx->RAM[start], MK_NOP, ctx->DP - start);
+        ctx->DP = start;
+        memcpy((void *)&hot->dict, (void *)&hot->undo, sizeof(hot->dict));
+        return MK_ERR_COMPILE;
+    }
+    /* Swap in the new bodies */
+    for(i = 0; i < hot->dict.symCount; i++) {
+        comp_sym_t * sym = &hot->dict.syms[i];
+        if(sym->pending != 0) {
+            patch_rel16(ctx, sym->addr + 1, sym->pending);
+            sym->pending = 0;
+        }
+    }
+    /* Run top-level code */
+    ctx->RAM[ctx->DP] = MK_HALT;
+    ctx->DP += 1;
+    ctx->PC = start;
+    ctx->RSDeep = 0;
+    ctx->halted = 0;
+    ctx->err = MK_ERR_OK;
+    autogen_step(ctx);
+    return ctx->err;
+}
+
+/* Start a new hot-reload session by compiling text and running its top-level
+ * code. Words defined by text can later be redefined with mk_hot_reload().
+ * Returns: VM error code, or MK_ERR_COMPILE
+ */
+int mk_hot_init(const u8 * text, u32 text_len_bytes) {
+    memset((void *)&HOT, 0, sizeof(HOT));
+    memset((void *)HOT.ctx.RAM, MK_NOP, sizeof(HOT.ctx.RAM));
+    /* Address 0 holds a HALT for mk_hot_call() to return into */
+    HOT.ctx.RAM[0] = MK_HALT;
+    HOT.ctx.DP = 1;
+    int err = hot_compile_and_run(&HOT, text, text_len_bytes);
+    HOT.ready = (err != MK_ERR_COMPILE);
+    return err;
+}
+
+/* Compile text into the running session. Words it redefines switch over to
+ * their new code for all callers, without restarting the VM. Any top-level
+ * code in text runs afterwards. If text has a compile error, the session
+ * keeps running the old code.
+ * Returns: VM error code, or MK_ERR_COMPILE
+ */
+int mk_hot_reload(const u8 * text, u32 text_len_bytes) {
+    if(!HOT.ready) {
+        return MK_ERR_COMPILE;
+    }
+    return hot_compile_and_run(&HOT, text, text_len_bytes);
+}
+
+/* Call a word by name in the running session, allowing it to run for up to
+ * max_cycles VM clock cycles. The data stack carries over between calls.
+ * Returns: VM error code, or MK_ERR_COMPILE if the word is not defined
+ */
+int mk_hot_call(const u8 * name, u32 name_len, u32 max_cycles) {
+    mk_context_t * ctx = &HOT.ctx;
+    const u16 n = HOT.ready ? comp_dict_find(&HOT.dict, name, name_len, 0) : 0;
+    if(n == 0 || !HOT.dict.syms[n - 1].defined) {
+        return MK_ERR_COMPILE;
+    }
+    /* Set up the return stack so the word's RET lands on the HALT at 0 */
+    ctx->R = 0;
+    ctx->RSDeep = 1;
+    ctx->PC = HOT.dict.syms[n - 1].addr;
+    ctx->halted = 0;
+    ctx->err = MK_ERR_OK;
+    autogen_run(ctx, max_cycles);
+    return ctx->err;
+}
+
+#endif /* LIBMKB_HOT_C */
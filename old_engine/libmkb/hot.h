@@ -0,0 +1,24 @@
+/* Copyright (c) 2023 Sam Blenny
+ * SPDX-License-Identifier: MIT
+ *
+ * Hot-reload session: recompile word definitions inside a live VM context.
+ */
+#ifndef LIBMKB_HOT_H
+#define LIBMKB_HOT_H
+
+/* Live session state. Compiling a reload can fail partway through, so a */
+/* copy of the symbol table gets saved first to allow rolling it back.   */
+typedef struct hot_session {
+    mk_context_t ctx;    /* The running VM                       */
+    comp_dict_t dict;    /* Symbol table for words in ctx.RAM    */
+    comp_dict_t undo;    /* Copy of dict from before a reload    */
+    u8 ready;            /* 1 = mk_hot_init() succeeded          */
+} hot_session_t;
+
+/* Compile text into the session at DP, patch stubs of redefined words to */
+/* their new bodies, then run any top-level code from text.               */
+/* Returns: VM error code, or MK_ERR_COMPILE (session is left unchanged)  */
+static int hot_compile_and_run(hot_session_t * hot, const u8 * text,
+    u32 text_len);
+
+#endif /* LIBMKB_HOT_H */
@@ -39,20 +39,47 @@
 /*****************************************************************************/
 /* DIY stdlib replacement: this works around lack of wasm32 standard library */
 /*****************************************************************************/
+#   ifdef __wasm_bulk_memory__
+    /* With the bulk-memory feature (clang -mbulk-memory), these builtins  */
+    /* compile to single memory.copy and memory.fill instructions.        */
     void *memcpy(void *dest, const void *src, unsigned long n) {
-        u32 i;
-        for(i = 0; i < n; i++) {
-            ((u8 *)dest)[i] = ((u8 *)src)[i];
+        return __builtin_memcpy(dest, src, n);
+    }
+    void *memset(void *s, int c, unsigned long n) {
+        return __builtin_memset(s, c, n);
+    }
+#   else
+    /* For the MVP instruction set, go a word at a time when the pointers */
+    /* allow it. Filling 64 KB of VM RAM takes 16k iterations, not 64k.   */
+    typedef uint32_t __attribute__((__may_alias__)) u32_alias;
+    void *memcpy(void *dest, const void *src, unsigned long n) {
+        uint8_t * d = (uint8_t *)dest;
+        const uint8_t * s = (const uint8_t *)src;
+        if((((unsigned long)d | (unsigned long)s) & 3) == 0) {
+            for(; n >= 4; n -= 4, d += 4, s += 4) {
+                *(u32_alias *)d = *(const u32_alias *)s;
+            }
+        }
+        for(; n > 0; n--) {
+            *d++ = *s++;
         }
         return dest;
     }
     void *memset(void *s, int c, unsigned long n) {
-        u32 i;
-        for(i = 0; i < n; i++) {
-            ((u8 *)s)[i] = c;
+        uint8_t * d = (uint8_t *)s;
+        const uint32_t word = (uint8_t)c * 0x01010101UL;
+        for(; n > 0 && ((unsigned long)d & 3) != 0; n--) {
+            *d++ = c;
+        }
+        for(; n >= 4; n -= 4, d += 4) {
+            *(u32_alias *)d = word;
+        }
+        for(; n > 0; n--) {
+            *d++ = c;
         }
         return s;
     }
+#   endif
 /*****************************************************************************/
 #endif
 #include "libmkb.h"
@@ -60,13 +87,18 @@
 #include "op.c"
 #include "vm.c"
 #include "autogen.c"
-#include "comp.c"
+#ifndef MK_NO_COMPILER
+#   include "comp.c"
+#   include "link.c"
+#   include "hot.c"
+#endif
+#include "script.c"
 
 
-/* Load and run a markab VM ROM image.
+/* Copy an image of code_len_bytes into VM RAM, then run it from entry.
  * Returns: value of VM err register (0 means OK, see vm.h for other codes)
  */
-int mk_load_rom(const u8 * code, u32 code_len_bytes) {
+static int load_and_run(const u8 * code, u32 code_len_bytes, u16 entry) {
     mk_context_t ctx = {
         0,       /* DSDEEP */
         0,       /* T */
@@ -94,12 +126,108 @@ int mk_load_rom(const u8 * code, u32 code_len_bytes) {
     if(n < sizeof(ctx.RAM)) {
         memset((void *)(&ctx.RAM[n]), MK_NOP, sizeof(ctx.RAM) - n);
     }
-    /* Start clocking the VM from the boot vector */
+    /* Start clocking the VM from the entry point */
+    ctx.PC = entry;
     autogen_step(&ctx);
     /* Return value of the VM's error register */
     return ctx.err;
 }
 
+/* Load and run a markab VM ROM image.
+ * Returns: value of VM err register (0 means OK, see vm.h for other codes)
+ */
+int mk_load_rom(const u8 * code, u32 code_len_bytes) {
+    /* ROM images always boot from address 0 */
+    return load_and_run(code, code_len_bytes, 0);
+}
+
+/* Hash Markab Script source code for use as a bytecode cache key.
+ * This is 32-bit FNV-1a. It only needs to catch edits to the source, not
+ * resist deliberate collisions, and it's cheap compared to compiling.
+ */
+u32 mk_hash_src(const u8 * text, u32 text_len_bytes) {
+    u32 hash = 2166136261UL;  /* FNV offset basis */
+    u32 i;
+    for(i = 0; i < text_len_bytes; i++) {
+        hash ^= text[i];
+        hash *= 16777619UL;   /* FNV prime */
+    }
+    return hash;
+}
+
+/* Parse the header of a .mkbc cache image, checking that it's intact and
+ * was made by this compiler version.
+ * Returns: MK_ERR_OK or MK_ERR_CACHE
+ */
+static int cache_header(const u8 * cache, u32 cache_len, u16 * entry,
+    u16 * image_len, u32 * hash) {
+    if(cache_len < MK_CACHE_HEADER_LEN) {
+        return MK_ERR_CACHE;
+    }
+    const u8 magic_ok = (cache[0] == 'M') && (cache[1] == 'K') &&
+                        (cache[2] == 'B') && (cache[3] == 'C');
+    if(!magic_ok) {
+        return MK_ERR_CACHE;  /* Corrupt: not a .mkbc file */
+    }
+    const u16 version = cache[4] | (cache[5] << 8);
+    *entry = cache[6] | (cache[7] << 8);
+    *hash = ((u32)cache[8]        | ((u32)cache[9]  <<  8) |
+            ((u32)cache[10] << 16) | ((u32)cache[11] << 24));
+    *image_len = cache[12] | (cache[13] << 8);
+    if(version != MK_COMP_VERSION) {
+        return MK_ERR_CACHE;  /* Stale: compiler has changed */
+    }
+    if(*image_len > MK_HEAP_MAX
+        || *image_len > cache_len - MK_CACHE_HEADER_LEN) {
+        return MK_ERR_CACHE;  /* Corrupt: image is truncated or too big */
+    }
+    return MK_ERR_OK;
+}
+
+/* Load a .mkbc cache image, run it, and return the VM's error code. If the
+ * cache is corrupt, was made by a different compiler version, or its source
+ * hash does not match src_hash, this returns MK_ERR_CACHE without running
+ * anything. In that case, the caller should recompile the source.
+ */
+int mk_load_cache(const u8 * cache, u32 cache_len, u32 src_hash) {
+    u16 entry;
+    u16 image_len;
+    u32 hash;
+    if(cache_header(cache, cache_len, &entry, &image_len, &hash) != MK_ERR_OK
+        || hash != src_hash) {
+        return MK_ERR_CACHE;  /* Stale or corrupt */
+    }
+    return load_and_run(&cache[MK_CACHE_HEADER_LEN], image_len, entry);
+}
+
+/* Load the code from a .mkbc cache image into script slot, without running
+ * it. This doesn't check the source hash, since runtimes that load scripts
+ * this way might not have the source.
+ * Returns: MK_ERR_OK, MK_ERR_CACHE, or MK_ERR_BAD_ADDRESS (bad slot)
+ */
+int mk_script_load_cache(u32 slot, const u8 * cache, u32 cache_len) {
+    u16 entry;
+    u16 image_len;
+    u32 hash;
+    if(cache_header(cache, cache_len, &entry, &image_len, &hash) != MK_ERR_OK
+        || entry > image_len) {
+        return MK_ERR_CACHE;
+    }
+    const int err = mk_script_load(slot, &cache[MK_CACHE_HEADER_LEN],
+        image_len);
+    if(err == MK_ERR_OK) {
+        SCRIPTS[slot].ctx.PC = entry;
+    }
+    return err;
+}
+
+#ifndef MK_NO_COMPILER
+/*
+ * Everything from here down needs the compiler or linker. Runtime-only
+ * builds, which load precompiled .mkbc images, define MK_NO_COMPILER to
+ * leave it all out.
+ */
+
 /* Compile Markab Script source code, run it, and return VM's error code. */
 /* Error code MK_ERR_OK means there were no errrors.                      */
 int mk_compile_and_run(const u8 * text, u32 text_len_bytes) {
@@ -130,4 +258,121 @@ int mk_compile_and_run(const u8 * text, u32 text_len_bytes) {
     return ctx.err;
 }
 
+/* Compile Markab Script source code into a .mkbc cache image, without running
+ * it. On success, *cache_len gets the number of bytes written to cache.
+ * Returns: MK_ERR_OK, MK_ERR_COMPILE, or MK_ERR_CACHE (cache buffer too small)
+ */
+int mk_compile_to_cache(const u8 * text, u32 text_len_bytes,
+    u8 * cache, u32 cache_size, u32 * cache_len) {
+    mk_context_t ctx = {
+        0,       /* DSDEEP */
+        0,       /* T */
+        0,       /* S */
+        {0},     /* DSTACK[] */
+        0,       /* RSDEEP */
+        0,       /* R */
+        {0},     /* RSTACK[] */
+        0,       /* PC */
+        0,       /* DP */
+        {0},     /* RAM */
+        0,       /* halted */
+        0,       /* err */
+    };
+    *cache_len = 0;
+    memset((void *)ctx.RAM, MK_NOP, sizeof(ctx.RAM));
+    if(!comp_compile_src(&ctx, text, text_len_bytes)) {
+        return MK_ERR_COMPILE;
+    }
+    const u16 image_len = ctx.DP;
+    if(cache_size < MK_CACHE_HEADER_LEN + (u32)image_len) {
+        return MK_ERR_CACHE;
+    }
+    const u32 hash = mk_hash_src(text, text_len_bytes);
+    const u16 entry = 0;  /* Compiled code starts running at address 0 */
+    cache[ 0] = 'M';
+    cache[ 1] = 'K';
+    cache[ 2] = 'B';
+    cache[ 3] = 'C';
+    cache[ 4] = (u8)  MK_COMP_VERSION;
+    cache[ 5] = (u8) (MK_COMP_VERSION >> 8);
+    cache[ 6] = (u8)  entry;
+    cache[ 7] = (u8) (entry >> 8);
+    cache[ 8] = (u8)  hash;
+    cache[ 9] = (u8) (hash >>  8);
+    cache[10] = (u8) (hash >> 16);
+    cache[11] = (u8) (hash >> 24);
+    cache[12] = (u8)  image_len;
+    cache[13] = (u8) (image_len >> 8);
+    cache[14] = 0;
+    cache[15] = 0;
+    memcpy((void *)&cache[MK_CACHE_HEADER_LEN], (void *)ctx.RAM, image_len);
+    *cache_len = MK_CACHE_HEADER_LEN + image_len;
+    return MK_ERR_OK;
+}
+
+/* Compile Markab Script source code as a module into a relocatable .mkbo
+ * object. Words that the module calls but does not define become imports.
+ * On success, *obj_len gets the number of bytes written to obj.
+ * Returns: MK_ERR_OK, MK_ERR_COMPILE, or MK_ERR_LINK (obj buffer too small)
+ */
+int mk_compile_module(const u8 * text, u32 text_len_bytes,
+    u8 * obj, u32 obj_size, u32 * obj_len) {
+    mk_context_t ctx = {
+        0,       /* DSDEEP */
+        0,       /* T */
+        0,       /* S */
+        {0},     /* DSTACK[] */
+        0,       /* RSDEEP */
+        0,       /* R */
+        {0},     /* RSTACK[] */
+        0,       /* PC */
+        0,       /* DP */
+        {0},     /* RAM */
+        0,       /* halted */
+        0,       /* err */
+    };
+    comp_dict_t dict;
+    *obj_len = 0;
+    memset((void *)ctx.RAM, MK_NOP, sizeof(ctx.RAM));
+    memset((void *)&dict, 0, sizeof(dict));
+    /* Modules always get compiled for base address 0 */
+    if(!comp_compile(&ctx, &dict, text, text_len_bytes, MK_comp_ModeModule)) {
+        return MK_ERR_COMPILE;
+    }
+    const u32 hash = mk_hash_src(text, text_len_bytes);
+    if(!link_write_obj(&ctx, &dict, hash, obj, obj_size, obj_len)) {
+        *obj_len = 0;
+        return MK_ERR_LINK;
+    }
+    return MK_ERR_OK;
+}
+
+/* Check if obj is a valid .mkbo object compiled by this compiler version */
+/* from source with hash src_hash. Returns: 1 = current, 0 = stale        */
+int mk_obj_is_current(const u8 * obj, u32 obj_len, u32 src_hash) {
+    if(link_check_header(obj, obj_len) < 0) {
+        return 0;
+    }
+    const u32 hash = ((u32)obj[8]        | ((u32)obj[9]  <<  8) |
+                     ((u32)obj[10] << 16) | ((u32)obj[11] << 24));
+    return hash == src_hash;
+}
+
+/* Link .mkbo objects into one ROM image, laid out in the order given. Code
+ * runs from address 0 and falls through from each module's top-level code
+ * into the next, so put libraries first and the main program last.
+ * On success, *rom_len gets the number of bytes written to rom.
+ * Returns: MK_ERR_OK or MK_ERR_LINK (details get logged to Host API)
+ */
+int mk_link(const u8 * const * objs, const u32 * obj_lens, u32 obj_count,
+    u8 * rom, u32 rom_size, u32 * rom_len) {
+    *rom_len = 0;
+    if(!link_objs(objs, obj_lens, obj_count, rom, rom_size, rom_len)) {
+        *rom_len = 0;
+        return MK_ERR_LINK;
+    }
+    return MK_ERR_OK;
+}
+#endif /* MK_NO_COMPILER */
+
 #endif /* LIBMKB_C */
@@ -68,12 +68,99 @@ typedef struct mk_str {
 #define MK_ERR_DIV_BY_ZERO  (8  /* Divide by zero */)
 #define MK_ERR_DIV_OVERFLOW (9  /* Quotient would overflow */)
 #define MK_ERR_COMPILE      (10 /* Compiler error */)
+#define MK_ERR_CACHE        (11 /* Bytecode cache is stale or corrupt */)
+#define MK_ERR_LINK         (12 /* Linker error */)
+
+
+/* ============================== */
+/* == Compiler symbol limits   == */
+/* ============================== */
+
+#define MK_NAME_MAX   (31   /* Longest name for a `: name ... ;` word */)
+#define MK_SYM_MAX    (512  /* Most names per compile or link         */)
+#define MK_FIXUP_MAX  (512  /* Most forward or imported call sites    */)
+
+
+/* ============================== */
+/* == Resumable script slots   == */
+/* ============================== */
+
+/* Most scripts that can be loaded at once. Each one has its own VM context. */
+#ifndef MK_SCRIPT_MAX
+#define MK_SCRIPT_MAX (8)
+#endif
+
+/* Scripts share state with their host through the 1024 bytes of RAM above
+ * the heap. The host decides what goes there (see mk_script_io()).
+ */
+#define MK_SCRIPT_IO     (MK_HEAP_MAX + 1)
+#define MK_SCRIPT_IO_LEN (MK_MEM_MAX - MK_HEAP_MAX)
+
+/* Script slot states */
+#define MK_SCRIPT_EMPTY  (0  /* Nothing loaded */)
+#define MK_SCRIPT_READY  (1  /* Runs or resumes on next mk_script_run() */)
+#define MK_SCRIPT_DONE   (2  /* Halted at the end of its code */)
+#define MK_SCRIPT_FAILED (3  /* Stopped by a VM error */)
+
+
+/* ============================================ */
+/* == Compiled bytecode cache (.mkbc) format == */
+/* ============================================ */
+
+/* Compiler version number gets stored in cache headers. Bump this whenever
+ * opcode numbering or code generation changes so old .mkbc files get
+ * rejected as stale instead of running with the wrong meaning.
+ */
+#define MK_COMP_VERSION (4)
+
+/* Cache file layout (all integers are little-endian):
+ *   offset  0: 'M' 'K' 'B' 'C'   magic number
+ *   offset  4: u16               compiler version (MK_COMP_VERSION)
+ *   offset  6: u16               entry point (initial PC)
+ *   offset  8: u32               source hash (see mk_hash_src())
+ *   offset 12: u16               image length (DP at end of compile)
+ *   offset 14: u16               reserved (0)
+ *   offset 16: u8[image length]  compiled RAM image from address 0 to DP
+ */
+#define MK_CACHE_HEADER_LEN (16)
+#define MK_CACHE_MAX_LEN    (MK_CACHE_HEADER_LEN + MK_HEAP_MAX)
+
+
+/* ============================================= */
+/* == Relocatable module object (.mkbo) format == */
+/* ============================================= */
+
+/* Object file layout (all integers are little-endian):
+ *   offset  0: 'M' 'K' 'B' 'O'   magic number
+ *   offset  4: u16               compiler version (MK_COMP_VERSION)
+ *   offset  6: u16               code length
+ *   offset  8: u32               source hash (see mk_hash_src())
+ *   offset 12: u16               export count
+ *   offset 14: u16               import count
+ *   offset 16: u8[code length]   code compiled for base address 0
+ *   then:      export records    {u8 name_len, name, u16 code offset}
+ *   then:      import records    {u8 name_len, name, u16 JAL/JMP operand}
+ *
+ * Code in a module is position independent (calls are PC-relative JAL), so
+ * the linker only needs to patch the operands listed in the import records.
+ */
+#define MK_OBJ_HEADER_LEN (16)
+#define MK_OBJ_RECORD_MAX (1 + MK_NAME_MAX + 2)
+#define MK_OBJ_MAX_LEN    (MK_OBJ_HEADER_LEN + MK_HEAP_MAX + \
+                           (MK_SYM_MAX + MK_FIXUP_MAX) * MK_OBJ_RECORD_MAX)
 
 
 /* ==================================================== */
 /* == Public Interface: Functions provided by libmkb == */
 /* ==================================================== */
 
+/* Runtime-only builds of libmkb (compiled with MK_NO_COMPILER defined) leave
+ * out the compiler, linker, and hot-reload code. That drops mk_compile_*(),
+ * mk_obj_is_current(), mk_link(), mk_hot_*(), and mk_script_compile(), but
+ * precompiled code can still be loaded with mk_load_rom(), mk_load_cache(),
+ * mk_script_load(), or mk_script_load_cache().
+ */
+
 /* Load code (a rom image) into RAM, run it, and return VM's error code. */
 /* Error code MK_ERR_OK means there were no errrors.                     */
 int mk_load_rom(const u8 * code, u32 code_len_bytes);
@@ -82,6 +169,102 @@ int mk_load_rom(const u8 * code, u32 code_len_bytes);
 /* Error code MK_ERR_OK means there were no errrors.                      */
 int mk_compile_and_run(const u8 * text, u32 text_len_bytes);
 
+/* Hash Markab Script source code for use as a bytecode cache key. */
+u32 mk_hash_src(const u8 * text, u32 text_len_bytes);
+
+/* Compile Markab Script source code into a .mkbc cache image, without running
+ * it. On success, *cache_len gets the number of bytes written to cache.
+ * Returns: MK_ERR_OK, MK_ERR_COMPILE, or MK_ERR_CACHE (cache buffer too small)
+ */
+int mk_compile_to_cache(const u8 * text, u32 text_len_bytes,
+    u8 * cache, u32 cache_size, u32 * cache_len);
+
+/* Load a .mkbc cache image, run it, and return the VM's error code. If the
+ * cache is corrupt, was made by a different compiler version, or its source
+ * hash does not match src_hash, this returns MK_ERR_CACHE without running
+ * anything. In that case, the caller should recompile the source.
+ */
+int mk_load_cache(const u8 * cache, u32 cache_len, u32 src_hash);
+
+/* Compile Markab Script source code as a module into a relocatable .mkbo
+ * object. Words that the module calls but does not define become imports.
+ * On success, *obj_len gets the number of bytes written to obj.
+ * Returns: MK_ERR_OK, MK_ERR_COMPILE, or MK_ERR_LINK (obj buffer too small)
+ */
+int mk_compile_module(const u8 * text, u32 text_len_bytes,
+    u8 * obj, u32 obj_size, u32 * obj_len);
+
+/* Check if obj is a valid .mkbo object compiled by this compiler version */
+/* from source with hash src_hash. Returns: 1 = current, 0 = stale        */
+int mk_obj_is_current(const u8 * obj, u32 obj_len, u32 src_hash);
+
+/* Link .mkbo objects into one ROM image, laid out in the order given. Code
+ * runs from address 0 and falls through from each module's top-level code
+ * into the next, so put libraries first and the main program last.
+ * On success, *rom_len gets the number of bytes written to rom.
+ * Returns: MK_ERR_OK or MK_ERR_LINK (details get logged to Host API)
+ */
+int mk_link(const u8 * const * objs, const u32 * obj_lens, u32 obj_count,
+    u8 * rom, u32 rom_size, u32 * rom_len);
+
+
+/* Start a new hot-reload session by compiling text and running its top-level
+ * code. Words defined by text can later be redefined with mk_hot_reload().
+ * Returns: VM error code, or MK_ERR_COMPILE
+ */
+int mk_hot_init(const u8 * text, u32 text_len_bytes);
+
+/* Compile text into the running session. Words it redefines switch over to
+ * their new code for all callers, without restarting the VM. Any top-level
+ * code in text runs afterwards. If text has a compile error, the session
+ * keeps running the old code.
+ * Returns: VM error code, or MK_ERR_COMPILE
+ */
+int mk_hot_reload(const u8 * text, u32 text_len_bytes);
+
+/* Call a word by name in the running session, allowing it to run for up to
+ * max_cycles VM clock cycles. The data stack carries over between calls.
+ * Returns: VM error code, or MK_ERR_COMPILE if the word is not defined
+ */
+int mk_hot_call(const u8 * name, u32 name_len, u32 max_cycles);
+
+
+/* Load a rom image into script slot. The code must fit below MK_SCRIPT_IO.
+ * Returns: MK_ERR_OK or MK_ERR_BAD_ADDRESS (bad slot or code too long)
+ */
+int mk_script_load(u32 slot, const u8 * code, u32 code_len_bytes);
+
+/* Load the code from a .mkbc cache image into script slot, without running
+ * it. This doesn't check the source hash, since runtimes that load scripts
+ * this way might not have the source.
+ * Returns: MK_ERR_OK, MK_ERR_CACHE, or MK_ERR_BAD_ADDRESS (bad slot)
+ */
+int mk_script_load_cache(u32 slot, const u8 * cache, u32 cache_len);
+
+/* Compile Markab Script source into script slot, without running it.
+ * Returns: MK_ERR_OK, MK_ERR_COMPILE, or MK_ERR_BAD_ADDRESS (bad slot)
+ */
+int mk_script_compile(u32 slot, const u8 * text, u32 text_len_bytes);
+
+/* Run the script in slot for up to max_cycles VM clock cycles. A script that
+ * runs out of cycles gets suspended mid-code, then the next call resumes it.
+ * The `halt` opcode yields, so the next call resumes after the `halt`, unless
+ * it was the last byte of code, which means the script is done.
+ * Returns: number of cycles used (0 unless slot is MK_SCRIPT_READY)
+ */
+u32 mk_script_run(u32 slot, u32 max_cycles);
+
+/* Returns: state of script slot (MK_SCRIPT_EMPTY, MK_SCRIPT_READY, ...) */
+int mk_script_state(u32 slot);
+
+/* Returns: VM error code of script slot (for when state is failed) */
+int mk_script_err(u32 slot);
+
+/* Returns: Pointer to the MK_SCRIPT_IO_LEN bytes of shared RAM for script
+ * slot, or 0 if slot is not valid. The host can read and write this
+ * between calls to mk_script_run().
+ */
+u8 * mk_script_io(u32 slot);
 
 /* ======================================================================== */
 /* == Public Interface: Functions libmkb expects its front end to export == */
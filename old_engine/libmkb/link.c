@@ -0,0 +1,234 @@
+/* Copyright (c) 2023 Sam Blenny
+ * SPDX-License-Identifier: MIT
+ *
+ * Write relocatable module objects and link them into ROM images.
+ *
+ * Modules get compiled separately with base address 0. Since JAL and JMP use
+ * PC-relative offsets, code within a module keeps working wherever the linker
+ * puts it. The only things that need patching are calls from one module to
+ * words defined in another module, which the compiler leaves as imports.
+ */
+#ifndef LIBMKB_LINK_C
+#define LIBMKB_LINK_C
+
+#include "libmkb.h"
+#include "comp.h"
+#include "link.h"
+
+
+/* ============ */
+/* == Macros == */
+/* ============ */
+
+/* Macro: Make sure obj buffer has room for N more bytes at pos          */
+/* CAUTION! This will cause enclosing function to return if check fails */
+#define _assert_obj_free_space(N)  \
+    if(pos + (N) > obj_size) {      \
+        return 0;                   \
+    }
+
+/* Macro: Append u16 N to obj buffer in little-endian byte order */
+#define _append_obj_u16(N) {         \
+    obj[pos    ] = (u8)  (N);        \
+    obj[pos + 1] = (u8) ((N) >> 8);  \
+    pos += 2;                        }
+
+/* Macro: Read little-endian u16 from buffer BUF at index I */
+#define _read_u16(BUF, I) ((u16)((BUF)[(I)] | ((BUF)[(I) + 1] << 8)))
+
+
+/* ======================= */
+/* == Utility Functions == */
+/* ======================= */
+
+/* Log linker error using the libmkb Host API */
+static void
+link_log_error(const char * message, u32 length, const u8 * name, u8 name_len) {
+    mk_host_stdout_write("LinkError: ", 11);
+    mk_host_stdout_write(message, length);
+    if(name_len > 0) {
+        mk_host_stdout_write(" ", 1);
+        mk_host_stdout_write(name, name_len);
+    }
+    mk_host_stdout_write("\n", 1);
+}
+
+/* Read a {u8 name_len, name, u16 value} record from obj at *pos.      */
+/* Returns: 1 = Success, 0 = record runs past the end of the object   */
+static int
+link_read_record(const u8 * obj, u32 obj_len, u32 * pos,
+    const u8 ** name, u8 * name_len, u16 * value) {
+    if(*pos + 1 > obj_len) {
+        return 0;
+    }
+    *name_len = obj[*pos];
+    if(*name_len < 1 || *name_len > MK_NAME_MAX
+        || *pos + 1 + *name_len + 2 > obj_len) {
+        return 0;
+    }
+    *name = &obj[*pos + 1];
+    *value = _read_u16(obj, *pos + 1 + *name_len);
+    *pos += 1 + *name_len + 2;
+    return 1;
+}
+
+/* Check an object header. Returns: code length, or -1 if header is bad */
+static i32
+link_check_header(const u8 * obj, u32 obj_len) {
+    if(obj_len < MK_OBJ_HEADER_LEN) {
+        return -1;
+    }
+    const u8 magic_ok = (obj[0] == 'M') && (obj[1] == 'K') &&
+                        (obj[2] == 'B') && (obj[3] == 'O');
+    const u16 code_len = _read_u16(obj, 6);
+    if(!magic_ok || _read_u16(obj, 4) != MK_COMP_VERSION
+        || code_len > obj_len - MK_OBJ_HEADER_LEN) {
+        return -1;
+    }
+    return code_len;
+}
+
+
+/* ===================== */
+/* == Object Writer   == */
+/* ===================== */
+
+/* Serialize compiled module code (ctx.RAM[0..DP]) plus its exports and
+ * imports from dict into .mkbo object format.
+ * Returns: 1 = Success, 0 = obj buffer is too small
+ */
+static int
+link_write_obj(const mk_context_t * ctx, const comp_dict_t * dict,
+    u32 src_hash, u8 * obj, u32 obj_size, u32 * obj_len) {
+    u32 pos = 0;
+    u16 exports = 0;
+    u16 i;
+    for(i = 0; i < dict->symCount; i++) {
+        exports += dict->syms[i].defined;
+    }
+    /* Header */
+    _assert_obj_free_space(MK_OBJ_HEADER_LEN + ctx->DP);
+    obj[0] = 'M';
+    obj[1] = 'K';
+    obj[2] = 'B';
+    obj[3] = 'O';
+    pos = 4;
+    _append_obj_u16(MK_COMP_VERSION);
+    _append_obj_u16(ctx->DP);
+    _append_obj_u16(src_hash);
+    _append_obj_u16(src_hash >> 16);
+    _append_obj_u16(exports);
+    _append_obj_u16(dict->fixupCount);
+    /* Code */
+    memcpy((void *)&obj[pos], (void *)ctx->RAM, ctx->DP);
+    pos += ctx->DP;
+    /* Exports: every defined word, with its code offset */
+    for(i = 0; i < dict->symCount; i++) {
+        const comp_sym_t * sym = &dict->syms[i];
+        if(sym->defined) {
+            _assert_obj_free_space(1 + sym->name[0] + 2);
+            memcpy((void *)&obj[pos], (void *)sym->name, 1 + sym->name[0]);
+            pos += 1 + sym->name[0];
+            _append_obj_u16(sym->addr);
+        }
+    }
+    /* Imports: every unresolved call site, with the name it calls */
+    for(i = 0; i < dict->fixupCount; i++) {
+        const comp_fixup_t * f = &dict->fixups[i];
+        const comp_sym_t * sym = &dict->syms[f->sym];
+        _assert_obj_free_space(1 + sym->name[0] + 2);
+        memcpy((void *)&obj[pos], (void *)sym->name, 1 + sym->name[0]);
+        pos += 1 + sym->name[0];
+        _append_obj_u16(f->site);
+    }
+    *obj_len = pos;
+    return 1;
+}
+
+
+/* ============ */
+/* == Linker == */
+/* ============ */
+
+/* Lay out objects in order into rom, then patch their imports.
+ * Returns: 1 = Success, 0 = Error (details get logged to Host API)
+ */
+static int
+link_objs(const u8 * const * objs, const u32 * obj_lens,
+    u32 obj_count, u8 * rom, u32 rom_size, u32 * rom_len) {
+    comp_dict_t dict;
+    memset((void *)&dict, 0, sizeof(dict));
+    u32 base = 0;
+    u32 i;
+    const u8 * name;
+    u8 name_len;
+    u16 value;
+    /* Pass 1: Copy code into place and collect exports in the dictionary */
+    for(i = 0; i < obj_count; i++) {
+        const u8 * obj = objs[i];
+        const i32 code_len = link_check_header(obj, obj_lens[i]);
+        if(code_len < 0) {
+            link_log_error("BadObject", 9, 0, 0);
+            return 0;
+        }
+        if(base + code_len > MK_HEAP_MAX || base + code_len > rom_size) {
+            link_log_error("RomFull", 7, 0, 0);
+            return 0;
+        }
+        memcpy((void *)&rom[base], (void *)&obj[MK_OBJ_HEADER_LEN], code_len);
+        u32 pos = MK_OBJ_HEADER_LEN + code_len;
+        u16 n = _read_u16(obj, 12);
+        for(; n > 0; n--) {
+            if(!link_read_record(obj, obj_lens[i], &pos, &name, &name_len,
+                &value) || value > code_len) {
+                link_log_error("BadObject", 9, 0, 0);
+                return 0;
+            }
+            const u16 s = comp_dict_find(&dict, name, name_len, 1);
+            if(s == 0) {
+                link_log_error("TooManySymbols", 14, name, name_len);
+                return 0;
+            }
+            if(dict.syms[s - 1].defined) {
+                link_log_error("DuplicateSymbol", 15, name, name_len);
+                return 0;
+            }
+            dict.syms[s - 1].defined = 1;
+            dict.syms[s - 1].addr = base + value;
+        }
+        base += code_len;
+    }
+    /* Pass 2: Patch each module's imports to point at the exports */
+    u32 obj_base = 0;
+    for(i = 0; i < obj_count; i++) {
+        const u8 * obj = objs[i];
+        const u16 code_len = _read_u16(obj, 6);
+        u32 pos = MK_OBJ_HEADER_LEN + code_len;
+        u16 n;
+        /* Skip exports */
+        for(n = _read_u16(obj, 12); n > 0; n--) {
+            link_read_record(obj, obj_lens[i], &pos, &name, &name_len, &value);
+        }
+        for(n = _read_u16(obj, 14); n > 0; n--) {
+            if(!link_read_record(obj, obj_lens[i], &pos, &name, &name_len,
+                &value) || value + 2 > code_len) {
+                link_log_error("BadObject", 9, 0, 0);
+                return 0;
+            }
+            const u16 s = comp_dict_find(&dict, name, name_len, 0);
+            if(s == 0 || !dict.syms[s - 1].defined) {
+                link_log_error("UndefinedSymbol", 15, name, name_len);
+                return 0;
+            }
+            const u16 site = obj_base + value;
+            const u16 offset = dict.syms[s - 1].addr - site;
+            rom[site    ] = (u8)  offset;
+            rom[site + 1] = (u8) (offset >> 8);
+        }
+        obj_base += code_len;
+    }
+    *rom_len = base;
+    return 1;
+}
+
+#endif /* LIBMKB_LINK_C */
@@ -0,0 +1,22 @@
+/* Copyright (c) 2023 Sam Blenny
+ * SPDX-License-Identifier: MIT
+ *
+ * Write relocatable module objects and link them into ROM images.
+ */
+#ifndef LIBMKB_LINK_H
+#define LIBMKB_LINK_H
+
+/* Serialize compiled module code (ctx.RAM[0..DP]) plus its exports and
+ * imports from dict into .mkbo object format.
+ * Returns: 1 = Success, 0 = obj buffer is too small
+ */
+static int link_write_obj(const mk_context_t * ctx, const comp_dict_t * dict,
+    u32 src_hash, u8 * obj, u32 obj_size, u32 * obj_len);
+
+/* Lay out objects in order into rom, then patch their imports.
+ * Returns: 1 = Success, 0 = Error (details get logged to Host API)
+ */
+static int link_objs(const u8 * const * objs, const u32 * obj_lens,
+    u32 obj_count, u8 * rom, u32 rom_size, u32 * rom_len);
+
+#endif /* LIBMKB_LINK_H */
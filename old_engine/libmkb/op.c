@@ -335,6 +335,23 @@ static void op_BZ(mk_context_t * ctx) {
     _drop_T();
 }
 
+/* BZL ( T -- ) Long form of BZ for if{ blocks with more than 255 bytes of */
+/* code. Offset is a u16, so maximum branch distance is +65535.             */
+static void op_BZL(mk_context_t * ctx) {
+    _assert_data_stack_depth_is_at_least(1);
+    _assert_valid_address(ctx->PC + 1);
+    if(ctx->T == 0) {
+        /* Branch forward past conditional block */
+        u16 n = _u16_lit();
+        _assert_valid_address(ctx->PC + n);
+        _adjust_PC_by(n);
+    } else {
+        /* Enter conditional block: Advance PC past address literal */
+        _adjust_PC_by(2);
+    }
+    _drop_T();
+}
+
 /* BNZ ( T -- ) Branch to PC-relative address if T != 0, drop T.           */
 /* The branch address is PC-relative to allow for relocatable object code. */
 /* NOTE: Relative distance has to be positive (+), unlike JMP, JAL, etc.   */
@@ -353,6 +370,40 @@ static void op_BNZ(mk_context_t * ctx) {
     _drop_T();
 }
 
+/* BFOR ( -- ) Decrement R and branch backward to start of loop if R > 0.  */
+/* The branch address is PC-relative to allow for relocatable object code. */
+/* NOTE: Relative distance is subtracted, so the branch can only go back.  */
+static void op_BFOR(mk_context_t * ctx) {
+    _assert_return_stack_depth_is_at_least(1);
+    ctx->R -= 1;
+    if(ctx->R > 0) {
+        /* Keep looping: Subtract address literal from instruction stream */
+        /* from PC. Maximum branch distance is -255.                      */
+        u8 n = _u8_lit();
+        _adjust_PC_by(-n);
+    } else {
+        /* End of loop: Advance PC past address literal, drop R */
+        _adjust_PC_by(1);
+        _drop_R();
+    }
+}
+
+/* BFORL ( -- ) Long form of BFOR for loops with more than 255 bytes of code */
+static void op_BFORL(mk_context_t * ctx) {
+    _assert_return_stack_depth_is_at_least(1);
+    _assert_valid_address(ctx->PC + 1);
+    ctx->R -= 1;
+    if(ctx->R > 0) {
+        /* Keep looping: Maximum branch distance is -65535 */
+        u16 n = _u16_lit();
+        _adjust_PC_by(-n);
+    } else {
+        /* End of loop: Advance PC past address literal, drop R */
+        _adjust_PC_by(2);
+        _drop_R();
+    }
+}
+
 /* JMP ( -- ) Jump to subroutine at address read from instruction stream. */
 /* The jump address is PC-relative to allow for relocatable object code.  */
 static void op_JMP(mk_context_t * ctx) {
@@ -20,6 +20,10 @@ static void op_STR(mk_context_t * ctx);
 
 /* Branch, Jump, Call, Return */
 static void op_BZ(mk_context_t * ctx);
+static void op_BZL(mk_context_t * ctx);
+static void op_BNZ(mk_context_t * ctx);
+static void op_BFOR(mk_context_t * ctx);
+static void op_BFORL(mk_context_t * ctx);
 static void op_JMP(mk_context_t * ctx);
 static void op_JAL(mk_context_t * ctx);
 static void op_RET(mk_context_t * ctx);
@@ -0,0 +1,117 @@
+/* Copyright (c) 2023 Sam Blenny
+ * SPDX-License-Identifier: MIT
+ *
+ * Resumable script slots: VM contexts that run a slice of cycles at a time.
+ *
+ * This is for hosts like a game engine that need to run scripts a little bit
+ * each frame without ever blocking for long. The host gives each script a
+ * cycle budget per frame. When a script uses up its budget, it gets suspended
+ * wherever it happens to be, and the next mk_script_run() picks up from
+ * there. Scripts that finish their work early can yield with `halt`.
+ *
+ * Scripts and their host communicate through the MK_SCRIPT_IO region at the
+ * top of each script's RAM, which the compiler never allocates.
+ */
+#ifndef LIBMKB_SCRIPT_C
+#define LIBMKB_SCRIPT_C
+
+#include "libmkb.h"
+#include "autogen.h"
+#ifndef MK_NO_COMPILER
+#   include "comp.h"
+#endif
+#include "script.h"
+
+/* Script slots are big (64 KB of RAM each), so keep them off the stack */
+static script_slot_t SCRIPTS[MK_SCRIPT_MAX];
+
+/* Clear a slot's VM context so it's ready to receive code at address 0 */
+static void script_reset(script_slot_t * s) {
+    memset((void *)s, 0, sizeof(*s));
+    memset((void *)s->ctx.RAM, MK_NOP, sizeof(s->ctx.RAM));
+    memset((void *)&s->ctx.RAM[MK_SCRIPT_IO], 0, MK_SCRIPT_IO_LEN);
+}
+
+/* Load a rom image into script slot. The code must fit below MK_SCRIPT_IO.
+ * Returns: MK_ERR_OK or MK_ERR_BAD_ADDRESS (bad slot or code too long)
+ */
+int mk_script_load(u32 slot, const u8 * code, u32 code_len_bytes) {
+    if(slot >= MK_SCRIPT_MAX || code_len_bytes >= MK_SCRIPT_IO) {
+        return MK_ERR_BAD_ADDRESS;
+    }
+    script_slot_t * s = &SCRIPTS[slot];
+    script_reset(s);
+    memcpy((void *)s->ctx.RAM, (void *)code, code_len_bytes);
+    /* End with a HALT so code that falls off the end finishes cleanly */
+    s->ctx.RAM[code_len_bytes] = MK_HALT;
+    s->ctx.DP = code_len_bytes + 1;
+    s->end = s->ctx.DP;
+    s->state = MK_SCRIPT_READY;
+    return MK_ERR_OK;
+}
+
+#ifndef MK_NO_COMPILER
+/* Compile Markab Script source into script slot, without running it.
+ * Returns: MK_ERR_OK, MK_ERR_COMPILE, or MK_ERR_BAD_ADDRESS (bad slot)
+ */
+int mk_script_compile(u32 slot, const u8 * text, u32 text_len_bytes) {
+    if(slot >= MK_SCRIPT_MAX) {
+        return MK_ERR_BAD_ADDRESS;
+    }
+    script_slot_t * s = &SCRIPTS[slot];
+    script_reset(s);
+    if(!comp_compile_src(&s->ctx, text, text_len_bytes)
+        || s->ctx.DP + 1 >= MK_HEAP_MAX) {
+        script_reset(s);
+        return MK_ERR_COMPILE;
+    }
+    /* End with a HALT so code that falls off the end finishes cleanly */
+    s->ctx.RAM[s->ctx.DP] = MK_HALT;
+    s->ctx.DP += 1;
+    s->end = s->ctx.DP;
+    s->state = MK_SCRIPT_READY;
+    return MK_ERR_OK;
+}
+#endif /* MK_NO_COMPILER */
+
+/* Run the script in slot for up to max_cycles VM clock cycles. A script that
+ * runs out of cycles gets suspended mid-code, then the next call resumes it.
+ * The `halt` opcode yields, so the next call resumes after the `halt`, unless
+ * it was the last byte of code, which means the script is done.
+ * Returns: number of cycles used (0 unless slot is MK_SCRIPT_READY)
+ */
+u32 mk_script_run(u32 slot, u32 max_cycles) {
+    if(slot >= MK_SCRIPT_MAX || SCRIPTS[slot].state != MK_SCRIPT_READY) {
+        return 0;
+    }
+    script_slot_t * s = &SCRIPTS[slot];
+    mk_context_t * ctx = &s->ctx;
+    ctx->halted = 0;
+    const u32 cycles = autogen_slice(ctx, max_cycles);
+    if(ctx->err != MK_ERR_OK) {
+        s->state = MK_SCRIPT_FAILED;
+    } else if(ctx->halted && ctx->PC == s->end) {
+        s->state = MK_SCRIPT_DONE;
+    }
+    return cycles;
+}
+
+/* Returns: state of script slot (MK_SCRIPT_EMPTY, MK_SCRIPT_READY, ...) */
+int mk_script_state(u32 slot) {
+    return slot < MK_SCRIPT_MAX ? SCRIPTS[slot].state : MK_SCRIPT_EMPTY;
+}
+
+/* Returns: VM error code of script slot (for when state is failed) */
+int mk_script_err(u32 slot) {
+    return slot < MK_SCRIPT_MAX ? SCRIPTS[slot].ctx.err : MK_ERR_OK;
+}
+
+/* Returns: Pointer to the MK_SCRIPT_IO_LEN bytes of shared RAM for script
+ * slot, or 0 if slot is not valid. The host can read and write this
+ * between calls to mk_script_run().
+ */
+u8 * mk_script_io(u32 slot) {
+    return slot < MK_SCRIPT_MAX ? &SCRIPTS[slot].ctx.RAM[MK_SCRIPT_IO] : 0;
+}
+
+#endif /* LIBMKB_SCRIPT_C */
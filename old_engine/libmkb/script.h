@@ -0,0 +1,20 @@
+/* Copyright (c) 2023 Sam Blenny
+ * SPDX-License-Identifier: MIT
+ *
+ * Resumable script slots: VM contexts that run a slice of cycles at a time.
+ */
+#ifndef LIBMKB_SCRIPT_H
+#define LIBMKB_SCRIPT_H
+
+/* One script slot. Everything needed to resume a suspended script lives in */
+/* its VM context, so suspending is just returning from autogen_slice().    */
+typedef struct script_slot {
+    mk_context_t ctx;    /* The script's VM                          */
+    u16 end;             /* Address just past the end of its code    */
+    u8 state;            /* MK_SCRIPT_EMPTY, MK_SCRIPT_READY, ...    */
+} script_slot_t;
+
+/* Clear a slot's VM context so it's ready to receive code at address 0 */
+static void script_reset(script_slot_t * s);
+
+#endif /* LIBMKB_SCRIPT_H */
@@ -2,14 +2,310 @@
  * SPDX-License-Identifier: MIT
  *
  * Markab example CLI front-end
+ *
+ * Usage:
+ *   ./markab              run the built-in hello world rom
+ *   ./markab foo.mkb      compile and run foo.mkb, caching bytecode in
+ *                         foo.mkbc so later runs can skip the compiler
+ *   ./markab -o out.rom a.mkb b.mkb ...
+ *                         compile each module to a.mkbo, b.mkbo, ... (in
+ *                         parallel, skipping modules whose source has not
+ *                         changed), then link them in order into out.rom
+ *   ./markab -r out.rom   run a rom image
  */
+
+#ifndef __MACH__
+/* This unlocks mmap() and friends on Debian since I'm using `clang -ansi`.  */
+/* But _XOPEN_SOURCE 500 on macOS causes trouble, so hide this behind ifdef. */
+#    define _XOPEN_SOURCE 500
+#endif
 #include <stdint.h>         /* uint8_t, uint16_t, int32_t, ... */
 #include <stdio.h>          /* printf(), getchar(), putchar(), ... */
+#include <stdlib.h>         /* malloc(), free() */
+#include <string.h>         /* strlen(), strcmp(), memcpy() */
 #include <unistd.h>         /* STDOUT_FILENO */
+#include <fcntl.h>          /* open() */
+#include <sys/mman.h>       /* mmap(), munmap() */
+#include <sys/stat.h>       /* fstat() */
+#include <pthread.h>        /* pthread_create(), pthread_mutex_lock(), ... */
 #include "libmkb/libmkb.h"
 #include "libmkb/autogen.h"
 
-int main() {
+/* Read a whole file into a malloc'd buffer. Caller must free(*buf).  */
+/* Returns: 1 = Success, 0 = Error (file missing, unreadable, etc)    */
+static int read_file(const char * path, u8 ** buf, u32 * len) {
+    FILE * f = fopen(path, "rb");
+    if(f == NULL) {
+        return 0;
+    }
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    *buf = malloc(size > 0 ? size : 1);
+    if(size < 0 || *buf == NULL || fread(*buf, 1, size, f) != (size_t)size) {
+        fclose(f);
+        free(*buf);
+        *buf = NULL;
+        return 0;
+    }
+    fclose(f);
+    *len = (u32)size;
+    return 1;
+}
+
+/* Try to run cached bytecode from cache_path by mapping it read-only into  */
+/* memory. This skips lexing and parsing entirely.                          */
+/* Returns: VM error code, or MK_ERR_CACHE if the cache is missing/stale    */
+static int run_cached(const char * cache_path, u32 src_hash) {
+    int fd = open(cache_path, O_RDONLY);
+    if(fd < 0) {
+        return MK_ERR_CACHE;
+    }
+    struct stat st;
+    if(fstat(fd, &st) != 0 || st.st_size < MK_CACHE_HEADER_LEN) {
+        close(fd);
+        return MK_ERR_CACHE;
+    }
+    void * map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if(map == MAP_FAILED) {
+        return MK_ERR_CACHE;
+    }
+    int err = mk_load_cache((const u8 *)map, (u32)st.st_size, src_hash);
+    munmap(map, st.st_size);
+    return err;
+}
+
+/* Compile source to a fresh cache file at cache_path, then run it. */
+/* Returns: VM error code                                           */
+static int compile_and_cache(const char * cache_path, const u8 * src,
+    u32 src_len) {
+    u8 * cache = malloc(MK_CACHE_MAX_LEN);
+    u32 cache_len = 0;
+    if(cache == NULL) {
+        return MK_ERR_CACHE;
+    }
+    int err = mk_compile_to_cache(src, src_len, cache, MK_CACHE_MAX_LEN,
+        &cache_len);
+    if(err == MK_ERR_OK) {
+        /* Failing to write the cache is not fatal. It just means the next */
+        /* run will have to compile again.                                 */
+        FILE * f = fopen(cache_path, "wb");
+        if(f != NULL) {
+            fwrite(cache, 1, cache_len, f);
+            fclose(f);
+        }
+        err = mk_load_cache(cache, cache_len, mk_hash_src(src, src_len));
+    }
+    free(cache);
+    return err;
+}
+
+/* Run a Markab Script source file, using foo.mkbc as cache for foo.mkb */
+static int run_script(const char * path) {
+    u8 * src = NULL;
+    u32 src_len = 0;
+    if(!read_file(path, &src, &src_len)) {
+        printf("unable to read %s\n", path);
+        return 1;
+    }
+    /* Cache path is source path with a "c" appended: foo.mkb -> foo.mkbc */
+    size_t path_len = strlen(path);
+    char * cache_path = malloc(path_len + 2);
+    if(cache_path == NULL) {
+        free(src);
+        return 1;
+    }
+    memcpy(cache_path, path, path_len);
+    cache_path[path_len] = 'c';
+    cache_path[path_len + 1] = 0;
+    int err = run_cached(cache_path, mk_hash_src(src, src_len));
+    if(err == MK_ERR_CACHE) {
+        err = compile_and_cache(cache_path, src, src_len);
+    }
+    free(cache_path);
+    free(src);
+    return err;
+}
+
+/* Build job for one module: foo.mkb gets compiled to foo.mkbo */
+typedef struct module_job {
+    const char * src_path;
+    char * obj_path;
+    u8 * obj;        /* Object bytes (malloc'd), valid if ok is set  */
+    u32 obj_len;
+    int ok;
+} module_job_t;
+
+/* Shared work queue for the compiler thread pool */
+typedef struct module_queue {
+    module_job_t * jobs;
+    u32 count;
+    u32 next;        /* Index of next job to claim (guarded by lock) */
+    pthread_mutex_t lock;
+} module_queue_t;
+
+/* Bring one module's object up to date, reusing foo.mkbo if its source */
+/* hash and compiler version still match.                               */
+static void build_module(module_job_t * job) {
+    u8 * src = NULL;
+    u32 src_len = 0;
+    if(!read_file(job->src_path, &src, &src_len)) {
+        printf("unable to read %s\n", job->src_path);
+        return;
+    }
+    const u32 hash = mk_hash_src(src, src_len);
+    if(read_file(job->obj_path, &job->obj, &job->obj_len)) {
+        if(mk_obj_is_current(job->obj, job->obj_len, hash)) {
+            free(src);
+            job->ok = 1;
+            return;
+        }
+        free(job->obj);
+    }
+    job->obj = malloc(MK_OBJ_MAX_LEN);
+    if(job->obj != NULL && MK_ERR_OK == mk_compile_module(src, src_len,
+        job->obj, MK_OBJ_MAX_LEN, &job->obj_len)) {
+        FILE * f = fopen(job->obj_path, "wb");
+        if(f != NULL) {
+            fwrite(job->obj, 1, job->obj_len, f);
+            fclose(f);
+        }
+        job->ok = 1;
+    }
+    free(src);
+}
+
+/* Compiler thread: keep claiming jobs from the queue until it's empty */
+static void * build_worker(void * arg) {
+    module_queue_t * q = (module_queue_t *)arg;
+    for(;;) {
+        pthread_mutex_lock(&q->lock);
+        const u32 i = q->next;
+        q->next += 1;
+        pthread_mutex_unlock(&q->lock);
+        if(i >= q->count) {
+            return NULL;
+        }
+        build_module(&q->jobs[i]);
+    }
+}
+
+/* Compile modules on a pool of threads (one per core, counting this one), */
+/* then link them, in the order given, into a rom image at rom_path.        */
+static int build_rom(const char * rom_path, char ** src_paths, u32 count) {
+    module_queue_t q;
+    pthread_t * threads = NULL;
+    const u8 ** objs = NULL;
+    u32 * obj_lens = NULL;
+    u8 * rom = NULL;
+    u32 rom_len = 0;
+    int err = 1;
+    u32 i;
+    q.jobs = calloc(count, sizeof(module_job_t));
+    q.count = count;
+    q.next = 0;
+    if(q.jobs == NULL) {
+        return 1;
+    }
+    for(i = 0; i < count; i++) {
+        /* Object path is source path with an "o" appended */
+        size_t path_len = strlen(src_paths[i]);
+        q.jobs[i].src_path = src_paths[i];
+        q.jobs[i].obj_path = malloc(path_len + 2);
+        if(q.jobs[i].obj_path == NULL) {
+            goto cleanup;
+        }
+        memcpy(q.jobs[i].obj_path, src_paths[i], path_len);
+        q.jobs[i].obj_path[path_len] = 'o';
+        q.jobs[i].obj_path[path_len + 1] = 0;
+    }
+    if(pthread_mutex_init(&q.lock, NULL) != 0) {
+        goto cleanup;
+    }
+    /* Start the thread pool. This thread works too, so it needs one less */
+    /* than the number of cores. If threads can't be made, just build the */
+    /* modules serially.                                                  */
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    u32 n_threads = (cores <= 1) ? 0 : (cores - 1 > count) ? count
+        : (u32)(cores - 1);
+    threads = malloc((n_threads ? n_threads : 1) * sizeof(pthread_t));
+    u32 started = 0;
+    while(threads != NULL && started < n_threads && 0 == pthread_create(
+        &threads[started], NULL, build_worker, (void *)&q)) {
+        started += 1;
+    }
+    build_worker((void *)&q);
+    for(i = 0; i < started; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    pthread_mutex_destroy(&q.lock);
+    /* Link the objects if they all built */
+    err = MK_ERR_OK;
+    objs = malloc(count * sizeof(u8 *));
+    obj_lens = malloc(count * sizeof(u32));
+    rom = malloc(MK_HEAP_MAX);
+    for(i = 0; i < count && err == MK_ERR_OK; i++) {
+        err = q.jobs[i].ok ? MK_ERR_OK : MK_ERR_COMPILE;
+    }
+    if(objs == NULL || obj_lens == NULL || rom == NULL) {
+        err = MK_ERR_LINK;
+    }
+    if(err == MK_ERR_OK) {
+        for(i = 0; i < count; i++) {
+            objs[i] = q.jobs[i].obj;
+            obj_lens[i] = q.jobs[i].obj_len;
+        }
+        err = mk_link(objs, obj_lens, count, rom, MK_HEAP_MAX, &rom_len);
+    }
+    if(err == MK_ERR_OK) {
+        FILE * f = fopen(rom_path, "wb");
+        if(f == NULL || fwrite(rom, 1, rom_len, f) != rom_len) {
+            printf("unable to write %s\n", rom_path);
+            err = MK_ERR_LINK;
+        }
+        if(f != NULL) {
+            fclose(f);
+        }
+    }
+cleanup:
+    /* calloc() zeroed the jobs, so paths and objects that never got */
+    /* malloc'd are NULL, which free() ignores                       */
+    for(i = 0; i < count; i++) {
+        free(q.jobs[i].obj_path);
+        free(q.jobs[i].obj);
+    }
+    free(q.jobs);
+    free(threads);
+    free((void *)objs);
+    free(obj_lens);
+    free(rom);
+    return err;
+}
+
+/* Run a rom image from a file */
+static int run_rom_file(const char * path) {
+    u8 * rom = NULL;
+    u32 rom_len = 0;
+    if(!read_file(path, &rom, &rom_len)) {
+        printf("unable to read %s\n", path);
+        return 1;
+    }
+    int err = mk_load_rom(rom, rom_len);
+    free(rom);
+    return err;
+}
+
+int main(int argc, char ** argv) {
+    if(argc > 3 && strcmp(argv[1], "-o") == 0) {
+        return build_rom(argv[2], &argv[3], argc - 3);
+    }
+    if(argc == 3 && strcmp(argv[1], "-r") == 0) {
+        return run_rom_file(argv[2]);
+    }
+    if(argc > 1) {
+        return run_script(argv[1]);
+    }
     u8 code[100] = {
         MK_U8, 'h', MK_EMIT,
         MK_U8, 'e', MK_EMIT,
@@ -38,6 +334,7 @@ void mk_host_log_error(u8 error_code) {
 
 /* Write length bytes from byte buffer buf to stdout */
 void mk_host_stdout_write(const void * buf, int length) {
+    fflush(stdout);
     write(1 /* STDOUT */, buf, length);
 }
 
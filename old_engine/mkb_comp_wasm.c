@@ -0,0 +1,50 @@
+/* Copyright (c) 2023 Sam Blenny
+ * SPDX-License-Identifier: MIT
+ *
+ * Markab Script compiler as its own wasm module. The engine module is runtime
+ * only, which keeps it small so it loads fast. Front ends that need to
+ * compile code at runtime, like a live-coding console, can load this module
+ * on demand and pass the .mkbc images it makes to the engine's scriptLoad().
+ *
+ * Note: __attribute__((visibility("default"))) tells LLVM to export a symbol.
+ */
+
+#include <stdint.h>
+#include "libmkb/libmkb.h"  /* u8, u32, i32, ... */
+/* Including C source here lets LLVM optimize the whole module as a single */
+/* translation unit. This should give better results than relying on LTO.  */
+#include "libmkb/libmkb.c"
+
+
+/**************************************/
+/* Exported Symbols: Global Variables */
+/**************************************/
+
+/* Buffer for js to write source into before calling compile() */
+#define COMP_SRC_MAX (16384)
+__attribute__((visibility("default")))
+u8 COMP_SRC[COMP_SRC_MAX];
+
+/* Buffer where compile() puts the .mkbc image */
+__attribute__((visibility("default")))
+u8 COMP_OUT[MK_CACHE_MAX_LEN];
+
+
+/*******************************/
+/* Exported Symbols: Functions */
+/*******************************/
+
+/* Compile len bytes of source from COMP_SRC into a .mkbc image in COMP_OUT. */
+/* The source must end with whitespace, or its last word gets dropped.       */
+/* Compiler errors get reported with the mk_host_*() imports.                */
+/* Returns: length of the image, or 0 if there was an error                  */
+__attribute__((visibility("default")))
+u32 compile(u32 len) {
+    u32 out_len = 0;
+    len = len < COMP_SRC_MAX ? len : COMP_SRC_MAX;
+    if(mk_compile_to_cache(COMP_SRC, len, COMP_OUT, sizeof(COMP_OUT),
+        &out_len) != MK_ERR_OK) {
+        return 0;
+    }
+    return out_len;
+}
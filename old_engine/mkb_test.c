@@ -359,6 +359,26 @@ static void test_BZ(void) {
     _score("test_BZ", code, expected, MK_ERR_OK);
 }
 
+/* Test BZL opcode */
+static void test_BZL(void) {
+    u8 code[] = {
+        MK_STR, 2, 'A', '\n', MK_PRINT,
+        MK_U8, 0, MK_BZL, 7, 0,                /* skip the "B\n" */
+        MK_STR, 2, 'B', '\n', MK_PRINT,
+        MK_STR, 2, 'C', '\n', MK_PRINT,
+        MK_U8, 1, MK_BZL, 7, 0,                /* don't skip the "D\n" */
+        MK_STR, 2, 'D', '\n', MK_PRINT,
+        MK_DOTS, MK_CR,
+        MK_HALT,
+    };
+    char * expected =
+        "A\n"
+        "C\n"
+        "D\n"
+        " Stack is empty\n";
+    _score("test_BZL", code, expected, MK_ERR_OK);
+}
+
 /* Test BNZ opcode */
 static void test_BNZ(void) {
     u8 code[] = {
@@ -381,6 +401,36 @@ static void test_BNZ(void) {
     _score("test_BNZ", code, expected, MK_ERR_OK);
 }
 
+/* Test BFOR opcode */
+static void test_BFOR(void) {
+    u8 code[] = {
+        MK_U8, 3, MK_MTR,
+        MK_R, MK_DOT,                           /* loop body: print R */
+        MK_BFOR, 3,                             /* PC - 3 -> loop body */
+        MK_DOTS, MK_DOTRH, MK_CR,
+        MK_HALT,
+    };
+    char * expected = " 3 2 1 Stack is empty Return stack is empty\n";
+    _score("test_BFOR", code, expected, MK_ERR_OK);
+}
+
+/* Test BFORL opcode */
+static void test_BFORL(void) {
+    u8 code[] = {
+        MK_U8, 2, MK_MTR,
+        MK_R, MK_DOT,                           /* loop body: print R */
+        MK_BFORL, 3, 0,                         /* PC - 3 -> loop body */
+        MK_DOTS, MK_DOTRH, MK_CR,
+        MK_HALT,
+    };
+    char * expected = " 2 1 Stack is empty Return stack is empty\n";
+    _score("test_BFORL", code, expected, MK_ERR_OK);
+    /* BFOR needs a loop counter on the return stack */
+    u8 code2[] = { MK_BFOR, 0, MK_HALT, };
+    _score("test_BFORL_R_UNDER", code2, "ERROR: Return stack underflow\n",
+        MK_ERR_R_UNDER);
+}
+
 /* Test JMP opcode */
 static void test_JMP(void) {
     u8 code[] = {
@@ -2511,6 +2561,441 @@ static void test_cParenComment(void) {
     _score_compiled("test_cParenComment", code, expected, MK_ERR_OK);
 }
 
+/* Test compiled bytecode cache (.mkbc) round trip and staleness checks */
+static void test_cCache(void) {
+    u8 code[] =
+        "\"cached\" print cr\n"
+        "halt\n";
+    char * expected = "cached\n";
+    u8 cache[MK_CACHE_HEADER_LEN + 64];
+    u32 cache_len = 0;
+    u32 hash = mk_hash_src(code, sizeof(code));
+    /* Compiling to cache should not run anything */
+    int err = mk_compile_to_cache(code, sizeof(code), cache, sizeof(cache),
+        &cache_len);
+    if(err != MK_ERR_OK || TEST_STDOUT.len != 0) {
+        score_fail("test_cCacheCompile");
+    } else {
+        score_pass("test_cCacheCompile");
+    }
+    /* Loading with a matching hash should run the cached image */
+    if(MK_ERR_OK != mk_load_cache(cache, cache_len, hash)) {
+        score_fail("test_cCacheLoad");
+    } else if(test_stdout_match(expected)) {
+        score_pass("test_cCacheLoad");
+    } else {
+        score_fail("test_cCacheLoad");
+    }
+    test_stdout_reset();
+    /* Loading with a different source hash should be rejected as stale */
+    err = mk_load_cache(cache, cache_len, hash ^ 1);
+    if(err == MK_ERR_CACHE && TEST_STDOUT.len == 0) {
+        score_pass("test_cCacheStale");
+    } else {
+        score_fail("test_cCacheStale");
+    }
+    test_stdout_reset();
+    /* Truncated images and bad magic numbers should be rejected as corrupt */
+    err = mk_load_cache(cache, cache_len - 1, hash);
+    cache[0] = 'X';
+    if(err == MK_ERR_CACHE && mk_load_cache(cache, cache_len, hash)
+        == MK_ERR_CACHE && TEST_STDOUT.len == 0) {
+        score_pass("test_cCacheCorrupt");
+    } else {
+        score_fail("test_cCacheCorrupt");
+    }
+    test_stdout_reset();
+    /* Cache buffer that is too small for the image should be an error */
+    err = mk_compile_to_cache(code, sizeof(code), cache, MK_CACHE_HEADER_LEN,
+        &cache_len);
+    if(err == MK_ERR_CACHE && cache_len == 0) {
+        score_pass("test_cCacheTooSmall");
+    } else {
+        score_fail("test_cCacheTooSmall");
+    }
+    test_stdout_reset();
+}
+
+
+/* Test colon definitions, forward references, and tail calls */
+static void test_cColonDefs(void) {
+    /* cColonDef: define words and call them, including a forward call */
+    u8 code[] =
+        ": sq dup * ;\n"
+        ": quad sq sq ;\n"
+        ": hi 'h' emit twice ;\n"
+        ": twice 'i' emit 'i' emit cr ;\n"
+        "3 quad . 5 sq . cr hi\n"
+        "halt\n";
+    char * expected = " 81 25\nhii\n";
+    _score_compiled("test_cColonDef", code, expected, MK_ERR_OK);
+
+    /* cColonUnknown: call to a word that never gets defined */
+    u8 code2[] =
+        ": sq dup * ;\n"
+        "2 sq cube .\n"
+        "halt\n";
+    char * expected2 =
+        "CompileError:2:6: UnknownWord\n"
+        "2 sq cu\n"
+        "      ^\n";
+    _score_compiled("test_cColonUnknown", code2, expected2, MK_ERR_COMPILE);
+
+    /* cColonNested: definitions can't be nested */
+    u8 code3[] =
+        ": a : b ;\n"
+        "halt\n";
+    char * expected3 =
+        "CompileError:1:5: DefSyntax\n"
+        ": a : \n"
+        "     ^\n";
+    _score_compiled("test_cColonNested", code3, expected3, MK_ERR_COMPILE);
+
+    /* cColonUnterminated: `:` without matching `;` */
+    u8 code4[] =
+        "1 . : a 1 .\n"
+        "halt\n";
+    char * expected4 =
+        "CompileError:1:5: DefSyntax\n"
+        "1 . : \n"
+        "     ^\n";
+    _score_compiled("test_cColonUnterminated", code4, expected4,
+        MK_ERR_COMPILE);
+}
+
+/* Test compiling modules separately then linking them into one ROM */
+static void test_cLink(void) {
+    u8 lib[] =
+        ": sq dup * ;\n"
+        ": show . cr ;\n";
+    u8 app[] =
+        "7 sq show\n"
+        "2 cube show\n"
+        ": cube dup sq * ;\n"
+        "halt\n";
+    static u8 obj_a[MK_OBJ_HEADER_LEN + 256];
+    static u8 obj_b[MK_OBJ_HEADER_LEN + 256];
+    static u8 rom[512];
+    u32 len_a = 0;
+    u32 len_b = 0;
+    u32 rom_len = 0;
+    /* Compiling modules should work even though app calls words from lib */
+    int err_a = mk_compile_module(lib, sizeof(lib), obj_a, sizeof(obj_a),
+        &len_a);
+    int err_b = mk_compile_module(app, sizeof(app), obj_b, sizeof(obj_b),
+        &len_b);
+    if(err_a != MK_ERR_OK || err_b != MK_ERR_OK || TEST_STDOUT.len != 0
+        || !mk_obj_is_current(obj_a, len_a, mk_hash_src(lib, sizeof(lib)))
+        || mk_obj_is_current(obj_a, len_a, mk_hash_src(app, sizeof(app)))) {
+        score_fail("test_cLinkCompile");
+    } else {
+        score_pass("test_cLinkCompile");
+    }
+    test_stdout_reset();
+    /* Linking should patch app's imports so it can call into lib */
+    const u8 * objs[2];
+    u32 lens[2];
+    objs[0] = obj_a;
+    objs[1] = obj_b;
+    lens[0] = len_a;
+    lens[1] = len_b;
+    int err = mk_link(objs, lens, 2, rom, sizeof(rom), &rom_len);
+    if(err != MK_ERR_OK) {
+        score_fail("test_cLinkRun");
+    } else if(MK_ERR_OK == mk_load_rom(rom, rom_len)
+        && test_stdout_match(" 49\n 8\n")) {
+        score_pass("test_cLinkRun");
+    } else {
+        score_fail("test_cLinkRun");
+    }
+    test_stdout_reset();
+    /* Linking app without lib should fail because sq is undefined */
+    err = mk_link(&objs[1], &lens[1], 1, rom, sizeof(rom), &rom_len);
+    if(err == MK_ERR_LINK && rom_len == 0
+        && test_stdout_match("LinkError: UndefinedSymbol sq\n")) {
+        score_pass("test_cLinkUndefined");
+    } else {
+        score_fail("test_cLinkUndefined");
+    }
+    test_stdout_reset();
+    /* Linking lib twice should fail because of duplicate exports */
+    objs[1] = obj_a;
+    lens[1] = len_a;
+    err = mk_link(objs, lens, 2, rom, sizeof(rom), &rom_len);
+    if(err == MK_ERR_LINK
+        && test_stdout_match("LinkError: DuplicateSymbol sq\n")) {
+        score_pass("test_cLinkDuplicate");
+    } else {
+        score_fail("test_cLinkDuplicate");
+    }
+    test_stdout_reset();
+}
+
+/* Test if{ }if and for{ }for control structures */
+static void test_cControlFlow(void) {
+    /* cIfFor: conditionals, counted loops, nesting, and early return */
+    u8 code[] =
+        ": odd? 1 & if{ 'o' emit ; }if 'e' emit ;\n"
+        ": stars for{ '*' emit }for cr ;\n"
+        "3 for{ r odd? }for cr\n"
+        "3 stars\n"
+        "2 for{ 2 for{ r . }for }for cr\n"
+        "0 if{ \"no\" print }if 1 if{ \"yes\" print cr }if\n"
+        "halt\n";
+    char * expected =
+        "oeo\n"
+        "***\n"
+        " 2 1 2 1\n"
+        "yes\n";
+    _score_compiled("test_cIfFor", code, expected, MK_ERR_OK);
+
+    /* cForLong: loop body too big for BFOR gets compiled with BFORL */
+    u8 code2[] =
+        "2 for{ r .\n"
+        "\"................................................................\"\n"
+        "\"................................................................\"\n"
+        "\"................................................................\"\n"
+        "\"................................................................\"\n"
+        "drop drop drop drop }for cr\n"
+        "halt\n";
+    char * expected2 = " 2 1\n";
+    _score_compiled("test_cForLong", code2, expected2, MK_ERR_OK);
+
+    /* cIfLong: if{ blocks with over 255 bytes of code */
+    u8 code3[] =
+        "0 if{ \"no\" print\n"
+        "\"................................................................\"\n"
+        "\"................................................................\"\n"
+        "\"................................................................\"\n"
+        "\"................................................................\"\n"
+        "drop drop drop drop }if\n"
+        "1 if{ \"yes\" print\n"
+        "\"................................................................\"\n"
+        "\"................................................................\"\n"
+        "\"................................................................\"\n"
+        "\"................................................................\"\n"
+        "drop drop drop drop }if cr\n"
+        "halt\n";
+    char * expected3 = "yes\n";
+    _score_compiled("test_cIfLong", code3, expected3, MK_ERR_OK);
+
+    /* cIfUnmatched: }for can't close an if{ */
+    u8 code4[] =
+        "1 if{ 2 }for\n"
+        "halt\n";
+    char * expected4 =
+        "CompileError:1:9: CtlSyntax\n"
+        "1 if{ 2 }f\n"
+        "         ^\n";
+    _score_compiled("test_cIfUnmatched", code4, expected4, MK_ERR_COMPILE);
+
+    /* cForUnclosed: for{ without }for */
+    u8 code5[] =
+        ": a 3 for{ 1 . ;\n"
+        "halt\n";
+    char * expected5 =
+        "CompileError:1:7: CtlSyntax\n"
+        ": a 3 fo\n"
+        "       ^\n";
+    _score_compiled("test_cForUnclosed", code5, expected5, MK_ERR_COMPILE);
+}
+
+/* Test compile-time evaluation with [ ... ], ]bytes, and immediate words */
+static void test_cCompileTimeEval(void) {
+    /* cEval: results of compile-time code get compiled as literals */
+    u8 code[] =
+        ": sq dup * ;\n"
+        ": answer 6 7 * ; immediate\n"
+        "[ 3 sq 4 sq + ] . answer . cr\n"
+        ": f [ 10 sq ] ; f . cr\n"
+        "halt\n";
+    char * expected = " 25 42\n 100\n";
+    _score_compiled("test_cEval", code, expected, MK_ERR_OK);
+
+    /* cEvalBytes: build a table at compile time, then read it at runtime */
+    u8 code2[] =
+        ": table 4 for{ r dup dup * swap 0x8000 + ! }for 0x8001 4 ;\n"
+        "[ table ]bytes dup ++ swap @ for{ dup @ . ++ }for drop cr\n"
+        "0x8001 @ . cr\n"
+        "halt\n";
+    char * expected2 = " 1 4 9 16\n 0\n";
+    _score_compiled("test_cEvalBytes", code2, expected2, MK_ERR_OK);
+
+    /* cEvalHog: compile-time code has a strict cycle budget */
+    u8 code3[] =
+        ": spin 1 drop spin ;\n"
+        "[ spin ]\n"
+        "halt\n";
+    char * expected3 =
+        "ERROR: Code was hogging CPU\n"
+        "CompileError:2:8: EvalError\n"
+        "[ spin ]\n"
+        "        ^\n";
+    _score_compiled("test_cEvalHog", code3, expected3, MK_ERR_COMPILE);
+
+    /* cEvalUnmatched: `[` without `]` */
+    u8 code4[] =
+        "1 [ 2 3 +\n"
+        "halt\n";
+    char * expected4 =
+        "CompileError:1:3: EvalSyntax\n"
+        "1 [ \n"
+        "   ^\n";
+    _score_compiled("test_cEvalUnmatched", code4, expected4, MK_ERR_COMPILE);
+}
+
+/* Test hot-reloading word definitions in a live session */
+static void test_cHotReload(void) {
+    u8 code[] =
+        ": speed 2 ;\n"
+        ": step speed . ;\n"
+        ": tick step step cr ;\n"
+        "\"init\" print cr\n";
+    u8 reload[] = ": speed 5 ;\n";
+    u8 bad_reload[] = ": speed 9 ; oops\n";
+    /* Top-level code runs once at init, then words can be called by name */
+    int err = mk_hot_init(code, sizeof(code));
+    err |= mk_hot_call((const u8 *)"tick", 4, 1000);
+    if(err == MK_ERR_OK && test_stdout_match("init\n 2 2\n")) {
+        score_pass("test_cHotInit");
+    } else {
+        score_fail("test_cHotInit");
+    }
+    test_stdout_reset();
+    /* Reloading speed should change what tick does, without a restart */
+    err = mk_hot_reload(reload, sizeof(reload));
+    err |= mk_hot_call((const u8 *)"tick", 4, 1000);
+    if(err == MK_ERR_OK && test_stdout_match(" 5 5\n")) {
+        score_pass("test_cHotReload");
+    } else {
+        score_fail("test_cHotReload");
+    }
+    test_stdout_reset();
+    /* A reload with a compile error should leave the old code running */
+    err = mk_hot_reload(bad_reload, sizeof(bad_reload));
+    test_stdout_reset();
+    if(err == MK_ERR_COMPILE
+        && MK_ERR_OK == mk_hot_call((const u8 *)"tick", 4, 1000)
+        && test_stdout_match(" 5 5\n")) {
+        score_pass("test_cHotReloadError");
+    } else {
+        score_fail("test_cHotReloadError");
+    }
+    test_stdout_reset();
+    /* Calls have a cycle budget, and unknown words are an error */
+    u8 spin[] = ": speed speed ;\n";
+    mk_hot_reload(spin, sizeof(spin));
+    err = mk_hot_call((const u8 *)"tick", 4, 1000);
+    test_stdout_reset();
+    if(err == MK_ERR_CPU_HOG
+        && mk_hot_call((const u8 *)"nope", 4, 1000) == MK_ERR_COMPILE) {
+        score_pass("test_cHotCall");
+    } else {
+        score_fail("test_cHotCall");
+    }
+    test_stdout_reset();
+}
+
+/* Read a little-endian u32 from a script's shared RAM */
+static u32 test_script_io(u32 slot, u32 offset) {
+    u8 * io = mk_script_io(slot);
+    return io[offset] | (io[offset + 1] << 8) | (io[offset + 2] << 16)
+        | ((u32)io[offset + 3] << 24);
+}
+
+/* Test resumable scripts with per-run cycle budgets */
+static void test_cScript(void) {
+    /* cScriptYield: halt yields, then the next run resumes after it */
+    u8 code[] =
+        ": tick 0xfc04 w@ ++ 0xfc04 w! halt tick ;\n"
+        "tick\n";
+    u32 i;
+    u32 cycles = 0;
+    int err = mk_script_compile(0, code, sizeof(code));
+    for(i = 0; i < 3; i++) {
+        cycles += mk_script_run(0, 1000);
+    }
+    if(err == MK_ERR_OK && test_script_io(0, 4) == 3 && cycles < 100
+        && mk_script_state(0) == MK_SCRIPT_READY) {
+        score_pass("test_cScriptYield");
+    } else {
+        score_fail("test_cScriptYield");
+    }
+    /* cScriptSuspend: running out of cycles suspends mid-loop, and later */
+    /* runs pick up where it left off until the code finishes             */
+    u8 code2[] =
+        "1000 for{ 1 drop }for 42 0xfc00 w!\n";
+    err = mk_script_compile(1, code2, sizeof(code2));
+    u32 first = mk_script_run(1, 500);
+    u32 suspended = mk_script_state(1) == MK_SCRIPT_READY
+        && test_script_io(1, 0) == 0;
+    for(i = 0; i < 100 && mk_script_state(1) == MK_SCRIPT_READY; i++) {
+        mk_script_run(1, 500);
+    }
+    if(err == MK_ERR_OK && first == 500 && suspended && i > 1
+        && mk_script_state(1) == MK_SCRIPT_DONE
+        && test_script_io(1, 0) == 42 && mk_script_run(1, 500) == 0) {
+        score_pass("test_cScriptSuspend");
+    } else {
+        score_fail("test_cScriptSuspend");
+    }
+    /* cScriptIO: the host can write shared RAM for scripts to read */
+    u8 code3[] =
+        ": echo 0xfc00 w@ 2 * 0xfc04 w! halt echo ;\n"
+        "echo\n";
+    err = mk_script_compile(2, code3, sizeof(code3));
+    mk_script_io(2)[0] = 21;
+    mk_script_run(2, 1000);
+    if(err == MK_ERR_OK && test_script_io(2, 4) == 42
+        && mk_script_io(MK_SCRIPT_MAX) == 0) {
+        score_pass("test_cScriptIO");
+    } else {
+        score_fail("test_cScriptIO");
+    }
+    /* cScriptError: a VM error stops the script for good */
+    u8 code4[] = "drop\n";
+    mk_script_compile(3, code4, sizeof(code4));
+    mk_script_run(3, 1000);
+    test_stdout_reset();
+    if(mk_script_state(3) == MK_SCRIPT_FAILED
+        && mk_script_err(3) == MK_ERR_D_UNDER
+        && mk_script_run(3, 1000) == 0
+        && mk_script_state(0) == MK_SCRIPT_READY) {
+        score_pass("test_cScriptError");
+    } else {
+        score_fail("test_cScriptError");
+    }
+    /* cScriptCompileError: bad source leaves the slot empty */
+    u8 code5[] = "oops\n";
+    err = mk_script_compile(3, code5, sizeof(code5));
+    test_stdout_reset();
+    if(err == MK_ERR_COMPILE && mk_script_state(3) == MK_SCRIPT_EMPTY
+        && mk_script_compile(MK_SCRIPT_MAX, code, sizeof(code))
+            == MK_ERR_BAD_ADDRESS) {
+        score_pass("test_cScriptCompileError");
+    } else {
+        score_fail("test_cScriptCompileError");
+    }
+    /* cScriptCache: runtime-only hosts load precompiled .mkbc images */
+    u8 code6[] = "7 0xfc00 w! halt 9 0xfc00 w!\n";
+    u8 cache[64];
+    u32 cache_len = 0;
+    err = mk_compile_to_cache(code6, sizeof(code6), cache, sizeof(cache),
+        &cache_len);
+    err |= mk_script_load_cache(4, cache, cache_len);
+    mk_script_run(4, 1000);
+    u32 yielded = test_script_io(4, 0) == 7
+        && mk_script_state(4) == MK_SCRIPT_READY;
+    mk_script_run(4, 1000);
+    cache[4] += 1;  /* Make the compiler version stale */
+    if(err == MK_ERR_OK && yielded && test_script_io(4, 0) == 9
+        && mk_script_state(4) == MK_SCRIPT_DONE
+        && mk_script_load_cache(4, cache, cache_len) == MK_ERR_CACHE) {
+        score_pass("test_cScriptCache");
+    } else {
+        score_fail("test_cScriptCache");
+    }
+}
 
 /* ========================================================================= */
 /* === main() ============================================================== */
@@ -2536,7 +3021,10 @@ int main() {
 
     /* Branch, Jump, Call, Return */
     test_BZ();
+    test_BZL();
     test_BNZ();
+    test_BFOR();
+    test_BFORL();
     test_JMP();
     test_JAL();
     test_RET();
@@ -2624,6 +3112,13 @@ int main() {
     test_cCharLit();
     test_cSharpComment();
     test_cParenComment();
+    test_cCache();
+    test_cColonDefs();
+    test_cLink();
+    test_cControlFlow();
+    test_cCompileTimeEval();
+    test_cHotReload();
+    test_cScript();
 
     /* If any tests failed, print the failed test log */
     if(TEST_SCORE_FAIL > 0) {
@@ -2,6 +2,10 @@
  * SPDX-License-Identifier: MIT
  *
  * Note: __attribute__((visibility("default"))) tells LLVM to export a symbol.
+ *
+ * The wasm build defines MK_NO_COMPILER, so this module only has the VM. To
+ * run scripts, compile them to .mkbc images ahead of time, or on demand with
+ * the separate compiler module (see mkb_comp_wasm.c), then use scriptLoad().
  */
 
 #include <stdint.h>
@@ -19,6 +23,22 @@
 __attribute__((visibility("default")))
 u32 GAMEPAD;
 
+/* Buffer for js to write a .mkbc image into before calling scriptLoad() */
+__attribute__((visibility("default")))
+u8 SCRIPT_BUF[MK_CACHE_MAX_LEN];
+
+/* VM cycles used by each script slot during the most recent frame */
+__attribute__((visibility("default")))
+u32 SCRIPT_SLOT_CYCLES[MK_SCRIPT_MAX];
+
+/* Total VM cycles used by all scripts during the most recent frame */
+__attribute__((visibility("default")))
+u32 SCRIPT_CYCLES;
+
+/* Microseconds spent running scripts during the most recent frame */
+__attribute__((visibility("default")))
+u32 SCRIPT_TIME_US;
+
 
 /******************************************************/
 /* Imported Symobols (to be linked by js wasm loader) */
@@ -35,6 +55,10 @@ extern void setPlayerTile(u32 tile);
 
 extern void drawLines();
 
+/* Returns: a monotonic clock in microseconds, for timing scripts. It can */
+/* wrap, so only differences between readings mean anything.             */
+extern u32 js_clock_us(void);
+
 
 /**************************/
 /* Non-exported Constants */
@@ -63,6 +87,24 @@ extern void drawLines();
 #define GP_R      (128)
 #define GP_DPAD   (GP_U|GP_D|GP_L|GP_R)
 
+/* Most VM cycles that all scripts together can use in one frame. Each slot
+ * gets an equal share, so no matter what scripts do, they can't take more
+ * than this. At a few ns per cycle, this is a small slice of a 16 ms frame.
+ */
+#define SCRIPT_FRAME_CYCLES (200000)
+#define SCRIPT_SLICE_CYCLES (SCRIPT_FRAME_CYCLES / MK_SCRIPT_MAX)
+
+/* Layout of the shared RAM that scripts use to talk to the engine. Values
+ * are little-endian u32 words starting at MK_SCRIPT_IO (0xfc00), so script
+ * code can access them with `w@` and `w!`. The engine writes all of them
+ * before running a script. Afterwards, it reads back the player position.
+ */
+#define IO_FRAME    (0   /* Frame counter (read only)                */)
+#define IO_ELAPSED  (4   /* ms since the previous frame (read only)  */)
+#define IO_GAMEPAD  (8   /* Gamepad button bitfield (read only)      */)
+#define IO_PLAYER_X (12  /* Player tile x coordinate (read/write)    */)
+#define IO_PLAYER_Y (16  /* Player tile y coordinate (read/write)    */)
+
 
 /*********************************/
 /* Non-exported Global Variables */
@@ -81,6 +123,9 @@ static u32 DPAD_MS = 0;
 /* Debounce flag for dpad buttons */
 static u32 DPAD_DEBOUNCED = 0;
 
+/* Number of frames so far, for scripts to use as a clock */
+static u32 FRAME_COUNT = 0;
+
 /* Types of motion that can be triggered by dpad buttons */
 typedef enum e_DpMove {
     DpWait = 0,
@@ -184,6 +229,57 @@ static void updatePlayerTile() {
     setPlayerTile(tile);
 }
 
+/* Write u32 n to shared script RAM io at offset, little-endian */
+static void scriptIoPut(u8 * io, u32 offset, u32 n) {
+    io[offset    ] = (u8)  n;
+    io[offset + 1] = (u8) (n >>  8);
+    io[offset + 2] = (u8) (n >> 16);
+    io[offset + 3] = (u8) (n >> 24);
+}
+
+/* Read u32 from shared script RAM io at offset, little-endian */
+static u32 scriptIoGet(u8 * io, u32 offset) {
+    return io[offset]
+        | (io[offset + 1] <<  8)
+        | (io[offset + 2] << 16)
+        | ((u32)io[offset + 3] << 24);
+}
+
+/* Give each loaded script its share of the frame's cycle budget. Scripts */
+/* that run out of cycles get suspended until the next frame.             */
+/* Returns 1 when a script moved the player, otherwise 0.                 */
+static u32 runScripts(u32 elapsed_ms) {
+    u32 moved = 0;
+    u32 slot;
+    SCRIPT_CYCLES = 0;
+    for(slot = 0; slot < MK_SCRIPT_MAX; slot++) {
+        SCRIPT_SLOT_CYCLES[slot] = 0;
+        if(mk_script_state(slot) != MK_SCRIPT_READY) {
+            continue;
+        }
+        u8 * io = mk_script_io(slot);
+        scriptIoPut(io, IO_FRAME, FRAME_COUNT);
+        scriptIoPut(io, IO_ELAPSED, elapsed_ms);
+        scriptIoPut(io, IO_GAMEPAD, GAMEPAD);
+        scriptIoPut(io, IO_PLAYER_X, PLAYER_X);
+        scriptIoPut(io, IO_PLAYER_Y, PLAYER_Y);
+        const u32 cycles = mk_script_run(slot, SCRIPT_SLICE_CYCLES);
+        SCRIPT_SLOT_CYCLES[slot] = cycles;
+        SCRIPT_CYCLES += cycles;
+        /* Ignore positions that are off the map */
+        const u32 x = scriptIoGet(io, IO_PLAYER_X);
+        const u32 y = scriptIoGet(io, IO_PLAYER_Y);
+        if(x < TILES_WIDE && y < TILES_HIGH
+            && (x != PLAYER_X || y != PLAYER_Y)) {
+            PLAYER_X = x;
+            PLAYER_Y = y;
+            moved = 1;
+        }
+    }
+    FRAME_COUNT += 1;
+    return moved;
+}
+
 
 /*******************************/
 /* Exported Symbols: Functions */
@@ -198,6 +294,14 @@ i32 init(void) {
     return 0;
 }
 
+/* Load a .mkbc image of len bytes from SCRIPT_BUF into script slot. The */
+/* script starts running on the next frame. Returns: VM error code.      */
+__attribute__((visibility("default")))
+i32 scriptLoad(u32 slot, u32 len) {
+    len = len < sizeof(SCRIPT_BUF) ? len : sizeof(SCRIPT_BUF);
+    return mk_script_load_cache(slot, SCRIPT_BUF, len);
+}
+
 /* Prepare the next frame */
 /* elapsed_ms: number of milliseconds since previous frame */
 __attribute__((visibility("default")))
@@ -228,6 +332,10 @@ void next(u32 elapsed_ms) {
         if(buttons & GP_L) { moved += dpadLeft();  }
         if(buttons & GP_R) { moved += dpadRight(); }
     }
+    /* Run scripts after the dpad, so they can override its movement */
+    const u32 start = js_clock_us();
+    moved += runScripts(elapsed_ms);
+    SCRIPT_TIME_US = js_clock_us() - start;
     /* Redraw if needed */
     if(moved || diff) {
         updatePlayerTile();
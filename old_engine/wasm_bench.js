@@ -0,0 +1,141 @@
+/* Copyright (c) 2023 Sam Blenny */
+/* SPDX-License-Identifier: MIT  */
+/*
+ * Benchmark the wasm modules using node.
+ *
+ * For each module in www/ that exists, this reports its size and how long it
+ * takes to compile and instantiate. The compiler module then compiles some
+ * test scripts, and for each engine build, this measures scriptLoad() (which
+ * clears a 64 KB VM RAM image) and next() with all script slots loaded. Half
+ * the scripts yield every frame, and half spin for their whole cycle budget,
+ * so next() shows the worst case.
+ *
+ * Usage: make wasm && node wasm_bench.js [frames]
+ */
+"use strict";
+
+const fs = require("fs");
+const path = require("path");
+
+const ENGINES = ["markab-engine.wasm", "markab-engine-simd.wasm"];
+const COMPILER = "markab-compiler.wasm";
+const FRAMES = Number(process.argv[2]) > 0 ? Number(process.argv[2]) : 2000;
+const LOADS = 200;
+const SLOTS = 8;  /* MK_SCRIPT_MAX */
+
+const YIELD_SRC = ": tick 0xfc0c w@ drop halt tick ;\ntick\n";
+const SPIN_SRC = ": spin 0xfc00 w@ drop spin ;\nspin\n";
+
+/* Stub out the js functions that the modules import */
+const IMPORTS = {
+    env: {
+        js_trace: (code) => {},
+        repaint: () => {},
+        drawLines: () => {},
+        setPlayerTile: (n) => {},
+        drawTiles: () => {},
+        mk_host_log_error: (code) => {},
+        mk_host_stdout_write: (buf, length) => {},
+        mk_host_stdout_fmt_int: (n) => {},
+        mk_host_putchar: (c) => {},
+        js_clock_us: () => Number(process.hrtime.bigint() / 1000n) >>> 0,
+    },
+};
+
+/* Time a function in ms */
+function time(f) {
+    const start = process.hrtime.bigint();
+    f();
+    return Number(process.hrtime.bigint() - start) / 1e6;
+}
+
+/* Load and instantiate a module from www/, reporting size and time */
+/* Returns: the module's exports, or null if it couldn't be loaded  */
+async function load(name) {
+    const file = path.join(__dirname, "www", name);
+    if(!fs.existsSync(file)) {
+        console.log(`${name}: not found (run make wasm)`);
+        return null;
+    }
+    const bytes = fs.readFileSync(file);
+    let result;
+    const start = process.hrtime.bigint();
+    try {
+        result = await WebAssembly.instantiate(bytes, IMPORTS);
+    } catch(e) {
+        console.log(`${name}: ${e.message}`);
+        return null;
+    }
+    const ms = Number(process.hrtime.bigint() - start) / 1e6;
+    console.log(`${name}:`);
+    console.log(`  size:           ${bytes.length} bytes`);
+    console.log(`  instantiate:    ${ms.toFixed(3)} ms`);
+    return result.instance.exports;
+}
+
+/* Compile script source to a .mkbc image with the compiler module */
+function compile(comp, src) {
+    const text = new TextEncoder().encode(src);
+    new Uint8Array(comp.memory.buffer, comp.COMP_SRC.value, text.length)
+        .set(text);
+    const len = comp.compile(text.length);
+    return new Uint8Array(comp.memory.buffer, comp.COMP_OUT.value, len)
+        .slice();
+}
+
+/* Copy a .mkbc image into the engine's SCRIPT_BUF, then load it */
+function loadScript(exp, slot, image) {
+    const addr = exp.SCRIPT_BUF.value;
+    new Uint8Array(exp.memory.buffer, addr, image.length).set(image);
+    return exp.scriptLoad(slot, image.length);
+}
+
+async function bench(name, yieldImage, spinImage) {
+    const exp = await load(name);
+    if(exp === null) {
+        return;
+    }
+    if(!exp.scriptLoad) {
+        console.log("  no scriptLoad() export (stale build?)");
+        return;
+    }
+    exp.init();
+    const loads = time(() => {
+        for(let i = 0; i < LOADS; i++) {
+            loadScript(exp, 0, yieldImage);
+        }
+    });
+    for(let slot = 0; slot < SLOTS; slot++) {
+        loadScript(exp, slot, slot & 1 ? spinImage : yieldImage);
+    }
+    let cycles = 0;
+    let script_us = 0;
+    const frames = time(() => {
+        for(let i = 0; i < FRAMES; i++) {
+            exp.next(16 + (i & 1));
+            cycles += new Uint32Array(exp.memory.buffer,
+                exp.SCRIPT_CYCLES.value, 1)[0];
+            script_us += new Uint32Array(exp.memory.buffer,
+                exp.SCRIPT_TIME_US.value, 1)[0];
+        }
+    });
+    const per_load = loads * 1e3 / LOADS;
+    const per_frame = frames * 1e3 / FRAMES;
+    console.log(`  scriptLoad:     ${per_load.toFixed(2)} us`);
+    console.log(`  next():         ${per_frame.toFixed(2)} us` +
+        ` (${Math.round(cycles / FRAMES)} script cycles per frame)`);
+    console.log(`  scripts:        ${(script_us / FRAMES).toFixed(2)} us` +
+        ` per frame (SCRIPT_TIME_US)`);
+}
+
+(async () => {
+    const comp = await load(COMPILER);
+    if(comp === null) {
+        return;
+    }
+    const yieldImage = compile(comp, YIELD_SRC);
+    const spinImage = compile(comp, SPIN_SRC);
+    for(const name of ENGINES) {
+        await bench(name, yieldImage, spinImage);
+    }
+})();
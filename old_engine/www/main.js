@@ -21,8 +21,11 @@ if(gl === null) {
 const GLD = {};  /* Dictionary to hold gl state objects during init chain */
 
 /* WASM module stuff, including shared memory regions */
-const wasmModule = "markab-engine.wasm";
+const wasmModule = wasmPickModule();
+const compilerModule = "markab-compiler.wasm";
+const COMP_SRC_MAX = 16384;  /* Must match COMP_SRC_MAX in mkb_comp_wasm.c */
 var WASM_EXPORT;   /* Wrapper object for symbols exported by wasm module */
+var COMPILER;      /* Exports of compiler module, once it's been loaded */
 var GAMEPAD;       /* Wrapper object for shared gampad memory region */
 
 /* Animation Control */
@@ -232,11 +235,103 @@ function repaint() {
     // CTX.putImageData(FRAME_BUFFER, 0, 0);
 }
 
+/* Buffer script stdout, logging it to the console a line at a time */
+var MKB_STDOUT = "";
+function mkHostStdout(text) {
+    MKB_STDOUT += text;
+    const lines = MKB_STDOUT.split("\n");
+    MKB_STDOUT = lines.pop();
+    for(const line of lines) {
+        console.log(line);
+    }
+}
+
+/* Markab VM host functions for a wasm module to import. The module's */
+/* memory doesn't exist until it's instantiated, so memory() gets it.  */
+function mkHostImports(memory) {
+    return {
+        mk_host_log_error: (code) => {console.error("mkb error:", code);},
+        mk_host_stdout_write: (buf, length) => {
+            const bytes = new Uint8Array(memory().buffer, buf, length);
+            mkHostStdout(new TextDecoder().decode(bytes));
+        },
+        mk_host_stdout_fmt_int: (n) => {mkHostStdout(`${n}`);},
+        mk_host_putchar: (c) => {mkHostStdout(String.fromCharCode(c));},
+    };
+}
+
+/* Compile Markab Script source, then load it into an engine script slot.
+ * The compiler is a separate wasm module, so the engine can start without
+ * it. It gets loaded the first time this is called. For live coding, call
+ * this from the browser's dev console like:
+ *   compileScript(0, ": t 0xfc0c w@ ++ 0xfc0c w! halt t ;  t")
+ * Returns: promise that resolves to true if the script got loaded
+ */
+async function compileScript(slot, src) {
+    if(!COMPILER) {
+        const imports = {env: mkHostImports(() => COMPILER.memory)};
+        const bytes = await (await fetch(compilerModule)).arrayBuffer();
+        const start = performance.now();
+        const result = await WebAssembly.instantiate(bytes, imports);
+        COMPILER = result.instance.exports;
+        const ms = (performance.now() - start).toFixed(1);
+        console.log(`compiler: ${bytes.byteLength} bytes, ${ms} ms`);
+    }
+    /* The lexer only sees a word once there's whitespace after it, so end */
+    /* the source with a newline, or a last word like `t` would get lost  */
+    const text = new TextEncoder().encode(src + "\n");
+    if(text.length > COMP_SRC_MAX) {
+        console.error("compileScript: source is too long");
+        return false;
+    }
+    const srcAddr = COMPILER.COMP_SRC.value | COMPILER.COMP_SRC;
+    new Uint8Array(COMPILER.memory.buffer, srcAddr, text.length).set(text);
+    const len = COMPILER.compile(text.length);
+    if(len === 0) {
+        return false;
+    }
+    const outAddr = COMPILER.COMP_OUT.value | COMPILER.COMP_OUT;
+    const image = new Uint8Array(COMPILER.memory.buffer, outAddr, len);
+    const bufAddr = WASM_EXPORT.SCRIPT_BUF.value | WASM_EXPORT.SCRIPT_BUF;
+    new Uint8Array(WASM_EXPORT.memory.buffer, bufAddr, len).set(image);
+    return WASM_EXPORT.scriptLoad(slot, len) === 0;
+}
+
+/* Read how much the scripts cost during the most recent frame, as VM */
+/* cycles and as microseconds. Call this from the browser's dev console. */
+function scriptStats() {
+    const buf = WASM_EXPORT.memory.buffer;
+    const c = WASM_EXPORT.SCRIPT_CYCLES.value | WASM_EXPORT.SCRIPT_CYCLES;
+    const t = WASM_EXPORT.SCRIPT_TIME_US.value | WASM_EXPORT.SCRIPT_TIME_US;
+    return {
+        cycles: new Uint32Array(buf, c, 1)[0],
+        us: new Uint32Array(buf, t, 1)[0],
+    };
+}
+
 
 /*****************************/
 /* WASM Module Load and Init */
 /*****************************/
 
+/* Pick the SIMD + bulk memory build if this browser supports both, or */
+/* else fall back to the MVP build. These tiny modules each use one of  */
+/* the features, so they only validate if the feature is supported.    */
+function wasmPickModule() {
+    const simd = new Uint8Array([
+        0, 97, 115, 109, 1, 0, 0, 0, 1, 5, 1, 96, 0, 1, 123, 3, 2, 1, 0, 10,
+        10, 1, 8, 0, 65, 0, 253, 15, 253, 98, 11,
+    ]);
+    const bulkMemory = new Uint8Array([
+        0, 97, 115, 109, 1, 0, 0, 0, 1, 4, 1, 96, 0, 0, 3, 2, 1, 0, 5, 3, 1,
+        0, 1, 10, 14, 1, 12, 0, 65, 0, 65, 0, 65, 0, 252, 10, 0, 0, 11,
+    ]);
+    if(WebAssembly.validate(simd) && WebAssembly.validate(bulkMemory)) {
+        return "markab-engine-simd.wasm";
+    }
+    return "markab-engine.wasm";
+}
+
 // Load WASM module, bind shared memory, then invoke callback.
 function wasmloadModule(callback) {
     var importObject = {
@@ -246,6 +341,9 @@ function wasmloadModule(callback) {
             drawLines: drawLines,
             setPlayerTile: setPlayerTile,
             drawTiles: drawTiles,
+            /* Wraps around every 71 minutes, which is fine for timing */
+            js_clock_us: () => Math.floor(performance.now() * 1000) >>> 0,
+            ...mkHostImports(() => WASM_EXPORT.memory),
         },
     };
     if ("instantiateStreaming" in WebAssembly) {